@@ -1,5 +1,7 @@
 #include <libsystem/Assert.h>
 #include <libsystem/Logger.h>
+#include <libsystem/core/Plugs.h>
+#include <libsystem/eventloop/EventLoop.h>
 #include <libsystem/system/Memory.h>
 #include <libsystem/utils/Hexdump.h>
 
@@ -12,7 +14,48 @@
 
 static List *_connected_client = nullptr;
 
-void client_handle_create_window(Client *client, CompositorCreateWindow create_window)
+// Shared memory attached to a message is already mapped, the bitmap takes it over.
+static ResultOr<RefPtr<Bitmap>> client_attached_bitmap(Message *message, ProtocolAttachment field, Vec2i size)
+{
+    MessageAttachment *attachment = protocol_attachment(message, field);
+
+    if (!attachment ||
+        attachment->type != MESSAGE_ATTACHMENT_MEMORY ||
+        attachment->id == HANDLE_INVALID_ID)
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    attachment->type = MESSAGE_ATTACHMENT_NONE;
+
+    return Bitmap::create_shared_from_memory(attachment->id, attachment->address, attachment->size, size);
+}
+
+// Give back whatever came with a message and wasn't used.
+static void client_release_attachments(Message *message)
+{
+    for (size_t i = 0; i < message->attachments_count; i++)
+    {
+        MessageAttachment &attachment = message->attachments[i];
+
+        if (attachment.id == HANDLE_INVALID_ID)
+        {
+            continue;
+        }
+
+        if (attachment.type == MESSAGE_ATTACHMENT_MEMORY)
+        {
+            memory_free(attachment.address);
+        }
+        else if (attachment.type == MESSAGE_ATTACHMENT_HANDLE)
+        {
+            Handle handle = {attachment.id, 0, SUCCESS};
+            __plug_handle_close(&handle);
+        }
+    }
+}
+
+void client_handle_create_window(Client *client, const protocol::Compositor::CreateWindow &create_window, Message *message)
 {
     if (manager_get_window(client, create_window.id))
     {
@@ -20,17 +63,19 @@ void client_handle_create_window(Client *client, CompositorCreateWindow create_w
         return;
     }
 
-    auto frontbuffer = Bitmap::create_shared_from_handle(create_window.frontbuffer, create_window.backbuffer_size);
+    auto frontbuffer = client_attached_bitmap(message, create_window.frontbuffer, create_window.frontbuffer_size);
 
     if (!frontbuffer.success())
     {
+        logger_warn("The client sent us a bad frontbuffer.");
         return;
     }
 
-    auto backbuffer = Bitmap::create_shared_from_handle(create_window.backbuffer, create_window.backbuffer_size);
+    auto backbuffer = client_attached_bitmap(message, create_window.backbuffer, create_window.backbuffer_size);
 
     if (!backbuffer.success())
     {
+        logger_warn("The client sent us a bad backbuffer.");
         return;
     }
 
@@ -43,7 +88,7 @@ void client_handle_create_window(Client *client, CompositorCreateWindow create_w
                backbuffer.take_value());
 }
 
-void client_handle_destroy_window(Client *client, CompositorDestroyWindow destroy_window)
+void client_handle_destroy_window(Client *client, const protocol::Compositor::DestroyWindow &destroy_window)
 {
     Window *window = manager_get_window(client, destroy_window.id);
 
@@ -56,7 +101,7 @@ void client_handle_destroy_window(Client *client, CompositorDestroyWindow destro
     delete window;
 }
 
-void client_handle_resize_window(Client *client, CompositorResizeWindow resize_window)
+void client_handle_resize_window(Client *client, const protocol::Compositor::ResizeWindow &resize_window)
 {
     Window *window = manager_get_window(client, resize_window.id);
 
@@ -69,7 +114,7 @@ void client_handle_resize_window(Client *client, CompositorResizeWindow resize_w
     window->resize(resize_window.bound);
 }
 
-void client_handle_move_window(Client *client, CompositorMoveWindow move_window)
+void client_handle_move_window(Client *client, const protocol::Compositor::MoveWindow &move_window)
 {
     Window *window = manager_get_window(client, move_window.id);
 
@@ -82,7 +127,7 @@ void client_handle_move_window(Client *client, CompositorMoveWindow move_window)
     window->move(move_window.position);
 }
 
-void client_handle_flip_window(Client *client, CompositorFlipWindow flip_window)
+void client_handle_flip_window(Client *client, const protocol::Compositor::FlipWindow &flip_window)
 {
     Window *window = manager_get_window(client, flip_window.id);
 
@@ -94,12 +139,10 @@ void client_handle_flip_window(Client *client, CompositorFlipWindow flip_window)
 
     window->flip_buffers(flip_window.frontbuffer, flip_window.frontbuffer_size, flip_window.backbuffer, flip_window.backbuffer_size, flip_window.bound);
 
-    CompositorMessage message = {};
-    message.type = COMPOSITOR_MESSAGE_ACK;
-    client_send_message(client, message);
+    protocol::Application::ack(client_outbox(client));
 }
 
-void client_handle_cursor_window(Client *client, CompositorCursorWindow cursor_window)
+void client_handle_cursor_window(Client *client, const protocol::Compositor::CursorWindow &cursor_window)
 {
     Window *window = manager_get_window(client, cursor_window.id);
 
@@ -116,26 +159,21 @@ void client_handle_cursor_window(Client *client, CompositorCursorWindow cursor_w
     renderer_region_dirty(cursor_dirty_bound());
 }
 
-void client_handle_set_resolution(Client *client, CompositorSetResolution set_resolution)
+void client_handle_set_resolution(Client *client, const protocol::Compositor::SetResolution &set_resolution)
 {
     __unused(client);
 
     if (renderer_set_resolution(set_resolution.width, set_resolution.height))
     {
-        client_broadcast((CompositorMessage){
-            .type = COMPOSITOR_MESSAGE_CHANGED_RESOLUTION,
-            .changed_resolution = {
-                .resolution = renderer_bound(),
-            },
-        });
+        client_broadcast_changed_resolution();
     }
 }
 
-void client_handle_set_wallpaper(Client *client, CompositorSetWallaper set_wallpaper)
+void client_handle_set_wallpaper(Client *client, const protocol::Compositor::SetWallpaper &set_wallpaper, Message *message)
 {
     __unused(client);
 
-    auto wallaper = Bitmap::create_shared_from_handle(set_wallpaper.wallpaper, set_wallpaper.resolution);
+    auto wallaper = client_attached_bitmap(message, set_wallpaper.wallpaper, set_wallpaper.resolution);
 
     if (wallaper.success())
     {
@@ -147,75 +185,126 @@ void client_handle_set_wallpaper(Client *client, CompositorSetWallaper set_wallp
     }
 }
 
+struct ClientRequests
+{
+    Client *client;
+
+    void handle(const protocol::Compositor::CreateWindow &create_window, Message *message)
+    {
+        client_handle_create_window(client, create_window, message);
+    }
+
+    void handle(const protocol::Compositor::DestroyWindow &destroy_window, Message *)
+    {
+        client_handle_destroy_window(client, destroy_window);
+    }
+
+    void handle(const protocol::Compositor::ResizeWindow &resize_window, Message *)
+    {
+        client_handle_resize_window(client, resize_window);
+    }
+
+    void handle(const protocol::Compositor::MoveWindow &move_window, Message *)
+    {
+        client_handle_move_window(client, move_window);
+    }
+
+    void handle(const protocol::Compositor::FlipWindow &flip_window, Message *)
+    {
+        client_handle_flip_window(client, flip_window);
+    }
+
+    void handle(const protocol::Compositor::CursorWindow &cursor_window, Message *)
+    {
+        client_handle_cursor_window(client, cursor_window);
+    }
+
+    void handle(const protocol::Compositor::SetResolution &set_resolution, Message *)
+    {
+        client_handle_set_resolution(client, set_resolution);
+    }
+
+    void handle(const protocol::Compositor::SetWallpaper &set_wallpaper, Message *message)
+    {
+        client_handle_set_wallpaper(client, set_wallpaper, message);
+    }
+};
+
 void client_request_callback(Client *client, Connection *connection, SelectEvent events)
 {
     assert(events & SELECT_READ);
 
-    CompositorMessage message = {};
-    size_t message_size = connection_receive(connection, &message, sizeof(CompositorMessage));
+    char buffer[MESSAGE_SIZE_MAX];
+
+    Message received = {};
+    received.buffer = buffer;
+    received.size = MESSAGE_SIZE_MAX;
+
+    connection_receive_message(connection, &received);
 
     if (handle_has_error(connection))
     {
         logger_error("Client handle has error: %s!", handle_error_string(connection));
 
+        client_release_attachments(&received);
         client->disconnected = true;
         client_destroy_disconnected();
         return;
     }
 
-    if (message_size != sizeof(CompositorMessage))
+    ClientRequests requests = {client};
+
+    if (!protocol::Compositor::dispatch(requests, &received))
     {
-        logger_error("Got a message with an invalid size from client %u != %u!", sizeof(CompositorMessage), message_size);
-        hexdump(&message, message_size);
+        logger_error("Got an invalid message from client %08x!", client);
+        hexdump(buffer, received.size);
 
+        client_release_attachments(&received);
         client->disconnected = true;
         client_destroy_disconnected();
-
         return;
     }
 
-    switch (message.type)
-    {
-    case COMPOSITOR_MESSAGE_CREATE_WINDOW:
-        client_handle_create_window(client, message.create_window);
-        break;
-
-    case COMPOSITOR_MESSAGE_DESTROY_WINDOW:
-        client_handle_destroy_window(client, message.destroy_window);
-        break;
+    client_release_attachments(&received);
+}
 
-    case COMPOSITOR_MESSAGE_RESIZE_WINDOW:
-        client_handle_resize_window(client, message.resize_window);
-        break;
-    case COMPOSITOR_MESSAGE_MOVE_WINDOW:
-        client_handle_move_window(client, message.move_window);
+static void client_did_flush(Client *client, Handle *handle, Result result)
+{
+    __unused(handle);
 
-        break;
-    case COMPOSITOR_MESSAGE_FLIP_WINDOW:
-        client_handle_flip_window(client, message.flip_window);
-        break;
+    client->outbox_writing--;
 
-    case COMPOSITOR_MESSAGE_CURSOR_WINDOW:
-        client_handle_cursor_window(client, message.cursor_window);
-        break;
+    if (result != SUCCESS)
+    {
+        logger_error("Failed to send message to %08x: %s", client, result_to_string(result));
+        client->disconnected = true;
+    }
+}
 
-    case COMPOSITOR_MESSAGE_SET_RESOLUTION:
-        client_handle_set_resolution(client, message.set_resolution);
-        break;
+// Sent along with the next select of the event loop, as a single message
+// of the connection.
+static void client_did_flush_outbox(Client *client, ProtocolBatch *batch)
+{
+    assert(batch->message.attachments_count == 0);
 
-    case COMPOSITOR_MESSAGE_SET_WALLPAPER:
-        client_handle_set_wallpaper(client, message.set_wallaper);
-        break;
+    if (client->disconnected)
+    {
+        return;
+    }
 
-    default:
-        logger_error("Invalid message for client %08x", client);
-        hexdump(&message, message_size);
+    client->outbox_writing++;
 
-        client->disconnected = true;
-        client_destroy_disconnected();
+    eventloop_queue_write(
+        HANDLE(client->connection),
+        batch->buffer,
+        batch->message.size,
+        client,
+        (EventLoopWriteCallback)client_did_flush);
+}
 
-        break;
-    }
+static void client_flush(Client *client)
+{
+    protocol_batch_flush(&client->outbox);
 }
 
 Client *client_create(Connection *connection)
@@ -234,16 +323,31 @@ Client *client_create(Connection *connection)
         SELECT_READ,
         (NotifierCallback)client_request_callback);
 
+    client->events = channel_create(sizeof(protocol::Application::EventWindow), CLIENT_EVENTS_COUNT);
+    protocol_batch_initialize(&client->outbox, client, (ProtocolFlushCallback)client_did_flush_outbox);
+
     list_pushback(_connected_client, client);
 
     logger_info("Client %08x connected", client);
 
-    client_send_message(client, (CompositorMessage){
-                                    .type = COMPOSITOR_MESSAGE_GREETINGS,
-                                    .greetings = {
-                                        .screen_bound = renderer_bound(),
-                                    },
-                                });
+    // The events channel comes along, without it they go through the
+    // connection. Attachments can't wait for the event loop, so this one
+    // goes right away.
+    ProtocolBatch greetings;
+    protocol_batch_initialize(&greetings, connection, (ProtocolFlushCallback)protocol_batch_send);
+
+    protocol::Application::greetings(
+        &greetings,
+        renderer_bound(),
+        client->events ? client->events->memory : HANDLE_INVALID_ID,
+        client->events ? channel_doorbell(client->events)->id : HANDLE_INVALID_ID);
+
+    protocol_batch_flush(&greetings);
+
+    if (handle_has_error(connection))
+    {
+        client->disconnected = true;
+    }
 
     return client;
 }
@@ -269,35 +373,98 @@ void client_destroy(Client *client)
 
     client_close_all_windows(client);
     list_remove(_connected_client, client);
+    event_cancel_run_later_for(client);
+    eventloop_cancel_write_for(client);
     notifier_destroy(client->notifier);
     connection_close(client->connection);
+
+    if (client->events)
+    {
+        channel_destroy(client->events);
+    }
+
     free(client);
 }
 
-void client_broadcast(CompositorMessage message)
+void client_broadcast_changed_resolution()
 {
     list_foreach(Client, client, _connected_client)
     {
-        client_send_message(client, message);
+        protocol::Application::changed_resolution(client_outbox(client), renderer_bound());
+    }
+}
+
+ProtocolBatch *client_outbox(Client *client)
+{
+    if (protocol_batch_empty(&client->outbox))
+    {
+        eventloop_run_later((RunLaterCallback)client_flush, client);
     }
+
+    return &client->outbox;
 }
 
-Result client_send_message(Client *client, CompositorMessage message)
+// Only where the mouse ended up matters, as long as nothing else happened in between.
+static bool client_coalesce_event(protocol::Application::EventWindow *waiting, const protocol::Application::EventWindow *event_window)
+{
+    const Event &waiting_event = waiting->event;
+    const Event &event = event_window->event;
+
+    if (waiting->after != event_window->after ||
+        waiting->id != event_window->id ||
+        waiting_event.type != Event::MOUSE_MOVE ||
+        event.type != Event::MOUSE_MOVE ||
+        waiting_event.mouse.buttons != event.mouse.buttons)
+    {
+        return false;
+    }
+
+    waiting->event.mouse.position = event.mouse.position;
+    waiting->sequence = event_window->sequence;
+
+    return true;
+}
+
+Result client_send_event(Client *client, int window, Event event)
 {
     if (client->disconnected)
     {
         return ERR_STREAM_CLOSED;
     }
 
-    connection_send(client->connection, &message, sizeof(CompositorMessage));
+    uint32_t sequence = ++client->events_sequence;
 
-    if (handle_has_error(client->connection))
+    // Those which went through the connection are in the kernel by now, the
+    // client will get to them before the next ones from the channel.
+    if (client->events_diverted &&
+        protocol_batch_empty(&client->outbox) &&
+        client->outbox_writing == 0)
     {
-        logger_error("Failed to send message to %08x: %s", client, handle_error_string(client->connection));
-        client->disconnected = true;
-        return handle_get_error(client->connection);
+        client->events_diverted = false;
     }
 
+    if (client->events && !client->events_diverted)
+    {
+        protocol::Application::EventWindow event_window = {};
+        event_window.id = window;
+        event_window.event = event;
+        event_window.sequence = sequence;
+        event_window.after = client->events_last_diverted;
+
+        if (channel_push(client->events, &event_window, (ChannelCoalesceCallback)client_coalesce_event))
+        {
+            client->events_last_queued = sequence;
+            return SUCCESS;
+        }
+
+        // When the client is that far behind, the connection still takes
+        // them rather than losing any.
+        client->events_diverted = true;
+    }
+
+    protocol::Application::event_window(client_outbox(client), window, event, sequence, client->events_last_queued);
+    client->events_last_diverted = sequence;
+
     return SUCCESS;
 }
 
@@ -1,23 +1,45 @@
 #pragma once
 
+#include <libsystem/eventloop/Channel.h>
 #include <libsystem/eventloop/Notifier.h>
 #include <libsystem/io/Connection.h>
 
-#include "compositor/Protocol.h"
+#include "protocols/compositor.h"
+
+#define CLIENT_EVENTS_COUNT 256
 
 struct Client
 {
     Notifier *notifier;
     Connection *connection;
     bool disconnected;
+
+    // Window events go through memory shared with the client, so they don't
+    // cost a system call each.
+    Channel *events;
+
+    // Once the channel was full, events go through the connection until
+    // they are all written. Each one says which was the last to go the
+    // other way, so the client can put them back in order.
+    bool events_diverted;
+    uint32_t events_sequence;
+    uint32_t events_last_queued;
+    uint32_t events_last_diverted;
+
+    // Messages go out together, with the next select of the event loop.
+    ProtocolBatch outbox;
+    int outbox_writing;
 };
 
 Client *client_create(Connection *connection);
 
 void client_destroy(Client *client);
 
-void client_broadcast(CompositorMessage message);
+// Where to encode messages for the client.
+ProtocolBatch *client_outbox(Client *client);
+
+void client_broadcast_changed_resolution();
 
-Result client_send_message(Client *client, CompositorMessage message);
+Result client_send_event(Client *client, int window, Event event);
 
 void client_destroy_disconnected();
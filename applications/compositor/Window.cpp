@@ -69,15 +69,7 @@ void Window::resize(Rectangle new_bound)
 
 void Window::send_event(Event event)
 {
-    CompositorMessage message = {
-        .type = COMPOSITOR_MESSAGE_EVENT_WINDOW,
-        .event_window = {
-            .id = _id,
-            .event = event,
-        },
-    };
-
-    client_send_message(_client, message);
+    client_send_event(_client, _id, event);
 }
 
 void Window::handle_mouse_move(Vec2i old_position, Vec2i position, MouseButton buttons)
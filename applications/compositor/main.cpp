@@ -130,7 +130,7 @@ int main(int argc, char const *argv[])
         return 0;
     }
 
-    Socket *socket = socket_open("/Session/compositor.ipc", OPEN_CREATE);
+    Socket *socket = socket_open(protocol::COMPOSITOR_PATH, OPEN_CREATE);
     Stream *lock_stream = stream_open("/Session/compositor.lock", OPEN_CREATE);
     stream_close(lock_stream);
 
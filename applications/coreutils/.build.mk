@@ -1,4 +1,13 @@
 UTILS = \
+	__BENCHLAUNCH \
+	__BENCHMEMORY \
+	__BENCHPATH \
+	__BENCHPIPE \
+	__BENCHPIPEPAGES \
+	__BENCHRANDOM \
+	__BENCHSYSCALLS \
+	__BENCHTAR \
+	__BENCHTHROUGHPUT \
 	__TESTEXEC \
 	__TESTTERM \
 	CAT \
@@ -23,6 +32,33 @@ UTILS = \
 	UPTIME \
 	LINK
 
+__BENCHLAUNCH_LIBS = json
+__BENCHLAUNCH_NAME = __benchlaunch
+
+__BENCHMEMORY_LIBS =
+__BENCHMEMORY_NAME = __benchmemory
+
+__BENCHPATH_LIBS =
+__BENCHPATH_NAME = __benchpath
+
+__BENCHPIPE_LIBS =
+__BENCHPIPE_NAME = __benchpipe
+
+__BENCHPIPEPAGES_LIBS =
+__BENCHPIPEPAGES_NAME = __benchpipepages
+
+__BENCHRANDOM_LIBS =
+__BENCHRANDOM_NAME = __benchrandom
+
+__BENCHSYSCALLS_LIBS = json
+__BENCHSYSCALLS_NAME = __benchsyscalls
+
+__BENCHTAR_LIBS = file
+__BENCHTAR_NAME = __benchtar
+
+__BENCHTHROUGHPUT_LIBS =
+__BENCHTHROUGHPUT_NAME = __benchthroughput
+
 __TESTEXEC_LIBS =
 __TESTEXEC_NAME = __testexec
 
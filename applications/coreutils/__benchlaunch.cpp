@@ -0,0 +1,115 @@
+#include <libjson/Json.h>
+#include <libsystem/io/Pipe.h>
+#include <libsystem/io/Stream.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/process/Launchpad.h>
+#include <libsystem/process/Process.h>
+#include <libsystem/system/System.h>
+#include <libsystem/utils/NumberParser.h>
+
+// Launch the shell N times (10 by default) and keep them all running, then
+// report how long each launch took and how much memory they really use
+// compared to what they would use if nothing was shared between them.
+
+#define SHELL_COUNT_MAX 64
+
+static int shells[SHELL_COUNT_MAX];
+
+static size_t resident_memory_of(json::Value *processes, int pid)
+{
+    for (size_t i = 0; i < json::array_length(processes); i++)
+    {
+        auto process = json::array_get(processes, i);
+
+        if (json::integer_value(json::object_get(process, "id")) == pid)
+        {
+            return json::integer_value(json::object_get(process, "ram"));
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int shell_count = 10;
+
+    if (argc == 2)
+    {
+        shell_count = MIN((int)parse_uint_inline(PARSER_DECIMAL, argv[1], 10), SHELL_COUNT_MAX);
+    }
+
+    // The shells block on an input that never comes, and their prompt goes nowhere.
+    Pipe *input = pipe_create();
+    Pipe *output = pipe_create();
+
+    size_t used_before = system_get_status().used_ram;
+
+    uint first_launch = 0;
+    uint other_launches = 0;
+
+    for (int i = 0; i < shell_count; i++)
+    {
+        Launchpad *launchpad = launchpad_create("shell", "/Applications/shell/shell");
+        launchpad_handle(launchpad, HANDLE(input->out), 0);
+        launchpad_handle(launchpad, HANDLE(output->in), 1);
+        launchpad_handle(launchpad, HANDLE(output->in), 2);
+
+        uint start = system_get_ticks();
+        Result result = launchpad_launch(launchpad, &shells[i]);
+        uint elapsed = system_get_ticks() - start;
+
+        if (result != SUCCESS)
+        {
+            stream_format(err_stream, "__benchlaunch: failed to launch shell %d: %s\n", i, result_to_string(result));
+            return -1;
+        }
+
+        if (i == 0)
+        {
+            first_launch = elapsed;
+        }
+        else
+        {
+            other_launches += elapsed;
+        }
+    }
+
+    // Let them reach their prompt.
+    process_sleep(500);
+
+    size_t used_after = system_get_status().used_ram;
+
+    size_t resident = 0;
+    json::Value *processes = json::parse_file("/System/processes");
+
+    for (int i = 0; i < shell_count; i++)
+    {
+        resident += resident_memory_of(processes, shells[i]);
+    }
+
+    json::destroy(processes);
+
+    for (int i = 0; i < shell_count; i++)
+    {
+        process_cancel(shells[i]);
+    }
+
+    pipe_destroy(input);
+    pipe_destroy(output);
+
+    printf("first launch took %dms\n", first_launch);
+
+    if (shell_count > 1)
+    {
+        printf("next launches took %dms on average\n", other_launches / (shell_count - 1));
+    }
+
+    printf("%d shells map %dKio but only use %dKio (%dKio shared)\n",
+           shell_count,
+           resident / 1024,
+           (used_after - used_before) / 1024,
+           (resident - MIN(resident, used_after - used_before)) / 1024);
+
+    return 0;
+}
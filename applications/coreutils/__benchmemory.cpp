@@ -0,0 +1,54 @@
+#include <libsystem/io/Stream.h>
+#include <libsystem/system/Memory.h>
+#include <libsystem/system/System.h>
+
+// Map then unmap 64MiB of memory one page at a time
+// and report the average cost of each operation.
+// (The per page figures are scaled down by 64 first so they fit in 32 bits.)
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT (64 * 1024 * 1024 / PAGE_SIZE)
+
+static uintptr_t pages[PAGE_COUNT];
+
+int main(int argc, char **argv)
+{
+    __unused(argc);
+    __unused(argv);
+
+    uint start = system_get_ticks();
+
+    for (int i = 0; i < PAGE_COUNT; i++)
+    {
+        Result result = memory_alloc(PAGE_SIZE, &pages[i]);
+
+        if (result != SUCCESS)
+        {
+            stream_format(err_stream, "__benchmemory: failed to map page %d: %s\n", i, result_to_string(result));
+            return -1;
+        }
+    }
+
+    uint map_elapsed = system_get_ticks() - start;
+
+    start = system_get_ticks();
+
+    for (int i = 0; i < PAGE_COUNT; i++)
+    {
+        memory_free(pages[i]);
+    }
+
+    uint unmap_elapsed = system_get_ticks() - start;
+
+    printf("mapped %d pages in %dms (%dns per page)\n",
+           PAGE_COUNT,
+           map_elapsed,
+           map_elapsed * (1000000 / 64) / (PAGE_COUNT / 64));
+
+    printf("unmapped %d pages in %dms (%dns per page)\n",
+           PAGE_COUNT,
+           unmap_elapsed,
+           unmap_elapsed * (1000000 / 64) / (PAGE_COUNT / 64));
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <libsystem/core/CString.h>
+#include <libsystem/io/Directory.h>
+#include <libsystem/io/Filesystem.h>
+#include <libsystem/io/Stream.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/system/System.h>
+
+// Resolve the path of every file of the sysroot, plus a missing file in
+// every directory, a few times over and report how long each pass took.
+// The first pass fills the dentry cache, the next ones should hit it.
+
+#define PASS_COUNT 5
+
+static char **paths = nullptr;
+static size_t paths_count = 0;
+static size_t paths_allocated = 0;
+
+static void add_path(const char *path)
+{
+    if (paths_count == paths_allocated)
+    {
+        paths_allocated = paths_allocated ? paths_allocated * 2 : 256;
+        paths = (char **)realloc(paths, paths_allocated * sizeof(char *));
+    }
+
+    paths[paths_count++] = strdup(path);
+}
+
+// directory_path is "" for the root so we don't end up with "//" everywhere.
+static void collect_paths(const char *directory_path)
+{
+    Directory *directory = directory_open(directory_path[0] ? directory_path : "/", OPEN_READ);
+
+    if (handle_has_error(directory))
+    {
+        directory_close(directory);
+        return;
+    }
+
+    char path[PATH_LENGTH];
+
+    snprintf(path, PATH_LENGTH, "%s/__benchpath_missing", directory_path);
+    add_path(path);
+
+    DirectoryEntry entry;
+
+    while (directory_read(directory, &entry) > 0)
+    {
+        snprintf(path, PATH_LENGTH, "%s/%s", directory_path, entry.name);
+
+        if (entry.stat.type == FILE_TYPE_DIRECTORY)
+        {
+            collect_paths(path);
+        }
+        else if (entry.stat.type == FILE_TYPE_REGULAR)
+        {
+            add_path(path);
+        }
+    }
+
+    directory_close(directory);
+}
+
+int main(int argc, char **argv)
+{
+    __unused(argc);
+    __unused(argv);
+
+    collect_paths("");
+
+    printf("resolving %d paths %d times\n", paths_count, PASS_COUNT);
+
+    for (int pass = 0; pass < PASS_COUNT; pass++)
+    {
+        size_t found = 0;
+        uint start = system_get_ticks();
+
+        for (size_t i = 0; i < paths_count; i++)
+        {
+            if (filesystem_exist(paths[i], FILE_TYPE_REGULAR))
+            {
+                found++;
+            }
+        }
+
+        uint elapsed = system_get_ticks() - start;
+
+        printf("pass %d: %dms (%dus per path, %d found)\n",
+               pass,
+               elapsed,
+               (elapsed * 1000) / MAX(paths_count, 1),
+               found);
+    }
+
+    for (size_t i = 0; i < paths_count; i++)
+    {
+        free(paths[i]);
+    }
+
+    free(paths);
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <libsystem/core/CString.h>
+#include <libsystem/io/Pipe.h>
+#include <libsystem/io/Stream.h>
+#include <libsystem/process/Launchpad.h>
+#include <libsystem/process/Process.h>
+#include <libsystem/system/System.h>
+
+// Bounce a byte between two processes through a pair of pipes
+// and report the average round-trip time.
+
+#define ROUND_TRIP_COUNT 10000
+
+static int pong()
+{
+    __cleanup(stream_cleanup) Stream *ping = stream_open_handle(0, OPEN_READ);
+    __cleanup(stream_cleanup) Stream *pong = stream_open_handle(1, OPEN_WRITE);
+
+    char byte;
+
+    while (stream_read(ping, &byte, 1) == 1)
+    {
+        stream_write(pong, &byte, 1);
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "--pong") == 0)
+    {
+        return pong();
+    }
+
+    Pipe *ping_pipe = pipe_create();
+    Pipe *pong_pipe = pipe_create();
+
+    Launchpad *launchpad = launchpad_create("__benchpipe", "/System/Binaries/__benchpipe");
+    launchpad_argument(launchpad, "--pong");
+    launchpad_handle(launchpad, HANDLE(ping_pipe->out), 0);
+    launchpad_handle(launchpad, HANDLE(pong_pipe->in), 1);
+
+    int pid = -1;
+    Result result = launchpad_launch(launchpad, &pid);
+
+    if (result != SUCCESS)
+    {
+        stream_format(err_stream, "__benchpipe: failed to launch the pong process: %s\n", result_to_string(result));
+        return -1;
+    }
+
+    uint start = system_get_ticks();
+
+    for (int i = 0; i < ROUND_TRIP_COUNT; i++)
+    {
+        char byte = i;
+
+        stream_write(ping_pipe->in, &byte, 1);
+
+        if (stream_read(pong_pipe->out, &byte, 1) != 1)
+        {
+            stream_format(err_stream, "__benchpipe: the pong process went away after %d round trips\n", i);
+            return -1;
+        }
+    }
+
+    uint elapsed = system_get_ticks() - start;
+
+    pipe_destroy(ping_pipe);
+    pipe_destroy(pong_pipe);
+
+    process_wait(pid, nullptr);
+
+    printf("%d round trips in %dms (%dus per round trip)\n",
+           ROUND_TRIP_COUNT,
+           elapsed,
+           (elapsed * 1000) / ROUND_TRIP_COUNT);
+
+    return 0;
+}
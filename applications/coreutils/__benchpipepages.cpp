@@ -0,0 +1,156 @@
+#include <libsystem/core/CString.h>
+#include <libsystem/io/Pipe.h>
+#include <libsystem/io/Stream.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/process/Launchpad.h>
+#include <libsystem/process/Process.h>
+#include <libsystem/system/Memory.h>
+#include <libsystem/system/System.h>
+#include <libsystem/utils/NumberParser.h>
+
+// Push data through a pipe to another process with a few write sizes, from
+// an unaligned buffer, from a page aligned one and by donating its pages, and
+// report the throughput. The other side reads into page aligned buffers, so
+// whole pages can be handed over to it instead of being copied.
+
+#define TOTAL_SIZE (8 * 1024 * 1024)
+#define PAGE_SIZE 4096
+
+static const size_t sizes[] = {64, 512, 4096, 65536, 1024 * 1024};
+
+enum Mode
+{
+    MODE_UNALIGNED,
+    MODE_ALIGNED,
+    MODE_DONATED,
+};
+
+static const char *mode_names[] = {"unaligned", "aligned", "donated"};
+
+static int sink(size_t size)
+{
+    __cleanup(stream_cleanup) Stream *input = stream_open_handle(0, OPEN_READ);
+    stream_set_read_buffer_mode(input, STREAM_BUFFERED_NONE);
+
+    uintptr_t buffer = 0;
+
+    if (memory_alloc(size, &buffer) != SUCCESS)
+    {
+        return -1;
+    }
+
+    while (stream_read(input, (void *)buffer, size) != 0)
+    {
+    }
+
+    memory_free(buffer);
+
+    return 0;
+}
+
+static Result measure(size_t size, Mode mode, uintptr_t buffer, uint *elapsed)
+{
+    Pipe *pipe = pipe_create();
+    stream_set_write_buffer_mode(pipe->in, STREAM_BUFFERED_NONE);
+
+    char size_argument[16];
+    snprintf(size_argument, 16, "%d", size);
+
+    Launchpad *launchpad = launchpad_create("__benchpipepages", "/System/Binaries/__benchpipepages");
+    launchpad_argument(launchpad, "--sink");
+    launchpad_argument(launchpad, size_argument);
+    launchpad_handle(launchpad, HANDLE(pipe->out), 0);
+
+    int pid = -1;
+    Result result = launchpad_launch(launchpad, &pid);
+
+    if (result != SUCCESS)
+    {
+        pipe_destroy(pipe);
+        return result;
+    }
+
+    if (mode == MODE_UNALIGNED)
+    {
+        buffer += 16;
+    }
+
+    uint start = system_get_ticks();
+
+    for (size_t written = 0; written < TOTAL_SIZE;)
+    {
+        size_t chunk = 0;
+
+        if (mode == MODE_DONATED)
+        {
+            chunk = stream_donate(pipe->in, (void *)buffer, size);
+        }
+        else
+        {
+            chunk = stream_write(pipe->in, (void *)buffer, size);
+        }
+
+        if (chunk == 0)
+        {
+            result = handle_get_error(pipe->in);
+            pipe_destroy(pipe);
+            return result;
+        }
+
+        written += chunk;
+    }
+
+    // Done once the other side has read everything.
+    pipe_destroy(pipe);
+    process_wait(pid, nullptr);
+
+    *elapsed = MAX(system_get_ticks() - start, 1u);
+
+    return SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "--sink") == 0)
+    {
+        return sink(parse_uint_inline(PARSER_DECIMAL, argv[2], PAGE_SIZE));
+    }
+
+    // Room for the unaligned writes to start a bit further.
+    uintptr_t buffer = 0;
+
+    if (memory_alloc(sizes[__array_length(sizes) - 1] + PAGE_SIZE, &buffer) != SUCCESS)
+    {
+        stream_format(err_stream, "__benchpipepages: out of memory\n");
+        return -1;
+    }
+
+    memset((void *)buffer, 'x', sizes[__array_length(sizes) - 1] + PAGE_SIZE);
+
+    for (size_t i = 0; i < __array_length(sizes); i++)
+    {
+        for (int mode = MODE_UNALIGNED; mode <= MODE_DONATED; mode++)
+        {
+            uint elapsed = 0;
+            Result result = measure(sizes[i], (Mode)mode, buffer, &elapsed);
+
+            if (result != SUCCESS)
+            {
+                stream_format(err_stream, "__benchpipepages: failed with %d bytes writes: %s\n", sizes[i], result_to_string(result));
+                memory_free(buffer);
+                return -1;
+            }
+
+            printf("%7d bytes %-9s writes: %dMio in %dms, %dMio/s\n",
+                   sizes[i],
+                   mode_names[mode],
+                   TOTAL_SIZE / (1024 * 1024),
+                   elapsed,
+                   (TOTAL_SIZE / 1024) * 1000 / elapsed / 1024);
+        }
+    }
+
+    memory_free(buffer);
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <abi/Paths.h>
+#include <libsystem/io/Stream.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/system/System.h>
+
+// Read from /Devices/random with a few buffer sizes and report the
+// throughput. Backed by the virtIO entropy source this measures how well
+// the virtqueue keeps the device busy.
+
+#define TOTAL_SIZE (1024 * 1024)
+
+static const size_t buffer_sizes[] = {16, 512, 4096, 65536};
+
+int main(int argc, char **argv)
+{
+    __unused(argc);
+    __unused(argv);
+
+    __cleanup(stream_cleanup) Stream *random = stream_open(UNIX_DEVICE_PATH("random"), OPEN_READ);
+
+    if (handle_has_error(random))
+    {
+        handle_printf_error(random, "__benchrandom: failed to open " UNIX_DEVICE_PATH("random"));
+        return -1;
+    }
+
+    stream_set_read_buffer_mode(random, STREAM_BUFFERED_NONE);
+
+    char *buffer = (char *)malloc(65536);
+
+    for (size_t i = 0; i < __array_length(buffer_sizes); i++)
+    {
+        size_t buffer_size = buffer_sizes[i];
+        size_t total = 0;
+        size_t reads = 0;
+
+        uint start = system_get_ticks();
+
+        while (total < TOTAL_SIZE)
+        {
+            size_t read = stream_read(random, buffer, buffer_size);
+
+            if (read == 0)
+            {
+                stream_format(err_stream, "__benchrandom: read failed\n");
+                free(buffer);
+                return -1;
+            }
+
+            total += read;
+            reads++;
+        }
+
+        uint elapsed = MAX(system_get_ticks() - start, 1u);
+
+        printf("%6d bytes per read: %dKio in %dms, %dKio/s (%d reads)\n",
+               buffer_size,
+               total / 1024,
+               elapsed,
+               (total / 1024) * 1000 / elapsed,
+               reads);
+    }
+
+    free(buffer);
+
+    return 0;
+}
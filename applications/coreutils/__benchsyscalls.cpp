@@ -0,0 +1,89 @@
+#include <libjson/Json.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/io/Stream.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/process/Process.h>
+#include <libsystem/system/System.h>
+#include <libsystem/utils/NumberParser.h>
+
+// Count the system calls a process makes over a few seconds (the compositor
+// for 5 seconds by default). The compositor repaints 60 times a second, so
+// it also reports how many calls that is per frame. Move the mouse around
+// while it runs to see how the input path does.
+
+#define FRAMES_PER_SECOND 60
+
+static bool syscalls_of(const char *name, int *pid, size_t *syscalls)
+{
+    json::Value *processes = json::parse_file("/System/processes");
+
+    bool found = false;
+
+    for (size_t i = 0; i < json::array_length(processes); i++)
+    {
+        auto process = json::array_get(processes, i);
+
+        if (strcmp(json::string_value(json::object_get(process, "name")), name) == 0 &&
+            (*pid == -1 || json::integer_value(json::object_get(process, "id")) == *pid))
+        {
+            *pid = json::integer_value(json::object_get(process, "id"));
+            *syscalls = json::integer_value(json::object_get(process, "syscalls"));
+            found = true;
+            break;
+        }
+    }
+
+    json::destroy(processes);
+
+    return found;
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = "compositor";
+    uint seconds = 5;
+
+    if (argc >= 2)
+    {
+        name = argv[1];
+    }
+
+    if (argc >= 3)
+    {
+        seconds = MAX(parse_uint_inline(PARSER_DECIMAL, argv[2], 5), 1u);
+    }
+
+    int pid = -1;
+    size_t before = 0;
+
+    if (!syscalls_of(name, &pid, &before))
+    {
+        stream_format(err_stream, "__benchsyscalls: no process named %s\n", name);
+        return -1;
+    }
+
+    uint start = system_get_ticks();
+    process_sleep(seconds * 1000);
+
+    size_t after = 0;
+
+    if (!syscalls_of(name, &pid, &after))
+    {
+        stream_format(err_stream, "__benchsyscalls: %s exited\n", name);
+        return -1;
+    }
+
+    uint elapsed = MAX(system_get_ticks() - start, 1u);
+    size_t syscalls = after - before;
+
+    printf("%s (%d): %d syscalls in %dms, %d per second, %d.%02d per frame\n",
+           name,
+           pid,
+           syscalls,
+           elapsed,
+           syscalls * 1000 / elapsed,
+           syscalls * 1000 / elapsed / FRAMES_PER_SECOND,
+           syscalls * 1000 / elapsed * 100 / FRAMES_PER_SECOND % 100);
+
+    return 0;
+}
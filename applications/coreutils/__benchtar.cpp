@@ -0,0 +1,112 @@
+#include <libfile/tar.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/io/Stream.h>
+#include <libsystem/system/System.h>
+
+// Build a 10k entries archive in memory and walk the first N entries of it
+// for growing values of N. The time per entry should stay the same.
+
+#define ENTRY_COUNT 10000
+#define WALK_COUNT 20
+
+static void write_octal(char *field, size_t length, size_t value)
+{
+    for (size_t i = length - 1; i > 0; i--)
+    {
+        field[i - 1] = '0' + value % 8;
+        value /= 8;
+    }
+
+    field[length - 1] = '\0';
+}
+
+static char *write_entry(char *cursor, int index)
+{
+    size_t size = (index * 37) % 1500;
+
+    memset(cursor, 0, 512);
+
+    // Every other entry goes through the ustar prefix.
+    if (index % 2)
+    {
+        snprintf(cursor + 345, 155, "System/Benchmarks/Archive/Directory%d", index % 16);
+    }
+
+    snprintf(cursor, 100, "file%d", index);
+    write_octal(cursor + 100, 8, 0644);
+    write_octal(cursor + 124, 12, size);
+    write_octal(cursor + 136, 12, 0);
+    cursor[156] = '0';
+    memcpy(cursor + 257, "ustar\0" "00", 8);
+
+    size_t checksum = 0;
+    memset(cursor + 148, ' ', 8);
+
+    for (size_t i = 0; i < 512; i++)
+    {
+        checksum += (uint8_t)cursor[i];
+    }
+
+    write_octal(cursor + 148, 7, checksum);
+
+    memset(cursor + 512, index, size);
+
+    return cursor + 512 + __align_up(size, 512);
+}
+
+int main(int argc, char **argv)
+{
+    __unused(argc);
+    __unused(argv);
+
+    // Entries are at most 1500 bytes so 4 blocks including the header.
+    size_t archive_size = ENTRY_COUNT * 4 * 512 + 1024;
+    char *archive = (char *)calloc(archive_size, 1);
+
+    char *cursor = archive;
+
+    for (int i = 0; i < ENTRY_COUNT; i++)
+    {
+        cursor = write_entry(cursor, i);
+    }
+
+    archive_size = cursor - archive + 1024;
+
+    for (int count = ENTRY_COUNT / 8; count <= ENTRY_COUNT; count *= 2)
+    {
+        size_t bytes = 0;
+        uint start = system_get_ticks();
+
+        for (int walk = 0; walk < WALK_COUNT; walk++)
+        {
+            TARIterator iterator;
+            tar_iterator_initialize(&iterator, archive, archive_size);
+
+            TARBlock block;
+
+            for (int i = 0; i < count && tar_iterator_next(&iterator, &block); i++)
+            {
+                bytes += block.size;
+            }
+
+            if (iterator.corrupted)
+            {
+                stream_format(err_stream, "__benchtar: the archive is damaged?\n");
+                return -1;
+            }
+        }
+
+        uint elapsed = system_get_ticks() - start;
+
+        printf("%5d entries: %dms for %d walks (%dns per entry, %dKio of data)\n",
+               count,
+               elapsed,
+               WALK_COUNT,
+               (elapsed * 1000000) / (count * WALK_COUNT),
+               bytes / WALK_COUNT / 1024);
+    }
+
+    free(archive);
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <libsystem/core/CString.h>
+#include <libsystem/io/Pipe.h>
+#include <libsystem/io/Stream.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/process/Launchpad.h>
+#include <libsystem/process/Process.h>
+#include <libsystem/system/System.h>
+
+// Push data through a pipe to another process with a few pipe capacities
+// and report the throughput, like `cat big | grep` would see it.
+
+#define TOTAL_SIZE (16 * 1024 * 1024)
+#define CHUNK_SIZE (64 * 1024)
+
+static const size_t capacities[] = {4096, 16384, 65536, 262144};
+
+static int sink()
+{
+    __cleanup(stream_cleanup) Stream *input = stream_open_handle(0, OPEN_READ);
+
+    char *buffer = (char *)malloc(CHUNK_SIZE);
+
+    while (stream_read(input, buffer, CHUNK_SIZE) != 0)
+    {
+    }
+
+    free(buffer);
+
+    return 0;
+}
+
+static Result measure(size_t capacity, char *buffer, uint *elapsed)
+{
+    Pipe *pipe = pipe_create();
+
+    IOCallPipeCapacityArgs args = {capacity};
+    Result result = stream_call(pipe->in, IOCALL_PIPE_SET_CAPACITY, &args);
+
+    if (result != SUCCESS)
+    {
+        pipe_destroy(pipe);
+        return result;
+    }
+
+    Launchpad *launchpad = launchpad_create("__benchthroughput", "/System/Binaries/__benchthroughput");
+    launchpad_argument(launchpad, "--sink");
+    launchpad_handle(launchpad, HANDLE(pipe->out), 0);
+
+    int pid = -1;
+    result = launchpad_launch(launchpad, &pid);
+
+    if (result != SUCCESS)
+    {
+        pipe_destroy(pipe);
+        return result;
+    }
+
+    uint start = system_get_ticks();
+
+    for (size_t written = 0; written < TOTAL_SIZE;)
+    {
+        size_t chunk = stream_write(pipe->in, buffer, MIN(CHUNK_SIZE, TOTAL_SIZE - written));
+
+        if (chunk == 0)
+        {
+            result = handle_get_error(pipe->in);
+            pipe_destroy(pipe);
+            return result;
+        }
+
+        written += chunk;
+    }
+
+    // Done once the other side has read everything.
+    pipe_destroy(pipe);
+    process_wait(pid, nullptr);
+
+    *elapsed = MAX(system_get_ticks() - start, 1u);
+
+    return SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "--sink") == 0)
+    {
+        return sink();
+    }
+
+    char *buffer = (char *)malloc(CHUNK_SIZE);
+    memset(buffer, 'x', CHUNK_SIZE);
+
+    for (size_t i = 0; i < __array_length(capacities); i++)
+    {
+        uint elapsed = 0;
+        Result result = measure(capacities[i], buffer, &elapsed);
+
+        if (result != SUCCESS)
+        {
+            stream_format(err_stream, "__benchthroughput: failed with a %d bytes pipe: %s\n", capacities[i], result_to_string(result));
+            free(buffer);
+            return -1;
+        }
+
+        printf("%6d bytes pipe: %dMio in %dms, %dMio/s\n",
+               capacities[i],
+               TOTAL_SIZE / (1024 * 1024),
+               elapsed,
+               (TOTAL_SIZE / 1024) * 1000 / elapsed / 1024);
+    }
+
+    free(buffer);
+
+    return 0;
+}
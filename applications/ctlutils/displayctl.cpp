@@ -8,7 +8,7 @@
 #include <libsystem/io/Socket.h>
 #include <libsystem/io/Stream.h>
 
-#include "compositor/Protocol.h"
+#include "protocols/compositor.h"
 
 static bool option_list = false;
 static bool option_get = false;
@@ -87,7 +87,7 @@ int gfxmode_get(Stream *framebuffer_device)
 
 int gfxmode_set_compositor(IOCallDisplayModeArgs *mode)
 {
-    Connection *compositor_connection = socket_connect("/Session/compositor.ipc");
+    Connection *compositor_connection = socket_connect(protocol::COMPOSITOR_PATH);
 
     if (handle_has_error(compositor_connection))
     {
@@ -95,15 +95,11 @@ int gfxmode_set_compositor(IOCallDisplayModeArgs *mode)
         return -1;
     }
 
-    CompositorMessage message = (CompositorMessage){
-        .type = COMPOSITOR_MESSAGE_SET_RESOLUTION,
-        .set_resolution = {
-            mode->width,
-            mode->height,
-        },
-    };
+    ProtocolBatch batch;
+    protocol_batch_initialize(&batch, compositor_connection, (ProtocolFlushCallback)protocol_batch_send);
 
-    connection_send(compositor_connection, &message, sizeof(message));
+    protocol::Compositor::set_resolution(&batch, mode->width, mode->height);
+    protocol_batch_flush(&batch);
 
     return 0;
 }
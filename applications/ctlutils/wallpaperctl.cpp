@@ -4,11 +4,11 @@
 #include <libsystem/io/Socket.h>
 #include <libsystem/io/Stream.h>
 
-#include "compositor/Protocol.h"
+#include "protocols/compositor.h"
 
 int set_wallpaper(const char *path)
 {
-    Connection *compositor_connection = socket_connect("/Session/compositor.ipc");
+    Connection *compositor_connection = socket_connect(protocol::COMPOSITOR_PATH);
 
     if (handle_has_error(compositor_connection))
     {
@@ -26,16 +26,19 @@ int set_wallpaper(const char *path)
 
     auto wallaper = wallaper_or_result.take_value();
 
-    CompositorMessage message = (CompositorMessage){
-        .type = COMPOSITOR_MESSAGE_SET_WALLPAPER,
-        .set_wallaper = {
-            .wallpaper = wallaper->handle(),
-            .resolution = wallaper->size(),
-        },
-    };
+    // The compositor gets the wallpaper along with the message, it doesn't
+    // matter if we are gone by the time it reads it.
+    ProtocolBatch batch;
+    protocol_batch_initialize(&batch, compositor_connection, (ProtocolFlushCallback)protocol_batch_send);
 
-    connection_send(compositor_connection, &message, sizeof(message));
-    __plug_process_sleep(1000); // FIXME: Find a better way to wait for the server...
+    protocol::Compositor::set_wallpaper(&batch, wallaper->handle(), wallaper->size());
+    protocol_batch_flush(&batch);
+
+    if (handle_has_error(compositor_connection))
+    {
+        handle_printf_error(compositor_connection, "Failed to send the wallpaper to the compositor.");
+        return -1;
+    }
 
     return 0;
 }
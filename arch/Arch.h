@@ -2,8 +2,19 @@
 
 #include "kernel/tasking/Task.h"
 
+// Upper bound on the number of processors brought up by the kernel.
+#define ARCH_PROCESSOR_MAX_COUNT 16
+
 void arch_initialize();
 
+void arch_start_processors();
+
+int arch_processor_id();
+
+int arch_processor_count();
+
+void arch_tlb_sync();
+
 void arch_disable_interupts();
 
 void arch_enable_interupts();
@@ -3,6 +3,7 @@
 #include "arch/x86/ACPI.h"
 #include "arch/x86/IOAPIC.h"
 #include "arch/x86/LAPIC.h"
+#include "arch/x86/SMP.h"
 #include "kernel/acpi/tables/MADT.h"
 #include "kernel/acpi/tables/RSDP.h"
 #include "kernel/acpi/tables/RSDT.h"
@@ -20,6 +21,11 @@ void acpi_madt_initialize(MADT *madt)
         {
             auto local_apic = reinterpret_cast<MADTLocalApicRecord *>(record);
             logger_info("Local APIC (cpu_id=%d, apic_id=%d, flags=%08x)", local_apic->processor_id, local_apic->apic_id, local_apic->flags);
+
+            if (local_apic->flags & MADT_LOCAL_APIC_ENABLED)
+            {
+                smp_found_processor(local_apic->apic_id);
+            }
         }
         break;
 
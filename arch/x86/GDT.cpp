@@ -1,6 +1,8 @@
 #include "arch/x86/GDT.h"
 
-static TSS tss = {
+static TSS tss[ARCH_PROCESSOR_MAX_COUNT] = {};
+
+static constexpr TSS tss_template = {
     .prev_tss = 0,
     .esp0 = 0,
     .ss0 = 0x10,
@@ -44,12 +46,23 @@ void gdt_initialize()
     gdt[2] = {0, 0xffffffff, GDT_PRESENT | GDT_READWRITE, GDT_FLAGS};
     gdt[3] = {0, 0xffffffff, GDT_PRESENT | GDT_READWRITE | GDT_USER | GDT_EXECUTABLE, GDT_FLAGS};
     gdt[4] = {0, 0xffffffff, GDT_PRESENT | GDT_READWRITE | GDT_USER, GDT_FLAGS};
-    gdt[5] = {&tss, GDT_TSS_PRESENT | GDT_ACCESSED | GDT_EXECUTABLE | GDT_USER, TSS_FLAGS};
 
+    for (int i = 0; i < ARCH_PROCESSOR_MAX_COUNT; i++)
+    {
+        tss[i] = tss_template;
+        gdt[GDT_TSS_ENTRY + i] = {&tss[i], GDT_TSS_PRESENT | GDT_ACCESSED | GDT_EXECUTABLE | GDT_USER, TSS_FLAGS};
+    }
+
+    gdt_initialize_processor(0);
+}
+
+void gdt_initialize_processor(int processor)
+{
     gdt_flush((uint32_t)&gdt_descriptor);
+    tss_flush((GDT_TSS_ENTRY + processor) * sizeof(GDTEntry));
 }
 
 void set_kernel_stack(uint32_t stack)
 {
-    tss.esp0 = stack;
+    tss[arch_processor_id()].esp0 = stack;
 }
@@ -3,7 +3,11 @@
 #include <libsystem/Common.h>
 #include <libsystem/Logger.h>
 
-#define GDT_ENTRY_COUNT 6
+#include "arch/Arch.h"
+
+// Null, kernel code/data and user code/data, then one TSS per processor.
+#define GDT_TSS_ENTRY 5
+#define GDT_ENTRY_COUNT (GDT_TSS_ENTRY + ARCH_PROCESSOR_MAX_COUNT)
 
 #define GDT_PRESENT 0b10010000     // Present bit. This must be 1 for all valid selectors.
 #define GDT_TSS_PRESENT 0b10000000 // Present bit. This must be 1 for all valid selectors.
@@ -99,6 +103,8 @@ struct __packed GDTEntry
 
 void gdt_initialize();
 
+void gdt_initialize_processor(int processor);
+
 extern "C" void gdt_flush(uint32_t);
 
 extern "C" void tss_flush(uint32_t);
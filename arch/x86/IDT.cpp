@@ -20,13 +20,19 @@ void idt_initialize()
     idt[3] = IDT_ENTRY(__interrupt_vector[3], 0x08, TRAPGATE);
     idt[4] = IDT_ENTRY(__interrupt_vector[4], 0x08, TRAPGATE);
 
-    for (int i = 5; i < 48; i++)
+    for (int i = 5; i < 49; i++)
     {
         idt[i] = IDT_ENTRY(__interrupt_vector[i], 0x08, INTGATE);
     }
 
-    idt[127] = IDT_ENTRY(__interrupt_vector[48], 0x08, INTGATE);
-    idt[128] = IDT_ENTRY(__interrupt_vector[49], 0x08, INTGATE | IDT_USER);
+    idt[127] = IDT_ENTRY(__interrupt_vector[49], 0x08, INTGATE);
+    idt[128] = IDT_ENTRY(__interrupt_vector[50], 0x08, INTGATE | IDT_USER);
+    idt[255] = IDT_ENTRY(__interrupt_vector[51], 0x08, INTGATE);
 
+    idt_initialize_processor();
+}
+
+void idt_initialize_processor()
+{
     idt_flush((uint32_t)&idt_descriptor);
 }
@@ -38,3 +38,5 @@ struct __packed IDTEntry
 extern "C" void idt_flush(uint32_t);
 
 void idt_initialize();
+
+void idt_initialize_processor();
@@ -4,6 +4,7 @@
 #include <libsystem/thread/Atomic.h>
 
 #include "arch/x86/Interrupts.h"
+#include "arch/x86/LAPIC.h"
 #include "arch/x86/PIC.h"
 #include "arch/x86/x86.h"
 
@@ -11,6 +12,7 @@
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/system/System.h"
 #include "kernel/tasking/Syscalls.h"
+#include "kernel/tasking/Task-Memory.h"
 
 static const char *_exception_messages[32] = {
     "Division by zero",
@@ -76,7 +78,14 @@ void backtrace(uint32_t ebp)
 
 extern "C" uint32_t interrupts_handler(uintptr_t esp, InterruptStackFrame stackframe)
 {
-    if (stackframe.intno < 32)
+    if (stackframe.intno == 14 &&
+        scheduler_running() &&
+        task_memory_handle_page_fault(scheduler_running(), CR2(), stackframe.err & 2))
+    {
+        // User memory is only mapped when it's first touched, and copied
+        // when it's first written to, now it is, try again.
+    }
+    else if (stackframe.intno < 32)
     {
         if (stackframe.eip >= 0x40000000)
         {
@@ -120,9 +129,26 @@ extern "C" uint32_t interrupts_handler(uintptr_t esp, InterruptStackFrame stackf
         else
         {
             dispatcher_dispatch(irq);
+
+            // Let the interrupt dispatcher run right away instead of on the next tick.
+            esp = schedule(esp);
         }
 
         atomic_enable();
+
+        pic_ack(stackframe.intno);
+    }
+    else if (stackframe.intno == LAPIC_TIMER_VECTOR)
+    {
+        // The application processors are preempted by their own timer,
+        // the system tick is still driven by the PIT on the bootstrap processor.
+        atomic_disable();
+
+        esp = schedule(esp);
+
+        atomic_enable();
+
+        lapic_ack();
     }
     else if (stackframe.intno == 127)
     {
@@ -139,7 +165,5 @@ extern "C" uint32_t interrupts_handler(uintptr_t esp, InterruptStackFrame stackf
         cli();
     }
 
-    pic_ack(stackframe.intno);
-
     return esp;
 }
@@ -107,9 +107,11 @@ INTERRUPT_NOERR 44
 INTERRUPT_NOERR 45
 INTERRUPT_NOERR 46
 INTERRUPT_NOERR 47
+INTERRUPT_NOERR 48
 
 INTERRUPT_NOERR 127
 INTERRUPT_SYSCALL 128
+INTERRUPT_NOERR 255
 
 global __interrupt_vector
 
@@ -163,6 +165,8 @@ __interrupt_vector:
     INTERRUPT_NAME 45
     INTERRUPT_NAME 46
     INTERRUPT_NAME 47
+    INTERRUPT_NAME 48
 
     INTERRUPT_NAME 127
     INTERRUPT_NAME 128
+    INTERRUPT_NAME 255
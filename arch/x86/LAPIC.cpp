@@ -1,26 +1,58 @@
 #include <libsystem/Logger.h>
+#include <libsystem/thread/Atomic.h>
 
 #include "arch/x86/LAPIC.h"
-#include "arch/x86/PIC.h"
+#include "kernel/memory/Virtual.h"
+#include "kernel/system/System.h"
 
+constexpr int LAPIC_ID = 0x0020;
 constexpr int LAPIC_EOI = 0x00B0;
+constexpr int LAPIC_SPURIOUS = 0x00F0;
+constexpr int LAPIC_ICR_LOW = 0x0300;
+constexpr int LAPIC_ICR_HIGH = 0x0310;
+constexpr int LAPIC_TIMER = 0x0320;
+constexpr int LAPIC_TIMER_INITIAL_COUNT = 0x0380;
+constexpr int LAPIC_TIMER_CURRENT_COUNT = 0x0390;
+constexpr int LAPIC_TIMER_DIVIDE = 0x03E0;
 
+constexpr uint32_t LAPIC_ENABLE = 0x100;
+
+constexpr uint32_t LAPIC_ICR_INIT = 0x0500;
+constexpr uint32_t LAPIC_ICR_STARTUP = 0x0600;
+constexpr uint32_t LAPIC_ICR_PENDING = 0x1000;
+constexpr uint32_t LAPIC_ICR_ASSERT = 0x4000;
+
+constexpr uint32_t LAPIC_TIMER_PERIODIC = 0x20000;
+constexpr uint32_t LAPIC_TIMER_MASKED = 0x10000;
+constexpr uint32_t LAPIC_TIMER_DIVIDE_BY_16 = 0x3;
+
+static uintptr_t lapic_physical_address = 0;
 static volatile uint32_t *lapic = nullptr;
 
 void lapic_found(uintptr_t address)
 {
-    lapic = reinterpret_cast<uint32_t *>(address);
-    logger_info("LAPIC found at %08x", lapic);
+    lapic_physical_address = address;
+    logger_info("LAPIC found at %08x", address);
+}
+
+bool lapic_is_available()
+{
+    return lapic != nullptr;
 }
 
 uint32_t lapic_read(uint32_t reg)
 {
-    return *((volatile uint32_t *)(lapic + reg));
+    return lapic[reg / sizeof(uint32_t)];
 }
 
 void lapic_write(uint32_t reg, uint32_t data)
 {
-    *((volatile uint32_t *)(lapic + reg)) = data;
+    lapic[reg / sizeof(uint32_t)] = data;
+}
+
+int lapic_id()
+{
+    return lapic_read(LAPIC_ID) >> 24;
 }
 
 void lapic_ack()
@@ -28,9 +60,71 @@ void lapic_ack()
     lapic_write(LAPIC_EOI, 0);
 }
 
+static void lapic_send_ipi(int apic_id, uint32_t command)
+{
+    lapic_write(LAPIC_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, command);
+
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING)
+    {
+        asm volatile("pause");
+    }
+}
+
+void lapic_send_init(int apic_id)
+{
+    lapic_send_ipi(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_ASSERT);
+}
+
+void lapic_send_startup(int apic_id, uintptr_t entry)
+{
+    lapic_send_ipi(apic_id, LAPIC_ICR_STARTUP | LAPIC_ICR_ASSERT | (entry / ARCH_PAGE_SIZE));
+}
+
 void lapic_initialize()
 {
-    pic_disable();
+    if (!lapic_physical_address)
+    {
+        logger_warn("No LAPIC found!");
+        return;
+    }
+
+    if (!lapic)
+    {
+        AtomicHolder holder;
+
+        MemoryRange range{lapic_physical_address, ARCH_PAGE_SIZE};
+        lapic = reinterpret_cast<volatile uint32_t *>(virtual_alloc(&kpdir, range, MEMORY_NONE).base());
+    }
+
+    // The legacy PIC stays in charge of the IRQs, it's wired to the LINT0 of
+    // the bootstrap processor, so we only have to software-enable the LAPIC.
+    lapic_write(LAPIC_SPURIOUS, LAPIC_ENABLE | LAPIC_SPURIOUS_VECTOR);
+}
+
+void lapic_timer_initialize(int frequency)
+{
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_BY_16);
+    lapic_write(LAPIC_TIMER, LAPIC_TIMER_MASKED);
+
+    // Calibrate the timer against the system tick driven by the PIT.
+    uint32_t start = system_get_tick();
+
+    while (system_get_tick() == start)
+    {
+        asm volatile("pause");
+    }
+
+    lapic_write(LAPIC_TIMER_INITIAL_COUNT, 0xFFFFFFFF);
+
+    while (system_get_tick() < start + 1 + LAPIC_TIMER_CALIBRATION_TICKS)
+    {
+        asm volatile("pause");
+    }
+
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT_COUNT);
+    uint32_t ticks_per_second = elapsed / LAPIC_TIMER_CALIBRATION_TICKS * 1000;
 
-    lapic_write(0xF0, lapic_read(0xF0) | 0x100);
+    lapic_write(LAPIC_TIMER, LAPIC_TIMER_VECTOR | LAPIC_TIMER_PERIODIC);
+    lapic_write(LAPIC_TIMER_INITIAL_COUNT, ticks_per_second / frequency);
 }
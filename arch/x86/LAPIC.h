@@ -2,10 +2,24 @@
 
 #include <libsystem/Common.h>
 
+#define LAPIC_TIMER_VECTOR 48
+#define LAPIC_SPURIOUS_VECTOR 255
 
+// Number of PIT ticks (1ms each) used to calibrate the LAPIC timer.
+#define LAPIC_TIMER_CALIBRATION_TICKS 10
 
 void lapic_found(uintptr_t address);
 
+bool lapic_is_available();
+
 void lapic_initialize();
 
+void lapic_timer_initialize(int frequency);
+
+int lapic_id();
+
 void lapic_ack();
+
+void lapic_send_init(int apic_id);
+
+void lapic_send_startup(int apic_id, uintptr_t entry);
@@ -0,0 +1,201 @@
+#include <libsystem/Assert.h>
+#include <libsystem/Logger.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "arch/x86/FPU.h"
+#include "arch/x86/GDT.h"
+#include "arch/x86/IDT.h"
+#include "arch/x86/LAPIC.h"
+#include "arch/x86/Paging.h"
+#include "arch/x86/SMP.h"
+
+#include "kernel/scheduling/Scheduler.h"
+#include "kernel/system/System.h"
+
+extern "C" char smp_trampoline_start[];
+extern "C" char smp_trampoline_end[];
+extern "C" char smp_trampoline_page_directory[];
+extern "C" char smp_trampoline_stack[];
+extern "C" char smp_trampoline_entry[];
+
+static int _found_apic_ids[ARCH_PROCESSOR_MAX_COUNT] = {};
+static int _found_count = 0;
+
+static int _processor_count = 1;
+
+static volatile int _starting_processor = 0;
+static Task *volatile _starting_idle_task = nullptr;
+static volatile bool _starting_processor_online = false;
+
+static uint32_t _tlb_generation = 0;
+static uint32_t _tlb_processor_generation[ARCH_PROCESSOR_MAX_COUNT] = {};
+
+void smp_found_processor(int apic_id)
+{
+    if (_found_count == ARCH_PROCESSOR_MAX_COUNT)
+    {
+        logger_warn("Too many processors, ignoring the one with apic_id=%d", apic_id);
+        return;
+    }
+
+    _found_apic_ids[_found_count] = apic_id;
+    _found_count++;
+}
+
+int smp_processor_id()
+{
+    // Each processor loads its own TSS, so the task register tells us who we are.
+    uint16_t selector;
+    asm volatile("str %0"
+                 : "=r"(selector));
+
+    if (selector < GDT_TSS_ENTRY * sizeof(GDTEntry))
+    {
+        return 0;
+    }
+
+    return selector / sizeof(GDTEntry) - GDT_TSS_ENTRY;
+}
+
+int smp_processor_count()
+{
+    return _processor_count;
+}
+
+void smp_tlb_shootdown()
+{
+    ASSERT_ATOMIC;
+
+    // Other processors flush their TLB the next time they take the kernel lock,
+    // they can't reach the unmapped memory without it.
+    _tlb_generation++;
+    _tlb_processor_generation[smp_processor_id()] = _tlb_generation;
+
+    paging_invalidate_tlb();
+}
+
+void smp_tlb_sync()
+{
+    int processor = smp_processor_id();
+
+    if (_tlb_processor_generation[processor] != _tlb_generation)
+    {
+        _tlb_processor_generation[processor] = _tlb_generation;
+        paging_invalidate_tlb();
+    }
+}
+
+extern "C" void smp_processor_main()
+{
+    int processor = _starting_processor;
+    Task *idle_task = _starting_idle_task;
+
+    gdt_initialize_processor(processor);
+    idt_initialize_processor();
+    fpu_initialize();
+    lapic_initialize();
+    lapic_timer_initialize(1000);
+
+    atomic_enable();
+    atomic_begin();
+
+    scheduler_did_create_idle_task(idle_task);
+    scheduler_did_create_running_task(idle_task);
+
+    logger_info("Processor %d (apic_id=%d) is online", processor, lapic_id());
+    _starting_processor_online = true;
+
+    atomic_end();
+
+    system_hang();
+}
+
+static void smp_wait(uint32_t ticks)
+{
+    uint32_t start = system_get_tick();
+
+    while (system_get_tick() - start < ticks && !_starting_processor_online)
+    {
+        asm volatile("pause");
+    }
+}
+
+static void smp_trampoline_write(char *symbol, uintptr_t value)
+{
+    uintptr_t offset = symbol - smp_trampoline_start;
+    *(volatile uintptr_t *)(SMP_TRAMPOLINE_ADDRESS + offset) = value;
+}
+
+static bool smp_start_processor(int processor, int apic_id)
+{
+    Task *idle_task = nullptr;
+
+    {
+        AtomicHolder holder;
+
+        idle_task = task_spawn(nullptr, "Idle", system_hang, nullptr, false);
+        task_go(idle_task);
+        task_set_state(idle_task, TASK_STATE_HANG);
+    }
+
+    _starting_processor = processor;
+    _starting_idle_task = idle_task;
+    _starting_processor_online = false;
+
+    // The application processor borrows the idle task's stack to boot,
+    // it becomes the idle task once it's done.
+    smp_trampoline_write(smp_trampoline_page_directory, (uintptr_t)memory_kpdir());
+    smp_trampoline_write(smp_trampoline_stack, (uintptr_t)idle_task->kernel_stack + PROCESS_STACK_SIZE);
+    smp_trampoline_write(smp_trampoline_entry, (uintptr_t)smp_processor_main);
+
+    lapic_send_init(apic_id);
+    smp_wait(10);
+
+    for (int attempt = 0; attempt < 2 && !_starting_processor_online; attempt++)
+    {
+        lapic_send_startup(apic_id, SMP_TRAMPOLINE_ADDRESS);
+        smp_wait(LAPIC_TIMER_CALIBRATION_TICKS * 20);
+    }
+
+    if (!_starting_processor_online)
+    {
+        logger_error("Processor with apic_id=%d didn't respond!", apic_id);
+
+        AtomicHolder holder;
+        task_cancel(idle_task, -1);
+
+        return false;
+    }
+
+    return true;
+}
+
+void smp_initialize()
+{
+    lapic_initialize();
+
+    if (!lapic_is_available())
+    {
+        return;
+    }
+
+    int bootstrap_apic_id = lapic_id();
+
+    memcpy((void *)SMP_TRAMPOLINE_ADDRESS, smp_trampoline_start, smp_trampoline_end - smp_trampoline_start);
+
+    for (int i = 0; i < _found_count; i++)
+    {
+        if (_found_apic_ids[i] == bootstrap_apic_id)
+        {
+            continue;
+        }
+
+        if (smp_start_processor(_processor_count, _found_apic_ids[i]))
+        {
+            _processor_count++;
+        }
+    }
+
+    logger_info("%d processor(s) online", _processor_count);
+}
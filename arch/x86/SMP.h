@@ -0,0 +1,19 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+// Must match SMP_TRAMPOLINE_ADDRESS in SMP.s, the startup IPI can only
+// jump to a page aligned address in the first megabyte.
+#define SMP_TRAMPOLINE_ADDRESS 0x8000
+
+void smp_found_processor(int apic_id);
+
+void smp_initialize();
+
+int smp_processor_id();
+
+int smp_processor_count();
+
+void smp_tlb_shootdown();
+
+void smp_tlb_sync();
@@ -0,0 +1,82 @@
+;; SMP.s: real mode entry point of the application processors.             ;;
+;;                                                                          ;;
+;; This code is copied to SMP_TRAMPOLINE_ADDRESS before sending the startup ;;
+;; IPI, so every memory reference is relative to that address.              ;;
+
+SMP_TRAMPOLINE_ADDRESS equ 0x8000
+
+%define TRAMPOLINE(__symbol) (__symbol - smp_trampoline_start + SMP_TRAMPOLINE_ADDRESS)
+
+section .text
+
+bits 16
+
+global smp_trampoline_start
+smp_trampoline_start:
+	cli
+	cld
+
+	xor ax, ax
+	mov ds, ax
+
+	lgdt [TRAMPOLINE(smp_trampoline_gdt_descriptor)]
+
+	mov eax, cr0
+	or eax, 1
+	mov cr0, eax
+
+	jmp dword 0x08:TRAMPOLINE(smp_trampoline_protected_mode)
+
+bits 32
+
+smp_trampoline_protected_mode:
+	mov ax, 0x10
+	mov ds, ax
+	mov es, ax
+	mov fs, ax
+	mov gs, ax
+	mov ss, ax
+
+	mov eax, [TRAMPOLINE(smp_trampoline_page_directory)]
+	mov cr3, eax
+
+	mov eax, cr0
+	or eax, 0x80010000 ; Paging and write protection
+	mov cr0, eax
+
+	mov esp, [TRAMPOLINE(smp_trampoline_stack)]
+	xor ebp, ebp
+
+	mov eax, [TRAMPOLINE(smp_trampoline_entry)]
+	call eax
+
+	cli
+.hang:	hlt
+	jmp .hang
+
+align 8
+smp_trampoline_gdt:
+	dq 0x0000000000000000
+	dq 0x00CF9A000000FFFF ; Kernel code
+	dq 0x00CF92000000FFFF ; Kernel data
+
+smp_trampoline_gdt_descriptor:
+	dw smp_trampoline_gdt_descriptor - smp_trampoline_gdt - 1
+	dd TRAMPOLINE(smp_trampoline_gdt)
+
+;; Filled by smp_start_processor() before each startup IPI.
+
+global smp_trampoline_page_directory
+smp_trampoline_page_directory:
+	dd 0
+
+global smp_trampoline_stack
+smp_trampoline_stack:
+	dd 0
+
+global smp_trampoline_entry
+smp_trampoline_entry:
+	dd 0
+
+global smp_trampoline_end
+smp_trampoline_end:
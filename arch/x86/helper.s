@@ -16,7 +16,11 @@ gdt_flush:
     jmp 0x08:._gdt_flush
 
 ._gdt_flush:
-    mov ax, 0x28
+    ret
+
+global tss_flush
+tss_flush:
+    mov eax, [esp + 4]
     ltr ax
     ret
 
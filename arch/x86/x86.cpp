@@ -9,6 +9,7 @@
 #include "arch/x86/PIC.h"
 #include "arch/x86/PIT.h"
 #include "arch/x86/RTC.h"
+#include "arch/x86/SMP.h"
 #include "arch/x86/x86.h"
 
 #include "kernel/system/System.h"
@@ -21,6 +22,14 @@ void arch_halt() { hlt(); }
 
 void arch_yield() { asm("int $127"); }
 
+void arch_start_processors() { smp_initialize(); }
+
+int arch_processor_id() { return smp_processor_id(); }
+
+int arch_processor_count() { return smp_processor_count(); }
+
+void arch_tlb_sync() { smp_tlb_sync(); }
+
 void arch_save_context(Task *task)
 {
     fpu_save_context(task);
@@ -59,7 +68,6 @@ extern "C" void arch_main(void *info, uint32_t magic)
     pit_initialize(1000);
 
     acpi_initialize(multiboot);
-    //lapic_initialize();
 
     system_main(multiboot);
 }
@@ -17,6 +17,8 @@ struct __packed MADTRecord
     uint8_t lenght;
 };
 
+#define MADT_LOCAL_APIC_ENABLED (1 << 0)
+
 struct __packed MADTLocalApicRecord
 {
     MADTRecord header;
@@ -50,12 +52,12 @@ struct __packed MADT
 
         while ((uintptr_t)current < (uintptr_t)&header + header.Length)
         {
-            current = (MADTRecord *)(((uintptr_t)current) + current->lenght);
-
             if (callback(current) != Iteration::CONTINUE)
             {
                 return;
             }
+
+            current = (MADTRecord *)(((uintptr_t)current) + current->lenght);
         }
     }
 
@@ -1,2 +1,362 @@
+#include <abi/Paths.h>
+#include <libsystem/Assert.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/io/Stream.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/thread/Atomic.h>
 
-#include "kernel/devices/Devices.h"
+#include "kernel/devices/Disk.h"
+#include "kernel/filesystem/BufferCache.h"
+#include "kernel/filesystem/Filesystem.h"
+#include "kernel/scheduling/Blocker.h"
+#include "kernel/scheduling/Scheduler.h"
+
+static int _disk_id = 0;
+
+static Disk *_disks = nullptr;
+
+class BlockerDiskRequest : public Blocker
+{
+private:
+    DiskRequest *_request;
+
+public:
+    BlockerDiskRequest(DiskRequest *request) : _request(request)
+    {
+    }
+
+    void on_block(Task *task)
+    {
+        wait_on(task, _request->waiters);
+    }
+
+    bool can_unblock(Task *task)
+    {
+        __unused(task);
+
+        return _request->done;
+    }
+};
+
+/* --- Requests ------------------------------------------------------------- */
+
+void disk_request_initialize(DiskRequest *request, DiskRequestType type, uint64_t sector)
+{
+    request->type = type;
+    request->sector = sector;
+    request->sector_count = 0;
+    request->segment_count = 0;
+    request->merged = nullptr;
+    request->next = nullptr;
+    request->done = false;
+    request->result = SUCCESS;
+    request->callback = nullptr;
+    request->callback_data = nullptr;
+}
+
+void disk_request_add_segment(DiskRequest *request, uintptr_t address, size_t size)
+{
+    assert(request->segment_count < DISK_REQUEST_SEGMENTS);
+    assert(size % DISK_SECTOR_SIZE == 0);
+
+    request->segments[request->segment_count] = (DiskSegment){address, size};
+    request->segment_count++;
+    request->sector_count += size / DISK_SECTOR_SIZE;
+}
+
+static void disk_request_done(DiskRequest *request, Result result)
+{
+    request->result = result;
+    request->done = true;
+    request->waiters.wakeup();
+
+    if (request->callback)
+    {
+        request->callback(request, request->callback_data);
+    }
+}
+
+// Turn request into a part of into if they are next to each other on the disk.
+static bool disk_request_merge(Disk *disk, DiskRequest *into, DiskRequest *request)
+{
+    if (into->type != request->type ||
+        into->segment_count + request->segment_count > disk->max_segments)
+    {
+        return false;
+    }
+
+    if (into->sector + into->sector_count == request->sector)
+    {
+        for (size_t i = 0; i < request->segment_count; i++)
+        {
+            into->segments[into->segment_count + i] = request->segments[i];
+        }
+    }
+    else if (request->sector + request->sector_count == into->sector)
+    {
+        memmove(&into->segments[request->segment_count], &into->segments[0], into->segment_count * sizeof(DiskSegment));
+
+        for (size_t i = 0; i < request->segment_count; i++)
+        {
+            into->segments[i] = request->segments[i];
+        }
+
+        into->sector = request->sector;
+    }
+    else
+    {
+        return false;
+    }
+
+    into->segment_count += request->segment_count;
+    into->sector_count += request->sector_count;
+
+    request->next = into->merged;
+    into->merged = request;
+
+    return true;
+}
+
+/* --- Queue ---------------------------------------------------------------- */
+
+void disk_submit(Disk *disk, DiskRequest *request)
+{
+    AtomicHolder holder;
+
+    assert(request->segment_count > 0);
+
+    if (request->sector + request->sector_count > disk->sector_count)
+    {
+        disk_request_done(request, ERR_INVALID_ARGUMENT);
+        return;
+    }
+
+    // Keep the queue sorted so the device sweeps across the disk, and
+    // merge with the neighbours on the way.
+    DiskRequest *previous = nullptr;
+    DiskRequest *current = disk->pending;
+
+    while (current && current->sector < request->sector)
+    {
+        previous = current;
+        current = current->next;
+    }
+
+    if ((previous && disk_request_merge(disk, previous, request)) ||
+        (current && disk_request_merge(disk, current, request)))
+    {
+        return;
+    }
+
+    request->next = current;
+
+    if (previous)
+    {
+        previous->next = request;
+    }
+    else
+    {
+        disk->pending = request;
+    }
+}
+
+void disk_kick(Disk *disk)
+{
+    AtomicHolder holder;
+
+    bool submitted = false;
+
+    while (disk->pending && disk->in_flight < disk->max_in_flight)
+    {
+        DiskRequest *request = disk->pending;
+
+        if (!disk->submit(disk, request))
+        {
+            break;
+        }
+
+        disk->pending = request->next;
+        request->next = nullptr;
+
+        disk->in_flight++;
+        submitted = true;
+    }
+
+    if (submitted && disk->notify)
+    {
+        disk->notify(disk);
+    }
+}
+
+Result disk_wait(Disk *disk, DiskRequest *request)
+{
+    disk_kick(disk);
+
+    task_block(scheduler_running(), new BlockerDiskRequest(request), -1);
+
+    return request->result;
+}
+
+void disk_complete(Disk *disk, DiskRequest *request, Result result)
+{
+    AtomicHolder holder;
+
+    assert(disk->in_flight > 0);
+    disk->in_flight--;
+
+    // The waiters may reuse the requests as soon as they are done.
+    DiskRequest *merged = request->merged;
+    disk_request_done(request, result);
+
+    while (merged)
+    {
+        DiskRequest *next = merged->next;
+        disk_request_done(merged, result);
+        merged = next;
+    }
+
+    disk_kick(disk);
+}
+
+/* --- FsNode --------------------------------------------------------------- */
+
+static size_t disk_device_size(FsNode *node, FsHandle *handle);
+
+static void disk_device_close(FsNode *node, FsHandle *handle);
+
+class DiskDevice : public FsNode
+{
+private:
+public:
+    Disk *_disk;
+
+    DiskDevice(Disk *disk) : FsNode(FILE_TYPE_DEVICE), _disk(disk)
+    {
+        size = disk_device_size;
+        close = disk_device_close;
+    }
+
+    size_t capacity()
+    {
+        return MIN(_disk->sector_count * DISK_SECTOR_SIZE, (uint64_t)SIZE_MAX);
+    }
+
+    ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size)
+    {
+        if (handle.offset >= capacity())
+        {
+            return 0;
+        }
+
+        size = MIN(capacity() - handle.offset, size);
+
+        for (size_t done = 0; done < size;)
+        {
+            size_t offset = handle.offset + done;
+            size_t block_offset = offset % BUFFER_CACHE_BLOCK_SIZE;
+            size_t chunk = MIN(BUFFER_CACHE_BLOCK_SIZE - block_offset, size - done);
+
+            Buffer *block = buffer_cache_acquire(_disk, offset / BUFFER_CACHE_BLOCK_SIZE);
+
+            if (!block)
+            {
+                if (done > 0)
+                {
+                    return done;
+                }
+
+                return ERR_INPUT_OUTPUT_ERROR;
+            }
+
+            memcpy((char *)buffer + done, (char *)block->data + block_offset, chunk);
+            buffer_cache_release(block);
+
+            done += chunk;
+        }
+
+        return size;
+    }
+
+    ResultOr<size_t> write(FsHandle &handle, const void *buffer, size_t size)
+    {
+        if (handle.offset >= capacity())
+        {
+            return ERR_INVALID_ARGUMENT;
+        }
+
+        size = MIN(capacity() - handle.offset, size);
+
+        for (size_t done = 0; done < size;)
+        {
+            size_t offset = handle.offset + done;
+            size_t block_offset = offset % BUFFER_CACHE_BLOCK_SIZE;
+            size_t chunk = MIN(BUFFER_CACHE_BLOCK_SIZE - block_offset, size - done);
+
+            Buffer *block = buffer_cache_acquire(_disk, offset / BUFFER_CACHE_BLOCK_SIZE);
+
+            if (!block)
+            {
+                if (done > 0)
+                {
+                    return done;
+                }
+
+                return ERR_INPUT_OUTPUT_ERROR;
+            }
+
+            memcpy((char *)block->data + block_offset, (const char *)buffer + done, chunk);
+            buffer_cache_mark_dirty(block);
+            buffer_cache_release(block);
+
+            done += chunk;
+        }
+
+        return size;
+    }
+};
+
+static size_t disk_device_size(FsNode *node, FsHandle *handle)
+{
+    __unused(handle);
+
+    return ((DiskDevice *)node)->capacity();
+}
+
+static void disk_device_close(FsNode *node, FsHandle *handle)
+{
+    if (handle->has_flag(OPEN_WRITE))
+    {
+        buffer_cache_sync(((DiskDevice *)node)->_disk);
+    }
+}
+
+void disk_register(Disk *disk)
+{
+    {
+        AtomicHolder holder;
+
+        disk->id = _disk_id++;
+        disk->next = _disks;
+        _disks = disk;
+    }
+
+    char path[PATH_LENGTH];
+    snprintf(path, PATH_LENGTH, DISK_DEVICE_PATH "%d", disk->id);
+
+    filesystem_link_and_take_ref_cstring(path, new DiskDevice(disk));
+}
+
+Disk *disk_get(int id)
+{
+    AtomicHolder holder;
+
+    for (Disk *disk = _disks; disk; disk = disk->next)
+    {
+        if (disk->id == id)
+        {
+            return disk;
+        }
+    }
+
+    return nullptr;
+}
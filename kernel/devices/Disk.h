@@ -0,0 +1,100 @@
+#pragma once
+
+#include <libsystem/Result.h>
+
+#include "kernel/scheduling/WaitQueue.h"
+
+#define DISK_SECTOR_SIZE (512)
+
+#define DISK_REQUEST_SEGMENTS (16)
+
+enum DiskRequestType
+{
+    DISK_READ,
+    DISK_WRITE,
+};
+
+// Identity mapped memory, so the driver can hand its address to the device.
+struct DiskSegment
+{
+    uintptr_t address;
+    size_t size;
+};
+
+struct DiskRequest;
+
+// Called with interrupts disabled once the request is done, for requests
+// nobody waits for.
+typedef void (*DiskRequestCallback)(DiskRequest *request, void *data);
+
+// Everything in a request belongs to the disk from disk_submit() until it is
+// done, adjacent requests get merged together so their fields may change.
+struct DiskRequest
+{
+    DiskRequestType type;
+    uint64_t sector;
+    size_t sector_count;
+
+    DiskSegment segments[DISK_REQUEST_SEGMENTS];
+    size_t segment_count;
+
+    // Requests merged into this one, in sector order, done along with it.
+    DiskRequest *merged;
+    DiskRequest *next;
+
+    bool done;
+    Result result;
+    WaitQueue waiters;
+
+    DiskRequestCallback callback;
+    void *callback_data;
+};
+
+struct Disk;
+
+// Hand the request to the device, returns false if the device is busy.
+typedef bool (*DiskSubmitCallback)(Disk *disk, DiskRequest *request);
+
+// Tell the device about the requests submitted since the last time.
+typedef void (*DiskNotifyCallback)(Disk *disk);
+
+struct Disk
+{
+    int id;
+    uint64_t sector_count;
+
+    void *driver;
+    DiskSubmitCallback submit;
+    DiskNotifyCallback notify;
+
+    size_t max_segments;
+    size_t max_in_flight;
+
+    // Waiting for the device, sorted by sector.
+    DiskRequest *pending;
+    size_t in_flight;
+
+    Disk *next;
+};
+
+void disk_request_initialize(DiskRequest *request, DiskRequestType type, uint64_t sector);
+
+void disk_request_add_segment(DiskRequest *request, uintptr_t address, size_t size);
+
+// Queue the request, it is not passed to the device before the next kick.
+void disk_submit(Disk *disk, DiskRequest *request);
+
+// Pass as many pending requests as the device can take.
+void disk_kick(Disk *disk);
+
+// Kick the disk and block until the request is done.
+Result disk_wait(Disk *disk, DiskRequest *request);
+
+// Called by the driver when the device is done with a request.
+void disk_complete(Disk *disk, DiskRequest *request, Result result);
+
+// Expose the disk as /Devices/diskN.
+void disk_register(Disk *disk);
+
+// Returns the disk registered as /Devices/diskN, or nullptr.
+Disk *disk_get(int id);
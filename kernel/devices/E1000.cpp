@@ -223,6 +223,8 @@ size_t e1000_send_packet(const void *buffer, size_t size)
 
 /* --- FsNode --------------------------------------------------------------- */
 
+static FsNode *_net_node = nullptr;
+
 static void e1000_interrupt_handler()
 {
     e1000_write(E1000_REG_IMASK, 0x0);
@@ -235,6 +237,11 @@ static void e1000_interrupt_handler()
         uint32_t flags = e1000_read(E1000_REG_CONTROL);
         e1000_write(E1000_REG_CONTROL, flags | E1000_CTL_START_LINK);
     }
+
+    if (_net_node)
+    {
+        _net_node->waiters.wakeup();
+    }
 }
 
 Result net_iocall(FsNode *node, FsHandle *handle, IOCall iocall, void *args)
@@ -336,7 +343,8 @@ void e1000_initialize(DeviceInfo info)
     e1000_enable_interrupt();
 
     dispatcher_register_handler(pci_device_get_interrupt(info.pci_device), e1000_interrupt_handler);
-    filesystem_link_and_take_ref_cstring(NETWORK_DEVICE_PATH, new Net());
+    _net_node = new Net();
+    filesystem_link_cstring(NETWORK_DEVICE_PATH, _net_node);
 
     logger_debug("TX HEAD=%d TX TAIL=%d", e1000_read(E1000_REG_TX_HEAD), e1000_read(E1000_REG_TX_TAIL));
 }
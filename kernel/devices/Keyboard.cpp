@@ -158,6 +158,9 @@ void keyboard_handle_key(Key key, KeyMotion motion)
     }
 
     _keystate[key] = motion;
+
+    _characters_node->waiters.wakeup();
+    _events_node->waiters.wakeup();
 }
 
 Key keyboard_scancode_to_key(int scancode)
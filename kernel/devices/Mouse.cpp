@@ -10,6 +10,7 @@
 #include "kernel/filesystem/Filesystem.h"
 #include "kernel/interrupts/Dispatcher.h"
 
+static FsNode *_mouse_node;
 static RingBuffer *_mouse_buffer;
 static int _mouse_cycle = 0;
 static uint8_t _mouse_packet[4];
@@ -49,6 +50,8 @@ static void ps2mouse_handle_finished_packet(uint8_t packet0, uint8_t packet1, ui
     {
         logger_warn("Mouse buffer overflow!");
     }
+
+    _mouse_node->waiters.wakeup();
 }
 
 void ps2mouse_handle_packet(uint8_t packet)
@@ -187,7 +190,8 @@ void mouse_initialize()
 
     // Setup the mouse handler
     _mouse_buffer = new RingBuffer(sizeof(MousePacket) * 256);
+    _mouse_node = new Mouse();
     dispatcher_register_handler(12, ps2mouse_interrupt_handler);
 
-    filesystem_link_and_take_ref_cstring(MOUSE_DEVICE_PATH, new Mouse());
+    filesystem_link_cstring(MOUSE_DEVICE_PATH, _mouse_node);
 }
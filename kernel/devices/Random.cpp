@@ -1,4 +1,5 @@
 #include <abi/Paths.h>
+#include <libsystem/Logger.h>
 #include <libsystem/system/Random.h>
 
 #include "kernel/filesystem/Filesystem.h"
@@ -42,5 +43,9 @@ public:
 
 void random_initialize()
 {
-    filesystem_link_and_take_ref_cstring(UNIX_DEVICE_PATH("random"), new RandomDevice());
+    // A hardware entropy source may already be there, it is better than us.
+    if (filesystem_link_and_take_ref_cstring(UNIX_DEVICE_PATH("random"), new RandomDevice()) == ERR_FILE_EXISTS)
+    {
+        logger_info("Using the hardware entropy source for " UNIX_DEVICE_PATH("random"));
+    }
 }
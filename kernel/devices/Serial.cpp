@@ -10,6 +10,7 @@
 
 /* --- Serial device  node -------------------------------------------------- */
 
+static FsNode *serial_node;
 static RingBuffer *serial_buffer;
 
 void serial_interrupt_handler()
@@ -17,6 +18,8 @@ void serial_interrupt_handler()
     char byte = com_getc(COM1);
 
     serial_buffer->write((const char *)&byte, sizeof(byte));
+
+    serial_node->waiters.wakeup();
 }
 
 class Serial : public FsNode
@@ -56,8 +59,9 @@ public:
 void serial_initialize()
 {
     serial_buffer = new RingBuffer(1024);
+    serial_node = new Serial();
 
     dispatcher_register_handler(4, serial_interrupt_handler);
 
-    filesystem_link_and_take_ref_cstring(SERIAL_DEVICE_PATH, new Serial());
+    filesystem_link_cstring(SERIAL_DEVICE_PATH, serial_node);
 }
@@ -0,0 +1,524 @@
+#include <libsystem/Assert.h>
+#include <libsystem/Logger.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "kernel/filesystem/BufferCache.h"
+#include "kernel/memory/Memory.h"
+#include "kernel/scheduling/Blocker.h"
+#include "kernel/scheduling/Scheduler.h"
+
+#define BUFFER_CACHE_BUCKETS (128)
+
+static Buffer *_buckets[BUFFER_CACHE_BUCKETS] = {};
+
+static Buffer *_buffers = nullptr;
+static size_t _buffers_count = 0;
+
+// Buffers nobody holds a reference to, least recently used first.
+static Buffer *_lru_head = nullptr;
+static Buffer *_lru_tail = nullptr;
+
+class BlockerBuffer : public Blocker
+{
+private:
+    Buffer *_buffer;
+
+public:
+    BlockerBuffer(Buffer *buffer) : _buffer(buffer)
+    {
+    }
+
+    void on_block(Task *task)
+    {
+        wait_on(task, _buffer->waiters);
+    }
+
+    bool can_unblock(Task *task)
+    {
+        __unused(task);
+
+        return !_buffer->busy;
+    }
+};
+
+/* --- Lookup --------------------------------------------------------------- */
+
+static size_t buffer_hash(Disk *disk, uint64_t block)
+{
+    return ((uint32_t)disk->id * 31 + (uint32_t)block) % BUFFER_CACHE_BUCKETS;
+}
+
+static Buffer *buffer_lookup(Disk *disk, uint64_t block)
+{
+    for (Buffer *buffer = _buckets[buffer_hash(disk, block)]; buffer; buffer = buffer->hash_next)
+    {
+        if (buffer->disk == disk && buffer->block == block)
+        {
+            return buffer;
+        }
+    }
+
+    return nullptr;
+}
+
+static void buffer_hash_insert(Buffer *buffer)
+{
+    size_t bucket = buffer_hash(buffer->disk, buffer->block);
+
+    buffer->hash_next = _buckets[bucket];
+    _buckets[bucket] = buffer;
+}
+
+static void buffer_hash_remove(Buffer *buffer)
+{
+    Buffer **link = &_buckets[buffer_hash(buffer->disk, buffer->block)];
+
+    while (*link != buffer)
+    {
+        link = &(*link)->hash_next;
+    }
+
+    *link = buffer->hash_next;
+    buffer->hash_next = nullptr;
+}
+
+/* --- LRU ------------------------------------------------------------------ */
+
+static void buffer_lru_push_back(Buffer *buffer)
+{
+    buffer->lru_prev = _lru_tail;
+    buffer->lru_next = nullptr;
+
+    if (_lru_tail)
+    {
+        _lru_tail->lru_next = buffer;
+    }
+    else
+    {
+        _lru_head = buffer;
+    }
+
+    _lru_tail = buffer;
+}
+
+static void buffer_lru_remove(Buffer *buffer)
+{
+    if (buffer->lru_prev)
+    {
+        buffer->lru_prev->lru_next = buffer->lru_next;
+    }
+    else
+    {
+        _lru_head = buffer->lru_next;
+    }
+
+    if (buffer->lru_next)
+    {
+        buffer->lru_next->lru_prev = buffer->lru_prev;
+    }
+    else
+    {
+        _lru_tail = buffer->lru_prev;
+    }
+
+    buffer->lru_prev = nullptr;
+    buffer->lru_next = nullptr;
+}
+
+static void buffer_ref(Buffer *buffer)
+{
+    ASSERT_ATOMIC;
+
+    if (buffer->refcount == 0)
+    {
+        buffer_lru_remove(buffer);
+    }
+
+    buffer->refcount++;
+}
+
+// Prefer buffers we can drop without writing them first.
+static Buffer *buffer_find_victim()
+{
+    for (Buffer *buffer = _lru_head; buffer; buffer = buffer->lru_next)
+    {
+        if (!buffer->dirty)
+        {
+            return buffer;
+        }
+    }
+
+    return _lru_head;
+}
+
+static Buffer *buffer_create()
+{
+    uintptr_t page = 0;
+
+    if (memory_alloc_identity(memory_kpdir(), MEMORY_NONE, &page) != SUCCESS)
+    {
+        return nullptr;
+    }
+
+    Buffer *buffer = __create(Buffer);
+
+    buffer->data = (void *)page;
+    buffer->all_next = _buffers;
+    _buffers = buffer;
+    _buffers_count++;
+
+    return buffer;
+}
+
+/* --- IO ------------------------------------------------------------------- */
+
+// Wait for the buffer to be idle and take it, only one request at a time.
+static void buffer_begin_io(Buffer *buffer)
+{
+    while (true)
+    {
+        task_block(scheduler_running(), new BlockerBuffer(buffer), -1);
+
+        AtomicHolder holder;
+
+        if (!buffer->busy)
+        {
+            buffer->busy = true;
+            return;
+        }
+    }
+}
+
+static void buffer_end_io(Buffer *buffer)
+{
+    AtomicHolder holder;
+
+    buffer->busy = false;
+    buffer->waiters.wakeup();
+}
+
+static void buffer_submit(Buffer *buffer, DiskRequestType type, DiskRequestCallback callback)
+{
+    DiskRequest *request = &buffer->request;
+
+    disk_request_initialize(request, type, buffer->block * BUFFER_CACHE_SECTORS_PER_BLOCK);
+    disk_request_add_segment(request, (uintptr_t)buffer->data, buffer->size);
+
+    request->callback = callback;
+    request->callback_data = buffer;
+
+    disk_submit(buffer->disk, request);
+}
+
+static Result buffer_write_back(Buffer *buffer)
+{
+    buffer_begin_io(buffer);
+
+    if (!buffer->dirty)
+    {
+        buffer_end_io(buffer);
+        return SUCCESS;
+    }
+
+    buffer->dirty = false;
+    buffer_submit(buffer, DISK_WRITE, nullptr);
+
+    Result result = disk_wait(buffer->disk, &buffer->request);
+
+    if (result != SUCCESS)
+    {
+        buffer->dirty = true;
+    }
+
+    buffer_end_io(buffer);
+
+    return result;
+}
+
+// Find the buffer of the block or recycle one for it. If every buffer we
+// could recycle is dirty, returns nullptr and a referenced victim to write
+// back before trying again.
+static Buffer *buffer_take(Disk *disk, uint64_t block, Buffer **victim_to_write_back)
+{
+    AtomicHolder holder;
+
+    Buffer *buffer = buffer_lookup(disk, block);
+
+    if (buffer)
+    {
+        buffer_ref(buffer);
+        return buffer;
+    }
+
+    Buffer *victim = buffer_find_victim();
+
+    if (_buffers_count < BUFFER_CACHE_COUNT || victim == nullptr)
+    {
+        // Every buffer is in use, grow past the limit rather than failing.
+        buffer = buffer_create();
+
+        if (buffer == nullptr)
+        {
+            return nullptr;
+        }
+    }
+    else if (victim->dirty)
+    {
+        buffer_ref(victim);
+        *victim_to_write_back = victim;
+
+        return nullptr;
+    }
+    else
+    {
+        buffer = victim;
+        buffer_lru_remove(buffer);
+        buffer_hash_remove(buffer);
+    }
+
+    uint64_t sectors = MIN(disk->sector_count - block * BUFFER_CACHE_SECTORS_PER_BLOCK, BUFFER_CACHE_SECTORS_PER_BLOCK);
+
+    buffer->disk = disk;
+    buffer->block = block;
+    buffer->size = sectors * DISK_SECTOR_SIZE;
+    buffer->refcount = 1;
+    buffer->valid = false;
+    buffer->dirty = false;
+
+    buffer_hash_insert(buffer);
+
+    return buffer;
+}
+
+// Take the buffer of the block, writing back dirty victims as needed.
+static Buffer *buffer_get(Disk *disk, uint64_t block)
+{
+    Buffer *buffer = nullptr;
+
+    while (!buffer)
+    {
+        Buffer *victim = nullptr;
+        buffer = buffer_take(disk, block, &victim);
+
+        if (victim)
+        {
+            if (buffer_write_back(victim) != SUCCESS)
+            {
+                AtomicHolder holder;
+
+                logger_error("Failed to write back block %d of disk%d, dropping it!", (int)victim->block, victim->disk->id);
+                victim->dirty = false;
+            }
+
+            buffer_cache_release(victim);
+        }
+        else if (!buffer)
+        {
+            return nullptr;
+        }
+    }
+
+    return buffer;
+}
+
+static void buffer_prefetch_done(DiskRequest *request, void *data)
+{
+    Buffer *buffer = (Buffer *)data;
+
+    buffer->valid = request->result == SUCCESS;
+    buffer->busy = false;
+    buffer->waiters.wakeup();
+
+    buffer_cache_release(buffer);
+}
+
+/* --- Public API ----------------------------------------------------------- */
+
+uint64_t buffer_cache_block_count(Disk *disk)
+{
+    return (disk->sector_count + BUFFER_CACHE_SECTORS_PER_BLOCK - 1) / BUFFER_CACHE_SECTORS_PER_BLOCK;
+}
+
+Buffer *buffer_cache_acquire(Disk *disk, uint64_t block)
+{
+    if (block >= buffer_cache_block_count(disk))
+    {
+        return nullptr;
+    }
+
+    Buffer *buffer = buffer_get(disk, block);
+
+    if (!buffer)
+    {
+        return nullptr;
+    }
+
+    if (buffer->valid)
+    {
+        return buffer;
+    }
+
+    buffer_begin_io(buffer);
+
+    // Someone else read it while we were waiting.
+    if (buffer->valid)
+    {
+        buffer_end_io(buffer);
+        return buffer;
+    }
+
+    buffer_submit(buffer, DISK_READ, nullptr);
+    Result result = disk_wait(disk, &buffer->request);
+
+    buffer->valid = result == SUCCESS;
+    buffer_end_io(buffer);
+
+    if (result != SUCCESS)
+    {
+        logger_error("Failed to read block %d of disk%d: %s", (int)block, disk->id, result_to_string(result));
+
+        buffer_cache_release(buffer);
+        return nullptr;
+    }
+
+    return buffer;
+}
+
+Buffer *buffer_cache_acquire_zeroed(Disk *disk, uint64_t block)
+{
+    if (block >= buffer_cache_block_count(disk))
+    {
+        return nullptr;
+    }
+
+    Buffer *buffer = buffer_get(disk, block);
+
+    if (!buffer)
+    {
+        return nullptr;
+    }
+
+    // Wait for reads of the old content still in flight.
+    buffer_begin_io(buffer);
+
+    memset(buffer->data, 0, BUFFER_CACHE_BLOCK_SIZE);
+    buffer->valid = true;
+    buffer->dirty = true;
+
+    buffer_end_io(buffer);
+
+    return buffer;
+}
+
+void buffer_cache_prefetch(Disk *disk, uint64_t block)
+{
+    if (block >= buffer_cache_block_count(disk))
+    {
+        return;
+    }
+
+    AtomicHolder holder;
+
+    if (buffer_lookup(disk, block))
+    {
+        return;
+    }
+
+    // Readahead is only a hint, don't grow the cache or wait for write backs for it.
+    if (_buffers_count >= BUFFER_CACHE_COUNT)
+    {
+        Buffer *victim = buffer_find_victim();
+
+        if (!victim || victim->dirty)
+        {
+            return;
+        }
+    }
+
+    Buffer *victim = nullptr;
+    Buffer *buffer = buffer_take(disk, block, &victim);
+
+    if (!buffer)
+    {
+        return;
+    }
+
+    // The reference is dropped once the read is done.
+    buffer->busy = true;
+    buffer_submit(buffer, DISK_READ, buffer_prefetch_done);
+}
+
+void buffer_cache_release(Buffer *buffer)
+{
+    AtomicHolder holder;
+
+    assert(buffer->refcount > 0);
+
+    buffer->refcount--;
+
+    if (buffer->refcount == 0)
+    {
+        buffer_lru_push_back(buffer);
+    }
+}
+
+void buffer_cache_mark_dirty(Buffer *buffer)
+{
+    AtomicHolder holder;
+
+    assert(buffer->refcount > 0);
+
+    buffer->dirty = true;
+}
+
+Result buffer_cache_sync(Disk *disk)
+{
+    Buffer *writing = nullptr;
+
+    {
+        AtomicHolder holder;
+
+        // Buffers already busy are being written by someone else.
+        for (Buffer *buffer = _buffers; buffer; buffer = buffer->all_next)
+        {
+            if (buffer->disk != disk || !buffer->dirty || buffer->busy)
+            {
+                continue;
+            }
+
+            buffer_ref(buffer);
+            buffer->busy = true;
+            buffer->dirty = false;
+
+            buffer_submit(buffer, DISK_WRITE, nullptr);
+
+            buffer->sync_next = writing;
+            writing = buffer;
+        }
+    }
+
+    disk_kick(disk);
+
+    Result result = SUCCESS;
+
+    while (writing)
+    {
+        Buffer *buffer = writing;
+        writing = buffer->sync_next;
+
+        Result buffer_result = disk_wait(disk, &buffer->request);
+
+        if (buffer_result != SUCCESS)
+        {
+            buffer->dirty = true;
+            result = buffer_result;
+        }
+
+        buffer_end_io(buffer);
+        buffer_cache_release(buffer);
+    }
+
+    return result;
+}
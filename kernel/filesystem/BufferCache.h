@@ -0,0 +1,62 @@
+#pragma once
+
+#include "kernel/devices/Disk.h"
+
+#define BUFFER_CACHE_BLOCK_SIZE (4096)
+
+#define BUFFER_CACHE_SECTORS_PER_BLOCK (BUFFER_CACHE_BLOCK_SIZE / DISK_SECTOR_SIZE)
+
+// How many blocks stay around once nobody uses them.
+#define BUFFER_CACHE_COUNT (256)
+
+// A block of a disk kept in memory, shared by every filesystem and by the
+// disk devices themselves. Changes are written back by buffer_cache_sync(),
+// or when the buffer is evicted.
+struct Buffer
+{
+    Disk *disk;
+    uint64_t block;
+
+    // One identity mapped page, only the first size bytes are on the disk.
+    void *data;
+    size_t size;
+
+    int refcount;
+    bool valid;
+    bool dirty;
+
+    // The buffer is being read or written, its request is in use.
+    bool busy;
+    DiskRequest request;
+    WaitQueue waiters;
+
+    Buffer *hash_next;
+    Buffer *lru_prev;
+    Buffer *lru_next;
+    Buffer *all_next;
+    Buffer *sync_next;
+};
+
+// Returns the buffer with a reference, reading it from the disk if needed,
+// or nullptr if the block couldn't be read.
+Buffer *buffer_cache_acquire(Disk *disk, uint64_t block);
+
+// Returns the buffer of a block about to be overwritten, zeroed and marked
+// dirty without reading it from the disk.
+Buffer *buffer_cache_acquire_zeroed(Disk *disk, uint64_t block);
+
+// Start reading the block in the background if it isn't cached. Requests are
+// only passed to the device by the next disk_kick(), so prefetching a few
+// blocks in a row gets them merged.
+void buffer_cache_prefetch(Disk *disk, uint64_t block);
+
+void buffer_cache_release(Buffer *buffer);
+
+void buffer_cache_mark_dirty(Buffer *buffer);
+
+// Write every dirty buffer of the disk back, all at once so the requests
+// can be merged.
+Result buffer_cache_sync(Disk *disk);
+
+// Number of blocks of the disk, the last one may be partial.
+uint64_t buffer_cache_block_count(Disk *disk);
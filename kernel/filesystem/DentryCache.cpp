@@ -0,0 +1,178 @@
+#include <libsystem/core/CString.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "kernel/filesystem/DentryCache.h"
+
+#define DENTRY_CACHE_SETS 256
+#define DENTRY_CACHE_WAYS 4
+
+struct DentryCacheEntry
+{
+    FsNode *parent;
+    FsNode *node;
+    uint32_t hash;
+    uint32_t last_used;
+    char name[FILE_NAME_LENGTH];
+};
+
+static DentryCacheEntry _entries[DENTRY_CACHE_SETS][DENTRY_CACHE_WAYS] = {};
+static uint32_t _clock = 0;
+
+static uint32_t dentry_cache_hash(FsNode *parent, const char *name)
+{
+    uint32_t hash = 5381 ^ (uint32_t)(uintptr_t)parent;
+
+    for (int c; (c = *name++);)
+    {
+        hash = ((hash << 5) + hash) + c;
+    }
+
+    return hash;
+}
+
+static DentryCacheEntry *dentry_cache_set(uint32_t hash)
+{
+    return _entries[hash % DENTRY_CACHE_SETS];
+}
+
+static DentryCacheEntry *dentry_cache_find(FsNode *parent, const char *name, uint32_t hash)
+{
+    DentryCacheEntry *set = dentry_cache_set(hash);
+
+    for (size_t i = 0; i < DENTRY_CACHE_WAYS; i++)
+    {
+        DentryCacheEntry &entry = set[i];
+
+        if (entry.parent == parent &&
+            entry.hash == hash &&
+            strcmp(entry.name, name) == 0)
+        {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+static void dentry_cache_drop(DentryCacheEntry &entry)
+{
+    if (entry.parent)
+    {
+        entry.parent->dentries--;
+    }
+
+    if (entry.node)
+    {
+        entry.node->dentries--;
+    }
+
+    entry.parent = nullptr;
+    entry.node = nullptr;
+}
+
+bool dentry_cache_lookup(FsNode *parent, const char *name, FsNode **out_node)
+{
+    AtomicHolder holder;
+
+    uint32_t hash = dentry_cache_hash(parent, name);
+    DentryCacheEntry *entry = dentry_cache_find(parent, name, hash);
+
+    if (!entry)
+    {
+        return false;
+    }
+
+    // The entry doesn't hold a reference, the node might have lost its last
+    // one and be about to forget it, then it's as good as not there.
+    if (entry->node && !entry->node->try_ref())
+    {
+        return false;
+    }
+
+    entry->last_used = ++_clock;
+    *out_node = entry->node;
+
+    return true;
+}
+
+void dentry_cache_insert(FsNode *parent, const char *name, FsNode *node)
+{
+    if (strlen(name) >= FILE_NAME_LENGTH)
+    {
+        return;
+    }
+
+    AtomicHolder holder;
+
+    uint32_t hash = dentry_cache_hash(parent, name);
+
+    if (dentry_cache_find(parent, name, hash))
+    {
+        return;
+    }
+
+    DentryCacheEntry *set = dentry_cache_set(hash);
+    DentryCacheEntry *victim = &set[0];
+
+    for (size_t i = 0; i < DENTRY_CACHE_WAYS; i++)
+    {
+        if (!set[i].parent)
+        {
+            victim = &set[i];
+            break;
+        }
+
+        if (set[i].last_used < victim->last_used)
+        {
+            victim = &set[i];
+        }
+    }
+
+    dentry_cache_drop(*victim);
+
+    victim->parent = parent;
+    victim->node = node;
+    victim->hash = hash;
+    victim->last_used = ++_clock;
+    strcpy(victim->name, name);
+
+    parent->dentries++;
+
+    if (node)
+    {
+        node->dentries++;
+    }
+}
+
+void dentry_cache_invalidate(FsNode *parent, const char *name)
+{
+    AtomicHolder holder;
+
+    DentryCacheEntry *entry = dentry_cache_find(parent, name, dentry_cache_hash(parent, name));
+
+    if (entry)
+    {
+        dentry_cache_drop(*entry);
+    }
+}
+
+void dentry_cache_forget(FsNode *node)
+{
+    AtomicHolder holder;
+
+    if (node->dentries == 0)
+    {
+        return;
+    }
+
+    for (auto &set : _entries)
+    {
+        for (auto &entry : set)
+        {
+            if (entry.parent == node || entry.node == node)
+            {
+                dentry_cache_drop(entry);
+            }
+        }
+    }
+}
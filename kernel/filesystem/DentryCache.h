@@ -0,0 +1,21 @@
+#pragma once
+
+#include "kernel/node/Node.h"
+
+// Remembers the result of recent directory lookups, found or not, so path
+// resolution doesn't have to lock every directory on the way. Entries don't
+// hold references, the filesystem invalidates them before changing a
+// directory and nodes are forgotten when they are destroyed.
+
+// Returns true if (parent, name) is cached, *out_node is then the referenced
+// child or nullptr if we know there is no such entry.
+bool dentry_cache_lookup(FsNode *parent, const char *name, FsNode **out_node);
+
+// Must be called with the parent lock held, node is nullptr for a miss.
+void dentry_cache_insert(FsNode *parent, const char *name, FsNode *node);
+
+// Must be called with the parent lock held, before name is linked or unlinked.
+void dentry_cache_invalidate(FsNode *parent, const char *name);
+
+// Drop every entry about node, it's about to be destroyed.
+void dentry_cache_forget(FsNode *node);
@@ -0,0 +1,1734 @@
+#include <abi/Paths.h>
+#include <libsystem/Assert.h>
+#include <libsystem/Logger.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "kernel/filesystem/BufferCache.h"
+#include "kernel/filesystem/ExtentFS.h"
+#include "kernel/filesystem/Filesystem.h"
+#include "kernel/memory/PageCache.h"
+#include "kernel/node/Directory.h"
+
+// The disk is made of blocks the size of the ones of the buffer cache:
+//
+//  - block 0 is the superblock,
+//  - then comes a bitmap of the blocks in use,
+//  - then the inode table,
+//  - and the content of the files.
+//
+// Files are lists of extents, runs of contiguous blocks. Directories are
+// files of fixed size entries.
+
+#define EXTENTFS_BLOCK_SIZE BUFFER_CACHE_BLOCK_SIZE
+
+#define EXTENTFS_MAGIC "EXTENTFS"
+#define EXTENTFS_VERSION (1)
+
+#define EXTENTFS_ROOT (1)
+
+// One inode for every 64Kio of disk.
+#define EXTENTFS_BLOCKS_PER_INODE (16)
+
+#define EXTENTFS_INLINE_EXTENTS (13)
+#define EXTENTFS_OVERFLOW_EXTENTS (EXTENTFS_BLOCK_SIZE / sizeof(ExtentFSExtent))
+#define EXTENTFS_MAX_EXTENTS (EXTENTFS_INLINE_EXTENTS + EXTENTFS_OVERFLOW_EXTENTS)
+
+#define EXTENTFS_BITS_PER_BLOCK (EXTENTFS_BLOCK_SIZE * 8)
+#define EXTENTFS_INODES_PER_BLOCK (EXTENTFS_BLOCK_SIZE / sizeof(ExtentFSInode))
+#define EXTENTFS_ENTRIES_PER_BLOCK (EXTENTFS_BLOCK_SIZE / sizeof(ExtentFSEntry))
+
+// Sequential reads double how far ahead we read, up to this many blocks.
+#define EXTENTFS_READAHEAD_MAX (32)
+
+// Don't take more than a quarter of the buffer cache with a single read.
+#define EXTENTFS_PREFETCH_BATCH (BUFFER_CACHE_COUNT / 4)
+
+#define EXTENTFS_NODE_BUCKETS (64)
+
+/* --- On disk -------------------------------------------------------------- */
+
+struct __packed ExtentFSSuperblock
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t block_count;
+
+    uint32_t bitmap_start;
+    uint32_t bitmap_blocks;
+
+    uint32_t inodes_start;
+    uint32_t inodes_count;
+
+    uint32_t data_start;
+    uint32_t root;
+};
+
+struct __packed ExtentFSExtent
+{
+    uint32_t start;
+    uint32_t count;
+};
+
+struct __packed ExtentFSInode
+{
+    // FILE_TYPE_UNKNOWN when the inode is free.
+    uint16_t type;
+    uint16_t links;
+
+    uint32_t extents_count;
+    uint64_t size;
+    uint32_t blocks;
+
+    // Block holding the extents past the inline ones, 0 if there is none.
+    uint32_t overflow;
+
+    ExtentFSExtent extents[EXTENTFS_INLINE_EXTENTS];
+};
+
+static_assert(sizeof(ExtentFSInode) == 128, "ExtentFSInode should fit the inode table");
+
+// Slots with a null inode are free.
+struct __packed ExtentFSEntry
+{
+    uint32_t inode;
+    uint32_t reserved;
+    char name[FILE_NAME_LENGTH];
+};
+
+/* --- In memory ------------------------------------------------------------ */
+
+struct ExtentFSNode;
+
+// Inodes nobody links to anymore, freed once their node is gone.
+struct ExtentFSOrphan
+{
+    uint32_t inode;
+    ExtentFSOrphan *next;
+};
+
+struct ExtentFS
+{
+    Disk *disk;
+    ExtentFSSuperblock super;
+
+    // Taken to allocate or free blocks and inodes and to change links.
+    Lock lock;
+    uint32_t block_hint;
+    uint32_t inode_hint;
+
+    // Nodes of the inodes in use, at most one per inode, and the orphans.
+    // Both are only touched with interrupts disabled since nodes are
+    // destroyed from wherever their last reference is dropped.
+    ExtentFSNode *nodes[EXTENTFS_NODE_BUCKETS];
+    ExtentFSOrphan *orphans;
+
+    ExtentFSNode *root;
+};
+
+class ExtentFSNode : public FsNode
+{
+private:
+public:
+    ExtentFS *_fs;
+    uint32_t _inode;
+
+    // Copies of the inode, every change to it goes through this node.
+    uint16_t _links;
+    size_t _size;
+
+    // Where the last read stopped, and how many blocks past it we read.
+    size_t _sequential_end;
+    uint32_t _readahead;
+
+    ExtentFSNode *_next;
+
+    ExtentFSNode(ExtentFS *fs, uint32_t inode, FileType type, uint16_t links, size_t file_size);
+
+    ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size);
+
+    ResultOr<size_t> write(FsHandle &handle, const void *buffer, size_t size);
+};
+
+// The inode with the buffer holding it, and the one of its overflow extents
+// once they are used.
+struct ExtentFSInodeRef
+{
+    ExtentFS *fs;
+    Buffer *buffer;
+    Buffer *overflow;
+    ExtentFSInode *inode;
+};
+
+/* --- Inodes --------------------------------------------------------------- */
+
+// Inode numbers read from the disk have to be checked before they are used,
+// only the ones we came up with ourselves are taken for granted.
+static bool extentfs_inode_valid(ExtentFS *fs, uint32_t number)
+{
+    return number > 0 && number < fs->super.inodes_count;
+}
+
+static Result extentfs_inode_get(ExtentFS *fs, uint32_t number, ExtentFSInodeRef *ref)
+{
+    assert(extentfs_inode_valid(fs, number));
+
+    ref->fs = fs;
+    ref->overflow = nullptr;
+    ref->buffer = buffer_cache_acquire(fs->disk, fs->super.inodes_start + number / EXTENTFS_INODES_PER_BLOCK);
+
+    if (!ref->buffer)
+    {
+        return ERR_INPUT_OUTPUT_ERROR;
+    }
+
+    ref->inode = &((ExtentFSInode *)ref->buffer->data)[number % EXTENTFS_INODES_PER_BLOCK];
+
+    return SUCCESS;
+}
+
+static void extentfs_inode_put(ExtentFSInodeRef *ref)
+{
+    if (ref->overflow)
+    {
+        buffer_cache_release(ref->overflow);
+    }
+
+    buffer_cache_release(ref->buffer);
+}
+
+static void extentfs_inode_dirty(ExtentFSInodeRef *ref)
+{
+    buffer_cache_mark_dirty(ref->buffer);
+
+    if (ref->overflow)
+    {
+        buffer_cache_mark_dirty(ref->overflow);
+    }
+}
+
+static ExtentFSExtent *extentfs_inode_extent(ExtentFSInodeRef *ref, size_t index)
+{
+    if (index < EXTENTFS_INLINE_EXTENTS)
+    {
+        return &ref->inode->extents[index];
+    }
+
+    if (!ref->overflow)
+    {
+        ref->overflow = buffer_cache_acquire(ref->fs->disk, ref->inode->overflow);
+
+        if (!ref->overflow)
+        {
+            return nullptr;
+        }
+    }
+
+    return &((ExtentFSExtent *)ref->overflow->data)[index - EXTENTFS_INLINE_EXTENTS];
+}
+
+// Find the block of the disk behind a block of the file, returns how many
+// blocks follow it on the disk or 0 if it's past the end of the file.
+static uint32_t extentfs_inode_map(ExtentFSInodeRef *ref, uint32_t logical, uint32_t *physical)
+{
+    for (size_t i = 0; i < ref->inode->extents_count; i++)
+    {
+        ExtentFSExtent *extent = extentfs_inode_extent(ref, i);
+
+        if (!extent)
+        {
+            return 0;
+        }
+
+        if (logical < extent->count)
+        {
+            *physical = extent->start + logical;
+            return extent->count - logical;
+        }
+
+        logical -= extent->count;
+    }
+
+    return 0;
+}
+
+/* --- Allocation ----------------------------------------------------------- */
+
+static Buffer *extentfs_bitmap_acquire(ExtentFS *fs, uint32_t block)
+{
+    return buffer_cache_acquire(fs->disk, fs->super.bitmap_start + block / EXTENTFS_BITS_PER_BLOCK);
+}
+
+static bool extentfs_bitmap_test(Buffer *bitmap, uint32_t block)
+{
+    uint32_t bit = block % EXTENTFS_BITS_PER_BLOCK;
+
+    return ((uint8_t *)bitmap->data)[bit / 8] & (1 << (bit % 8));
+}
+
+// Number of free blocks in a row starting at start, up to max.
+static uint32_t extentfs_bitmap_free_run(ExtentFS *fs, uint32_t start, uint32_t max)
+{
+    if (start >= fs->super.block_count)
+    {
+        return 0;
+    }
+
+    max = MIN(max, fs->super.block_count - start);
+
+    uint32_t run = 0;
+
+    while (run < max)
+    {
+        Buffer *bitmap = extentfs_bitmap_acquire(fs, start + run);
+
+        if (!bitmap)
+        {
+            break;
+        }
+
+        bool used = false;
+
+        do
+        {
+            used = extentfs_bitmap_test(bitmap, start + run);
+
+            if (!used)
+            {
+                run++;
+            }
+        } while (!used && run < max && (start + run) % EXTENTFS_BITS_PER_BLOCK != 0);
+
+        buffer_cache_release(bitmap);
+
+        if (used)
+        {
+            break;
+        }
+    }
+
+    return run;
+}
+
+static Result extentfs_bitmap_set(ExtentFS *fs, uint32_t start, uint32_t count, bool used)
+{
+    uint32_t done = 0;
+
+    while (done < count)
+    {
+        Buffer *bitmap = extentfs_bitmap_acquire(fs, start + done);
+
+        if (!bitmap)
+        {
+            return ERR_INPUT_OUTPUT_ERROR;
+        }
+
+        uint8_t *bits = (uint8_t *)bitmap->data;
+
+        do
+        {
+            uint32_t bit = (start + done) % EXTENTFS_BITS_PER_BLOCK;
+
+            if (used)
+            {
+                bits[bit / 8] |= 1 << (bit % 8);
+            }
+            else
+            {
+                bits[bit / 8] &= ~(1 << (bit % 8));
+            }
+
+            done++;
+        } while (done < count && (start + done) % EXTENTFS_BITS_PER_BLOCK != 0);
+
+        buffer_cache_mark_dirty(bitmap);
+        buffer_cache_release(bitmap);
+    }
+
+    return SUCCESS;
+}
+
+// Find the first free block from a given one, wrapping around the disk.
+static bool extentfs_bitmap_find_free(ExtentFS *fs, uint32_t from, uint32_t *found)
+{
+    uint32_t count = fs->super.block_count;
+
+    for (uint32_t scanned = 0; scanned < count;)
+    {
+        uint32_t block = (from + scanned) % count;
+        uint32_t limit = MIN(EXTENTFS_BITS_PER_BLOCK - block % EXTENTFS_BITS_PER_BLOCK, count - block);
+        limit = MIN(limit, count - scanned);
+
+        Buffer *bitmap = extentfs_bitmap_acquire(fs, block);
+
+        if (!bitmap)
+        {
+            return false;
+        }
+
+        uint8_t *bits = (uint8_t *)bitmap->data;
+
+        for (uint32_t i = 0; i < limit; i++)
+        {
+            uint32_t bit = (block + i) % EXTENTFS_BITS_PER_BLOCK;
+
+            // Skip over full bytes.
+            if (bit % 8 == 0 && i + 8 <= limit && bits[bit / 8] == 0xFF)
+            {
+                i += 7;
+                continue;
+            }
+
+            if (!extentfs_bitmap_test(bitmap, block + i))
+            {
+                buffer_cache_release(bitmap);
+
+                *found = block + i;
+                return true;
+            }
+        }
+
+        buffer_cache_release(bitmap);
+
+        scanned += limit;
+    }
+
+    return false;
+}
+
+// Allocate up to count blocks in a row, right at goal if it's free. Returns
+// how many we got. Must be called with the filesystem lock held.
+static uint32_t extentfs_blocks_alloc(ExtentFS *fs, uint32_t goal, uint32_t count, uint32_t *start)
+{
+    uint32_t run = goal ? extentfs_bitmap_free_run(fs, goal, count) : 0;
+
+    if (run == 0)
+    {
+        if (!extentfs_bitmap_find_free(fs, fs->block_hint, &goal))
+        {
+            return 0;
+        }
+
+        run = extentfs_bitmap_free_run(fs, goal, count);
+    }
+
+    if (run == 0 || extentfs_bitmap_set(fs, goal, run, true) != SUCCESS)
+    {
+        return 0;
+    }
+
+    fs->block_hint = goal + run;
+    *start = goal;
+
+    return run;
+}
+
+static Result extentfs_inode_append(ExtentFSInodeRef *ref, uint32_t start, uint32_t count)
+{
+    ExtentFS *fs = ref->fs;
+    ExtentFSInode *inode = ref->inode;
+
+    // The file is too fragmented.
+    if (inode->extents_count == EXTENTFS_MAX_EXTENTS)
+    {
+        return ERR_NO_SPACE_LEFT_ON_DEVICE;
+    }
+
+    if (inode->extents_count == EXTENTFS_INLINE_EXTENTS && !inode->overflow)
+    {
+        uint32_t block = 0;
+
+        if (!extentfs_blocks_alloc(fs, 0, 1, &block))
+        {
+            return ERR_NO_SPACE_LEFT_ON_DEVICE;
+        }
+
+        ref->overflow = buffer_cache_acquire_zeroed(fs->disk, block);
+
+        if (!ref->overflow)
+        {
+            extentfs_bitmap_set(fs, block, 1, false);
+            return ERR_INPUT_OUTPUT_ERROR;
+        }
+
+        inode->overflow = block;
+    }
+
+    ExtentFSExtent *extent = extentfs_inode_extent(ref, inode->extents_count);
+
+    if (!extent)
+    {
+        return ERR_INPUT_OUTPUT_ERROR;
+    }
+
+    extent->start = start;
+    extent->count = count;
+    inode->extents_count++;
+
+    extentfs_inode_dirty(ref);
+
+    return SUCCESS;
+}
+
+// Give the inode at least that many blocks, trying to keep them next to the
+// ones it already has. Must be called with the filesystem lock held.
+static Result extentfs_inode_grow(ExtentFSInodeRef *ref, uint32_t blocks)
+{
+    ExtentFSInode *inode = ref->inode;
+
+    while (inode->blocks < blocks)
+    {
+        ExtentFSExtent *last = nullptr;
+
+        if (inode->extents_count > 0)
+        {
+            last = extentfs_inode_extent(ref, inode->extents_count - 1);
+
+            if (!last)
+            {
+                return ERR_INPUT_OUTPUT_ERROR;
+            }
+        }
+
+        uint32_t goal = last ? last->start + last->count : 0;
+        uint32_t start = 0;
+        uint32_t count = extentfs_blocks_alloc(ref->fs, goal, blocks - inode->blocks, &start);
+
+        if (count == 0)
+        {
+            return ERR_NO_SPACE_LEFT_ON_DEVICE;
+        }
+
+        if (last && start == goal)
+        {
+            last->count += count;
+        }
+        else
+        {
+            Result result = extentfs_inode_append(ref, start, count);
+
+            if (result != SUCCESS)
+            {
+                extentfs_bitmap_set(ref->fs, start, count, false);
+                return result;
+            }
+        }
+
+        inode->blocks += count;
+        extentfs_inode_dirty(ref);
+    }
+
+    return SUCCESS;
+}
+
+// Give all the blocks of the inode back. Must be called with the filesystem
+// lock held.
+static Result extentfs_inode_truncate(ExtentFSInodeRef *ref)
+{
+    ExtentFS *fs = ref->fs;
+    ExtentFSInode *inode = ref->inode;
+
+    for (size_t i = 0; i < inode->extents_count; i++)
+    {
+        ExtentFSExtent *extent = extentfs_inode_extent(ref, i);
+
+        if (!extent)
+        {
+            return ERR_INPUT_OUTPUT_ERROR;
+        }
+
+        extentfs_bitmap_set(fs, extent->start, extent->count, false);
+    }
+
+    if (inode->overflow)
+    {
+        extentfs_bitmap_set(fs, inode->overflow, 1, false);
+
+        if (ref->overflow)
+        {
+            buffer_cache_release(ref->overflow);
+            ref->overflow = nullptr;
+        }
+
+        inode->overflow = 0;
+    }
+
+    inode->extents_count = 0;
+    inode->blocks = 0;
+    inode->size = 0;
+
+    extentfs_inode_dirty(ref);
+
+    return SUCCESS;
+}
+
+// Must be called with the filesystem lock held.
+static Result extentfs_inode_alloc(ExtentFS *fs, FileType type, uint32_t *number)
+{
+    for (uint32_t i = 0; i < fs->super.inodes_count; i++)
+    {
+        uint32_t candidate = (fs->inode_hint + i) % fs->super.inodes_count;
+
+        // Inode 0 stands for free directory entries.
+        if (candidate == 0)
+        {
+            continue;
+        }
+
+        ExtentFSInodeRef ref;
+        Result result = extentfs_inode_get(fs, candidate, &ref);
+
+        if (result != SUCCESS)
+        {
+            return result;
+        }
+
+        if (ref.inode->type == FILE_TYPE_UNKNOWN)
+        {
+            memset(ref.inode, 0, sizeof(ExtentFSInode));
+            ref.inode->type = type;
+            ref.inode->links = 1;
+
+            extentfs_inode_dirty(&ref);
+            extentfs_inode_put(&ref);
+
+            fs->inode_hint = candidate + 1;
+            *number = candidate;
+
+            return SUCCESS;
+        }
+
+        extentfs_inode_put(&ref);
+    }
+
+    return ERR_NO_SPACE_LEFT_ON_DEVICE;
+}
+
+// Must be called with the filesystem lock held.
+static Result extentfs_inode_free(ExtentFS *fs, uint32_t number)
+{
+    ExtentFSInodeRef ref;
+    Result result = extentfs_inode_get(fs, number, &ref);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    result = extentfs_inode_truncate(&ref);
+
+    if (result == SUCCESS)
+    {
+        memset(ref.inode, 0, sizeof(ExtentFSInode));
+        extentfs_inode_dirty(&ref);
+
+        fs->inode_hint = MIN(fs->inode_hint, number);
+    }
+
+    extentfs_inode_put(&ref);
+
+    return result;
+}
+
+/* --- Nodes ---------------------------------------------------------------- */
+
+static void extentfs_node_destroy(ExtentFSNode *node);
+
+// The node may be on its way to destruction, don't bring it back.
+static ExtentFSNode *extentfs_node_lookup(ExtentFS *fs, uint32_t inode)
+{
+    AtomicHolder holder;
+
+    for (ExtentFSNode *node = fs->nodes[inode % EXTENTFS_NODE_BUCKETS]; node; node = node->_next)
+    {
+        if (node->_inode == inode && node->try_ref())
+        {
+            return node;
+        }
+    }
+
+    return nullptr;
+}
+
+// Returns the node of the inode with a reference, creating it if needed.
+static Result extentfs_node_get(ExtentFS *fs, uint32_t inode, ExtentFSNode **result_node)
+{
+    // They come from directory entries on the disk.
+    if (!extentfs_inode_valid(fs, inode))
+    {
+        logger_error("Inode %d of disk%d doesn't exist", inode, fs->disk->id);
+        return ERR_INPUT_OUTPUT_ERROR;
+    }
+
+    ExtentFSNode *node = extentfs_node_lookup(fs, inode);
+
+    if (node)
+    {
+        *result_node = node;
+        return SUCCESS;
+    }
+
+    ExtentFSInodeRef ref;
+    Result result = extentfs_inode_get(fs, inode, &ref);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    FileType type = (FileType)ref.inode->type;
+    uint16_t links = ref.inode->links;
+    size_t size = ref.inode->size;
+
+    extentfs_inode_put(&ref);
+
+    if (type != FILE_TYPE_REGULAR && type != FILE_TYPE_DIRECTORY)
+    {
+        logger_error("Inode %d of disk%d is corrupted", inode, fs->disk->id);
+        return ERR_NO_SUCH_FILE_OR_DIRECTORY;
+    }
+
+    node = new ExtentFSNode(fs, inode, type, links, size);
+
+    AtomicHolder holder;
+
+    // Someone else might have made one while we were reading the inode.
+    ExtentFSNode *existing = extentfs_node_lookup(fs, inode);
+
+    if (existing)
+    {
+        node->deref();
+        node = existing;
+    }
+    else
+    {
+        node->_next = fs->nodes[inode % EXTENTFS_NODE_BUCKETS];
+        fs->nodes[inode % EXTENTFS_NODE_BUCKETS] = node;
+    }
+
+    *result_node = node;
+
+    return SUCCESS;
+}
+
+// Must be called with the filesystem lock held.
+static Result extentfs_node_set_links(ExtentFSNode *node, uint16_t links)
+{
+    ExtentFSInodeRef ref;
+    Result result = extentfs_inode_get(node->_fs, node->_inode, &ref);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    ref.inode->links = links;
+    node->_links = links;
+
+    extentfs_inode_dirty(&ref);
+    extentfs_inode_put(&ref);
+
+    return SUCCESS;
+}
+
+// Free the inodes of the nodes destroyed since the last time.
+static void extentfs_reap(ExtentFS *fs)
+{
+    while (true)
+    {
+        ExtentFSOrphan *orphan = nullptr;
+
+        {
+            AtomicHolder holder;
+
+            orphan = fs->orphans;
+
+            if (orphan)
+            {
+                fs->orphans = orphan->next;
+            }
+        }
+
+        if (!orphan)
+        {
+            return;
+        }
+
+        {
+            LockHolder holder(fs->lock);
+
+            if (extentfs_inode_free(fs, orphan->inode) != SUCCESS)
+            {
+                logger_error("Failed to free inode %d of disk%d", orphan->inode, fs->disk->id);
+            }
+        }
+
+        free(orphan);
+    }
+}
+
+/* --- Directories ---------------------------------------------------------- */
+
+static Buffer *extentfs_directory_block(ExtentFSInodeRef *directory, uint32_t block)
+{
+    uint32_t physical = 0;
+
+    if (!extentfs_inode_map(directory, block, &physical))
+    {
+        return nullptr;
+    }
+
+    return buffer_cache_acquire(directory->fs->disk, physical);
+}
+
+// Returns the inode of the entry called name and its slot, or 0.
+static uint32_t extentfs_directory_lookup(ExtentFSInodeRef *directory, const char *name, uint32_t *slot)
+{
+    for (uint32_t block = 0; block < directory->inode->blocks; block++)
+    {
+        Buffer *buffer = extentfs_directory_block(directory, block);
+
+        if (!buffer)
+        {
+            return 0;
+        }
+
+        ExtentFSEntry *entries = (ExtentFSEntry *)buffer->data;
+
+        for (size_t i = 0; i < EXTENTFS_ENTRIES_PER_BLOCK; i++)
+        {
+            if (entries[i].inode && strncmp(entries[i].name, name, FILE_NAME_LENGTH) == 0)
+            {
+                uint32_t inode = entries[i].inode;
+                *slot = block * EXTENTFS_ENTRIES_PER_BLOCK + i;
+
+                buffer_cache_release(buffer);
+
+                return inode;
+            }
+        }
+
+        buffer_cache_release(buffer);
+    }
+
+    return 0;
+}
+
+static Result extentfs_directory_add(ExtentFSInodeRef *directory, const char *name, uint32_t inode)
+{
+    ExtentFSEntry *entry = nullptr;
+    Buffer *buffer = nullptr;
+
+    for (uint32_t block = 0; !entry && block < directory->inode->blocks; block++)
+    {
+        buffer = extentfs_directory_block(directory, block);
+
+        if (!buffer)
+        {
+            return ERR_INPUT_OUTPUT_ERROR;
+        }
+
+        ExtentFSEntry *entries = (ExtentFSEntry *)buffer->data;
+
+        for (size_t i = 0; !entry && i < EXTENTFS_ENTRIES_PER_BLOCK; i++)
+        {
+            if (!entries[i].inode)
+            {
+                entry = &entries[i];
+            }
+        }
+
+        if (!entry)
+        {
+            buffer_cache_release(buffer);
+        }
+    }
+
+    if (!entry)
+    {
+        uint32_t block = directory->inode->blocks;
+
+        {
+            LockHolder holder(directory->fs->lock);
+
+            Result result = extentfs_inode_grow(directory, block + 1);
+
+            if (result != SUCCESS)
+            {
+                return result;
+            }
+        }
+
+        uint32_t physical = 0;
+        extentfs_inode_map(directory, block, &physical);
+
+        buffer = buffer_cache_acquire_zeroed(directory->fs->disk, physical);
+
+        if (!buffer)
+        {
+            return ERR_INPUT_OUTPUT_ERROR;
+        }
+
+        directory->inode->size = (uint64_t)directory->inode->blocks * EXTENTFS_BLOCK_SIZE;
+        extentfs_inode_dirty(directory);
+
+        entry = (ExtentFSEntry *)buffer->data;
+    }
+
+    memset(entry, 0, sizeof(ExtentFSEntry));
+    strncpy(entry->name, name, FILE_NAME_LENGTH - 1);
+    entry->inode = inode;
+
+    buffer_cache_mark_dirty(buffer);
+    buffer_cache_release(buffer);
+
+    return SUCCESS;
+}
+
+static Result extentfs_directory_remove(ExtentFSInodeRef *directory, uint32_t slot)
+{
+    Buffer *buffer = extentfs_directory_block(directory, slot / EXTENTFS_ENTRIES_PER_BLOCK);
+
+    if (!buffer)
+    {
+        return ERR_INPUT_OUTPUT_ERROR;
+    }
+
+    ExtentFSEntry *entry = &((ExtentFSEntry *)buffer->data)[slot % EXTENTFS_ENTRIES_PER_BLOCK];
+    memset(entry, 0, sizeof(ExtentFSEntry));
+
+    buffer_cache_mark_dirty(buffer);
+    buffer_cache_release(buffer);
+
+    return SUCCESS;
+}
+
+static bool extentfs_directory_is_empty(ExtentFSInodeRef *directory)
+{
+    for (uint32_t block = 0; block < directory->inode->blocks; block++)
+    {
+        Buffer *buffer = extentfs_directory_block(directory, block);
+
+        if (!buffer)
+        {
+            return false;
+        }
+
+        ExtentFSEntry *entries = (ExtentFSEntry *)buffer->data;
+
+        for (size_t i = 0; i < EXTENTFS_ENTRIES_PER_BLOCK; i++)
+        {
+            if (entries[i].inode)
+            {
+                buffer_cache_release(buffer);
+                return false;
+            }
+        }
+
+        buffer_cache_release(buffer);
+    }
+
+    return true;
+}
+
+static Result extentfs_directory_open(ExtentFSNode *node, FsHandle *handle)
+{
+    ExtentFSInodeRef directory;
+    Result result = extentfs_inode_get(node->_fs, node->_inode, &directory);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    size_t capacity = directory.inode->blocks * EXTENTFS_ENTRIES_PER_BLOCK;
+    DirectoryListing *listing = (DirectoryListing *)malloc(sizeof(DirectoryListing) + sizeof(DirectoryEntry) * capacity);
+    listing->count = 0;
+
+    for (uint32_t block = 0; block < directory.inode->blocks; block++)
+    {
+        Buffer *buffer = extentfs_directory_block(&directory, block);
+
+        if (!buffer)
+        {
+            break;
+        }
+
+        ExtentFSEntry *entries = (ExtentFSEntry *)buffer->data;
+
+        for (size_t i = 0; i < EXTENTFS_ENTRIES_PER_BLOCK; i++)
+        {
+            ExtentFSInodeRef child;
+
+            if (!extentfs_inode_valid(node->_fs, entries[i].inode) ||
+                extentfs_inode_get(node->_fs, entries[i].inode, &child) != SUCCESS)
+            {
+                continue;
+            }
+
+            DirectoryEntry *record = &listing->entries[listing->count];
+
+            strncpy(record->name, entries[i].name, FILE_NAME_LENGTH);
+            record->name[FILE_NAME_LENGTH - 1] = '\0';
+            record->stat.type = (FileType)child.inode->type;
+            record->stat.size = child.inode->size;
+
+            extentfs_inode_put(&child);
+
+            listing->count++;
+        }
+
+        buffer_cache_release(buffer);
+    }
+
+    extentfs_inode_put(&directory);
+
+    handle->attached = listing;
+
+    return SUCCESS;
+}
+
+/* --- FsNode --------------------------------------------------------------- */
+
+static Result extentfs_node_open(ExtentFSNode *node, FsHandle *handle)
+{
+    if (node->type == FILE_TYPE_DIRECTORY)
+    {
+        return extentfs_directory_open(node, handle);
+    }
+
+    if (handle->has_flag(OPEN_TRUNC) && node->_size > 0)
+    {
+        ExtentFSInodeRef ref;
+        Result result = extentfs_inode_get(node->_fs, node->_inode, &ref);
+
+        if (result != SUCCESS)
+        {
+            return result;
+        }
+
+        {
+            LockHolder holder(node->_fs->lock);
+            result = extentfs_inode_truncate(&ref);
+        }
+
+        extentfs_inode_put(&ref);
+
+        node->_size = 0;
+        page_cache_invalidate(node);
+
+        return result;
+    }
+
+    return SUCCESS;
+}
+
+static void extentfs_node_close(ExtentFSNode *node, FsHandle *handle)
+{
+    if (node->type == FILE_TYPE_DIRECTORY)
+    {
+        free(handle->attached);
+    }
+    else if (handle->has_flag(OPEN_WRITE))
+    {
+        buffer_cache_sync(node->_fs->disk);
+    }
+}
+
+static size_t extentfs_node_size(ExtentFSNode *node, FsHandle *handle)
+{
+    __unused(handle);
+
+    return node->_size;
+}
+
+static FsNode *extentfs_node_find(ExtentFSNode *node, const char *name)
+{
+    ExtentFSInodeRef directory;
+
+    if (extentfs_inode_get(node->_fs, node->_inode, &directory) != SUCCESS)
+    {
+        return nullptr;
+    }
+
+    uint32_t slot = 0;
+    uint32_t inode = extentfs_directory_lookup(&directory, name, &slot);
+
+    extentfs_inode_put(&directory);
+
+    ExtentFSNode *child = nullptr;
+
+    if (!inode || extentfs_node_get(node->_fs, inode, &child) != SUCCESS)
+    {
+        return nullptr;
+    }
+
+    return child;
+}
+
+static Result extentfs_node_create(ExtentFSNode *node, const char *name, FileType type, FsNode **child)
+{
+    *child = nullptr;
+
+    if (type != FILE_TYPE_REGULAR && type != FILE_TYPE_DIRECTORY)
+    {
+        return ERR_OPERATION_NOT_SUPPORTED;
+    }
+
+    if (strlen(name) >= FILE_NAME_LENGTH)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    ExtentFS *fs = node->_fs;
+
+    ExtentFSInodeRef directory;
+    Result result = extentfs_inode_get(fs, node->_inode, &directory);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    uint32_t slot = 0;
+    uint32_t inode = extentfs_directory_lookup(&directory, name, &slot);
+
+    if (!inode)
+    {
+        extentfs_reap(fs);
+
+        {
+            LockHolder holder(fs->lock);
+            result = extentfs_inode_alloc(fs, type, &inode);
+        }
+
+        if (result == SUCCESS)
+        {
+            result = extentfs_directory_add(&directory, name, inode);
+            node->_size = directory.inode->size;
+
+            if (result != SUCCESS)
+            {
+                LockHolder holder(fs->lock);
+                extentfs_inode_free(fs, inode);
+            }
+        }
+    }
+
+    extentfs_inode_put(&directory);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    return extentfs_node_get(fs, inode, (ExtentFSNode **)child);
+}
+
+static Result extentfs_node_link(ExtentFSNode *node, const char *name, FsNode *child)
+{
+    // Nodes of other filesystems have nowhere to go on the disk.
+    if (child->destroy != (FsNodeDestroyCallback)extentfs_node_destroy ||
+        ((ExtentFSNode *)child)->_fs != node->_fs)
+    {
+        return ERR_OPERATION_NOT_SUPPORTED;
+    }
+
+    if (strlen(name) >= FILE_NAME_LENGTH)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    ExtentFSNode *extentfs_child = (ExtentFSNode *)child;
+
+    ExtentFSInodeRef directory;
+    Result result = extentfs_inode_get(node->_fs, node->_inode, &directory);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    uint32_t slot = 0;
+
+    if (extentfs_directory_lookup(&directory, name, &slot))
+    {
+        result = ERR_FILE_EXISTS;
+    }
+    else
+    {
+        result = extentfs_directory_add(&directory, name, extentfs_child->_inode);
+        node->_size = directory.inode->size;
+    }
+
+    extentfs_inode_put(&directory);
+
+    if (result == SUCCESS)
+    {
+        LockHolder holder(node->_fs->lock);
+        result = extentfs_node_set_links(extentfs_child, extentfs_child->_links + 1);
+    }
+
+    return result;
+}
+
+static Result extentfs_node_unlink(ExtentFSNode *node, const char *name)
+{
+    ExtentFS *fs = node->_fs;
+
+    ExtentFSInodeRef directory;
+    Result result = extentfs_inode_get(fs, node->_inode, &directory);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    uint32_t slot = 0;
+    uint32_t inode = extentfs_directory_lookup(&directory, name, &slot);
+
+    ExtentFSNode *child = nullptr;
+
+    if (!inode)
+    {
+        result = ERR_NO_SUCH_FILE_OR_DIRECTORY;
+    }
+    else
+    {
+        result = extentfs_node_get(fs, inode, &child);
+    }
+
+    if (result == SUCCESS && child->type == FILE_TYPE_DIRECTORY && child->_links == 1)
+    {
+        ExtentFSInodeRef child_directory;
+        result = extentfs_inode_get(fs, child->_inode, &child_directory);
+
+        if (result == SUCCESS)
+        {
+            if (!extentfs_directory_is_empty(&child_directory))
+            {
+                result = ERR_DIRECTORY_NOT_EMPTY;
+            }
+
+            extentfs_inode_put(&child_directory);
+        }
+    }
+
+    if (result == SUCCESS)
+    {
+        result = extentfs_directory_remove(&directory, slot);
+    }
+
+    extentfs_inode_put(&directory);
+
+    if (result == SUCCESS)
+    {
+        LockHolder holder(fs->lock);
+        result = extentfs_node_set_links(child, child->_links - 1);
+    }
+
+    // The inode is freed along with the node if this was the last link.
+    if (child)
+    {
+        child->deref();
+    }
+
+    extentfs_reap(fs);
+
+    return result;
+}
+
+static void extentfs_node_destroy(ExtentFSNode *node)
+{
+    AtomicHolder holder;
+
+    ExtentFS *fs = node->_fs;
+
+    ExtentFSNode **link = &fs->nodes[node->_inode % EXTENTFS_NODE_BUCKETS];
+
+    while (*link && *link != node)
+    {
+        link = &(*link)->_next;
+    }
+
+    if (*link)
+    {
+        *link = node->_next;
+    }
+
+    // Freeing the inode means going to the disk, we might be in the middle
+    // of an interrupt handler so leave it to extentfs_reap().
+    if (node->_links == 0)
+    {
+        ExtentFSOrphan *orphan = __create(ExtentFSOrphan);
+
+        orphan->inode = node->_inode;
+        orphan->next = fs->orphans;
+        fs->orphans = orphan;
+    }
+}
+
+ExtentFSNode::ExtentFSNode(ExtentFS *fs, uint32_t inode, FileType type, uint16_t links, size_t file_size)
+    : FsNode(type), _fs(fs), _inode(inode), _links(links), _size(file_size)
+{
+    _sequential_end = 0;
+    _readahead = 0;
+    _next = nullptr;
+
+    open = (FsNodeOpenCallback)extentfs_node_open;
+    close = (FsNodeCloseCallback)extentfs_node_close;
+    size = (FsNodeSizeCallback)extentfs_node_size;
+    destroy = (FsNodeDestroyCallback)extentfs_node_destroy;
+
+    if (type == FILE_TYPE_DIRECTORY)
+    {
+        find = (FsNodeFindCallback)extentfs_node_find;
+        link = (FsNodeLinkCallback)extentfs_node_link;
+        unlink = (FsNodeUnlinkCallback)extentfs_node_unlink;
+        create = (FsNodeCreateCallback)extentfs_node_create;
+    }
+}
+
+// Start reading the blocks of the file in [first, end), returns where we
+// stopped.
+static uint32_t extentfs_prefetch(ExtentFSInodeRef *ref, uint32_t first, uint32_t end)
+{
+    uint32_t logical = first;
+
+    while (logical < end)
+    {
+        uint32_t physical = 0;
+        uint32_t run = extentfs_inode_map(ref, logical, &physical);
+
+        if (!run)
+        {
+            break;
+        }
+
+        run = MIN(run, end - logical);
+
+        for (uint32_t i = 0; i < run; i++)
+        {
+            buffer_cache_prefetch(ref->fs->disk, physical + i);
+        }
+
+        logical += run;
+    }
+
+    disk_kick(ref->fs->disk);
+
+    return MAX(logical, first + 1);
+}
+
+ResultOr<size_t> ExtentFSNode::read(FsHandle &handle, void *buffer, size_t size)
+{
+    if (type == FILE_TYPE_DIRECTORY)
+    {
+        DirectoryListing *listing = (DirectoryListing *)handle.attached;
+        size_t index = handle.offset / sizeof(DirectoryEntry);
+
+        if (!listing || size != sizeof(DirectoryEntry) || index >= listing->count)
+        {
+            return 0;
+        }
+
+        *((DirectoryEntry *)buffer) = listing->entries[index];
+
+        return sizeof(DirectoryEntry);
+    }
+
+    if (handle.offset >= _size)
+    {
+        return 0;
+    }
+
+    size = MIN(_size - handle.offset, size);
+
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    ExtentFSInodeRef ref;
+    Result result = extentfs_inode_get(_fs, _inode, &ref);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    // Read further ahead each time the file is read where the last read
+    // stopped, and only what's asked for otherwise.
+    if (handle.offset == _sequential_end)
+    {
+        _readahead = MIN(MAX(_readahead * 2, 1u), (uint32_t)EXTENTFS_READAHEAD_MAX);
+    }
+    else
+    {
+        _readahead = 0;
+    }
+
+    _sequential_end = handle.offset + size;
+
+    uint32_t last = MIN((handle.offset + size - 1) / EXTENTFS_BLOCK_SIZE + _readahead, ref.inode->blocks - 1);
+    uint32_t prefetched = handle.offset / EXTENTFS_BLOCK_SIZE;
+
+    size_t done = 0;
+
+    while (done < size)
+    {
+        size_t offset = handle.offset + done;
+        size_t block_offset = offset % EXTENTFS_BLOCK_SIZE;
+        size_t chunk = MIN(EXTENTFS_BLOCK_SIZE - block_offset, size - done);
+        uint32_t logical = offset / EXTENTFS_BLOCK_SIZE;
+
+        if (logical >= prefetched)
+        {
+            prefetched = extentfs_prefetch(&ref, logical, MIN(last + 1, logical + EXTENTFS_PREFETCH_BATCH));
+        }
+
+        uint32_t physical = 0;
+        Buffer *block = nullptr;
+
+        if (extentfs_inode_map(&ref, logical, &physical))
+        {
+            block = buffer_cache_acquire(_fs->disk, physical);
+        }
+
+        if (!block)
+        {
+            break;
+        }
+
+        memcpy((char *)buffer + done, (char *)block->data + block_offset, chunk);
+        buffer_cache_release(block);
+
+        done += chunk;
+    }
+
+    extentfs_inode_put(&ref);
+
+    // The very first block couldn't be read.
+    if (done == 0)
+    {
+        return ERR_INPUT_OUTPUT_ERROR;
+    }
+
+    return done;
+}
+
+ResultOr<size_t> ExtentFSNode::write(FsHandle &handle, const void *buffer, size_t size)
+{
+    if (type == FILE_TYPE_DIRECTORY)
+    {
+        return ERR_IS_A_DIRECTORY;
+    }
+
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    ExtentFSInodeRef ref;
+    Result result = extentfs_inode_get(_fs, _inode, &ref);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    uint32_t old_blocks = ref.inode->blocks;
+    uint32_t needed = (handle.offset + size + EXTENTFS_BLOCK_SIZE - 1) / EXTENTFS_BLOCK_SIZE;
+
+    if (needed > old_blocks)
+    {
+        LockHolder holder(_fs->lock);
+        result = extentfs_inode_grow(&ref, needed);
+    }
+
+    // Write as much as we found room for.
+    size_t room = (size_t)ref.inode->blocks * EXTENTFS_BLOCK_SIZE;
+
+    if (room <= handle.offset)
+    {
+        extentfs_inode_put(&ref);
+        return result != SUCCESS ? result : ERR_NO_SPACE_LEFT_ON_DEVICE;
+    }
+
+    size = MIN(size, room - handle.offset);
+
+    // New blocks are zeroed rather than read, including the ones of the
+    // hole left when writing past the end of the file.
+    for (uint32_t logical = old_blocks; logical < handle.offset / EXTENTFS_BLOCK_SIZE; logical++)
+    {
+        uint32_t physical = 0;
+        extentfs_inode_map(&ref, logical, &physical);
+
+        Buffer *block = buffer_cache_acquire_zeroed(_fs->disk, physical);
+
+        if (block)
+        {
+            buffer_cache_release(block);
+        }
+    }
+
+    size_t done = 0;
+
+    while (done < size)
+    {
+        size_t offset = handle.offset + done;
+        size_t block_offset = offset % EXTENTFS_BLOCK_SIZE;
+        size_t chunk = MIN(EXTENTFS_BLOCK_SIZE - block_offset, size - done);
+        uint32_t logical = offset / EXTENTFS_BLOCK_SIZE;
+
+        uint32_t physical = 0;
+        Buffer *block = nullptr;
+
+        if (extentfs_inode_map(&ref, logical, &physical))
+        {
+            if (logical >= old_blocks || chunk == EXTENTFS_BLOCK_SIZE)
+            {
+                block = buffer_cache_acquire_zeroed(_fs->disk, physical);
+            }
+            else
+            {
+                block = buffer_cache_acquire(_fs->disk, physical);
+            }
+        }
+
+        if (!block)
+        {
+            break;
+        }
+
+        memcpy((char *)block->data + block_offset, (const char *)buffer + done, chunk);
+        buffer_cache_mark_dirty(block);
+        buffer_cache_release(block);
+
+        done += chunk;
+    }
+
+    if (handle.offset + done > _size)
+    {
+        _size = handle.offset + done;
+        ref.inode->size = _size;
+        extentfs_inode_dirty(&ref);
+    }
+
+    extentfs_inode_put(&ref);
+
+    if (done > 0)
+    {
+        // Tasks mapping the file keep the old pages.
+        page_cache_invalidate(this);
+    }
+
+    if (done == 0)
+    {
+        return ERR_INPUT_OUTPUT_ERROR;
+    }
+
+    return done;
+}
+
+/* --- Mounting ------------------------------------------------------------- */
+
+static Result extentfs_format(ExtentFS *fs)
+{
+    ExtentFSSuperblock *super = &fs->super;
+
+    uint32_t block_count = MIN(fs->disk->sector_count / BUFFER_CACHE_SECTORS_PER_BLOCK, (uint64_t)UINT32_MAX);
+    uint32_t inodes_blocks = (MAX(block_count / EXTENTFS_BLOCKS_PER_INODE, 64u) + EXTENTFS_INODES_PER_BLOCK - 1) / EXTENTFS_INODES_PER_BLOCK;
+
+    memcpy(super->magic, EXTENTFS_MAGIC, sizeof(super->magic));
+    super->version = EXTENTFS_VERSION;
+    super->block_count = block_count;
+    super->bitmap_start = 1;
+    super->bitmap_blocks = (block_count + EXTENTFS_BITS_PER_BLOCK - 1) / EXTENTFS_BITS_PER_BLOCK;
+    super->inodes_start = super->bitmap_start + super->bitmap_blocks;
+    super->inodes_count = inodes_blocks * EXTENTFS_INODES_PER_BLOCK;
+    super->data_start = super->inodes_start + inodes_blocks;
+    super->root = EXTENTFS_ROOT;
+
+    if (super->data_start >= block_count)
+    {
+        return ERR_NO_SPACE_LEFT_ON_DEVICE;
+    }
+
+    for (uint32_t block = 0; block < super->data_start; block++)
+    {
+        Buffer *buffer = buffer_cache_acquire_zeroed(fs->disk, block);
+
+        if (!buffer)
+        {
+            return ERR_INPUT_OUTPUT_ERROR;
+        }
+
+        if (block == 0)
+        {
+            memcpy(buffer->data, super, sizeof(ExtentFSSuperblock));
+        }
+
+        buffer_cache_release(buffer);
+    }
+
+    Result result = extentfs_bitmap_set(fs, 0, super->data_start, true);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    ExtentFSInodeRef root;
+    result = extentfs_inode_get(fs, EXTENTFS_ROOT, &root);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    root.inode->type = FILE_TYPE_DIRECTORY;
+    root.inode->links = 1;
+
+    extentfs_inode_dirty(&root);
+    extentfs_inode_put(&root);
+
+    return buffer_cache_sync(fs->disk);
+}
+
+// Free the inodes which were still open when they lost their last link.
+static void extentfs_recover(ExtentFS *fs)
+{
+    uint32_t inodes_blocks = fs->super.inodes_count / EXTENTFS_INODES_PER_BLOCK;
+
+    for (uint32_t block = 0; block < inodes_blocks; block++)
+    {
+        buffer_cache_prefetch(fs->disk, fs->super.inodes_start + block);
+    }
+
+    disk_kick(fs->disk);
+
+    LockHolder holder(fs->lock);
+
+    for (uint32_t inode = 1; inode < fs->super.inodes_count; inode++)
+    {
+        ExtentFSInodeRef ref;
+
+        if (extentfs_inode_get(fs, inode, &ref) != SUCCESS)
+        {
+            continue;
+        }
+
+        bool orphan = ref.inode->type != FILE_TYPE_UNKNOWN && ref.inode->links == 0;
+
+        extentfs_inode_put(&ref);
+
+        if (orphan)
+        {
+            extentfs_inode_free(fs, inode);
+        }
+    }
+}
+
+Result extentfs_mount(Disk *disk, const char *path)
+{
+    Buffer *buffer = buffer_cache_acquire(disk, 0);
+
+    if (!buffer)
+    {
+        return ERR_INPUT_OUTPUT_ERROR;
+    }
+
+    ExtentFS *fs = __create(ExtentFS);
+
+    fs->disk = disk;
+    lock_init(fs->lock);
+
+    bool blank = true;
+
+    for (size_t i = 0; blank && i < EXTENTFS_BLOCK_SIZE / sizeof(uint32_t); i++)
+    {
+        blank = ((uint32_t *)buffer->data)[i] == 0;
+    }
+
+    memcpy(&fs->super, buffer->data, sizeof(ExtentFSSuperblock));
+    buffer_cache_release(buffer);
+
+    Result result = SUCCESS;
+
+    if (blank)
+    {
+        logger_info("Formatting disk%d...", disk->id);
+        result = extentfs_format(fs);
+    }
+    else if (memcmp(fs->super.magic, EXTENTFS_MAGIC, sizeof(fs->super.magic)) != 0 ||
+             fs->super.version != EXTENTFS_VERSION ||
+             fs->super.block_count > disk->sector_count / BUFFER_CACHE_SECTORS_PER_BLOCK ||
+             fs->super.inodes_count <= EXTENTFS_ROOT ||
+             (uint64_t)fs->super.inodes_start + fs->super.inodes_count / EXTENTFS_INODES_PER_BLOCK > fs->super.block_count ||
+             fs->super.root != EXTENTFS_ROOT)
+    {
+        logger_error("disk%d doesn't hold a filesystem we know about", disk->id);
+        result = ERR_INVALID_ARGUMENT;
+    }
+
+    if (result != SUCCESS)
+    {
+        free(fs);
+        return result;
+    }
+
+    fs->block_hint = fs->super.data_start;
+    fs->inode_hint = EXTENTFS_ROOT + 1;
+
+    extentfs_recover(fs);
+
+    result = extentfs_node_get(fs, EXTENTFS_ROOT, &fs->root);
+
+    if (result != SUCCESS)
+    {
+        free(fs);
+        return result;
+    }
+
+    Path *mount_path = path_create(path);
+
+    result = filesystem_mkdir(mount_path);
+
+    if (result == SUCCESS || result == ERR_FILE_EXISTS)
+    {
+        result = filesystem_mount(mount_path, fs->root);
+    }
+
+    path_destroy(mount_path);
+
+    if (result != SUCCESS)
+    {
+        // Nothing else knows about the root yet, it goes away with its node.
+        fs->root->deref();
+        free(fs);
+        return result;
+    }
+
+    logger_info("Mounted disk%d at %s: %d blocks, %d inodes", disk->id, path, fs->super.block_count, fs->super.inodes_count);
+
+    return SUCCESS;
+}
+
+void extentfs_initialize()
+{
+    Disk *disk = disk_get(0);
+
+    if (!disk)
+    {
+        return;
+    }
+
+    Result result = extentfs_mount(disk, DISK_PATH);
+
+    if (result != SUCCESS)
+    {
+        logger_error("Failed to mount disk0 at " DISK_PATH ": %s", result_to_string(result));
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "kernel/devices/Disk.h"
+
+// A simple on-disk filesystem keeping files as runs of contiguous blocks,
+// on top of the buffer cache. Blank disks are formatted when mounted.
+
+// Mount the filesystem on disk at path.
+Result extentfs_mount(Disk *disk, const char *path);
+
+// Mount the first disk at /Disk, if there is one.
+void extentfs_initialize();
@@ -6,7 +6,9 @@
 #include <libsystem/Result.h>
 #include <libsystem/core/CString.h>
 #include <libsystem/math/Math.h>
+#include <libsystem/thread/Atomic.h>
 
+#include "kernel/filesystem/DentryCache.h"
 #include "kernel/filesystem/Filesystem.h"
 #include "kernel/node/Directory.h"
 #include "kernel/node/File.h"
@@ -16,6 +18,15 @@
 
 static FsNode *_filesystem_root = nullptr;
 
+// Filesystems mounted on a directory of another one.
+struct FsMount
+{
+    FsNode *mountpoint;
+    FsNode *root;
+};
+
+static List *_filesystem_mounts = nullptr;
+
 #define ASSERT_FILESYSTEM_READY                                              \
     if (!root != nullptr)                                                    \
     {                                                                        \
@@ -27,36 +38,86 @@ void filesystem_initialize()
     logger_info("Initializing filesystem...");
 
     _filesystem_root = new FsDirectory();
+    _filesystem_mounts = list_create();
 
     logger_info("File system root at 0x%x", _filesystem_root);
 }
 
+// Go from a mountpoint to the root of the filesystem mounted on it.
+static FsNode *filesystem_cross_mount(FsNode *node)
+{
+    if (!node || !node->mounted)
+    {
+        return node;
+    }
+
+    FsNode *root = nullptr;
+
+    {
+        AtomicHolder holder;
+
+        list_foreach(FsMount, mount, _filesystem_mounts)
+        {
+            if (mount->mountpoint == node)
+            {
+                root = mount->root->ref();
+                break;
+            }
+        }
+    }
+
+    if (!root)
+    {
+        return node;
+    }
+
+    node->deref();
+
+    return root;
+}
+
 FsNode *filesystem_find_and_ref(Path *path)
 {
     assert(_filesystem_root != nullptr);
 
     FsNode *current = _filesystem_root->ref();
 
-    for (size_t i = 0; i < path_element_count(path); i++)
+    for (size_t i = 0; i < path_element_count(path);)
     {
         if (current && current->type == FILE_TYPE_DIRECTORY)
         {
-            const char *element = path_peek_at(path, i);
-
             FsNode *found = nullptr;
 
-            if (current->find)
+            if (current->lookup)
             {
-                fsnode_acquire_lock(current, scheduler_running_id());
-                found = current->find(current, element);
-                fsnode_release_lock(current, scheduler_running_id());
+                found = current->lookup(current, path, &i);
+            }
+
+            if (!found)
+            {
+                const char *element = path_peek_at(path, i);
+
+                if (!dentry_cache_lookup(current, element, &found) && current->find)
+                {
+                    fsnode_acquire_lock(current, scheduler_running_id());
+                    found = current->find(current, element);
+                    dentry_cache_insert(current, element, found);
+                    fsnode_release_lock(current, scheduler_running_id());
+                }
+
+                i++;
             }
 
             current->deref();
-            current = found;
+            current = filesystem_cross_mount(found);
         }
         else
         {
+            if (current)
+            {
+                current->deref();
+            }
+
             return nullptr;
         }
     }
@@ -87,7 +148,20 @@ Result filesystem_open(Path *path, OpenFlag flags, FsHandle **handle)
 
         if (parent)
         {
-            if (parent->link)
+            if (parent->create)
+            {
+                fsnode_acquire_lock(parent, scheduler_running_id());
+                dentry_cache_invalidate(parent, path_filename(path));
+                Result result = parent->create(parent, path_filename(path), (flags & OPEN_SOCKET) ? FILE_TYPE_SOCKET : FILE_TYPE_REGULAR, &node);
+                fsnode_release_lock(parent, scheduler_running_id());
+
+                if (result != SUCCESS)
+                {
+                    parent->deref();
+                    return result;
+                }
+            }
+            else if (parent->link)
             {
                 if (flags & OPEN_SOCKET)
                 {
@@ -99,6 +173,7 @@ Result filesystem_open(Path *path, OpenFlag flags, FsHandle **handle)
                 }
 
                 fsnode_acquire_lock(parent, scheduler_running_id());
+                dentry_cache_invalidate(parent, path_filename(path));
                 parent->link(parent, path_filename(path), node);
                 fsnode_release_lock(parent, scheduler_running_id());
             }
@@ -145,6 +220,41 @@ Result filesystem_open(Path *path, OpenFlag flags, FsHandle **handle)
     return SUCCESS;
 }
 
+Result filesystem_mount(Path *path, FsNode *root)
+{
+    FsNode *mountpoint = filesystem_find_and_ref(path);
+
+    if (!mountpoint)
+    {
+        return ERR_NO_SUCH_FILE_OR_DIRECTORY;
+    }
+
+    if (mountpoint->type != FILE_TYPE_DIRECTORY || root->type != FILE_TYPE_DIRECTORY)
+    {
+        mountpoint->deref();
+        return ERR_NOT_A_DIRECTORY;
+    }
+
+    // Its filesystem resolves paths on its own, it wouldn't stop there.
+    if (mountpoint->lookup)
+    {
+        mountpoint->deref();
+        return ERR_OPERATION_NOT_SUPPORTED;
+    }
+
+    FsMount *mount = __create(FsMount);
+
+    mount->mountpoint = mountpoint;
+    mount->root = root->ref();
+
+    AtomicHolder holder;
+
+    list_pushback(_filesystem_mounts, mount);
+    mountpoint->mounted = true;
+
+    return SUCCESS;
+}
+
 Result filesystem_connect(Path *path, FsHandle **connection_handle)
 {
     FsNode *node = filesystem_find_and_ref(path);
@@ -175,11 +285,53 @@ Result filesystem_mkdir(Path *path)
         return ERR_FILE_EXISTS;
     }
 
-    auto directory = new FsDirectory();
+    FsNode *parent = filesystem_find_parent_and_ref(path);
 
-    Result result = filesystem_link(path, directory);
+    if (!parent)
+    {
+        return ERR_NO_SUCH_FILE_OR_DIRECTORY;
+    }
+
+    if (!parent->create)
+    {
+        parent->deref();
+
+        auto directory = new FsDirectory();
+
+        Result result = filesystem_link(path, directory);
+
+        directory->deref();
+
+        return result;
+    }
+
+    Result result = SUCCESS;
+
+    fsnode_acquire_lock(parent, scheduler_running_id());
+
+    FsNode *existing = parent->find ? parent->find(parent, path_filename(path)) : nullptr;
+
+    if (existing)
+    {
+        existing->deref();
+        result = ERR_FILE_EXISTS;
+    }
+    else
+    {
+        dentry_cache_invalidate(parent, path_filename(path));
+
+        FsNode *directory = nullptr;
+        result = parent->create(parent, path_filename(path), FILE_TYPE_DIRECTORY, &directory);
+
+        if (directory)
+        {
+            directory->deref();
+        }
+    }
+
+    fsnode_release_lock(parent, scheduler_running_id());
 
-    directory->deref();
+    parent->deref();
 
     return result;
 }
@@ -265,6 +417,7 @@ Result filesystem_link(Path *path, FsNode *node)
     }
 
     fsnode_acquire_lock(parent, scheduler_running_id());
+    dentry_cache_invalidate(parent, path_filename(path));
     result = parent->link(parent, path_filename(path), node);
     fsnode_release_lock(parent, scheduler_running_id());
 
@@ -318,6 +471,7 @@ Result filesystem_unlink(Path *path)
     }
 
     fsnode_acquire_lock(parent, scheduler_running_id());
+    dentry_cache_invalidate(parent, path_filename(path));
     result = parent->unlink(parent, path_filename(path));
     fsnode_release_lock(parent, scheduler_running_id());
 
@@ -375,10 +529,12 @@ Result filesystem_rename(Path *old_path, Path *new_path)
         goto unlock_cleanup_and_return;
     }
 
+    dentry_cache_invalidate(new_parent, path_filename(new_path));
     result = new_parent->link(new_parent, path_filename(new_path), child);
 
     if (result == SUCCESS)
     {
+        dentry_cache_invalidate(old_parent, path_filename(old_path));
         result = old_parent->unlink(old_parent, path_filename(old_path));
     }
 
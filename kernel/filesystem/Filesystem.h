@@ -14,6 +14,10 @@ FsNode *filesystem_find_parent_and_ref(Path *path);
 
 Result filesystem_open(Path *path, OpenFlag flags, FsHandle **handle);
 
+// Paths going through the directory at path go through root instead from
+// now on.
+Result filesystem_mount(Path *path, FsNode *root);
+
 Result filesystem_connect(Path *path, FsHandle **connection_handle);
 
 Result filesystem_mkdir(Path *path);
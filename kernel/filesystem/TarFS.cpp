@@ -0,0 +1,261 @@
+#include <libfile/tar.h>
+#include <libsystem/Logger.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/io/Stream.h>
+#include <libsystem/thread/Atomic.h>
+#include <libsystem/utils/HashMap.h>
+
+#include "kernel/filesystem/TarFS.h"
+#include "kernel/node/Directory.h"
+#include "kernel/node/File.h"
+
+struct TarFS
+{
+    // Every node by its path from the root, without the leading '/'. The
+    // entries don't hold references, they go away along with the link.
+    HashMap *index;
+};
+
+class TarFSDirectory : public FsDirectory
+{
+private:
+public:
+    TarFS *_fs;
+    char _path[PATH_LENGTH];
+
+    TarFSDirectory(TarFS *fs, const char *path);
+};
+
+static void tarfs_join(char *buffer, const char *directory, const char *name)
+{
+    if (directory[0])
+    {
+        snprintf(buffer, PATH_LENGTH, "%s/%s", directory, name);
+    }
+    else
+    {
+        strlcpy(buffer, name, PATH_LENGTH);
+    }
+}
+
+static void tarfs_index_put(TarFSDirectory *directory, const char *name, FsNode *node)
+{
+    char path[PATH_LENGTH];
+    tarfs_join(path, directory->_path, name);
+
+    AtomicHolder holder;
+
+    hashmap_put(directory->_fs->index, path, node);
+}
+
+static void tarfs_index_remove(TarFSDirectory *directory, const char *name)
+{
+    char path[PATH_LENGTH];
+    tarfs_join(path, directory->_path, name);
+
+    AtomicHolder holder;
+
+    hashmap_remove(directory->_fs->index, path);
+}
+
+static FsNode *tarfs_directory_lookup(TarFSDirectory *directory, Path *path, size_t *index)
+{
+    char buffer[PATH_LENGTH];
+    size_t length = strlcpy(buffer, directory->_path, PATH_LENGTH);
+
+    for (size_t i = *index; i < path_element_count(path); i++)
+    {
+        if (length > 0)
+        {
+            buffer[length++] = '/';
+        }
+
+        length += strlcpy(buffer + length, path_peek_at(path, i), PATH_LENGTH - length);
+
+        if (length >= PATH_LENGTH - 1)
+        {
+            return nullptr;
+        }
+    }
+
+    AtomicHolder holder;
+
+    FsNode *node = (FsNode *)hashmap_get(directory->_fs->index, buffer);
+
+    if (!node)
+    {
+        return nullptr;
+    }
+
+    *index = path_element_count(path);
+
+    return node->ref();
+}
+
+static Result tarfs_directory_link(TarFSDirectory *directory, const char *name, FsNode *child)
+{
+    // Their content would be left behind in the index.
+    if (child->lookup == (FsNodeLookupCallback)tarfs_directory_lookup)
+    {
+        return ERR_OPERATION_NOT_SUPPORTED;
+    }
+
+    Result result = directory_link(directory, name, child);
+
+    if (result == SUCCESS)
+    {
+        tarfs_index_put(directory, name, child);
+    }
+
+    return result;
+}
+
+static Result tarfs_directory_unlink(TarFSDirectory *directory, const char *name)
+{
+    FsDirectoryEntry *entry = (FsDirectoryEntry *)hashmap_get(directory->childs_by_name, name);
+
+    if (entry &&
+        entry->node->lookup == (FsNodeLookupCallback)tarfs_directory_lookup &&
+        ((TarFSDirectory *)entry->node)->childs->count() > 0)
+    {
+        return ERR_DIRECTORY_NOT_EMPTY;
+    }
+
+    // Before the node goes away, nobody should find it anymore.
+    tarfs_index_remove(directory, name);
+
+    return directory_unlink(directory, name);
+}
+
+TarFSDirectory::TarFSDirectory(TarFS *fs, const char *path) : FsDirectory(), _fs(fs)
+{
+    strlcpy(_path, path, PATH_LENGTH);
+
+    link = (FsNodeLinkCallback)tarfs_directory_link;
+    unlink = (FsNodeUnlinkCallback)tarfs_directory_unlink;
+    lookup = (FsNodeLookupCallback)tarfs_directory_lookup;
+}
+
+FsNode *tarfs_create(const void *archive, size_t size, const char *prefix)
+{
+    TarFS *fs = __create(TarFS);
+    fs->index = hashmap_create_string_to_value();
+
+    TarFSDirectory *root = new TarFSDirectory(fs, "");
+
+    size_t prefix_length = strlen(prefix);
+    size_t file_count = 0;
+
+    TARIterator iterator;
+    tar_iterator_initialize(&iterator, archive, size);
+
+    TARBlock block;
+
+    while (tar_iterator_next(&iterator, &block))
+    {
+        if (strncmp(block.name, prefix, prefix_length) != 0)
+        {
+            continue;
+        }
+
+        char *name = block.name + prefix_length;
+        size_t length = strlen(name);
+
+        bool is_directory = length > 0 && name[length - 1] == '/';
+
+        if (is_directory)
+        {
+            name[--length] = '\0';
+        }
+
+        is_directory = is_directory || block.typeflag == TAR_TYPE_DIRECTORY;
+
+        // The directory of the prefix itself.
+        if (length == 0)
+        {
+            continue;
+        }
+
+        TarFSDirectory *parent = root;
+        const char *filename = name;
+
+        char *separator = strrchr(name, '/');
+
+        if (separator)
+        {
+            *separator = '\0';
+            filename = separator + 1;
+
+            // Archives list directories before their content.
+            FsNode *node = (FsNode *)hashmap_get(fs->index, name);
+
+            if (!node || node->lookup != (FsNodeLookupCallback)tarfs_directory_lookup)
+            {
+                logger_warn("No directory for %s%s/%s, skipping it", prefix, name, filename);
+                continue;
+            }
+
+            parent = (TarFSDirectory *)node;
+        }
+
+        FsNode *node = nullptr;
+
+        if (is_directory)
+        {
+            char path[PATH_LENGTH];
+            tarfs_join(path, parent->_path, filename);
+
+            node = new TarFSDirectory(fs, path);
+        }
+        else if (block.typeflag == TAR_TYPE_REGULAR ||
+                 block.typeflag == TAR_TYPE_REGULAR_OLD ||
+                 block.typeflag == TAR_TYPE_CONTIGUOUS)
+        {
+            node = new FsFile(block.data, block.size);
+            file_count++;
+        }
+        else if (block.typeflag == TAR_TYPE_HARD_LINK)
+        {
+            // The target comes first in the archive, so it's already there.
+            FsNode *target = nullptr;
+
+            if (strncmp(block.linkname, prefix, prefix_length) == 0)
+            {
+                target = (FsNode *)hashmap_get(fs->index, block.linkname + prefix_length);
+            }
+
+            if (!target || target->type == FILE_TYPE_DIRECTORY)
+            {
+                logger_warn("No file for the link %s to %s, skipping it", filename, block.linkname);
+                continue;
+            }
+
+            node = target->ref();
+        }
+        else
+        {
+            logger_warn("%s isn't a file, a directory or a hard link, skipping it", filename);
+            continue;
+        }
+
+        if (directory_link(parent, filename, node) == SUCCESS)
+        {
+            tarfs_index_put(parent, filename, node);
+        }
+        else
+        {
+            logger_warn("Failed to add %s to the archive filesystem", filename);
+        }
+
+        node->deref();
+    }
+
+    if (iterator.corrupted)
+    {
+        logger_warn("The archive is damaged after %d files, the rest is skipped!", file_count);
+    }
+
+    logger_info("Archive filesystem of %s: %d files.", prefix, file_count);
+
+    return root;
+}
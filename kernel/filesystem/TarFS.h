@@ -0,0 +1,12 @@
+#pragma once
+
+#include "kernel/node/Node.h"
+
+// The entries of a tar archive in memory, served in place like the ramdisk.
+// Paths are looked up in one go in an index of the whole tree rather than
+// directory by directory. Nodes can still be linked in, but directories
+// can't be moved around.
+
+// Returns the root of a filesystem holding the entries of the archive under
+// prefix, which should end with a '/'.
+FsNode *tarfs_create(const void *archive, size_t size, const char *prefix);
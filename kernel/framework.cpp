@@ -216,6 +216,79 @@ size_t __plug_handle_write(Handle *handle, const void *buffer, size_t size)
     }
 }
 
+size_t __plug_handle_readv(Handle *handle, const IOVector *vectors, size_t count)
+{
+    assert(handle->id != INTERNAL_LOG_STREAM_HANDLE);
+
+    size_t read = 0;
+
+    handle->result = task_fshandle_readv(scheduler_running(), handle->id, vectors, count, &read);
+
+    return read;
+}
+
+size_t __plug_handle_writev(Handle *handle, const IOVector *vectors, size_t count)
+{
+    assert(handle->id != INTERNAL_LOG_STREAM_HANDLE);
+
+    size_t written = 0;
+
+    handle->result = task_fshandle_writev(scheduler_running(), handle->id, vectors, count, &written);
+
+    return written;
+}
+
+size_t __plug_handle_pread(Handle *handle, void *buffer, size_t size, size_t offset)
+{
+    assert(handle->id != INTERNAL_LOG_STREAM_HANDLE);
+
+    size_t read = 0;
+
+    handle->result = task_fshandle_pread(scheduler_running(), handle->id, buffer, size, offset, &read);
+
+    return read;
+}
+
+size_t __plug_handle_pwrite(Handle *handle, const void *buffer, size_t size, size_t offset)
+{
+    assert(handle->id != INTERNAL_LOG_STREAM_HANDLE);
+
+    size_t written = 0;
+
+    handle->result = task_fshandle_pwrite(scheduler_running(), handle->id, buffer, size, offset, &written);
+
+    return written;
+}
+
+size_t __plug_handle_donate(Handle *handle, const void *buffer, size_t size)
+{
+    assert(handle->id != INTERNAL_LOG_STREAM_HANDLE);
+
+    size_t written = 0;
+
+    handle->result = task_fshandle_donate(scheduler_running(), handle->id, buffer, size, &written);
+
+    return written;
+}
+
+Result __plug_handle_send(Handle *handle, const Message *message)
+{
+    assert(handle->id != INTERNAL_LOG_STREAM_HANDLE);
+
+    handle->result = task_fshandle_send(scheduler_running(), handle->id, message);
+
+    return handle->result;
+}
+
+Result __plug_handle_receive(Handle *handle, Message *message)
+{
+    assert(handle->id != INTERNAL_LOG_STREAM_HANDLE);
+
+    handle->result = task_fshandle_receive(scheduler_running(), handle->id, message);
+
+    return handle->result;
+}
+
 Result __plug_handle_call(Handle *handle, IOCall request, void *args)
 {
     assert(handle->id != INTERNAL_LOG_STREAM_HANDLE);
@@ -268,6 +341,22 @@ void __plug_handle_accept(Handle *handle, Handle *connection_handle)
     handle->result = task_fshandle_accept(scheduler_running(), handle->id, &connection_handle->id);
 }
 
+Result __plug_handle_map(Handle *handle, uintptr_t *out_address, size_t *out_size)
+{
+    assert(handle->id != INTERNAL_LOG_STREAM_HANDLE);
+
+    handle->result = task_fshandle_map(scheduler_running(), handle->id, out_address, out_size);
+
+    return handle->result;
+}
+
+// The kernel doesn't need to batch its calls to itself.
+Result __plug_handle_ring(IORing *ring)
+{
+    __unused(ring);
+    ASSERT_NOT_REACHED();
+}
+
 Result __plug_create_pipe(int *reader_handle, int *writer_handle)
 {
     return task_create_pipe(scheduler_running(), reader_handle, writer_handle);
@@ -9,7 +9,11 @@
 #include "kernel/scheduling/Scheduler.h"
 
 static RingBuffer *_interupts_to_dispatch = nullptr;
-static DispatcherInteruptHandler _interupts_to_handlers[255] = {};
+// PCI devices may share an interrupt line, every handler of the line is run.
+#define DISPATCHER_HANDLERS_PER_INTERRUPT (4)
+
+static DispatcherInteruptHandler _interupts_to_handlers[255][DISPATCHER_HANDLERS_PER_INTERRUPT] = {};
+static WaitQueue _dispatcher_waiters = {};
 
 void dispatcher_initialize()
 {
@@ -21,9 +25,10 @@ void dispatcher_initialize()
 
 void dispatcher_dispatch(int interrupt)
 {
-    if (_interupts_to_handlers[interrupt])
+    if (_interupts_to_handlers[interrupt][0])
     {
         _interupts_to_dispatch->put(interrupt);
+        _dispatcher_waiters.wakeup();
     }
 }
 
@@ -46,6 +51,11 @@ private:
 public:
     BlockerDispatcher() {}
 
+    void on_block(struct Task *task)
+    {
+        wait_on(task, _dispatcher_waiters);
+    }
+
     bool can_unblock(struct Task *task)
     {
         __unused(task);
@@ -64,13 +74,14 @@ void dispatcher_service()
         {
             int interrupt = dispatcher_get_interupt();
 
-            if (_interupts_to_handlers[interrupt])
+            if (!_interupts_to_handlers[interrupt][0])
             {
-                _interupts_to_handlers[interrupt]();
+                logger_warn("No handler for interrupt %d!", interrupt);
             }
-            else
+
+            for (size_t i = 0; i < DISPATCHER_HANDLERS_PER_INTERRUPT && _interupts_to_handlers[interrupt][i]; i++)
             {
-                logger_warn("No handler for interrupt %d!", interrupt);
+                _interupts_to_handlers[interrupt][i]();
             }
         }
     }
@@ -78,17 +89,42 @@ void dispatcher_service()
 
 void dispatcher_register_handler(int interrupt, DispatcherInteruptHandler handler)
 {
-    assert(!_interupts_to_handlers[interrupt]);
-    _interupts_to_handlers[interrupt] = handler;
+    DispatcherInteruptHandler *handlers = _interupts_to_handlers[interrupt];
+
+    for (size_t i = 0; i < DISPATCHER_HANDLERS_PER_INTERRUPT; i++)
+    {
+        assert(handlers[i] != handler);
+
+        if (!handlers[i])
+        {
+            handlers[i] = handler;
+            return;
+        }
+    }
+
+    ASSERT_NOT_REACHED();
 }
 
 void dispatcher_unregister_handler(DispatcherInteruptHandler handler)
 {
-    for (int i = 0; i < 255; i++)
+    for (int interrupt = 0; interrupt < 255; interrupt++)
     {
-        if (_interupts_to_handlers[i] == handler)
+        DispatcherInteruptHandler *handlers = _interupts_to_handlers[interrupt];
+
+        // Keep the handlers packed at the start of the line.
+        size_t kept = 0;
+
+        for (size_t i = 0; i < DISPATCHER_HANDLERS_PER_INTERRUPT; i++)
+        {
+            if (handlers[i] != handler)
+            {
+                handlers[kept++] = handlers[i];
+            }
+        }
+
+        while (kept < DISPATCHER_HANDLERS_PER_INTERRUPT)
         {
-            _interupts_to_handlers[i] = nullptr;
+            handlers[kept++] = nullptr;
         }
     }
 }
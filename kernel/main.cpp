@@ -11,6 +11,7 @@
 #include "arch/Arch.h"
 #include "arch/x86/Interrupts.h"
 #include "kernel/devices/Devices.h"
+#include "kernel/filesystem/ExtentFS.h"
 #include "kernel/filesystem/Filesystem.h"
 #include "kernel/graphics/Graphics.h"
 #include "kernel/modules/Modules.h"
@@ -44,9 +45,11 @@ void system_main(Multiboot *multiboot)
     scheduler_initialize();
     tasking_initialize();
     interrupts_initialize();
+    arch_start_processors();
     filesystem_initialize();
     modules_initialize(multiboot);
     device_initialize();
+    extentfs_initialize();
     null_initialize();
     zero_initialize();
     random_initialize();
@@ -5,6 +5,8 @@
 #include <libsystem/io/Stream.h>
 #include <libsystem/thread/Atomic.h>
 
+#include "arch/x86/SMP.h"
+
 #include "kernel/memory/Memory.h"
 #include "kernel/memory/MemoryObject.h"
 #include "kernel/memory/Physical.h"
@@ -52,6 +54,8 @@ void memory_initialize(Multiboot *multiboot)
     USED_MEMORY = 0;
     TOTAL_MEMORY = multiboot->memory_usable;
 
+    virtual_initialize();
+
     logger_info("Mapping kernel...");
     memory_map_identity(&kpdir, kernel_memory_range(), MEMORY_NONE);
 
@@ -61,11 +65,17 @@ void memory_initialize(Multiboot *multiboot)
         memory_map_identity(&kpdir, multiboot->modules[i].range, MEMORY_NONE);
     }
 
+    logger_info("Mapping the processors trampoline...");
+    memory_map_identity(&kpdir, MemoryRange{SMP_TRAMPOLINE_ADDRESS, ARCH_PAGE_SIZE}, MEMORY_NONE);
+
     // Unmap the 0 page
     MemoryRange page_zero{0, ARCH_PAGE_SIZE};
     virtual_free(memory_kpdir(), page_zero);
     physical_set_used(page_zero);
 
+    logger_info("Building the physical memory free lists...");
+    memory_map_identity(&kpdir, physical_initialize(), MEMORY_NONE);
+
     memory_pdir_switch(&kpdir);
     paging_enable();
 
@@ -100,6 +110,16 @@ size_t memory_get_total()
     return TOTAL_MEMORY;
 }
 
+void memory_get_free_blocks(size_t free_blocks[MEMORY_ORDER_COUNT])
+{
+    AtomicHolder holder;
+
+    for (int i = 0; i < MEMORY_ORDER_COUNT; i++)
+    {
+        free_blocks[i] = physical_free_blocks(i);
+    }
+}
+
 PageDirectory *memory_kpdir()
 {
     return &kpdir;
@@ -192,30 +212,45 @@ Result memory_alloc_identity(PageDirectory *page_directory, MemoryFlags flags, u
 {
     AtomicHolder holder;
 
-    for (size_t i = 1; i < 256 * 1024; i++)
+    // Nothing but identity mapped memory lives below virtual_identity_end(),
+    // so a free physical page there is free in the virtual address space too.
+    MemoryRange identity_range = physical_alloc(ARCH_PAGE_SIZE);
+
+    if (identity_range.base() + ARCH_PAGE_SIZE > virtual_identity_end())
     {
-        MemoryRange identity_range{i * ARCH_PAGE_SIZE, ARCH_PAGE_SIZE};
+        physical_free(identity_range);
+        identity_range = MemoryRange();
 
-        if (!virtual_present(page_directory, identity_range.base()) &&
-            !physical_is_used(identity_range))
+        for (size_t i = 1; i < virtual_identity_end() / ARCH_PAGE_SIZE; i++)
         {
-            physical_set_used(identity_range);
-            virtual_map(page_directory, identity_range, identity_range.base(), flags);
+            MemoryRange candidate_range{i * ARCH_PAGE_SIZE, ARCH_PAGE_SIZE};
+
+            if (!physical_is_used(candidate_range))
+            {
+                physical_set_used(candidate_range);
+                identity_range = candidate_range;
+                break;
+            }
+        }
+    }
 
-            if (flags & MEMORY_CLEAR)
-                memset((void *)identity_range.base(), 0, ARCH_PAGE_SIZE);
+    if (identity_range.empty())
+    {
+        logger_warn("Failed to allocate identity mapped page!");
 
-            *out_address = identity_range.base();
+        *out_address = 0;
 
-            return SUCCESS;
-        }
+        return ERR_OUT_OF_MEMORY;
     }
 
-    logger_warn("Failed to allocate identity mapped page!");
+    virtual_map(page_directory, identity_range, identity_range.base(), flags);
 
-    *out_address = 0;
+    if (flags & MEMORY_CLEAR)
+        memset((void *)identity_range.base(), 0, ARCH_PAGE_SIZE);
 
-    return ERR_OUT_OF_MEMORY;
+    *out_address = identity_range.base();
+
+    return SUCCESS;
 }
 
 Result memory_free(PageDirectory *page_directory, MemoryRange virtual_range)
@@ -231,13 +266,13 @@ Result memory_free(PageDirectory *page_directory, MemoryRange virtual_range)
         if (virtual_present(page_directory, virtual_address))
         {
             MemoryRange page_physical_range{virtual_to_physical(page_directory, virtual_address), ARCH_PAGE_SIZE};
-            MemoryRange page_virtual_range{virtual_address, ARCH_PAGE_SIZE};
 
             physical_free(page_physical_range);
-            virtual_free(page_directory, page_virtual_range);
         }
     }
 
+    virtual_free(page_directory, virtual_range);
+
     return SUCCESS;
 }
 
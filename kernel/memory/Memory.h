@@ -15,6 +15,8 @@ size_t memory_get_used();
 
 size_t memory_get_total();
 
+void memory_get_free_blocks(size_t free_blocks[MEMORY_ORDER_COUNT]);
+
 PageDirectory *memory_kpdir();
 
 Result memory_map(PageDirectory *page_directory, MemoryRange range, MemoryFlags flags);
@@ -1,3 +1,4 @@
+#include <libsystem/Assert.h>
 #include <libsystem/Logger.h>
 #include <libsystem/thread/Atomic.h>
 #include <libsystem/utils/List.h>
@@ -14,31 +15,147 @@ void memory_object_initialize()
     _memory_objects = list_create();
 }
 
-MemoryObject *memory_object_create(size_t size)
+static void memory_object_release_page(uintptr_t page)
 {
-    AtomicHolder holder;
+    physical_free(MemoryRange{page, ARCH_PAGE_SIZE});
+}
 
-    size = PAGE_ALIGN_UP(size);
+static void memory_object_release_identity_page(uintptr_t page)
+{
+    memory_free(memory_kpdir(), MemoryRange{page, ARCH_PAGE_SIZE});
+}
+
+static PageTreeReleaseCallback memory_object_releaser(MemoryObject *memory_object)
+{
+    return memory_object->identity() ? memory_object_release_identity_page : memory_object_release_page;
+}
+
+static MemoryObject *memory_object_create_internal(size_t size, bool identity)
+{
+    AtomicHolder holder;
 
     MemoryObject *memory_object = __create(MemoryObject);
 
     memory_object->id = _memory_object_id++;
     memory_object->refcount = 1;
-    memory_object->_range = physical_alloc(size);
+    memory_object->_size = PAGE_ALIGN_UP(size);
+    memory_object->_identity = identity;
 
     list_pushback(_memory_objects, memory_object);
 
     return memory_object;
 }
 
+MemoryObject *memory_object_create(size_t size)
+{
+    return memory_object_create_internal(size, false);
+}
+
+MemoryObject *memory_object_create_identity(size_t size)
+{
+    return memory_object_create_internal(size, true);
+}
+
+void memory_object_resize(MemoryObject *memory_object, size_t size)
+{
+    AtomicHolder holder;
+
+    size = PAGE_ALIGN_UP(size);
+
+    if (size < memory_object->_size)
+    {
+        page_tree_truncate(&memory_object->_pages, size / ARCH_PAGE_SIZE, memory_object_releaser(memory_object));
+    }
+
+    memory_object->_size = size;
+}
+
 void memory_object_destroy(MemoryObject *memory_object)
 {
     list_remove(_memory_objects, memory_object);
 
-    physical_free(memory_object->range());
+    page_tree_truncate(&memory_object->_pages, 0, memory_object_releaser(memory_object));
+
     free(memory_object);
 }
 
+uintptr_t memory_object_page(MemoryObject *memory_object, size_t index, bool *out_fresh)
+{
+    ASSERT_ATOMIC;
+
+    assert(index < memory_object->page_count());
+
+    *out_fresh = false;
+
+    uintptr_t page = memory_object->page(index);
+
+    if (page)
+    {
+        return page;
+    }
+
+    if (memory_object->identity())
+    {
+        if (memory_alloc_identity(memory_kpdir(), MEMORY_NONE, &page) != SUCCESS)
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        page = physical_alloc(ARCH_PAGE_SIZE).base();
+    }
+
+    if (!page_tree_insert(&memory_object->_pages, index, page))
+    {
+        memory_object_releaser(memory_object)(page);
+        return 0;
+    }
+
+    *out_fresh = true;
+
+    return page;
+}
+
+uintptr_t memory_object_take_page(MemoryObject *memory_object, size_t index)
+{
+    ASSERT_ATOMIC;
+
+    assert(!memory_object->identity());
+
+    uintptr_t page = memory_object->page(index);
+
+    if (page)
+    {
+        // The table is already there, clearing the entry can't fail.
+        page_tree_insert(&memory_object->_pages, index, 0);
+    }
+
+    return page;
+}
+
+bool memory_object_give_page(MemoryObject *memory_object, size_t index, uintptr_t page)
+{
+    ASSERT_ATOMIC;
+
+    assert(!memory_object->identity());
+    assert(index < memory_object->page_count());
+
+    uintptr_t old_page = memory_object->page(index);
+
+    if (!page_tree_insert(&memory_object->_pages, index, page))
+    {
+        return false;
+    }
+
+    if (old_page)
+    {
+        memory_object_release_page(old_page);
+    }
+
+    return true;
+}
+
 MemoryObject *memory_object_ref(MemoryObject *memory_object)
 {
     __atomic_add_fetch(&memory_object->refcount, 1, __ATOMIC_SEQ_CST);
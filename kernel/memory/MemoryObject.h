@@ -2,22 +2,59 @@
 
 #include <libsystem/Common.h>
 
+#include "arch/Paging.h"
+#include "kernel/memory/PageTree.h"
+
 struct MemoryObject
 {
     int id;
-    MemoryRange _range;
+    size_t _size;
+    bool _identity;
+
+    // Physical address of each page, pages are only there once touched.
+    PageTree _pages;
 
     int refcount;
 
-    auto range() { return _range; }
+    auto size() { return _size; }
+
+    auto page_count() { return _size / ARCH_PAGE_SIZE; }
+
+    // Pages are identity mapped in kernel space, page() can be dereferenced.
+    auto identity() { return _identity; }
+
+    // Physical address of the page at index, 0 if it was never touched.
+    auto page(size_t index) { return page_tree_lookup(&_pages, index); }
 };
 
 void memory_object_initialize();
 
 MemoryObject *memory_object_create(size_t size);
 
+// Same as memory_object_create() but the pages are identity mapped in kernel
+// space, for objects the kernel reads and writes itself all the time.
+MemoryObject *memory_object_create_identity(size_t size);
+
+// Grow or shrink the object, the pages past the new end are released.
+void memory_object_resize(MemoryObject *memory_object, size_t size);
+
 void memory_object_destroy(MemoryObject *memory_object);
 
+// Returns the physical page backing the page at index, allocating it if this
+// is the first time it is touched. Fresh pages aren't cleared since they are
+// not always reachable from kernel space, the caller has to do it once it
+// mapped them. Returns 0 if we are out of memory.
+uintptr_t memory_object_page(MemoryObject *memory_object, size_t index, bool *out_fresh);
+
+// Take the page at index out of the object, the caller owns it from now on
+// and the object gets a fresh one the next time it is touched. Returns 0 if
+// the page was never touched.
+uintptr_t memory_object_take_page(MemoryObject *memory_object, size_t index);
+
+// Put page at index in place of the current one, which is released. The
+// object owns page from now on, unless false is returned.
+bool memory_object_give_page(MemoryObject *memory_object, size_t index, uintptr_t page);
+
 MemoryObject *memory_object_ref(MemoryObject *memory_object);
 
 void memory_object_deref(MemoryObject *memory_object);
@@ -0,0 +1,259 @@
+#include <libsystem/Assert.h>
+#include <libsystem/math/MinMax.h>
+
+#include "kernel/memory/MemoryRegion.h"
+
+static int region_height(MemoryRegion *region)
+{
+    return region ? region->height : 0;
+}
+
+static uintptr_t region_end(MemoryRegion *region)
+{
+    return region->address + region->size;
+}
+
+// Recompute the height and the hole annotations of a node from its children.
+static void region_update(MemoryRegion *region)
+{
+    MemoryRegion *left = region->left;
+    MemoryRegion *right = region->right;
+
+    region->height = MAX(region_height(left), region_height(right)) + 1;
+
+    region->subtree_begin = left ? left->subtree_begin : region->address;
+    region->subtree_end = right ? right->subtree_end : region_end(region);
+    region->subtree_gap = 0;
+
+    if (left)
+    {
+        region->subtree_gap = MAX(left->subtree_gap, region->address - left->subtree_end);
+    }
+
+    if (right)
+    {
+        region->subtree_gap = MAX(region->subtree_gap, right->subtree_gap);
+        region->subtree_gap = MAX(region->subtree_gap, right->subtree_begin - region_end(region));
+    }
+}
+
+static MemoryRegion *region_rotate_left(MemoryRegion *region)
+{
+    MemoryRegion *pivot = region->right;
+
+    region->right = pivot->left;
+    pivot->left = region;
+
+    region_update(region);
+    region_update(pivot);
+
+    return pivot;
+}
+
+static MemoryRegion *region_rotate_right(MemoryRegion *region)
+{
+    MemoryRegion *pivot = region->left;
+
+    region->left = pivot->right;
+    pivot->right = region;
+
+    region_update(region);
+    region_update(pivot);
+
+    return pivot;
+}
+
+static MemoryRegion *region_balance(MemoryRegion *region)
+{
+    region_update(region);
+
+    int balance = region_height(region->left) - region_height(region->right);
+
+    if (balance > 1)
+    {
+        if (region_height(region->left->left) < region_height(region->left->right))
+        {
+            region->left = region_rotate_left(region->left);
+        }
+
+        return region_rotate_right(region);
+    }
+
+    if (balance < -1)
+    {
+        if (region_height(region->right->right) < region_height(region->right->left))
+        {
+            region->right = region_rotate_right(region->right);
+        }
+
+        return region_rotate_left(region);
+    }
+
+    return region;
+}
+
+static MemoryRegion *region_insert(MemoryRegion *node, MemoryRegion *region)
+{
+    if (!node)
+    {
+        region->left = nullptr;
+        region->right = nullptr;
+        region_update(region);
+
+        return region;
+    }
+
+    if (region->address < node->address)
+    {
+        node->left = region_insert(node->left, region);
+    }
+    else
+    {
+        node->right = region_insert(node->right, region);
+    }
+
+    return region_balance(node);
+}
+
+static MemoryRegion *region_remove_min(MemoryRegion *node, MemoryRegion **min)
+{
+    if (!node->left)
+    {
+        *min = node;
+        return node->right;
+    }
+
+    node->left = region_remove_min(node->left, min);
+
+    return region_balance(node);
+}
+
+static MemoryRegion *region_remove(MemoryRegion *node, MemoryRegion *region)
+{
+    assert(node);
+
+    if (region->address < node->address)
+    {
+        node->left = region_remove(node->left, region);
+    }
+    else if (region->address > node->address)
+    {
+        node->right = region_remove(node->right, region);
+    }
+    else
+    {
+        assert(node == region);
+
+        if (!region->right)
+        {
+            return region->left;
+        }
+
+        MemoryRegion *successor = nullptr;
+        MemoryRegion *right = region_remove_min(region->right, &successor);
+
+        successor->left = region->left;
+        successor->right = right;
+
+        return region_balance(successor);
+    }
+
+    return region_balance(node);
+}
+
+// Is there a hole of size bytes in [from, to) once the regions of node are taken out?
+static bool region_has_room(MemoryRegion *node, uintptr_t from, uintptr_t to, size_t size)
+{
+    if (!node)
+    {
+        return to - from >= size;
+    }
+
+    return node->subtree_begin - from >= size ||
+           node->subtree_gap >= size ||
+           to - node->subtree_end >= size;
+}
+
+// The caller made sure there is room, so we never have to backtrack.
+static uintptr_t region_find_free(MemoryRegion *node, uintptr_t from, uintptr_t to, size_t size)
+{
+    if (!node)
+    {
+        return from;
+    }
+
+    if (region_has_room(node->left, from, node->address, size))
+    {
+        return region_find_free(node->left, from, node->address, size);
+    }
+
+    return region_find_free(node->right, region_end(node), to, size);
+}
+
+void memory_region_tree_initialize(MemoryRegionTree *tree, uintptr_t begin, uintptr_t end)
+{
+    tree->root = nullptr;
+    tree->begin = begin;
+    tree->end = end;
+    tree->count = 0;
+    tree->size = 0;
+}
+
+void memory_region_tree_insert(MemoryRegionTree *tree, MemoryRegion *region)
+{
+    assert(region->size > 0);
+    assert(region->address >= tree->begin && region_end(region) <= tree->end);
+    assert(!memory_region_tree_overlap(tree, region->address, region->size));
+
+    tree->root = region_insert(tree->root, region);
+    tree->count++;
+    tree->size += region->size;
+}
+
+void memory_region_tree_remove(MemoryRegionTree *tree, MemoryRegion *region)
+{
+    tree->root = region_remove(tree->root, region);
+    tree->count--;
+    tree->size -= region->size;
+
+    region->left = nullptr;
+    region->right = nullptr;
+}
+
+uintptr_t memory_region_tree_find_free(MemoryRegionTree *tree, size_t size)
+{
+    if (size == 0 || !region_has_room(tree->root, tree->begin, tree->end, size))
+    {
+        return 0;
+    }
+
+    return region_find_free(tree->root, tree->begin, tree->end, size);
+}
+
+MemoryRegion *memory_region_tree_lookup(MemoryRegionTree *tree, uintptr_t address)
+{
+    return memory_region_tree_overlap(tree, address, 1);
+}
+
+MemoryRegion *memory_region_tree_overlap(MemoryRegionTree *tree, uintptr_t address, size_t size)
+{
+    MemoryRegion *node = tree->root;
+
+    while (node)
+    {
+        if (address + size <= node->address)
+        {
+            node = node->left;
+        }
+        else if (address >= region_end(node))
+        {
+            node = node->right;
+        }
+        else
+        {
+            return node;
+        }
+    }
+
+    return nullptr;
+}
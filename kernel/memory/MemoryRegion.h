@@ -0,0 +1,49 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+// A range of an address space kept in a MemoryRegionTree, embed it in the
+// structure owning the range so the tree never has to allocate.
+struct MemoryRegion
+{
+    uintptr_t address;
+    size_t size;
+
+    // Tree bookkeeping, see kernel/memory/MemoryRegion.cpp
+    MemoryRegion *left;
+    MemoryRegion *right;
+    int height;
+
+    uintptr_t subtree_begin; // Lowest address covered by the subtree.
+    uintptr_t subtree_end;   // End of the highest region of the subtree.
+    size_t subtree_gap;      // Largest hole between two regions of the subtree.
+};
+
+// Non-overlapping regions of [begin, end) sorted by address in an AVL tree.
+// Every node knows the largest hole of its subtree, so finding room for a
+// new region, looking up an address and checking for overlaps are O(log n).
+struct MemoryRegionTree
+{
+    MemoryRegion *root;
+
+    uintptr_t begin;
+    uintptr_t end;
+
+    size_t count;
+    size_t size;
+};
+
+void memory_region_tree_initialize(MemoryRegionTree *tree, uintptr_t begin, uintptr_t end);
+
+void memory_region_tree_insert(MemoryRegionTree *tree, MemoryRegion *region);
+
+void memory_region_tree_remove(MemoryRegionTree *tree, MemoryRegion *region);
+
+// Returns the lowest address of a hole of at least size bytes, or 0 if there is none.
+uintptr_t memory_region_tree_find_free(MemoryRegionTree *tree, size_t size);
+
+// Returns the region containing address.
+MemoryRegion *memory_region_tree_lookup(MemoryRegionTree *tree, uintptr_t address);
+
+// Returns one of the regions intersecting [address, address + size).
+MemoryRegion *memory_region_tree_overlap(MemoryRegionTree *tree, uintptr_t address, size_t size);
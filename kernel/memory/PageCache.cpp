@@ -0,0 +1,185 @@
+#include <libsystem/Logger.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "kernel/memory/PageCache.h"
+#include "kernel/memory/Virtual.h"
+
+#define PAGE_CACHE_FILE_COUNT 32
+
+struct PageCacheEntry
+{
+    FsNode *node;
+    MemoryObject *object;
+};
+
+static PageCacheEntry _entries[PAGE_CACHE_FILE_COUNT] = {};
+
+static void page_cache_entry_drop(PageCacheEntry &entry)
+{
+    memory_object_deref(entry.object);
+    entry.node->deref();
+
+    entry.object = nullptr;
+    entry.node = nullptr;
+}
+
+// Find a slot for a new file, reusing the one of a file nobody maps anymore if needed.
+static PageCacheEntry *page_cache_entry_alloc()
+{
+    for (auto &entry : _entries)
+    {
+        if (entry.node == nullptr)
+        {
+            return &entry;
+        }
+    }
+
+    for (auto &entry : _entries)
+    {
+        if (entry.object->refcount == 1)
+        {
+            page_cache_entry_drop(entry);
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+static MemoryObject *page_cache_lookup(FsNode *node)
+{
+    ASSERT_ATOMIC;
+
+    for (auto &entry : _entries)
+    {
+        if (entry.node == node)
+        {
+            return memory_object_ref(entry.object);
+        }
+    }
+
+    return nullptr;
+}
+
+MemoryObject *page_cache_acquire(FsHandle *handle)
+{
+    FsNode *node = handle->node;
+
+    // pages() and size() might take the lock of the node, so they are called
+    // outside of any atomic section.
+    MemoryObject *pages = node->pages();
+
+    if (pages)
+    {
+        return pages;
+    }
+
+    {
+        AtomicHolder holder;
+
+        MemoryObject *cached = page_cache_lookup(node);
+
+        if (cached)
+        {
+            return cached;
+        }
+    }
+
+    size_t size = node->size ? node->size(node, handle) : 0;
+    MemoryObject *memory_object = memory_object_create(size);
+
+    AtomicHolder holder;
+
+    // Someone else might have cached it while we were asking for its size.
+    MemoryObject *cached = page_cache_lookup(node);
+
+    if (cached)
+    {
+        memory_object_deref(memory_object);
+        return cached;
+    }
+
+    PageCacheEntry *entry = page_cache_entry_alloc();
+
+    if (entry)
+    {
+        entry->node = node->ref();
+        entry->object = memory_object_ref(memory_object);
+    }
+
+    return memory_object;
+}
+
+Result page_cache_fill(MemoryObject *memory_object, FsHandle *handle, size_t offset, size_t size)
+{
+    size_t first_page = offset / ARCH_PAGE_SIZE;
+    size_t last_page = MIN(PAGE_ALIGN_UP(offset + size) / ARCH_PAGE_SIZE, memory_object->page_count());
+
+    char *buffer = nullptr;
+
+    for (size_t page = first_page; page < last_page; page++)
+    {
+        if (memory_object->page(page))
+        {
+            continue;
+        }
+
+        if (buffer == nullptr)
+        {
+            buffer = (char *)malloc(ARCH_PAGE_SIZE);
+        }
+
+        memset(buffer, 0, ARCH_PAGE_SIZE);
+
+        size_t read = 0;
+        Result result = fshandle_pread(handle, buffer, ARCH_PAGE_SIZE, page * ARCH_PAGE_SIZE, &read);
+
+        if (result != SUCCESS)
+        {
+            free(buffer);
+            return result;
+        }
+
+        AtomicHolder holder;
+
+        // Someone else might have filled it while we were reading.
+        bool fresh = false;
+        uintptr_t physical_address = memory_object_page(memory_object, page, &fresh);
+
+        if (!physical_address)
+        {
+            free(buffer);
+            return ERR_OUT_OF_MEMORY;
+        }
+
+        if (fresh && memory_object->identity())
+        {
+            memcpy((void *)physical_address, buffer, ARCH_PAGE_SIZE);
+        }
+        else if (fresh)
+        {
+            MemoryRange window = virtual_alloc(&kpdir, MemoryRange{physical_address, ARCH_PAGE_SIZE}, MEMORY_NONE);
+            memcpy((void *)window.base(), buffer, ARCH_PAGE_SIZE);
+            virtual_free(&kpdir, window);
+        }
+    }
+
+    free(buffer);
+
+    return SUCCESS;
+}
+
+void page_cache_invalidate(FsNode *node)
+{
+    AtomicHolder holder;
+
+    for (auto &entry : _entries)
+    {
+        if (entry.node == node)
+        {
+            page_cache_entry_drop(entry);
+        }
+    }
+}
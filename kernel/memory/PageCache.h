@@ -0,0 +1,19 @@
+#pragma once
+
+#include "kernel/memory/MemoryObject.h"
+#include "kernel/node/Handle.h"
+
+// Pages of files shared by every task mapping them, looked up by node and
+// then by page offset in the file. Used to map executables without copying.
+// Nodes which already keep their content in a memory object (see
+// FsNode::pages()) are handed out as is.
+
+// Returns the memory object caching the pages of the file behind handle,
+// with a reference for the caller.
+MemoryObject *page_cache_acquire(FsHandle *handle);
+
+// Read the pages of [offset, offset + size) in the file that aren't cached yet.
+Result page_cache_fill(MemoryObject *memory_object, FsHandle *handle, size_t offset, size_t size);
+
+// Forget the pages of node, tasks which already mapped them keep the old ones.
+void page_cache_invalidate(FsNode *node);
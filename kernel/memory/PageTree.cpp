@@ -0,0 +1,91 @@
+#include <libsystem/Assert.h>
+#include <libsystem/core/CString.h>
+
+#include "kernel/memory/PageTree.h"
+
+uintptr_t page_tree_lookup(PageTree *tree, size_t index)
+{
+    size_t table = index / PAGE_TREE_FANOUT;
+
+    if (tree->tables == nullptr ||
+        table >= PAGE_TREE_FANOUT ||
+        tree->tables[table] == nullptr)
+    {
+        return 0;
+    }
+
+    return tree->tables[table][index % PAGE_TREE_FANOUT];
+}
+
+bool page_tree_insert(PageTree *tree, size_t index, uintptr_t page)
+{
+    size_t table = index / PAGE_TREE_FANOUT;
+
+    assert(table < PAGE_TREE_FANOUT);
+
+    if (tree->tables == nullptr)
+    {
+        tree->tables = (uintptr_t **)calloc(PAGE_TREE_FANOUT, sizeof(uintptr_t *));
+
+        if (tree->tables == nullptr)
+        {
+            return false;
+        }
+    }
+
+    if (tree->tables[table] == nullptr)
+    {
+        tree->tables[table] = (uintptr_t *)calloc(PAGE_TREE_FANOUT, sizeof(uintptr_t));
+
+        if (tree->tables[table] == nullptr)
+        {
+            return false;
+        }
+    }
+
+    tree->tables[table][index % PAGE_TREE_FANOUT] = page;
+
+    return true;
+}
+
+void page_tree_truncate(PageTree *tree, size_t index, PageTreeReleaseCallback release)
+{
+    if (tree->tables == nullptr)
+    {
+        return;
+    }
+
+    for (size_t table = index / PAGE_TREE_FANOUT; table < PAGE_TREE_FANOUT; table++)
+    {
+        uintptr_t *pages = tree->tables[table];
+
+        if (pages == nullptr)
+        {
+            continue;
+        }
+
+        // Only the first table can be cut in the middle.
+        size_t first = table == index / PAGE_TREE_FANOUT ? index % PAGE_TREE_FANOUT : 0;
+
+        for (size_t i = first; i < PAGE_TREE_FANOUT; i++)
+        {
+            if (pages[i])
+            {
+                release(pages[i]);
+                pages[i] = 0;
+            }
+        }
+
+        if (first == 0)
+        {
+            free(pages);
+            tree->tables[table] = nullptr;
+        }
+    }
+
+    if (index == 0)
+    {
+        free(tree->tables);
+        tree->tables = nullptr;
+    }
+}
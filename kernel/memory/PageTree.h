@@ -0,0 +1,25 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+#define PAGE_TREE_FANOUT 1024
+
+// Sparse array of physical page addresses indexed by page number, laid out as
+// a two level radix tree like the x86 page tables. A table is only allocated
+// once it holds a page, so holes cost nothing and growing never moves
+// anything around.
+struct PageTree
+{
+    uintptr_t **tables;
+};
+
+typedef void (*PageTreeReleaseCallback)(uintptr_t page);
+
+// Returns the page at index, or 0 if there is none.
+uintptr_t page_tree_lookup(PageTree *tree, size_t index);
+
+// Returns false if there was no memory left for the tables.
+bool page_tree_insert(PageTree *tree, size_t index, uintptr_t page);
+
+// Remove every page from index onward, handing each of them to release.
+void page_tree_truncate(PageTree *tree, size_t index, PageTreeReleaseCallback release);
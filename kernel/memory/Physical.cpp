@@ -1,5 +1,9 @@
+#include <libsystem/Assert.h>
+#include <libsystem/Logger.h>
+#include <libsystem/math/MinMax.h>
 #include <libsystem/thread/Atomic.h>
 
+#include "arch/Arch.h"
 #include "arch/Paging.h"
 
 #include "kernel/memory/Physical.h"
@@ -8,59 +12,482 @@
 size_t TOTAL_MEMORY = 0;
 size_t USED_MEMORY = 0;
 
-size_t best_bet = 0;
 uint8_t MEMORY[1024 * 1024 / 8] = {};
 
-bool physical_page_is_used(uintptr_t address)
+// Free memory is kept by a buddy allocator as naturally aligned blocks of
+// (1 << order) pages, with one free list per order. Free pages aren't mapped
+// so the links live in a side array indexed by page number.
+// The MEMORY bitmap is still the authority on which pages are in use.
+
+#define PHYSICAL_NO_PAGE 0xFFFFFFFF
+#define PHYSICAL_NOT_A_BLOCK 0xFF
+
+// Only the first gigabyte is identity mapped in kernel space.
+#define PHYSICAL_IDENTITY_PAGES (256 * 1024)
+
+struct PhysicalPage
 {
-    uintptr_t page = address / ARCH_PAGE_SIZE;
+    uint32_t prev;
+    uint32_t next;
+    uint8_t order; // Order of the free block starting at this page.
+};
+
+static PhysicalPage *_pages = nullptr;
+static size_t _pages_count = 0;
 
+static uint32_t _free_lists[MEMORY_ORDER_COUNT];
+static size_t _free_blocks[MEMORY_ORDER_COUNT] = {};
+static uint32_t _free_lists_bitmap = 0;
+
+static bool page_is_used(size_t page)
+{
     return MEMORY[page / 8] & (1 << (page % 8));
 }
 
-void physical_page_set_used(uintptr_t address)
+static void page_set_used(size_t page)
 {
-    uintptr_t page = address / ARCH_PAGE_SIZE;
+    MEMORY[page / 8] |= 1 << (page % 8);
+}
 
-    if (page == best_bet)
+static void page_set_free(size_t page)
+{
+    MEMORY[page / 8] &= ~(1 << (page % 8));
+
+    // Until the free lists are built, just remember how far memory goes.
+    if (_pages == nullptr && page >= _pages_count)
     {
-        best_bet++;
+        _pages_count = page + 1;
     }
+}
 
-    MEMORY[page / 8] |= 1 << (page % 8);
+static void block_push(uint32_t page, int order)
+{
+    PhysicalPage &block = _pages[page];
+
+    block.order = order;
+    block.prev = PHYSICAL_NO_PAGE;
+    block.next = _free_lists[order];
+
+    if (block.next != PHYSICAL_NO_PAGE)
+    {
+        _pages[block.next].prev = page;
+    }
+
+    _free_lists[order] = page;
+    _free_blocks[order]++;
+    _free_lists_bitmap |= 1 << order;
 }
 
-void phyisical_page_set_used(uintptr_t address)
+static void block_remove(uint32_t page)
 {
-    uintptr_t page = address / ARCH_PAGE_SIZE;
+    PhysicalPage &block = _pages[page];
+    int order = block.order;
 
-    if (page < best_bet)
+    if (block.prev != PHYSICAL_NO_PAGE)
     {
-        best_bet = page;
+        _pages[block.prev].next = block.next;
+    }
+    else
+    {
+        _free_lists[order] = block.next;
     }
 
-    MEMORY[page / 8] &= ~(1 << (page % 8));
+    if (block.next != PHYSICAL_NO_PAGE)
+    {
+        _pages[block.next].prev = block.prev;
+    }
+
+    block.order = PHYSICAL_NOT_A_BLOCK;
+    _free_blocks[order]--;
+
+    if (_free_lists[order] == PHYSICAL_NO_PAGE)
+    {
+        _free_lists_bitmap &= ~(1 << order);
+    }
+}
+
+static bool block_is_free(uint32_t page, int order)
+{
+    return page < _pages_count && _pages[page].order == order;
+}
+
+// Give back a block, merging it with its buddy for as long as we can.
+static void block_free(uint32_t page, int order)
+{
+    while (order < MEMORY_ORDER_COUNT - 1)
+    {
+        uint32_t buddy = page ^ (1 << order);
+
+        if (!block_is_free(buddy, order))
+        {
+            break;
+        }
+
+        block_remove(buddy);
+        page &= ~(1 << order);
+        order++;
+    }
+
+    block_push(page, order);
+}
+
+// Give back a run of pages as the largest aligned blocks that fit.
+static void blocks_free(uint32_t page, size_t count)
+{
+    if (page >= _pages_count)
+    {
+        return;
+    }
+
+    count = MIN(count, _pages_count - page);
+
+    while (count > 0)
+    {
+        int order = page ? __builtin_ctz(page) : MEMORY_ORDER_COUNT - 1;
+
+        if (order > MEMORY_ORDER_COUNT - 1)
+        {
+            order = MEMORY_ORDER_COUNT - 1;
+        }
+
+        while ((1u << order) > count)
+        {
+            order--;
+        }
+
+        block_free(page, order);
+
+        page += 1 << order;
+        count -= 1 << order;
+    }
+}
+
+// Take a single page out of the free block containing it,
+// splitting that block and giving back the rest.
+static void blocks_take_page(uint32_t page)
+{
+    if (_pages == nullptr || page >= _pages_count)
+    {
+        return;
+    }
+
+    for (int order = 0; order < MEMORY_ORDER_COUNT; order++)
+    {
+        uint32_t block = page & ~((1u << order) - 1);
+
+        if (block_is_free(block, order))
+        {
+            block_remove(block);
+
+            while (order > 0)
+            {
+                order--;
+
+                uint32_t half = block + (1 << order);
+
+                if (page >= half)
+                {
+                    block_push(block, order);
+                    block = half;
+                }
+                else
+                {
+                    block_push(half, order);
+                }
+            }
+
+            return;
+        }
+    }
+}
+
+static int order_for_page_count(size_t count)
+{
+    int order = 0;
+
+    while ((1u << order) < count)
+    {
+        order++;
+    }
+
+    return order;
+}
+
+static size_t find_free_pages(size_t count, size_t limit)
+{
+    size_t run = 0;
+
+    for (size_t page = 1; page < limit; page++)
+    {
+        if (page_is_used(page))
+        {
+            run = 0;
+        }
+        else if (++run == count)
+        {
+            return page + 1 - count;
+        }
+    }
+
+    return 0;
+}
+
+MemoryRange physical_initialize()
+{
+    ASSERT_ATOMIC;
+
+    size_t metadata_size = PAGE_ALIGN_UP(_pages_count * sizeof(PhysicalPage));
+    size_t metadata_page = find_free_pages(metadata_size / ARCH_PAGE_SIZE, MIN(_pages_count, PHYSICAL_IDENTITY_PAGES));
+
+    if (metadata_page == 0)
+    {
+        system_panic("No room for the physical memory allocator!");
+    }
+
+    MemoryRange metadata_range{metadata_page * ARCH_PAGE_SIZE, metadata_size};
+    physical_set_used(metadata_range);
+
+    _pages = reinterpret_cast<PhysicalPage *>(metadata_range.base());
+
+    for (size_t i = 0; i < _pages_count; i++)
+    {
+        _pages[i].order = PHYSICAL_NOT_A_BLOCK;
+    }
+
+    for (int i = 0; i < MEMORY_ORDER_COUNT; i++)
+    {
+        _free_lists[i] = PHYSICAL_NO_PAGE;
+    }
+
+    size_t run = 0;
+
+    for (size_t page = 0; page <= _pages_count; page++)
+    {
+        if (page == _pages_count || page_is_used(page))
+        {
+            blocks_free(page - run, run);
+            run = 0;
+        }
+        else
+        {
+            run++;
+        }
+    }
+
+    return metadata_range;
+}
+
+uintptr_t physical_end()
+{
+    return _pages_count * ARCH_PAGE_SIZE;
+}
+
+static MemoryRange physical_alloc_large(size_t count)
+{
+    size_t page = find_free_pages(count, _pages_count);
+
+    if (page == 0)
+    {
+        return MemoryRange();
+    }
+
+    MemoryRange range{page * ARCH_PAGE_SIZE, count * ARCH_PAGE_SIZE};
+    physical_set_used(range);
+
+    return range;
+}
+
+// Take a block of exactly (1 << order) pages out of the free lists,
+// the pages are still marked as free in the bitmap.
+static uint32_t blocks_alloc(int order)
+{
+    uint32_t available = _free_lists_bitmap & ~((1u << order) - 1);
+
+    if (available == 0)
+    {
+        return PHYSICAL_NO_PAGE;
+    }
+
+    int block_order = __builtin_ctz(available);
+    uint32_t block = _free_lists[block_order];
+
+    block_remove(block);
+
+    while (block_order > order)
+    {
+        block_order--;
+        block_push(block + (1 << block_order), block_order);
+    }
+
+    return block;
+}
+
+static MemoryRange physical_alloc_pages(size_t count)
+{
+    int order = order_for_page_count(count);
+
+    uint32_t block = PHYSICAL_NO_PAGE;
+
+    if (order < MEMORY_ORDER_COUNT)
+    {
+        block = blocks_alloc(order);
+    }
+
+    if (block == PHYSICAL_NO_PAGE)
+    {
+        // No block is big enough, but the pages may still be there across blocks.
+        return physical_alloc_large(count);
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        page_set_used(block + i);
+    }
+
+    USED_MEMORY += count * ARCH_PAGE_SIZE;
+
+    // Don't waste the end of the block on allocations that aren't a power of two.
+    blocks_free(block + count, (1 << order) - count);
+
+    return MemoryRange{block * ARCH_PAGE_SIZE, count * ARCH_PAGE_SIZE};
+}
+
+/* --- Page magazines ------------------------------------------------------- */
+
+// Each processor keeps a small stack of free pages so single page
+// allocations, which are most of them, don't have to go through the
+// free lists. The pages are marked as used in the bitmap while they sit
+// in a magazine, but they don't count toward USED_MEMORY.
+
+#define PHYSICAL_MAGAZINE_SIZE 64
+#define PHYSICAL_MAGAZINE_BATCH_ORDER 5
+#define PHYSICAL_MAGAZINE_BATCH (1 << PHYSICAL_MAGAZINE_BATCH_ORDER)
+
+struct PhysicalMagazine
+{
+    uint32_t pages[PHYSICAL_MAGAZINE_SIZE];
+    int count;
+};
+
+static PhysicalMagazine _magazines[ARCH_PROCESSOR_MAX_COUNT] = {};
+
+static void magazine_refill(PhysicalMagazine &magazine)
+{
+    uint32_t block = blocks_alloc(PHYSICAL_MAGAZINE_BATCH_ORDER);
+
+    for (int i = 0; i < PHYSICAL_MAGAZINE_BATCH; i++)
+    {
+        uint32_t page = PHYSICAL_NO_PAGE;
+
+        if (block != PHYSICAL_NO_PAGE)
+        {
+            // Pushed backward so pages are handed out in ascending order.
+            page = block + PHYSICAL_MAGAZINE_BATCH - 1 - i;
+        }
+        else
+        {
+            page = blocks_alloc(0);
+        }
+
+        if (page == PHYSICAL_NO_PAGE)
+        {
+            return;
+        }
+
+        page_set_used(page);
+        magazine.pages[magazine.count] = page;
+        magazine.count++;
+    }
+}
+
+static void magazine_drain(PhysicalMagazine &magazine, int count)
+{
+    for (int i = 0; i < count && magazine.count > 0; i++)
+    {
+        magazine.count--;
+
+        uint32_t page = magazine.pages[magazine.count];
+
+        page_set_free(page);
+        block_free(page, 0);
+    }
 }
 
+static void magazines_drain_all()
+{
+    for (int i = 0; i < ARCH_PROCESSOR_MAX_COUNT; i++)
+    {
+        magazine_drain(_magazines[i], PHYSICAL_MAGAZINE_SIZE);
+    }
+}
+
+static uint32_t magazine_pop()
+{
+    PhysicalMagazine &magazine = _magazines[arch_processor_id()];
+
+    if (magazine.count == 0)
+    {
+        magazine_refill(magazine);
+    }
+
+    if (magazine.count == 0)
+    {
+        return PHYSICAL_NO_PAGE;
+    }
+
+    magazine.count--;
+
+    return magazine.pages[magazine.count];
+}
+
+static void magazine_push(uint32_t page)
+{
+    PhysicalMagazine &magazine = _magazines[arch_processor_id()];
+
+    if (magazine.count == PHYSICAL_MAGAZINE_SIZE)
+    {
+        magazine_drain(magazine, PHYSICAL_MAGAZINE_BATCH);
+    }
+
+    magazine.pages[magazine.count] = page;
+    magazine.count++;
+}
+
+/* --- Public API ----------------------------------------------------------- */
+
 MemoryRange physical_alloc(size_t size)
 {
     ASSERT_ATOMIC;
 
     assert(IS_PAGE_ALIGN(size));
 
-    for (size_t i = best_bet; i < ((TOTAL_MEMORY - size) / ARCH_PAGE_SIZE); i++)
+    if (size == ARCH_PAGE_SIZE && _pages != nullptr)
     {
-        MemoryRange range(i * ARCH_PAGE_SIZE, size);
+        uint32_t page = magazine_pop();
 
-        if (!physical_is_used(range))
+        if (page != PHYSICAL_NO_PAGE)
         {
-            physical_set_used(range);
-            return range;
+            USED_MEMORY += ARCH_PAGE_SIZE;
+
+            return MemoryRange{page * ARCH_PAGE_SIZE, ARCH_PAGE_SIZE};
         }
     }
 
-    system_panic("Out of physical memory!\tTrying to allocat %dkio but free memory is %dkio !", size / 1024, (TOTAL_MEMORY - USED_MEMORY) / 1024);
-    return MemoryRange();
+    MemoryRange range = physical_alloc_pages(size / ARCH_PAGE_SIZE);
+
+    if (range.empty())
+    {
+        // Memory is tight, take back what's sitting in the magazines and try again.
+        magazines_drain_all();
+        range = physical_alloc_pages(size / ARCH_PAGE_SIZE);
+    }
+
+    if (range.empty())
+    {
+        system_panic("Out of physical memory!\tTrying to allocat %dkio but free memory is %dkio !", size / 1024, (TOTAL_MEMORY - USED_MEMORY) / 1024);
+    }
+
+    return range;
 }
 
 void physical_free(MemoryRange range)
@@ -69,7 +496,17 @@ void physical_free(MemoryRange range)
 
     assert(range.is_page_aligned());
 
-    physical_set_free(range);
+    size_t page = range.base() / ARCH_PAGE_SIZE;
+
+    if (range.page_count() == 1 && page < _pages_count && page_is_used(page) && _pages != nullptr)
+    {
+        USED_MEMORY -= ARCH_PAGE_SIZE;
+        magazine_push(page);
+    }
+    else
+    {
+        physical_set_free(range);
+    }
 }
 
 bool physical_is_used(MemoryRange range)
@@ -80,9 +517,7 @@ bool physical_is_used(MemoryRange range)
 
     for (size_t i = 0; i < range.page_count(); i++)
     {
-        uintptr_t address = range.base() + i * ARCH_PAGE_SIZE;
-
-        if (physical_page_is_used(address))
+        if (page_is_used(range.base() / ARCH_PAGE_SIZE + i))
         {
             return true;
         }
@@ -99,12 +534,13 @@ void physical_set_used(MemoryRange range)
 
     for (size_t i = 0; i < range.page_count(); i++)
     {
-        uintptr_t address = range.base() + i * ARCH_PAGE_SIZE;
+        size_t page = range.base() / ARCH_PAGE_SIZE + i;
 
-        if (!physical_page_is_used(address))
+        if (!page_is_used(page))
         {
             USED_MEMORY += ARCH_PAGE_SIZE;
-            physical_page_set_used(address);
+            blocks_take_page(page);
+            page_set_used(page);
         }
     }
 }
@@ -115,14 +551,34 @@ void physical_set_free(MemoryRange range)
 
     assert(range.is_page_aligned());
 
-    for (size_t i = 0; i < range.page_count(); i++)
+    size_t run = 0;
+    size_t first_page = range.base() / ARCH_PAGE_SIZE;
+
+    for (size_t i = 0; i <= range.page_count(); i++)
     {
-        uintptr_t address = range.base() + i * ARCH_PAGE_SIZE;
+        size_t page = first_page + i;
 
-        if (physical_page_is_used(address))
+        if (i < range.page_count() && page_is_used(page))
         {
             USED_MEMORY -= ARCH_PAGE_SIZE;
-            phyisical_page_set_used(address);
+            page_set_free(page);
+            run++;
+        }
+        else if (run > 0)
+        {
+            if (_pages != nullptr)
+            {
+                blocks_free(page - run, run);
+            }
+
+            run = 0;
         }
     }
 }
+
+size_t physical_free_blocks(int order)
+{
+    ASSERT_ATOMIC;
+
+    return _free_blocks[order];
+}
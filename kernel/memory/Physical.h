@@ -1,5 +1,7 @@
 #pragma once
 
+#include <abi/Memory.h>
+
 #include <libsystem/Common.h>
 
 #include "kernel/memory/MemoryRange.h"
@@ -8,6 +10,13 @@ extern size_t TOTAL_MEMORY;
 extern size_t USED_MEMORY;
 extern uint8_t MEMORY[1024 * 1024 / 8];
 
+// Build the free lists from the MEMORY bitmap, returns the
+// range holding the allocator bookkeeping so it can be mapped.
+MemoryRange physical_initialize();
+
+// End of the highest usable page of physical memory.
+uintptr_t physical_end();
+
 MemoryRange physical_alloc(size_t size);
 
 void physical_free(MemoryRange range);
@@ -17,3 +26,5 @@ bool physical_is_used(MemoryRange range);
 void physical_set_used(MemoryRange range);
 
 void physical_set_free(MemoryRange range);
+
+size_t physical_free_blocks(int order);
@@ -1,15 +1,116 @@
+#include <libsystem/math/MinMax.h>
 #include <libsystem/thread/Atomic.h>
 
+#include "arch/x86/SMP.h"
+
 #include "kernel/memory/Memory.h"
+#include "kernel/memory/MemoryRegion.h"
+#include "kernel/memory/Physical.h"
 #include "kernel/memory/Virtual.h"
 #include "kernel/system/System.h"
 
 #define PD_INDEX(vaddr) ((vaddr) >> 22)
 #define PT_INDEX(vaddr) (((vaddr) >> 12) & 0x03ff)
 
+// Kernel space is split in two: physical memory is identity mapped at the
+// bottom, and virtual_alloc() hands out the rest up to the first gigabyte.
+// Identity mapped memory is never allowed to take more than this so there is
+// always some room left for virtual_alloc().
+#define VIRTUAL_IDENTITY_MAX (768 * 1024 * 1024)
+#define VIRTUAL_KERNEL_END (1024 * 1024 * 1024)
+
 PageDirectory kpdir __aligned(ARCH_PAGE_SIZE) = {};
 PageTable kptable[256] __aligned(ARCH_PAGE_SIZE) = {};
 
+static MemoryRegionTree _kernel_regions = {};
+
+// Unused kernel regions, linked through MemoryRegion::right.
+static MemoryRegion *_kernel_regions_pool = nullptr;
+
+void virtual_initialize()
+{
+    uintptr_t identity_end = MIN(PAGE_ALIGN_UP(physical_end()), VIRTUAL_IDENTITY_MAX);
+
+    memory_region_tree_initialize(&_kernel_regions, identity_end, VIRTUAL_KERNEL_END);
+}
+
+uintptr_t virtual_identity_end()
+{
+    return _kernel_regions.begin;
+}
+
+// The kernel regions can't come from malloc() since malloc() itself ends up
+// in virtual_alloc(), so they are carved out of identity mapped pages.
+static MemoryRegion *kernel_region_create()
+{
+    if (!_kernel_regions_pool)
+    {
+        uintptr_t page = 0;
+
+        if (memory_alloc_identity(&kpdir, MEMORY_CLEAR, &page) != SUCCESS)
+        {
+            return nullptr;
+        }
+
+        MemoryRegion *regions = reinterpret_cast<MemoryRegion *>(page);
+
+        for (size_t i = 0; i < ARCH_PAGE_SIZE / sizeof(MemoryRegion); i++)
+        {
+            regions[i].right = _kernel_regions_pool;
+            _kernel_regions_pool = &regions[i];
+        }
+    }
+
+    MemoryRegion *region = _kernel_regions_pool;
+    _kernel_regions_pool = region->right;
+
+    return region;
+}
+
+static void kernel_region_destroy(MemoryRegion *region)
+{
+    region->right = _kernel_regions_pool;
+    _kernel_regions_pool = region;
+}
+
+// Give back [address, address + size) to virtual_alloc(), the regions
+// straddling the edges of the range are trimmed or split.
+static void kernel_regions_release(uintptr_t address, size_t size)
+{
+    MemoryRegion *region = nullptr;
+
+    while ((region = memory_region_tree_overlap(&_kernel_regions, address, size)))
+    {
+        memory_region_tree_remove(&_kernel_regions, region);
+
+        uintptr_t region_end = region->address + region->size;
+
+        if (region_end > address + size)
+        {
+            MemoryRegion *tail = region->address < address ? kernel_region_create() : region;
+
+            if (tail == nullptr)
+            {
+                system_panic("Out of memory for the kernel regions!");
+            }
+
+            tail->address = address + size;
+            tail->size = region_end - (address + size);
+            memory_region_tree_insert(&_kernel_regions, tail);
+        }
+
+        if (region->address < address)
+        {
+            region->size = address - region->address;
+            memory_region_tree_insert(&_kernel_regions, region);
+        }
+        else if (region_end <= address + size)
+        {
+            kernel_region_destroy(region);
+        }
+    }
+}
+
 bool virtual_present(PageDirectory *page_directory, uintptr_t virtual_address)
 {
     ASSERT_ATOMIC;
@@ -91,7 +192,7 @@ Result virtual_map(PageDirectory *page_directory, MemoryRange physical_range, ui
         PageTableEntry &page_table_entry = page_table->entries[page_table_index];
 
         page_table_entry.Present = 1;
-        page_table_entry.Write = 1;
+        page_table_entry.Write = !(flags & MEMORY_READONLY);
         page_table_entry.User = flags & MEMORY_USER;
         page_table_entry.PageFrameNumber = (physical_range.base() + offset) >> 12;
     }
@@ -105,39 +206,24 @@ MemoryRange virtual_alloc(PageDirectory *page_directory, MemoryRange physical_ra
 {
     ASSERT_ATOMIC;
 
-    bool is_user_memory = flags & MEMORY_USER;
+    // User space is laid out by the tasks, see kernel/tasking/Task-Memory.cpp
+    assert(!(flags & MEMORY_USER));
 
-    uintptr_t virtual_address = 0;
-    size_t current_size = 0;
+    MemoryRegion *region = kernel_region_create();
+    uintptr_t virtual_address = memory_region_tree_find_free(&_kernel_regions, physical_range.size());
 
-    // we skip the first page to make null deref trigger a page fault
-    for (size_t i = (is_user_memory ? 256 : 1) * 1024; i < (is_user_memory ? 1024 : 256) * 1024; i++)
+    if (region == nullptr || virtual_address == 0)
     {
-        uintptr_t current_address = i * ARCH_PAGE_SIZE;
-
-        if (!virtual_present(page_directory, current_address))
-        {
-            if (current_size == 0)
-            {
-                virtual_address = current_address;
-            }
-
-            current_size += ARCH_PAGE_SIZE;
+        system_panic("Out of virtual memory!");
+    }
 
-            if (current_size == physical_range.size())
-            {
-                virtual_map(page_directory, physical_range, virtual_address, flags);
+    region->address = virtual_address;
+    region->size = physical_range.size();
+    memory_region_tree_insert(&_kernel_regions, region);
 
-                return (MemoryRange){virtual_address, current_size};
-            }
-        }
-        else
-        {
-            current_size = 0;
-        }
-    }
+    virtual_map(page_directory, physical_range, virtual_address, flags);
 
-    system_panic("Out of virtual memory!");
+    return (MemoryRange){virtual_address, physical_range.size()};
 }
 
 void virtual_free(PageDirectory *page_directory, MemoryRange virtual_range)
@@ -151,6 +237,9 @@ void virtual_free(PageDirectory *page_directory, MemoryRange virtual_range)
         size_t page_directory_index = PD_INDEX(virtual_range.base() + offset);
         PageDirectoryEntry *page_directory_entry = &page_directory->entries[page_directory_index];
 
+        if (!page_directory_entry->Present)
+            continue;
+
         PageTable *page_table = (PageTable *)(page_directory_entry->PageFrameNumber * ARCH_PAGE_SIZE);
 
         size_t page_table_index = PT_INDEX(virtual_range.base() + offset);
@@ -160,5 +249,11 @@ void virtual_free(PageDirectory *page_directory, MemoryRange virtual_range)
             page_table_entry->as_uint = 0;
     }
 
-    paging_invalidate_tlb();
+    if (virtual_range.base() < _kernel_regions.end &&
+        virtual_range.base() + virtual_range.size() > _kernel_regions.begin)
+    {
+        kernel_regions_release(virtual_range.base(), virtual_range.size());
+    }
+
+    smp_tlb_shootdown();
 }
@@ -9,6 +9,11 @@
 extern PageDirectory kpdir;
 extern PageTable kptable[256];
 
+void virtual_initialize();
+
+// Kernel space below this address only holds identity mapped memory.
+uintptr_t virtual_identity_end();
+
 bool virtual_present(PageDirectory *page_directory, uintptr_t virtual_address);
 
 uintptr_t virtual_to_physical(PageDirectory *page_directory, uintptr_t virtual_address);
@@ -1,18 +1,58 @@
-
 #include <libfile/tar.h>
 #include <libsystem/Logger.h>
 #include <libsystem/Result.h>
 #include <libsystem/core/CString.h>
 
 #include "kernel/filesystem/Filesystem.h"
-#include "kernel/memory/Memory.h"
+#include "kernel/filesystem/TarFS.h"
 #include "kernel/modules/Modules.h"
+#include "kernel/node/File.h"
+
+// Looked up all the time, served by a filesystem of their own.
+#define RAMDISK_SYSTEM_PREFIX "System/"
+#define RAMDISK_SYSTEM_PATH "/System"
+
+static void ramdisk_mount_system(Module *module)
+{
+    FsNode *system = tarfs_create((void *)module->range.base(), module->range.size(), RAMDISK_SYSTEM_PREFIX);
+
+    Path *path = path_create(RAMDISK_SYSTEM_PATH);
+
+    Result result = filesystem_mkdir(path);
+
+    if (result == SUCCESS || result == ERR_FILE_EXISTS)
+    {
+        result = filesystem_mount(path, system);
+    }
+
+    if (result != SUCCESS)
+    {
+        logger_warn("Failed to mount " RAMDISK_SYSTEM_PATH ": %s", result_to_string(result));
+    }
+
+    path_destroy(path);
+    system->deref();
+}
 
+// Files are served straight from the archive, which stays mapped for good,
+// and only get copied the first time they are written to or mapped.
 void ramdisk_load(Module *module)
 {
+    ramdisk_mount_system(module);
+
+    TARIterator iterator;
+    tar_iterator_initialize(&iterator, (void *)module->range.base(), module->range.size());
+
     TARBlock block;
-    for (size_t i = 0; tar_read((void *)module->range.base(), &block, i); i++)
+    size_t file_count = 0;
+
+    while (tar_iterator_next(&iterator, &block))
     {
+        if (strncmp(block.name, RAMDISK_SYSTEM_PREFIX, strlen(RAMDISK_SYSTEM_PREFIX)) == 0)
+        {
+            continue;
+        }
+
         Path *file_path = path_create(block.name);
 
         if (block.name[strlen(block.name) - 1] == '/')
@@ -26,24 +66,14 @@ void ramdisk_load(Module *module)
         }
         else if ((block.typeflag & 8) == 0 || (block.typeflag & 8) == 5)
         {
-            FsHandle *handle = nullptr;
-            Result result = filesystem_open(file_path, OPEN_WRITE | OPEN_CREATE, &handle);
+            Result result = filesystem_link_and_take_ref(file_path, new FsFile(block.data, block.size));
 
             if (result != SUCCESS)
             {
-                logger_warn("Failed to open file %s! %s", block.name, result_to_string(result));
-                continue;
+                logger_warn("Failed to create file %s: %s", block.name, result_to_string(result));
             }
 
-            size_t written = 0;
-            result = fshandle_write(handle, block.data, block.size, &written);
-
-            if (result != SUCCESS)
-            {
-                logger_error("Failed to write file: %s", result_to_string(result));
-            }
-
-            fshandle_destroy(handle);
+            file_count++;
         }
         else if (block.name[strlen(block.name) - 1] != '/')
         {
@@ -55,7 +85,10 @@ void ramdisk_load(Module *module)
         path_destroy(file_path);
     }
 
-    memory_free(memory_kpdir(), module->range);
+    if (iterator.corrupted)
+    {
+        logger_warn("The ramdisk is damaged after %d files, the rest is skipped!", file_count);
+    }
 
-    logger_info("Loading ramdisk succeeded.");
+    logger_info("Loading ramdisk succeeded, %d files.", file_count);
 }
@@ -1,11 +1,11 @@
 
+#include <libsystem/Assert.h>
 #include <libsystem/core/CString.h>
+#include <libsystem/math/MinMax.h>
 
 #include "kernel/node/Connection.h"
 #include "kernel/node/Handle.h"
 
-#define CONNECTION_BUFFER_SIZE 4096
-
 static void fsconnection_accept(FsConnection *connection)
 {
     connection->_accepted = true;
@@ -16,10 +16,36 @@ static bool fsconnection_is_accepted(FsConnection *connection)
     return connection->_accepted;
 }
 
+// Release the attachments of the messages nobody received.
+static void fsconnection_drain(RingBuffer &buffer)
+{
+    while (!buffer.empty())
+    {
+        ConnectionMessage message;
+        buffer.read((char *)&message, sizeof(ConnectionMessage));
+
+        for (size_t i = 0; i < message.attachments_count; i++)
+        {
+            FsAttachment attachment;
+            buffer.read((char *)&attachment, sizeof(FsAttachment));
+            fsattachment_release(&attachment);
+        }
+
+        buffer.skip(message.size);
+    }
+}
+
+static void fsconnection_destroy(FsConnection *connection)
+{
+    fsconnection_drain(connection->_data_to_server);
+    fsconnection_drain(connection->_data_to_client);
+}
+
 FsConnection::FsConnection() : FsNode(FILE_TYPE_CONNECTION)
 {
     accept = (FsNodeAcceptCallback)fsconnection_accept;
     is_accepted = (FsNodeIsAcceptedCallback)fsconnection_is_accepted;
+    destroy = (FsNodeDestroyCallback)fsconnection_destroy;
 }
 
 bool FsConnection::can_read(FsHandle *handle)
@@ -38,63 +64,95 @@ bool FsConnection::can_write(FsHandle *handle)
 {
     if (handle->has_flag(OPEN_CLIENT))
     {
-        return !_data_to_server.full() || !server;
+        return _data_to_server.capacity() - _data_to_server.used() >= MESSAGE_FRAME_MAX || !server;
     }
     else
     {
-        return !_data_to_client.full() || !clients;
+        return _data_to_client.capacity() - _data_to_client.used() >= MESSAGE_FRAME_MAX || !clients;
     }
 }
 
 ResultOr<size_t> FsConnection::read(FsHandle &handle, void *buffer, size_t size)
 {
-    if (handle.has_flag(OPEN_CLIENT))
-    {
-        if (server)
-        {
-            return _data_to_client.read((char *)buffer, size);
-        }
-        else
-        {
-            return ERR_STREAM_CLOSED;
-        }
-    }
-    else
+    FsAttachment attachments[MESSAGE_ATTACHMENT_COUNT];
+    size_t attachments_count = 0;
+
+    auto result_or_read = receive(handle, buffer, size, attachments, &attachments_count);
+
+    // Nobody is there to take them.
+    for (size_t i = 0; i < attachments_count; i++)
     {
-        if (clients)
-        {
-            return _data_to_server.read((char *)buffer, size);
-        }
-        else
-        {
-            return ERR_STREAM_CLOSED;
-        }
+        fsattachment_release(&attachments[i]);
     }
+
+    return result_or_read;
 }
 
 ResultOr<size_t> FsConnection::write(FsHandle &handle, const void *buffer, size_t size)
 {
+    return send(handle, buffer, size, nullptr, 0);
+}
+
+ResultOr<size_t> FsConnection::send(FsHandle &handle, const void *buffer, size_t size, const FsAttachment *attachments, size_t attachments_count)
+{
+    bool is_client = handle.has_flag(OPEN_CLIENT);
+
+    RingBuffer &data = is_client ? _data_to_server : _data_to_client;
 
-    if (handle.has_flag(OPEN_CLIENT))
+    if (!(is_client ? server : clients))
     {
-        if (server)
-        {
-            return _data_to_server.write((const char *)buffer, size);
-        }
-        else
-        {
-            return ERR_STREAM_CLOSED;
-        }
+        return ERR_STREAM_CLOSED;
     }
-    else
+
+    if (size > MESSAGE_SIZE_MAX)
     {
-        if (clients)
-        {
-            return _data_to_client.write((const char *)buffer, size);
-        }
-        else
+        return ERR_MESSAGE_TOO_LONG;
+    }
+
+    if (attachments_count > MESSAGE_ATTACHMENT_COUNT)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    // We only get there once can_write() said so, and messages go in whole.
+    assert(data.capacity() - data.used() >= MESSAGE_FRAME_MAX);
+
+    ConnectionMessage message = {size, attachments_count};
+
+    data.write((const char *)&message, sizeof(ConnectionMessage));
+    data.write((const char *)attachments, sizeof(FsAttachment) * attachments_count);
+    data.write((const char *)buffer, size);
+
+    return size;
+}
+
+ResultOr<size_t> FsConnection::receive(FsHandle &handle, void *buffer, size_t size, FsAttachment *attachments, size_t *attachments_count)
+{
+    bool is_client = handle.has_flag(OPEN_CLIENT);
+
+    RingBuffer &data = is_client ? _data_to_client : _data_to_server;
+
+    *attachments_count = 0;
+
+    // What was sent before the other side went away can still be received.
+    if (data.empty())
+    {
+        if (!(is_client ? server : clients))
         {
             return ERR_STREAM_CLOSED;
         }
+
+        return 0;
     }
+
+    ConnectionMessage message;
+    data.read((char *)&message, sizeof(ConnectionMessage));
+
+    data.read((char *)attachments, sizeof(FsAttachment) * message.attachments_count);
+    *attachments_count = message.attachments_count;
+
+    size_t received = data.read((char *)buffer, MIN(size, message.size));
+    data.skip(message.size - received);
+
+    return received;
 }
@@ -4,11 +4,25 @@
 
 #include "kernel/node/Node.h"
 
+// Messages are kept in the buffers one after the other, each one is a
+// ConnectionMessage, then its attachments and then its content.
+struct ConnectionMessage
+{
+    size_t size;
+    size_t attachments_count;
+};
+
 class FsConnection : public FsNode
 {
 private:
 public:
-    static constexpr int BUFFER_SIZE = 4096;
+    static constexpr int BUFFER_SIZE = 16384;
+
+    // Room for the biggest message, so one can always be sent once the
+    // connection is writable.
+    static constexpr size_t MESSAGE_FRAME_MAX = sizeof(ConnectionMessage) +
+                                                sizeof(FsAttachment) * MESSAGE_ATTACHMENT_COUNT +
+                                                MESSAGE_SIZE_MAX;
 
     bool _accepted = false;
 
@@ -25,4 +39,8 @@ public:
     ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size);
 
     ResultOr<size_t> write(FsHandle &handle, const void *buffer, size_t size);
+
+    ResultOr<size_t> send(FsHandle &handle, const void *buffer, size_t size, const FsAttachment *attachments, size_t attachments_count);
+
+    ResultOr<size_t> receive(FsHandle &handle, void *buffer, size_t size, FsAttachment *attachments, size_t *attachments_count);
 };
@@ -48,26 +48,22 @@ static void directory_close(FsDirectory *node, FsHandle *handle)
 
 static FsNode *directory_find(FsDirectory *node, const char *name)
 {
-    list_foreach(FsDirectoryEntry, entry, node->childs)
+    FsDirectoryEntry *entry = (FsDirectoryEntry *)hashmap_get(node->childs_by_name, name);
+
+    if (entry)
     {
-        if (strcmp(entry->name, name) == 0)
-        {
-            return entry->node->ref();
-        }
-    };
+        return entry->node->ref();
+    }
 
     return nullptr;
 }
 
-static Result directory_link(FsDirectory *node, const char *name, FsNode *child)
+Result directory_link(FsDirectory *node, const char *name, FsNode *child)
 {
-    list_foreach(FsDirectoryEntry, entry, node->childs)
+    if (hashmap_has(node->childs_by_name, name))
     {
-        if (strcmp(entry->name, name) == 0)
-        {
-            return ERR_FILE_EXISTS;
-        }
-    };
+        return ERR_FILE_EXISTS;
+    }
 
     FsDirectoryEntry *new_entry = __create(FsDirectoryEntry);
 
@@ -75,6 +71,7 @@ static Result directory_link(FsDirectory *node, const char *name, FsNode *child)
     strcpy(new_entry->name, name);
 
     list_pushback(node->childs, new_entry);
+    hashmap_put(node->childs_by_name, new_entry->name, new_entry);
 
     return SUCCESS;
 }
@@ -85,24 +82,25 @@ static void directory_entry_destroy(FsDirectoryEntry *entry)
     free(entry);
 }
 
-static Result directory_unlink(FsDirectory *node, const char *name)
+Result directory_unlink(FsDirectory *node, const char *name)
 {
-    list_foreach(FsDirectoryEntry, entry, node->childs)
-    {
-        if (strcmp(entry->name, name) == 0)
-        {
-            list_remove(node->childs, entry);
-            directory_entry_destroy(entry);
+    FsDirectoryEntry *entry = (FsDirectoryEntry *)hashmap_get(node->childs_by_name, name);
 
-            return SUCCESS;
-        }
+    if (!entry)
+    {
+        return ERR_NO_SUCH_FILE_OR_DIRECTORY;
     }
 
-    return ERR_NO_SUCH_FILE_OR_DIRECTORY;
+    hashmap_remove(node->childs_by_name, name);
+    list_remove(node->childs, entry);
+    directory_entry_destroy(entry);
+
+    return SUCCESS;
 }
 
 static void directory_destroy(FsDirectory *node)
 {
+    hashmap_destroy(node->childs_by_name);
     list_destroy_with_callback(node->childs, (ListDestroyElementCallback)directory_entry_destroy);
 }
 
@@ -116,6 +114,7 @@ FsDirectory::FsDirectory() : FsNode(FILE_TYPE_DIRECTORY)
     destroy = (FsNodeDestroyCallback)directory_destroy;
 
     childs = list_create();
+    childs_by_name = hashmap_create_string_to_value();
 }
 
 ResultOr<size_t> FsDirectory::read(FsHandle &handle, void *buffer, size_t size)
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <libsystem/utils/HashMap.h>
+
 #include "kernel/node/Node.h"
 
 struct DirectoryListing
@@ -19,8 +21,14 @@ class FsDirectory : public FsNode
 private:
 public:
     List *childs;
+    HashMap *childs_by_name;
 
     FsDirectory();
 
     ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size);
 };
+
+// For filesystems building on FsDirectory.
+Result directory_link(FsDirectory *node, const char *name, FsNode *child);
+
+Result directory_unlink(FsDirectory *node, const char *name);
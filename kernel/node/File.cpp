@@ -1,20 +1,33 @@
-
 #include <libsystem/Logger.h>
 #include <libsystem/Result.h>
 #include <libsystem/core/CString.h>
 #include <libsystem/math/MinMax.h>
+#include <libsystem/thread/Atomic.h>
 
 #include "kernel/node/File.h"
 #include "kernel/node/Handle.h"
+#include "kernel/scheduling/Scheduler.h"
 
 static Result file_open(FsFile *node, FsHandle *handle)
 {
     if (handle->has_flag(OPEN_TRUNC))
     {
-        free(node->_buffer);
-        node->_buffer = (char *)malloc(512);
-        node->_buffer_allocated = 512;
-        node->_buffer_size = 0;
+        AtomicHolder holder;
+
+        node->_borrowed = nullptr;
+
+        // Tasks mapping the file keep the old pages.
+        if (node->_pages->refcount > 1)
+        {
+            memory_object_deref(node->_pages);
+            node->_pages = memory_object_create_identity(0);
+        }
+        else
+        {
+            memory_object_resize(node->_pages, 0);
+        }
+
+        node->_size = 0;
     }
 
     return SUCCESS;
@@ -22,49 +35,167 @@ static Result file_open(FsFile *node, FsHandle *handle)
 
 ResultOr<size_t> FsFile::read(FsHandle &handle, void *buffer, size_t size)
 {
-    size_t read = 0;
+    if (handle.offset >= _size)
+    {
+        return 0;
+    }
+
+    size = MIN(_size - handle.offset, size);
+
+    if (_borrowed)
+    {
+        memcpy(buffer, _borrowed + handle.offset, size);
+
+        return size;
+    }
+
+    for (size_t done = 0; done < size;)
+    {
+        size_t offset = handle.offset + done;
+        size_t page_offset = offset % ARCH_PAGE_SIZE;
+        size_t chunk = MIN(ARCH_PAGE_SIZE - page_offset, size - done);
+
+        uintptr_t page = _pages->page(offset / ARCH_PAGE_SIZE);
+
+        if (page)
+        {
+            memcpy((char *)buffer + done, (char *)page + page_offset, chunk);
+        }
+        else
+        {
+            // Nothing was ever written there.
+            memset((char *)buffer + done, 0, chunk);
+        }
+
+        done += chunk;
+    }
+
+    return size;
+}
+
+static size_t file_write_pages(FsFile *file, size_t offset, const void *buffer, size_t size)
+{
+    if (offset + size > file->_pages->size())
+    {
+        memory_object_resize(file->_pages, offset + size);
+    }
 
-    if (handle.offset <= _buffer_size)
+    size_t done = 0;
+
+    while (done < size)
     {
-        read = MIN(_buffer_size - handle.offset, size);
-        memcpy(buffer, (char *)_buffer + handle.offset, read);
+        size_t page_offset = (offset + done) % ARCH_PAGE_SIZE;
+        size_t chunk = MIN(ARCH_PAGE_SIZE - page_offset, size - done);
+
+        AtomicHolder holder;
+
+        bool fresh = false;
+        uintptr_t page = memory_object_page(file->_pages, (offset + done) / ARCH_PAGE_SIZE, &fresh);
+
+        if (!page)
+        {
+            break;
+        }
+
+        if (fresh)
+        {
+            memset((void *)page, 0, ARCH_PAGE_SIZE);
+        }
+
+        memcpy((char *)page + page_offset, (const char *)buffer + done, chunk);
+
+        done += chunk;
     }
 
-    return read;
+    file->_size = MAX(offset + done, file->_size);
+
+    return done;
+}
+
+Result FsFile::materialize()
+{
+    if (!_borrowed)
+    {
+        return SUCCESS;
+    }
+
+    const char *content = _borrowed;
+    size_t size = _size;
+
+    _borrowed = nullptr;
+    _size = 0;
+
+    if (file_write_pages(this, 0, content, size) != size)
+    {
+        // Keep reading in place, we'll try again next time.
+        memory_object_resize(_pages, 0);
+        _borrowed = content;
+        _size = size;
+
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    return SUCCESS;
 }
 
 ResultOr<size_t> FsFile::write(FsHandle &handle, const void *buffer, size_t size)
 {
-    if ((handle.offset + size) > _buffer_allocated)
+    Result result = materialize();
+
+    if (result != SUCCESS)
     {
-        _buffer = (char *)realloc(_buffer, handle.offset + size);
-        _buffer_allocated = handle.offset + size;
+        return result;
     }
 
-    _buffer_size = MAX(handle.offset + size, _buffer_size);
-    memcpy((char *)(_buffer) + handle.offset, buffer, size);
+    size_t written = file_write_pages(this, handle.offset, buffer, size);
 
-    return size;
+    if (written == 0 && size > 0)
+    {
+        return ERR_OUT_OF_MEMORY;
+    }
+
+    return written;
 }
+
+MemoryObject *FsFile::pages()
+{
+    fsnode_acquire_lock(this, scheduler_running_id());
+
+    MemoryObject *pages = nullptr;
+
+    if (materialize() == SUCCESS)
+    {
+        pages = memory_object_ref(_pages);
+    }
+
+    fsnode_release_lock(this, scheduler_running_id());
+
+    return pages;
+}
+
 static size_t file_size(FsFile *node, FsHandle *handle)
 {
     __unused(handle);
 
-    return node->_buffer_size;
+    return node->_size;
 }
 
 static void file_destroy(FsFile *node)
 {
-    free(node->_buffer);
+    memory_object_deref(node->_pages);
+}
+
+FsFile::FsFile() : FsFile(nullptr, 0)
+{
 }
 
-FsFile::FsFile() : FsNode(FILE_TYPE_REGULAR)
+FsFile::FsFile(const void *content, size_t content_size) : FsNode(FILE_TYPE_REGULAR)
 {
     open = (FsNodeOpenCallback)file_open;
     size = (FsNodeSizeCallback)file_size;
     destroy = (FsNodeDestroyCallback)file_destroy;
 
-    _buffer = (char *)malloc(512);
-    _buffer_allocated = 512;
-    _buffer_size = 0;
+    _pages = memory_object_create_identity(0);
+    _size = content_size;
+    _borrowed = (const char *)content;
 }
@@ -1,18 +1,31 @@
 #pragma once
 
+#include "kernel/memory/MemoryObject.h"
 #include "kernel/node/Node.h"
 
 class FsFile : public FsNode
 {
 private:
 public:
-    char *_buffer;
-    size_t _buffer_allocated;
-    size_t _buffer_size;
+    // The content of the file, page by page, shared with the tasks mapping it.
+    MemoryObject *_pages;
+    size_t _size;
+
+    // Content read in place from memory we don't own, like the ramdisk
+    // archive, until it's copied into _pages by materialize().
+    const char *_borrowed;
 
     FsFile();
 
+    // The file reads content in place until it's written to or mapped, so
+    // content must stay around as long as the file does.
+    FsFile(const void *content, size_t content_size);
+
     ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size);
 
     ResultOr<size_t> write(FsHandle &handle, const void *buffer, size_t size);
+
+    MemoryObject *pages();
+
+    Result materialize();
 };
@@ -5,6 +5,7 @@
 #include <libsystem/core/CString.h>
 #include <libsystem/math/MinMax.h>
 
+#include "kernel/memory/MemoryObject.h"
 #include "kernel/node/Connection.h"
 #include "kernel/node/Handle.h"
 #include "kernel/scheduling/Blocker.h"
@@ -142,7 +143,7 @@ Result fshandle_read(FsHandle *handle, void *buffer, size_t size, size_t *read)
     return result_or_read.result();
 }
 
-static Result fshandle_write_internal(FsHandle *handle, const void *buffer, size_t size, size_t *written)
+static Result fshandle_write_internal(FsHandle *handle, const void *buffer, size_t size, bool donate, size_t *written)
 {
     FsNode *node = handle->node;
 
@@ -156,7 +157,8 @@ static Result fshandle_write_internal(FsHandle *handle, const void *buffer, size
         }
     }
 
-    auto result_or_written = node->write(*handle, buffer, size);
+    auto result_or_written = donate ? node->donate(*handle, buffer, size)
+                                    : node->write(*handle, buffer, size);
 
     if (result_or_written.success())
     {
@@ -173,7 +175,7 @@ static Result fshandle_write_internal(FsHandle *handle, const void *buffer, size
     return result_or_written.result();
 }
 
-Result fshandle_write(FsHandle *handle, const void *buffer, size_t size, size_t *written)
+static Result fshandle_write_all(FsHandle *handle, const void *buffer, size_t size, bool donate, size_t *written)
 {
     int remaining = size;
     Result result = SUCCESS;
@@ -195,6 +197,7 @@ Result fshandle_write(FsHandle *handle, const void *buffer, size_t size, size_t
             handle,
             (void *)((uintptr_t)buffer + (size - remaining)),
             remaining,
+            donate,
             &written_this_time);
 
         remaining -= written_this_time;
@@ -204,6 +207,227 @@ Result fshandle_write(FsHandle *handle, const void *buffer, size_t size, size_t
     return result;
 }
 
+Result fshandle_write(FsHandle *handle, const void *buffer, size_t size, size_t *written)
+{
+    return fshandle_write_all(handle, buffer, size, false, written);
+}
+
+Result fshandle_donate(FsHandle *handle, const void *buffer, size_t size, size_t *written)
+{
+    return fshandle_write_all(handle, buffer, size, true, written);
+}
+
+Result fshandle_readv(FsHandle *handle, const IOVector *vectors, size_t count, size_t *read)
+{
+    *read = 0;
+
+    if (!handle->has_flag(OPEN_READ) &&
+        !handle->has_flag(OPEN_MASTER) &&
+        !handle->has_flag(OPEN_SERVER) &&
+        !handle->has_flag(OPEN_CLIENT))
+    {
+        return ERR_WRITE_ONLY_STREAM;
+    }
+
+    FsNode *node = handle->node;
+
+    task_block(scheduler_running(), new BlockerRead(handle), -1);
+
+    Result result = SUCCESS;
+
+    // Everything is read under the same lock, so nobody can slip in between the buffers.
+    for (size_t i = 0; i < count; i++)
+    {
+        auto result_or_read = node->read(*handle, vectors[i].buffer, vectors[i].size);
+
+        if (!result_or_read.success())
+        {
+            result = result_or_read.result();
+            break;
+        }
+
+        handle->offset += result_or_read.value();
+        *read += result_or_read.value();
+
+        if (result_or_read.value() < vectors[i].size)
+        {
+            break;
+        }
+    }
+
+    fsnode_release_lock(node, scheduler_running_id());
+
+    return result;
+}
+
+Result fshandle_writev(FsHandle *handle, const IOVector *vectors, size_t count, size_t *written)
+{
+    *written = 0;
+
+    if (!handle->has_flag(OPEN_WRITE) &&
+        !handle->has_flag(OPEN_MASTER) &&
+        !handle->has_flag(OPEN_SERVER) &&
+        !handle->has_flag(OPEN_CLIENT))
+    {
+        return ERR_READ_ONLY_STREAM;
+    }
+
+    FsNode *node = handle->node;
+
+    Result result = SUCCESS;
+
+    size_t index = 0;
+    size_t done = 0;
+
+    while (result == SUCCESS)
+    {
+        while (index < count && done == vectors[index].size)
+        {
+            index++;
+            done = 0;
+        }
+
+        if (index == count)
+        {
+            break;
+        }
+
+        task_block(scheduler_running(), new BlockerWrite(handle), -1);
+
+        if (handle->has_flag(OPEN_APPEND) && node->size)
+        {
+            handle->offset = node->size(node, handle);
+        }
+
+        // Keep the node as long as it takes the data, and only wait for it
+        // again once it is full.
+        while (index < count)
+        {
+            auto result_or_written = node->write(
+                *handle,
+                (const void *)((uintptr_t)vectors[index].buffer + done),
+                vectors[index].size - done);
+
+            if (!result_or_written.success())
+            {
+                result = result_or_written.result();
+                break;
+            }
+
+            handle->offset += result_or_written.value();
+            *written += result_or_written.value();
+            done += result_or_written.value();
+
+            if (done < vectors[index].size)
+            {
+                break;
+            }
+
+            index++;
+            done = 0;
+        }
+
+        fsnode_release_lock(node, scheduler_running_id());
+    }
+
+    return result;
+}
+
+Result fshandle_send(FsHandle *handle, const void *buffer, size_t size, const FsAttachment *attachments, size_t attachments_count, size_t *sent)
+{
+    *sent = 0;
+
+    if (!handle->has_flag(OPEN_WRITE) &&
+        !handle->has_flag(OPEN_SERVER) &&
+        !handle->has_flag(OPEN_CLIENT))
+    {
+        return ERR_READ_ONLY_STREAM;
+    }
+
+    FsNode *node = handle->node;
+
+    task_block(scheduler_running(), new BlockerWrite(handle), -1);
+
+    auto result_or_sent = node->send(*handle, buffer, size, attachments, attachments_count);
+
+    if (result_or_sent.success())
+    {
+        *sent = result_or_sent.value();
+    }
+
+    fsnode_release_lock(node, scheduler_running_id());
+
+    return result_or_sent.result();
+}
+
+Result fshandle_receive(FsHandle *handle, void *buffer, size_t size, FsAttachment *attachments, size_t *attachments_count, size_t *received)
+{
+    *received = 0;
+    *attachments_count = 0;
+
+    if (!handle->has_flag(OPEN_READ) &&
+        !handle->has_flag(OPEN_SERVER) &&
+        !handle->has_flag(OPEN_CLIENT))
+    {
+        return ERR_WRITE_ONLY_STREAM;
+    }
+
+    FsNode *node = handle->node;
+
+    task_block(scheduler_running(), new BlockerRead(handle), -1);
+
+    auto result_or_received = node->receive(*handle, buffer, size, attachments, attachments_count);
+
+    if (result_or_received.success())
+    {
+        *received = result_or_received.value();
+    }
+
+    fsnode_release_lock(node, scheduler_running_id());
+
+    return result_or_received.result();
+}
+
+void fsattachment_release(FsAttachment *attachment)
+{
+    if (attachment->handle)
+    {
+        fshandle_destroy(attachment->handle);
+    }
+
+    if (attachment->memory_object)
+    {
+        memory_object_deref(attachment->memory_object);
+    }
+
+    *attachment = {};
+}
+
+Result fshandle_pread(FsHandle *handle, void *buffer, size_t size, size_t offset, size_t *read)
+{
+    // The handle is held by the caller, so nobody sees the offset move.
+    size_t saved_offset = handle->offset;
+    handle->offset = offset;
+
+    Result result = fshandle_read(handle, buffer, size, read);
+
+    handle->offset = saved_offset;
+
+    return result;
+}
+
+Result fshandle_pwrite(FsHandle *handle, const void *buffer, size_t size, size_t offset, size_t *written)
+{
+    size_t saved_offset = handle->offset;
+    handle->offset = offset;
+
+    Result result = fshandle_write(handle, buffer, size, written);
+
+    handle->offset = saved_offset;
+
+    return result;
+}
+
 Result fshandle_seek(FsHandle *handle, int offset, Whence whence)
 {
     FsNode *node = handle->node;
@@ -31,6 +31,23 @@ void fshandle_release_lock(FsHandle *handle, int who_release);
 Result fshandle_read(FsHandle *handle, void *buffer, size_t size, size_t *read);
 Result fshandle_write(FsHandle *handle, const void *buffer, size_t size, size_t *written);
 
+// Write buffer, giving its whole pages away when the node can take them, see
+// FsNode::donate().
+Result fshandle_donate(FsHandle *handle, const void *buffer, size_t size, size_t *written);
+
+Result fshandle_readv(FsHandle *handle, const IOVector *vectors, size_t count, size_t *read);
+Result fshandle_writev(FsHandle *handle, const IOVector *vectors, size_t count, size_t *written);
+
+// Like read and write, at offset, leaving the offset of the handle alone.
+Result fshandle_pread(FsHandle *handle, void *buffer, size_t size, size_t offset, size_t *read);
+Result fshandle_pwrite(FsHandle *handle, const void *buffer, size_t size, size_t offset, size_t *written);
+
+// One message with its attachments, see FsNode::send() and FsNode::receive().
+Result fshandle_send(FsHandle *handle, const void *buffer, size_t size, const FsAttachment *attachments, size_t attachments_count, size_t *sent);
+Result fshandle_receive(FsHandle *handle, void *buffer, size_t size, FsAttachment *attachments, size_t *attachments_count, size_t *received);
+
+void fsattachment_release(FsAttachment *attachment);
+
 Result fshandle_seek(FsHandle *handle, int offset, Whence whence);
 Result fshandle_tell(FsHandle *handle, Whence whence, int *offset);
 
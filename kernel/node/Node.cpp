@@ -2,6 +2,7 @@
 #include <libsystem/Logger.h>
 #include <libsystem/core/CString.h>
 
+#include "kernel/filesystem/DentryCache.h"
 #include "kernel/filesystem/Filesystem.h"
 
 FsNode::FsNode(FileType type)
@@ -18,10 +19,27 @@ FsNode *FsNode::ref()
     return this;
 }
 
+bool FsNode::try_ref()
+{
+    uint count = __atomic_load_n(&refcount, __ATOMIC_SEQ_CST);
+
+    while (count > 0)
+    {
+        if (__atomic_compare_exchange_n(&refcount, &count, count + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void FsNode::deref()
 {
     if (__atomic_sub_fetch(&refcount, 1, __ATOMIC_SEQ_CST) == 0)
     {
+        dentry_cache_forget(this);
+
         if (destroy)
         {
             destroy(this);
@@ -108,4 +126,6 @@ void fsnode_acquire_lock(FsNode *node, int who_acquire)
 void fsnode_release_lock(FsNode *node, int who_release)
 {
     lock_release_by(node->lock, who_release);
+
+    node->waiters.wakeup();
 }
@@ -1,12 +1,18 @@
 #pragma once
 
+#include <abi/Message.h>
+
 #include <libsystem/Result.h>
+#include <libsystem/io/Path.h>
 #include <libsystem/io/Stream.h>
 #include <libsystem/thread/Lock.h>
 #include <libutils/ResultOr.h>
 
+#include "kernel/scheduling/WaitQueue.h"
+
 struct FsNode;
 struct FsHandle;
+struct MemoryObject;
 
 typedef Result (*FsNodeOpenCallback)(struct FsNode *node, struct FsHandle *handle);
 typedef void (*FsNodeCloseCallback)(struct FsNode *node, struct FsHandle *handle);
@@ -15,6 +21,17 @@ typedef struct FsNode *(*FsNodeFindCallback)(struct FsNode *node, const char *na
 typedef Result (*FsNodeLinkCallback)(struct FsNode *node, const char *name, struct FsNode *child);
 typedef Result (*FsNodeUnlinkCallback)(struct FsNode *node, const char *name);
 
+// Directories of filesystems which can't hold arbitrary nodes create their
+// children themselves. *child is referenced, it's the existing one if there
+// is already an entry called name.
+typedef Result (*FsNodeCreateCallback)(struct FsNode *node, const char *name, FileType type, struct FsNode **child);
+
+// Filesystems with their own lookup caching resolve as many elements of path
+// as they can in one go, starting at *index. Returns the referenced node
+// reached and moves *index past the elements used, or nullptr to fall back
+// to find() one element at a time.
+typedef struct FsNode *(*FsNodeLookupCallback)(struct FsNode *node, Path *path, size_t *index);
+
 typedef Result (*FsNodeCallCallback)(struct FsNode *node, struct FsHandle *handle, IOCall request, void *args);
 typedef Result (*FsNodeStatCallback)(struct FsNode *node, struct FsHandle *handle, FileState *stat);
 
@@ -30,6 +47,15 @@ typedef struct FsNode *(*FsNodeAcceptConnectionCallback)(struct FsNode *node);
 
 typedef void (*FsNodeDestroyCallback)(struct FsNode *node);
 
+// Something traveling along with a message, see FsNode::send().
+struct FsAttachment
+{
+    MessageAttachmentType type;
+
+    FsHandle *handle;
+    MemoryObject *memory_object;
+};
+
 struct FsNode
 {
     FileType type;
@@ -42,11 +68,22 @@ struct FsNode
     uint server = 0;
     uint master = 0;
 
+    // Number of dentry cache entries about this node, see kernel/filesystem/DentryCache.h
+    uint dentries = 0;
+
+    // A filesystem is mounted on this directory, see filesystem_mount().
+    bool mounted = false;
+
+    // Tasks blocked on this node, woken up each time its lock is released.
+    WaitQueue waiters;
+
     FsNodeOpenCallback open = nullptr;
     FsNodeCloseCallback close = nullptr;
     FsNodeFindCallback find = nullptr;
     FsNodeLinkCallback link = nullptr;
     FsNodeUnlinkCallback unlink = nullptr;
+    FsNodeCreateCallback create = nullptr;
+    FsNodeLookupCallback lookup = nullptr;
     FsNodeCallCallback call = nullptr;
     FsNodeStatCallback stat = nullptr;
     FsNodeSizeCallback size = nullptr;
@@ -65,6 +102,10 @@ public:
 
     FsNode *ref();
 
+    // Only takes a reference if there is one left, for nodes found through
+    // something that doesn't hold one and might be on their way out.
+    bool try_ref();
+
     void deref();
 
     void ref_handle(FsHandle &handle);
@@ -102,6 +143,46 @@ public:
 
         return ERR_NOT_WRITABLE;
     }
+
+    // Send one message, the node owns the attachments if it succeeds.
+    virtual ResultOr<size_t> send(FsHandle &handle, const void *buffer, size_t size, const FsAttachment *attachments, size_t attachments_count)
+    {
+        __unused(handle);
+        __unused(buffer);
+        __unused(size);
+        __unused(attachments);
+        __unused(attachments_count);
+
+        return ERR_SOCKET_OPERATION_ON_NON_SOCKET;
+    }
+
+    // Receive one message, attachments has room for MESSAGE_ATTACHMENT_COUNT
+    // of them and the caller owns the ones it gets.
+    virtual ResultOr<size_t> receive(FsHandle &handle, void *buffer, size_t size, FsAttachment *attachments, size_t *attachments_count)
+    {
+        __unused(handle);
+        __unused(buffer);
+        __unused(size);
+        __unused(attachments);
+        __unused(attachments_count);
+
+        return ERR_SOCKET_OPERATION_ON_NON_SOCKET;
+    }
+
+    // Same as write() but the node may take whole pages of buffer away from
+    // the running task instead of copying them, what's left in buffer
+    // afterward is unspecified.
+    virtual ResultOr<size_t> donate(FsHandle &handle, const void *buffer, size_t size)
+    {
+        return write(handle, buffer, size);
+    }
+
+    // Nodes keeping their content in memory return it here, with a reference
+    // for the caller, so it can be mapped without going through the page cache.
+    virtual MemoryObject *pages()
+    {
+        return nullptr;
+    }
 };
 
 bool fsnode_can_accept(FsNode *node);
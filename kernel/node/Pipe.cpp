@@ -1,22 +1,105 @@
 
 #include <libsystem/Result.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/thread/Atomic.h>
 
+#include "kernel/memory/Physical.h"
+#include "kernel/memory/Virtual.h"
 #include "kernel/node/Handle.h"
 #include "kernel/node/Pipe.h"
+#include "kernel/scheduling/Scheduler.h"
+#include "kernel/tasking/Task-Memory.h"
 
-#define PIPE_BUFFER_SIZE 4096
+// The pages aren't mapped in kernel space, they are reached through a window.
+static void pipe_page_copy(uintptr_t page, size_t offset, void *buffer, size_t size, bool to_page)
+{
+    AtomicHolder holder;
+
+    MemoryRange window = virtual_alloc(&kpdir, MemoryRange{page, ARCH_PAGE_SIZE}, MEMORY_NONE);
+
+    if (to_page)
+    {
+        memcpy((char *)window.base() + offset, buffer, size);
+    }
+    else
+    {
+        memcpy(buffer, (char *)window.base() + offset, size);
+    }
+
+    virtual_free(&kpdir, window);
+}
+
+static void pipe_pages_destroy(PipePages *pages)
+{
+    AtomicHolder holder;
+
+    for (size_t i = 0; i < pages->size / ARCH_PAGE_SIZE; i++)
+    {
+        if (pages->pages[i])
+        {
+            physical_free(MemoryRange{pages->pages[i], ARCH_PAGE_SIZE});
+        }
+    }
+
+    free(pages);
+}
+
+static Result pipe_iocall(FsPipe *node, FsHandle *handle, IOCall request, void *args)
+{
+    __unused(handle);
+
+    IOCallPipeCapacityArgs *capacity_args = (IOCallPipeCapacityArgs *)args;
+
+    switch (request)
+    {
+    case IOCALL_PIPE_GET_CAPACITY:
+        capacity_args->capacity = node->_buffer.capacity();
+
+        return SUCCESS;
+
+    case IOCALL_PIPE_SET_CAPACITY:
+        if (capacity_args->capacity == 0 || capacity_args->capacity > FsPipe::BUFFER_SIZE_MAX)
+        {
+            return ERR_INVALID_ARGUMENT;
+        }
+
+        // What's already in the pipe has to fit.
+        if (capacity_args->capacity < node->_buffer.used() + node->_pages_size ||
+            !node->_buffer.resize(capacity_args->capacity))
+        {
+            return ERR_INVALID_ARGUMENT;
+        }
+
+        capacity_args->capacity = node->_buffer.capacity();
+
+        return SUCCESS;
+
+    default:
+        return ERR_INAPPROPRIATE_CALL_FOR_DEVICE;
+    }
+}
 
 static size_t pipe_size(FsPipe *node, FsHandle *handle)
 {
-    __unused(node);
     __unused(handle);
 
-    return PIPE_BUFFER_SIZE;
+    return node->_buffer.capacity();
+}
+
+static void pipe_destroy(FsPipe *node)
+{
+    for (size_t i = 0; i < node->_pages_count; i++)
+    {
+        pipe_pages_destroy(node->_pages[(node->_pages_head + i) % FsPipe::PAGES_COUNT]);
+    }
 }
 
 FsPipe::FsPipe() : FsNode(FILE_TYPE_PIPE)
 {
+    call = (FsNodeCallCallback)pipe_iocall;
     size = (FsNodeSizeCallback)pipe_size;
+    destroy = (FsNodeDestroyCallback)pipe_destroy;
 }
 
 bool FsPipe::can_read(FsHandle *handle)
@@ -24,7 +107,7 @@ bool FsPipe::can_read(FsHandle *handle)
     __unused(handle);
 
     // FIXME: make this atomic or something...
-    return !_buffer.empty() || !writers;
+    return !_buffer.empty() || _pages_count > 0 || !writers;
 }
 
 bool FsPipe::can_write(FsHandle *handle)
@@ -32,7 +115,129 @@ bool FsPipe::can_write(FsHandle *handle)
     __unused(handle);
 
     // FIXME: make this atomic or something...
-    return !_buffer.full() || !readers;
+    return room() > 0 || !readers;
+}
+
+size_t FsPipe::room()
+{
+    size_t used = _buffer.used() + _pages_size;
+
+    if (used >= _buffer.capacity())
+    {
+        return 0;
+    }
+
+    return _buffer.capacity() - used;
+}
+
+size_t FsPipe::read_buffer(void *buffer, size_t size)
+{
+    // Stop where the next pages were written.
+    if (_pages_count > 0)
+    {
+        size = MIN(size, _pages[_pages_head]->position - _buffer_read);
+    }
+
+    size_t read = _buffer.read((char *)buffer, size);
+    _buffer_read += read;
+
+    return read;
+}
+
+size_t FsPipe::read_pages(void *buffer, size_t size)
+{
+    PipePages *pages = _pages[_pages_head];
+    size_t read = 0;
+
+    while (read < size && pages->offset < pages->size)
+    {
+        uintptr_t address = (uintptr_t)buffer + read;
+        size_t index = pages->offset / ARCH_PAGE_SIZE;
+        size_t page_offset = pages->offset % ARCH_PAGE_SIZE;
+        size_t chunk = MIN(ARCH_PAGE_SIZE - page_offset, size - read);
+
+        // A whole page into a whole page of the reader, it can just have ours.
+        if (chunk == ARCH_PAGE_SIZE &&
+            address % ARCH_PAGE_SIZE == 0 &&
+            task_memory_page_give(scheduler_running(), address, pages->pages[index]))
+        {
+            pages->pages[index] = 0;
+        }
+        else
+        {
+            pipe_page_copy(pages->pages[index], page_offset, (void *)address, chunk, false);
+        }
+
+        pages->offset += chunk;
+        read += chunk;
+    }
+
+    _pages_size -= read;
+
+    if (pages->offset == pages->size)
+    {
+        pipe_pages_destroy(pages);
+
+        _pages[_pages_head] = nullptr;
+        _pages_head = (_pages_head + 1) % PAGES_COUNT;
+        _pages_count--;
+    }
+
+    return read;
+}
+
+size_t FsPipe::write_buffer(const void *buffer, size_t size)
+{
+    size = MIN(size, room());
+
+    size_t written = _buffer.write((const char *)buffer, size);
+    _buffer_written += written;
+
+    return written;
+}
+
+size_t FsPipe::write_pages(const void *buffer, size_t size, bool donate)
+{
+    PipePages *pages = __create(PipePages);
+    pages->position = _buffer_written;
+
+    size_t count = MIN(MIN(size, room()) / ARCH_PAGE_SIZE, (size_t)PipePages::COUNT);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uintptr_t address = (uintptr_t)buffer + i * ARCH_PAGE_SIZE;
+        uintptr_t page = donate ? task_memory_page_take(scheduler_running(), address) : 0;
+
+        if (!page)
+        {
+            AtomicHolder holder;
+
+            page = physical_alloc(ARCH_PAGE_SIZE).base();
+
+            if (!page)
+            {
+                break;
+            }
+
+            pipe_page_copy(page, 0, (void *)address, ARCH_PAGE_SIZE, true);
+        }
+
+        pages->pages[i] = page;
+        pages->size += ARCH_PAGE_SIZE;
+    }
+
+    if (pages->size == 0)
+    {
+        free(pages);
+
+        return 0;
+    }
+
+    _pages[(_pages_head + _pages_count) % PAGES_COUNT] = pages;
+    _pages_count++;
+    _pages_size += pages->size;
+
+    return pages->size;
 }
 
 ResultOr<size_t> FsPipe::read(FsHandle &handle, void *buffer, size_t size)
@@ -44,17 +249,49 @@ ResultOr<size_t> FsPipe::read(FsHandle &handle, void *buffer, size_t size)
         return ERR_STREAM_CLOSED;
     }
 
-    return _buffer.read((char *)buffer, size);
+    if (_pages_count > 0 && _pages[_pages_head]->position == _buffer_read)
+    {
+        return read_pages(buffer, size);
+    }
+
+    return read_buffer(buffer, size);
 }
 
-ResultOr<size_t> FsPipe::write(FsHandle &handle, const void *buffer, size_t size)
+ResultOr<size_t> FsPipe::write_any(const void *buffer, size_t size, bool donate)
 {
-    __unused(handle);
-
     if (!readers)
     {
         return ERR_STREAM_CLOSED;
     }
 
-    return _buffer.write((const char *)buffer, size);
+    // Whole pages are moved on their own, so they might not have to be
+    // copied again when they are read.
+    if ((uintptr_t)buffer % ARCH_PAGE_SIZE == 0 &&
+        size >= ARCH_PAGE_SIZE &&
+        room() >= ARCH_PAGE_SIZE &&
+        _pages_count < PAGES_COUNT)
+    {
+        size_t written = write_pages(buffer, size, donate);
+
+        if (written > 0)
+        {
+            return written;
+        }
+    }
+
+    return write_buffer(buffer, size);
+}
+
+ResultOr<size_t> FsPipe::write(FsHandle &handle, const void *buffer, size_t size)
+{
+    __unused(handle);
+
+    return write_any(buffer, size, false);
+}
+
+ResultOr<size_t> FsPipe::donate(FsHandle &handle, const void *buffer, size_t size)
+{
+    __unused(handle);
+
+    return write_any(buffer, size, true);
 }
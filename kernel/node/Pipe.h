@@ -4,21 +4,63 @@
 
 #include "kernel/node/Node.h"
 
+// Whole pages written to the pipe, they are handed to the reader as they are
+// when it reads them into whole pages of its own.
+struct PipePages
+{
+    static constexpr int COUNT = 64;
+
+    size_t position; // Bytes written to the ring before these.
+    size_t size;
+    size_t offset; // Bytes read so far.
+
+    uintptr_t pages[COUNT]; // Physical pages, 0 once given to the reader.
+};
+
 class FsPipe : public FsNode
 {
 private:
 public:
-    static constexpr int BUFFER_SIZE = 4096;
+    static constexpr int BUFFER_SIZE = 16384;
+    static constexpr int BUFFER_SIZE_MAX = 1024 * 1024;
+
+    static constexpr int PAGES_COUNT = 16;
 
     RingBuffer _buffer{BUFFER_SIZE};
 
+    // Keep the order between what goes through the ring and through pages.
+    size_t _buffer_written = 0;
+    size_t _buffer_read = 0;
+
+    PipePages *_pages[PAGES_COUNT] = {};
+    size_t _pages_head = 0;
+    size_t _pages_count = 0;
+
+    // Bytes in the pages not read yet, they count toward the capacity along
+    // with the ones in the ring.
+    size_t _pages_size = 0;
+
     FsPipe();
 
     bool can_read(FsHandle *handle);
 
     bool can_write(FsHandle *handle);
 
+    size_t room();
+
     ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size);
 
     ResultOr<size_t> write(FsHandle &handle, const void *buffer, size_t size);
+
+    ResultOr<size_t> donate(FsHandle &handle, const void *buffer, size_t size);
+
+    size_t read_buffer(void *buffer, size_t size);
+
+    size_t read_pages(void *buffer, size_t size);
+
+    size_t write_buffer(const void *buffer, size_t size);
+
+    size_t write_pages(const void *buffer, size_t size, bool donate);
+
+    ResultOr<size_t> write_any(const void *buffer, size_t size, bool donate);
 };
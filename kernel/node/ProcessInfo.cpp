@@ -24,8 +24,10 @@ static Iteration serialize_task(json::Value *destination, Task *task)
     json::object_put(task_object, "state", json::create_string(task_state_string(task->state)));
     json::object_put(task_object, "directory", json::create_string_adopt(path_as_string(task->directory)));
     json::object_put(task_object, "cpu", json::create_integer(scheduler_get_usage(task->id)));
-    json::object_put(task_object, "ram", json::create_integer(task_memory_usage(task)));
+    json::object_put(task_object, "ram", json::create_integer(task_memory_resident(task)));
+    json::object_put(task_object, "ram_reserved", json::create_integer(task_memory_usage(task)));
     json::object_put(task_object, "user", json::create_boolean(task->user));
+    json::object_put(task_object, "syscalls", json::create_integer(task->syscalls));
 
     json::array_append(destination, task_object);
 
@@ -1,8 +1,45 @@
+#include <libsystem/Assert.h>
+#include <libsystem/thread/Atomic.h>
+
 #include "kernel/scheduling/Blocker.h"
 #include "kernel/tasking/Task.h"
 
+/* --- Blocker -------------------------------------------------------------- */
+
+void Blocker::wait_on(struct Task *task, WaitQueue &queue)
+{
+    ASSERT_ATOMIC;
+
+    Waiter *waiter = __create(Waiter);
+
+    waiter->task = task;
+    waiter->sibling = _waiters;
+    _waiters = waiter;
+
+    queue.add(waiter);
+}
+
+void Blocker::stop_waiting()
+{
+    ASSERT_ATOMIC;
+
+    while (_waiters)
+    {
+        Waiter *waiter = _waiters;
+        _waiters = waiter->sibling;
+
+        waiter->queue->remove(waiter);
+        free(waiter);
+    }
+}
+
 /* --- BlockerAccept -------------------------------------------------------- */
 
+void BlockerAccept::on_block(struct Task *task)
+{
+    wait_on(task, _node->waiters);
+}
+
 bool BlockerAccept::can_unblock(struct Task *task)
 {
     __unused(task);
@@ -17,6 +54,11 @@ void BlockerAccept::on_unblock(struct Task *task)
 
 /* --- BlockerConnect ------------------------------------------------------- */
 
+void BlockerConnect::on_block(struct Task *task)
+{
+    wait_on(task, _connection->waiters);
+}
+
 bool BlockerConnect::can_unblock(struct Task *task)
 {
     __unused(task);
@@ -25,6 +67,11 @@ bool BlockerConnect::can_unblock(struct Task *task)
 
 /* --- BlockerRead ---------------------------------------------------------- */
 
+void BlockerRead::on_block(Task *task)
+{
+    wait_on(task, _handle->node->waiters);
+}
+
 bool BlockerRead::can_unblock(Task *task)
 {
     __unused(task);
@@ -39,6 +86,14 @@ void BlockerRead::on_unblock(Task *task)
 
 /* --- BlockerSelect -------------------------------------------------------- */
 
+void BlockerSelect::on_block(Task *task)
+{
+    for (size_t i = 0; i < _count; i++)
+    {
+        wait_on(task, _handles[i]->node->waiters);
+    }
+}
+
 bool BlockerSelect::can_unblock(Task *task)
 {
     __unused(task);
@@ -83,21 +138,37 @@ bool BlockerTime::can_unblock(Task *task)
 
 /* --- BlockerWait ---------------------------------------------------------- */
 
+void BlockerWait::on_block(Task *task)
+{
+    // can_unblock() just found it, under the same lock.
+    wait_on(task, task_by_id(_task_id)->waiters);
+}
+
 bool BlockerWait::can_unblock(Task *task)
 {
     __unused(task);
 
-    return _task->state == TASK_STATE_CANCELED;
+    Task *waited = task_by_id(_task_id);
+
+    // Destroyed before we got to block, its exit value went with it.
+    return !waited || waited->state == TASK_STATE_CANCELED;
 }
 
 void BlockerWait::on_unblock(Task *task)
 {
     __unused(task);
 
-    *_exit_value = task->exit_value;
+    Task *waited = task_by_id(_task_id);
+
+    *_exit_value = waited ? waited->exit_value : -1;
 }
 
-/* --- BlockerWrite ---------------------------------------------------------- */
+/* --- BlockerWrite --------------------------------------------------------- */
+
+void BlockerWrite::on_block(Task *task)
+{
+    wait_on(task, _handle->node->waiters);
+}
 
 bool BlockerWrite::can_unblock(Task *task)
 {
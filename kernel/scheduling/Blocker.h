@@ -3,6 +3,8 @@
 #include <libsystem/Time.h>
 
 #include "kernel/node/Handle.h"
+#include "kernel/scheduling/Timer.h"
+#include "kernel/scheduling/WaitQueue.h"
 #include "kernel/system/System.h"
 
 struct Task;
@@ -17,9 +19,24 @@ struct Blocker
 {
     BlockerResult _result;
     TimeStamp _timeout;
+    Waiter *_waiters = nullptr;
+    Timer _timer;
 
     virtual ~Blocker() {}
 
+    // Blockers which don't wait on any queue and can't time out
+    // have to be checked by the scheduler on every tick.
+    bool is_polled() { return _waiters == nullptr && _timeout == (Timeout)-1; }
+
+    void wait_on(struct Task *task, WaitQueue &queue);
+
+    void stop_waiting();
+
+    virtual void on_block(struct Task *task)
+    {
+        __unused(task);
+    }
+
     virtual bool can_unblock(struct Task *task)
     {
         __unused(task);
@@ -47,6 +64,8 @@ public:
     {
     }
 
+    void on_block(struct Task *task);
+
     bool can_unblock(struct Task *task);
 
     void on_unblock(struct Task *task);
@@ -63,6 +82,8 @@ public:
     {
     }
 
+    void on_block(struct Task *task);
+
     bool can_unblock(struct Task *task);
 };
 
@@ -77,6 +98,8 @@ public:
     {
     }
 
+    void on_block(Task *task);
+
     bool can_unblock(Task *task);
 
     void on_unblock(Task *task);
@@ -106,6 +129,8 @@ public:
     {
     }
 
+    void on_block(Task *task);
+
     bool can_unblock(Task *task);
 
     void on_unblock(Task *task);
@@ -128,15 +153,18 @@ public:
 class BlockerWait : public Blocker
 {
 private:
-    Task *_task;
+    // By id, it might be gone by the time we block.
+    int _task_id;
     int *_exit_value;
 
 public:
-    BlockerWait(Task *task, int *exit_value)
-        : _task(task), _exit_value(exit_value)
+    BlockerWait(int task_id, int *exit_value)
+        : _task_id(task_id), _exit_value(exit_value)
     {
     }
 
+    void on_block(Task *task);
+
     bool can_unblock(Task *task);
 
     void on_unblock(Task *task);
@@ -153,6 +181,8 @@ public:
     {
     }
 
+    void on_block(Task *task);
+
     bool can_unblock(Task *task);
 
     void on_unblock(Task *task);
@@ -1,73 +1,240 @@
+#include <libsystem/Assert.h>
 #include <libsystem/thread/Atomic.h>
 
 #include "arch/Arch.h"
 
 #include "kernel/scheduling/Scheduler.h"
+#include "kernel/scheduling/TaskQueue.h"
+#include "kernel/scheduling/Timer.h"
 #include "kernel/system/System.h"
 
-static bool scheduler_context_switch = false;
-static int scheduler_record[SCHEDULER_RECORD_COUNT] = {};
+// Scheduling state of a single processor.
+struct Processor
+{
+    Task *running;
+    Task *idle;
+
+    // The task we just switched away from. We are still on its kernel stack
+    // until the interrupt handler returns, so no one else may run it before
+    // this processor schedules again.
+    Task *previous;
+
+    bool context_switch;
+
+    // The running task gave up the processor itself, rather than being
+    // preempted by the timer.
+    bool yielded;
+
+    // Multi-level feedback run queue: one FIFO per priority and a bitmap of the
+    // non-empty ones, so picking the next task is a single bit scan.
+    TaskQueue running_tasks[SCHEDULER_PRIORITY_COUNT];
+    uint32_t running_tasks_bitmap;
+    int load;
+
+    uint32_t last_accounted_tick;
+    int record[SCHEDULER_RECORD_COUNT];
+};
+
+static Processor processors[ARCH_PROCESSOR_MAX_COUNT] = {};
+
+static TaskQueue blocked_tasks = {};
+
+static uint32_t last_boost_tick = 0;
+
+static Processor &current_processor()
+{
+    return processors[arch_processor_id()];
+}
+
+static bool processor_is_online(Processor &processor)
+{
+    return processor.idle != nullptr;
+}
+
+static int scheduler_quantum(int priority)
+{
+    return (priority + 1) * SCHEDULER_QUANTUM;
+}
+
+static void run_queue_push(Task *task)
+{
+    Processor &processor = processors[task->processor];
+
+    processor.running_tasks[task->priority].push_back(task);
+    processor.running_tasks_bitmap |= 1 << task->priority;
+    processor.load++;
+}
+
+static void run_queue_remove(Task *task)
+{
+    Processor &processor = processors[task->processor];
+
+    processor.running_tasks[task->priority].remove(task);
+    processor.load--;
+
+    if (processor.running_tasks[task->priority].empty())
+    {
+        processor.running_tasks_bitmap &= ~(1 << task->priority);
+    }
+}
+
+static Task *run_queue_peek(Processor &processor)
+{
+    if (processor.running_tasks_bitmap == 0)
+    {
+        return nullptr;
+    }
+
+    return processor.running_tasks[__builtin_ctz(processor.running_tasks_bitmap)].head;
+}
+
+// New tasks go to the least loaded processor, they stay there
+// until an idle processor steals them.
+static int least_loaded_processor()
+{
+    int best = arch_processor_id();
+
+    for (int i = 0; i < ARCH_PROCESSOR_MAX_COUNT; i++)
+    {
+        if (processor_is_online(processors[i]) &&
+            processors[i].load < processors[best].load)
+        {
+            best = i;
+        }
+    }
+
+    return best;
+}
 
-static Task *running = nullptr;
-static Task *idle = nullptr;
+static Task *steal_task(int thief)
+{
+    Processor *victim = nullptr;
 
-static List *blocked_tasks;
-static List *running_tasks;
+    for (int i = 0; i < ARCH_PROCESSOR_MAX_COUNT; i++)
+    {
+        Processor &processor = processors[i];
+
+        // Leave the victim at least the task it's running.
+        if (i != thief &&
+            processor_is_online(processor) &&
+            processor.load > 1 &&
+            (victim == nullptr || processor.load > victim->load))
+        {
+            victim = &processor;
+        }
+    }
+
+    if (victim == nullptr)
+    {
+        return nullptr;
+    }
+
+    for (int priority = 0; priority < SCHEDULER_PRIORITY_COUNT; priority++)
+    {
+        for (Task *task = victim->running_tasks[priority].head; task; task = task->scheduler_next)
+        {
+            if (task != victim->running && task != victim->previous)
+            {
+                run_queue_remove(task);
+                task->processor = thief;
+                run_queue_push(task);
+
+                return task;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+static void wakeup_on_timeout(Task *task)
+{
+    scheduler_wakeup_if_unblocked(task);
+}
 
 void scheduler_initialize()
 {
-    blocked_tasks = list_create();
-    running_tasks = list_create();
 }
 
 void scheduler_did_create_idle_task(Task *task)
 {
-    idle = task;
+    current_processor().idle = task;
 }
 
 void scheduler_did_create_running_task(Task *task)
 {
-    running = task;
+    current_processor().running = task;
 }
 
 void scheduler_did_change_task_state(Task *task, TaskState oldstate, TaskState newstate)
 {
     if (oldstate != newstate)
     {
+        if (oldstate == TASK_STATE_NONE)
+        {
+            task->priority = 0;
+            task->time_slice = scheduler_quantum(0);
+            task->processor = least_loaded_processor();
+        }
+
         if (oldstate == TASK_STATE_RUNNING)
         {
-            list_remove(running_tasks, task);
+            run_queue_remove(task);
         }
 
         if (oldstate == TASK_STATE_BLOCKED)
         {
-            list_remove(blocked_tasks, task);
+            if (task->blocker->is_polled())
+            {
+                blocked_tasks.remove(task);
+            }
+
+            task->blocker->stop_waiting();
+            timer_disarm(&task->blocker->_timer);
         }
 
         if (newstate == TASK_STATE_BLOCKED)
         {
-            list_push(blocked_tasks, task);
+            task->blocker->on_block(task);
+
+            if (task->blocker->_timeout != (Timeout)-1)
+            {
+                task->blocker->_timer.callback = (TimerCallback)wakeup_on_timeout;
+                task->blocker->_timer.target = task;
+                timer_arm(&task->blocker->_timer, task->blocker->_timeout);
+            }
+
+            if (task->blocker->is_polled())
+            {
+                blocked_tasks.push_back(task);
+            }
         }
 
         if (newstate == TASK_STATE_RUNNING)
         {
-            list_push(running_tasks, task);
+            run_queue_push(task);
         }
     }
 }
 
 bool scheduler_is_context_switch()
 {
-    return scheduler_context_switch;
+    AtomicHolder holder;
+
+    return current_processor().context_switch;
 }
 
 Task *scheduler_running()
 {
-    return running;
+    AtomicHolder holder;
+
+    return current_processor().running;
 }
 
 int scheduler_running_id()
 {
+    Task *running = scheduler_running();
+
     if (running == nullptr)
     {
         return -1;
@@ -76,8 +243,27 @@ int scheduler_running_id()
     return running->id;
 }
 
+bool scheduler_is_on_processor(Task *task)
+{
+    AtomicHolder holder;
+
+    for (int i = 0; i < ARCH_PROCESSOR_MAX_COUNT; i++)
+    {
+        if (processors[i].running == task || processors[i].previous == task)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void scheduler_yield()
 {
+    atomic_begin();
+    current_processor().yielded = true;
+    atomic_end();
+
     arch_yield();
 }
 
@@ -86,21 +272,72 @@ int scheduler_get_usage(int task_id)
     AtomicHolder holder;
 
     int count = 0;
+    int total = 0;
 
-    for (int i = 0; i < SCHEDULER_RECORD_COUNT; i++)
+    for (int i = 0; i < ARCH_PROCESSOR_MAX_COUNT; i++)
     {
-        if (scheduler_record[i] == task_id)
+        if (!processor_is_online(processors[i]))
+        {
+            continue;
+        }
+
+        for (int j = 0; j < SCHEDULER_RECORD_COUNT; j++)
         {
-            count++;
+            if (processors[i].record[j] == task_id)
+            {
+                count++;
+            }
         }
+
+        total += SCHEDULER_RECORD_COUNT;
     }
 
-    return (count * 100) / SCHEDULER_RECORD_COUNT;
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    return (count * 100) / total;
 }
 
-static Iteration wakeup_task_if_unblocked(void *target, Task *task)
+int scheduler_get_idle_usage()
 {
-    __unused(target);
+    AtomicHolder holder;
+
+    int count = 0;
+    int total = 0;
+
+    for (int i = 0; i < ARCH_PROCESSOR_MAX_COUNT; i++)
+    {
+        Processor &processor = processors[i];
+
+        if (!processor_is_online(processor))
+        {
+            continue;
+        }
+
+        for (int j = 0; j < SCHEDULER_RECORD_COUNT; j++)
+        {
+            if (processor.record[j] == processor.idle->id)
+            {
+                count++;
+            }
+        }
+
+        total += SCHEDULER_RECORD_COUNT;
+    }
+
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    return (count * 100) / total;
+}
+
+bool scheduler_wakeup_if_unblocked(Task *task)
+{
+    ASSERT_ATOMIC;
 
     Blocker *blocker = task->blocker;
 
@@ -110,6 +347,8 @@ static Iteration wakeup_task_if_unblocked(void *target, Task *task)
         blocker->_result = BLOCKER_UNBLOCKED;
 
         task_set_state(task, TASK_STATE_RUNNING);
+
+        return true;
     }
     else if (blocker->_timeout != (Timeout)-1 &&
              blocker->_timeout <= system_get_tick())
@@ -118,33 +357,143 @@ static Iteration wakeup_task_if_unblocked(void *target, Task *task)
         blocker->_result = BLOCKER_TIMEOUT;
 
         task_set_state(task, TASK_STATE_RUNNING);
+
+        return true;
     }
 
-    return Iteration::CONTINUE;
+    return false;
+}
+
+// Only blockers without any wait queue or timeout are left here.
+static void wakeup_blocked_tasks()
+{
+    Task *task = blocked_tasks.head;
+
+    while (task)
+    {
+        // The task may leave the blocked queue, so grab the next one first.
+        Task *next = task->scheduler_next;
+        scheduler_wakeup_if_unblocked(task);
+        task = next;
+    }
+}
+
+// Charge the ticks elapsed since the last accounting to the running task,
+// and move it one level down once it has used up its time slice.
+static void account_running_task(Processor &processor, uint32_t tick)
+{
+    Task *running = processor.running;
+
+    uint32_t elapsed = tick - processor.last_accounted_tick;
+    processor.last_accounted_tick = tick;
+
+    if (elapsed == 0 ||
+        running == processor.idle ||
+        running->state != TASK_STATE_RUNNING)
+    {
+        return;
+    }
+
+    running->time_slice -= elapsed;
+
+    if (running->time_slice <= 0)
+    {
+        run_queue_remove(running);
+
+        if (running->priority < SCHEDULER_PRIORITY_COUNT - 1)
+        {
+            running->priority++;
+        }
+
+        running->time_slice = scheduler_quantum(running->priority);
+        run_queue_push(running);
+    }
+}
+
+static void boost_running_tasks(Processor &processor)
+{
+    for (int priority = 1; priority < SCHEDULER_PRIORITY_COUNT; priority++)
+    {
+        for (Task *task = processor.running_tasks[priority].head; task; task = task->scheduler_next)
+        {
+            task->priority = 0;
+            task->time_slice = scheduler_quantum(0);
+        }
+
+        processor.running_tasks[0].append(processor.running_tasks[priority]);
+    }
+
+    processor.running_tasks_bitmap = processor.running_tasks[0].empty() ? 0 : 1;
 }
 
 uintptr_t schedule(uintptr_t current_stack_pointer)
 {
-    scheduler_context_switch = true;
+    int processor_id = arch_processor_id();
+    Processor &processor = processors[processor_id];
+
+    processor.context_switch = true;
+    processor.previous = nullptr;
 
-    running->kernel_stack_pointer = current_stack_pointer;
-    arch_save_context(running);
+    processor.running->kernel_stack_pointer = current_stack_pointer;
+    arch_save_context(processor.running);
 
-    scheduler_record[system_get_tick() % SCHEDULER_RECORD_COUNT] = running->id;
+    uint32_t tick = system_get_tick();
 
-    list_iterate(blocked_tasks, nullptr, (ListIterationCallback)wakeup_task_if_unblocked);
+    processor.record[tick % SCHEDULER_RECORD_COUNT] = processor.running->id;
+
+    timer_expire(tick);
+    wakeup_blocked_tasks();
+
+    account_running_task(processor, tick);
+
+    // Let its peers at the same level go first, even if it didn't use up a
+    // whole tick.
+    if (processor.yielded &&
+        processor.running != processor.idle &&
+        processor.running->state == TASK_STATE_RUNNING)
+    {
+        run_queue_remove(processor.running);
+        run_queue_push(processor.running);
+    }
+
+    processor.yielded = false;
+
+    if (tick - last_boost_tick >= SCHEDULER_BOOST_INTERVAL)
+    {
+        for (int i = 0; i < ARCH_PROCESSOR_MAX_COUNT; i++)
+        {
+            boost_running_tasks(processors[i]);
+        }
+
+        last_boost_tick = tick;
+    }
 
     // Get the next task
-    if (!list_peek_and_pushback(running_tasks, (void **)&running))
+    Task *next = run_queue_peek(processor);
+
+    if (!next)
+    {
+        // Take one from a busy processor.
+        next = steal_task(processor_id);
+    }
+
+    if (!next)
     {
         // Or the idle task if there are no running tasks.
-        running = idle;
+        next = processor.idle;
     }
 
-    memory_pdir_switch(running->pdir);
-    arch_load_context(running);
+    if (next != processor.running)
+    {
+        processor.previous = processor.running;
+    }
+
+    processor.running = next;
+
+    memory_pdir_switch(processor.running->pdir);
+    arch_load_context(processor.running);
 
-    scheduler_context_switch = false;
+    processor.context_switch = false;
 
-    return running->kernel_stack_pointer;
+    return processor.running->kernel_stack_pointer;
 }
@@ -4,6 +4,17 @@
 
 #define SCHEDULER_RECORD_COUNT 1000
 
+// Number of priority levels of the run queue, 0 is the highest priority.
+#define SCHEDULER_PRIORITY_COUNT 8
+
+// Time slice (in ticks) of a task at the highest priority,
+// each level below get one more quantum.
+#define SCHEDULER_QUANTUM 5
+
+// Every runnable task is moved back to the highest priority
+// after this many ticks so cpu bound tasks can't starve.
+#define SCHEDULER_BOOST_INTERVAL 1000
+
 void scheduler_initialize();
 
 void scheduler_did_create_idle_task(Task *task);
@@ -16,10 +27,17 @@ bool scheduler_is_context_switch();
 
 int scheduler_get_usage(int task_id);
 
+int scheduler_get_idle_usage();
+
 Task *scheduler_running();
 
 int scheduler_running_id();
 
+// Is the task running, or still on the stack of a processor that just switched away from it?
+bool scheduler_is_on_processor(Task *task);
+
 void scheduler_yield();
 
+bool scheduler_wakeup_if_unblocked(Task *task);
+
 uintptr_t schedule(uintptr_t current_stack_pointer);
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "kernel/tasking/Task.h"
+
+// Intrusive FIFO of tasks, linked through Task::scheduler_prev/next.
+// A task can only be on one TaskQueue at a time.
+struct TaskQueue
+{
+    Task *head = nullptr;
+    Task *tail = nullptr;
+    int count = 0;
+
+    bool empty() { return head == nullptr; }
+
+    void push_back(Task *task)
+    {
+        task->scheduler_prev = tail;
+        task->scheduler_next = nullptr;
+
+        if (tail)
+        {
+            tail->scheduler_next = task;
+        }
+        else
+        {
+            head = task;
+        }
+
+        tail = task;
+        count++;
+    }
+
+    void remove(Task *task)
+    {
+        if (task->scheduler_prev)
+        {
+            task->scheduler_prev->scheduler_next = task->scheduler_next;
+        }
+        else
+        {
+            head = task->scheduler_next;
+        }
+
+        if (task->scheduler_next)
+        {
+            task->scheduler_next->scheduler_prev = task->scheduler_prev;
+        }
+        else
+        {
+            tail = task->scheduler_prev;
+        }
+
+        task->scheduler_prev = nullptr;
+        task->scheduler_next = nullptr;
+        count--;
+    }
+
+    // Move every task of other at the end of this queue.
+    void append(TaskQueue &other)
+    {
+        if (other.empty())
+        {
+            return;
+        }
+
+        if (tail)
+        {
+            tail->scheduler_next = other.head;
+            other.head->scheduler_prev = tail;
+        }
+        else
+        {
+            head = other.head;
+        }
+
+        tail = other.tail;
+        count += other.count;
+
+        other.head = nullptr;
+        other.tail = nullptr;
+        other.count = 0;
+    }
+};
@@ -0,0 +1,127 @@
+#include <libsystem/Assert.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "kernel/scheduling/Timer.h"
+
+static Timer **_timers = nullptr;
+static int _timers_count = 0;
+static int _timers_capacity = 0;
+
+static void timer_place(Timer *timer, int index)
+{
+    _timers[index] = timer;
+    timer->index = index;
+}
+
+static void timer_sift_up(int index)
+{
+    Timer *timer = _timers[index];
+
+    while (index > 0)
+    {
+        int parent = (index - 1) / 2;
+
+        if (_timers[parent]->deadline <= timer->deadline)
+        {
+            break;
+        }
+
+        timer_place(_timers[parent], index);
+        index = parent;
+    }
+
+    timer_place(timer, index);
+}
+
+static void timer_sift_down(int index)
+{
+    Timer *timer = _timers[index];
+
+    while (true)
+    {
+        int child = index * 2 + 1;
+
+        if (child >= _timers_count)
+        {
+            break;
+        }
+
+        if (child + 1 < _timers_count &&
+            _timers[child + 1]->deadline < _timers[child]->deadline)
+        {
+            child++;
+        }
+
+        if (timer->deadline <= _timers[child]->deadline)
+        {
+            break;
+        }
+
+        timer_place(_timers[child], index);
+        index = child;
+    }
+
+    timer_place(timer, index);
+}
+
+void timer_arm(Timer *timer, uint32_t deadline)
+{
+    ASSERT_ATOMIC;
+
+    if (timer->armed())
+    {
+        timer_disarm(timer);
+    }
+
+    if (_timers_count == _timers_capacity)
+    {
+        _timers_capacity = MAX(16, _timers_capacity * 2);
+        _timers = (Timer **)realloc(_timers, sizeof(Timer *) * _timers_capacity);
+    }
+
+    timer->deadline = deadline;
+
+    _timers_count++;
+    timer_place(timer, _timers_count - 1);
+    timer_sift_up(timer->index);
+}
+
+void timer_disarm(Timer *timer)
+{
+    ASSERT_ATOMIC;
+
+    if (!timer->armed())
+    {
+        return;
+    }
+
+    int index = timer->index;
+    timer->index = -1;
+
+    _timers_count--;
+
+    if (index == _timers_count)
+    {
+        return;
+    }
+
+    // Move the last timer in the hole and restore the heap property.
+    Timer *moved = _timers[_timers_count];
+    timer_place(moved, index);
+    timer_sift_down(moved->index);
+    timer_sift_up(moved->index);
+}
+
+void timer_expire(uint32_t tick)
+{
+    ASSERT_ATOMIC;
+
+    while (_timers_count > 0 && _timers[0]->deadline <= tick)
+    {
+        Timer *timer = _timers[0];
+        timer_disarm(timer);
+
+        timer->callback(timer->target);
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+typedef void (*TimerCallback)(void *target);
+
+struct Timer
+{
+    uint32_t deadline;
+
+    TimerCallback callback;
+    void *target;
+
+    // Position in the timer heap, or -1 when the timer is not armed.
+    int index = -1;
+
+    bool armed() { return index != -1; }
+};
+
+// Timers are kept in a binary min-heap keyed on their deadline, so arming
+// and disarming is O(log n) and the tick only looks at expired timers.
+
+void timer_arm(Timer *timer, uint32_t deadline);
+
+void timer_disarm(Timer *timer);
+
+void timer_expire(uint32_t tick);
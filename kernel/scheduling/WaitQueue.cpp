@@ -0,0 +1,73 @@
+#include <libsystem/Assert.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "kernel/scheduling/Scheduler.h"
+#include "kernel/scheduling/WaitQueue.h"
+
+void WaitQueue::add(Waiter *waiter)
+{
+    ASSERT_ATOMIC;
+
+    waiter->queue = this;
+    waiter->prev = tail;
+    waiter->next = nullptr;
+
+    if (tail)
+    {
+        tail->next = waiter;
+    }
+    else
+    {
+        head = waiter;
+    }
+
+    tail = waiter;
+}
+
+void WaitQueue::remove(Waiter *waiter)
+{
+    ASSERT_ATOMIC;
+
+    if (waiter->prev)
+    {
+        waiter->prev->next = waiter->next;
+    }
+    else
+    {
+        head = waiter->next;
+    }
+
+    if (waiter->next)
+    {
+        waiter->next->prev = waiter->prev;
+    }
+    else
+    {
+        tail = waiter->prev;
+    }
+
+    waiter->queue = nullptr;
+    waiter->prev = nullptr;
+    waiter->next = nullptr;
+}
+
+void WaitQueue::wakeup()
+{
+    AtomicHolder holder;
+
+    Waiter *waiter = head;
+
+    while (waiter)
+    {
+        if (scheduler_wakeup_if_unblocked(waiter->task))
+        {
+            // Waking up a task remove all its waiters from their queues,
+            // this may include the next one so start over.
+            waiter = head;
+        }
+        else
+        {
+            waiter = waiter->next;
+        }
+    }
+}
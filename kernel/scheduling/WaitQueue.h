@@ -0,0 +1,32 @@
+#pragma once
+
+struct Task;
+struct WaitQueue;
+
+struct Waiter
+{
+    Task *task;
+    WaitQueue *queue;
+
+    Waiter *prev;
+    Waiter *next;
+
+    // Next waiter owned by the same blocker.
+    Waiter *sibling;
+};
+
+// List of tasks blocked until something happens to the object owning the queue.
+struct WaitQueue
+{
+    Waiter *head = nullptr;
+    Waiter *tail = nullptr;
+
+    bool empty() { return head == nullptr; }
+
+    void add(Waiter *waiter);
+
+    void remove(Waiter *waiter);
+
+    // Give every waiting task a chance to unblock.
+    void wakeup();
+};
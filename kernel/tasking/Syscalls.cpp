@@ -1,6 +1,8 @@
 
 /* syscalls.c syscalls handeling code                                         */
 
+#include <abi/IORing.h>
+
 #include <libsystem/Assert.h>
 #include <libsystem/BuildInfo.h>
 #include <libsystem/Logger.h>
@@ -27,11 +29,19 @@ bool syscall_validate_ptr(uintptr_t ptr, size_t size)
            ptr + size >= ptr;
 }
 
+// For what the kernel writes to, a write fault on a read-only mapping in
+// kernel mode would take the whole system down.
+bool syscall_validate_writable_ptr(uintptr_t ptr, size_t size)
+{
+    return syscall_validate_ptr(ptr, size) &&
+           task_memory_is_writable(scheduler_running(), ptr, size);
+}
+
 /* --- Process -------------------------------------------------------------- */
 
 Result sys_process_this(int *pid)
 {
-    if (!syscall_validate_ptr((uintptr_t)pid, sizeof(int)))
+    if (!syscall_validate_writable_ptr((uintptr_t)pid, sizeof(int)))
     {
         return ERR_BAD_ADDRESS;
     }
@@ -44,7 +54,7 @@ Result sys_process_this(int *pid)
 Result sys_process_launch(Launchpad *launchpad, int *pid)
 {
     if (!syscall_validate_ptr((uintptr_t)launchpad, sizeof(Launchpad)) ||
-        !syscall_validate_ptr((uintptr_t)pid, sizeof(int)))
+        !syscall_validate_writable_ptr((uintptr_t)pid, sizeof(int)))
     {
         return ERR_BAD_ADDRESS;
     }
@@ -91,6 +101,11 @@ Result sys_process_cancel(int pid)
 
 Result sys_process_get_directory(char *buffer, uint size)
 {
+    if (!syscall_validate_writable_ptr((uintptr_t)buffer, size))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
     return task_get_directory(scheduler_running(), buffer, size);
 }
 
@@ -110,7 +125,7 @@ Result sys_process_wait(int tid, int *user_exit_value)
 
     Result result = task_wait(tid, &exit_value);
 
-    if (syscall_validate_ptr((uintptr_t)user_exit_value, sizeof(int)))
+    if (syscall_validate_writable_ptr((uintptr_t)user_exit_value, sizeof(int)))
     {
         *user_exit_value = exit_value;
     }
@@ -122,7 +137,7 @@ Result sys_process_wait(int tid, int *user_exit_value)
 
 Result sys_memory_alloc(size_t size, uintptr_t *out_address)
 {
-    if (!syscall_validate_ptr((uintptr_t)out_address, sizeof(uintptr_t)))
+    if (!syscall_validate_writable_ptr((uintptr_t)out_address, sizeof(uintptr_t)))
     {
         return ERR_BAD_ADDRESS;
     }
@@ -137,8 +152,8 @@ Result sys_memory_free(uintptr_t address)
 
 Result sys_memory_include(int handle, uintptr_t *out_address, size_t *out_size)
 {
-    if (!syscall_validate_ptr((uintptr_t)out_address, sizeof(uintptr_t)) ||
-        !syscall_validate_ptr((uintptr_t)out_size, sizeof(size_t)))
+    if (!syscall_validate_writable_ptr((uintptr_t)out_address, sizeof(uintptr_t)) ||
+        !syscall_validate_writable_ptr((uintptr_t)out_size, sizeof(size_t)))
     {
         return ERR_BAD_ADDRESS;
     }
@@ -148,7 +163,7 @@ Result sys_memory_include(int handle, uintptr_t *out_address, size_t *out_size)
 
 Result sys_memory_get_handle(uintptr_t address, int *out_handle)
 {
-    if (!syscall_validate_ptr((uintptr_t)out_handle, sizeof(int)))
+    if (!syscall_validate_writable_ptr((uintptr_t)out_handle, sizeof(int)))
     {
         return ERR_BAD_ADDRESS;
     }
@@ -221,6 +236,11 @@ Result sys_filesystem_rename(const char *old_path, const char *new_path)
 
 Result sys_system_get_info(SystemInfo *info)
 {
+    if (!syscall_validate_writable_ptr((uintptr_t)info, sizeof(SystemInfo)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
     strncpy(info->kernel_name, "hjert", SYSTEM_INFO_FIELD_SIZE);
 
     strncpy(info->kernel_release, __BUILD_GITREF__, SYSTEM_INFO_FIELD_SIZE);
@@ -237,20 +257,31 @@ ElapsedTime system_get_uptime();
 
 Result sys_system_get_status(SystemStatus *status)
 {
+    if (!syscall_validate_writable_ptr((uintptr_t)status, sizeof(SystemStatus)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
     // FIXME: get a real uptime value;
     status->uptime = system_get_uptime();
 
     status->total_ram = memory_get_total();
     status->used_ram = memory_get_used();
+    memory_get_free_blocks(status->free_blocks);
 
     status->running_tasks = task_count();
-    status->cpu_usage = 100 - scheduler_get_usage(0);
+    status->cpu_usage = 100 - scheduler_get_idle_usage();
 
     return SUCCESS;
 }
 
 Result sys_system_get_time(TimeStamp *timestamp)
 {
+    if (!syscall_validate_writable_ptr((uintptr_t)timestamp, sizeof(TimeStamp)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
     *timestamp = arch_get_time();
 
     return SUCCESS;
@@ -258,7 +289,7 @@ Result sys_system_get_time(TimeStamp *timestamp)
 
 Result sys_system_get_ticks(uint32_t *tick)
 {
-    if (!syscall_validate_ptr((uintptr_t)tick, sizeof(uintptr_t)))
+    if (!syscall_validate_writable_ptr((uintptr_t)tick, sizeof(uintptr_t)))
     {
         return ERR_BAD_ADDRESS;
     }
@@ -283,8 +314,8 @@ Result sys_system_shutdown()
 
 Result sys_create_pipe(int *reader_handle, int *writer_handle)
 {
-    if (!syscall_validate_ptr((uintptr_t)reader_handle, sizeof(int)) ||
-        !syscall_validate_ptr((uintptr_t)writer_handle, sizeof(int)))
+    if (!syscall_validate_writable_ptr((uintptr_t)reader_handle, sizeof(int)) ||
+        !syscall_validate_writable_ptr((uintptr_t)writer_handle, sizeof(int)))
     {
         return ERR_BAD_ADDRESS;
     }
@@ -294,8 +325,8 @@ Result sys_create_pipe(int *reader_handle, int *writer_handle)
 
 Result sys_create_term(int *master_handle, int *slave_handle)
 {
-    if (!syscall_validate_ptr((uintptr_t)master_handle, sizeof(int)) ||
-        !syscall_validate_ptr((uintptr_t)slave_handle, sizeof(int)))
+    if (!syscall_validate_writable_ptr((uintptr_t)master_handle, sizeof(int)) ||
+        !syscall_validate_writable_ptr((uintptr_t)slave_handle, sizeof(int)))
     {
         return ERR_BAD_ADDRESS;
     }
@@ -307,7 +338,7 @@ Result sys_create_term(int *master_handle, int *slave_handle)
 
 Result sys_handle_open(int *handle, const char *path, OpenFlag flags)
 {
-    if (!syscall_validate_ptr((uintptr_t)handle, sizeof(int)))
+    if (!syscall_validate_writable_ptr((uintptr_t)handle, sizeof(int)))
     {
         return ERR_BAD_ADDRESS;
     }
@@ -329,8 +360,8 @@ Result sys_handle_select(
     if (!syscall_validate_ptr((uintptr_t)handles_set, sizeof(HandleSet)) ||
         !syscall_validate_ptr((uintptr_t)handles_set->handles, sizeof(int) * handles_set->count) ||
         !syscall_validate_ptr((uintptr_t)handles_set->events, sizeof(SelectEvent) * handles_set->count) ||
-        !syscall_validate_ptr((uintptr_t)selected, sizeof(int)) ||
-        !syscall_validate_ptr((uintptr_t)selected_events, sizeof(SelectEvent)))
+        !syscall_validate_writable_ptr((uintptr_t)selected, sizeof(int)) ||
+        !syscall_validate_writable_ptr((uintptr_t)selected_events, sizeof(SelectEvent)))
     {
         return ERR_BAD_ADDRESS;
     }
@@ -369,8 +400,8 @@ Result sys_handle_select(
 
 Result sys_handle_read(int handle, char *buffer, size_t size, size_t *read)
 {
-    if (!syscall_validate_ptr((uintptr_t)buffer, size) ||
-        !syscall_validate_ptr((uintptr_t)read, sizeof(size_t)))
+    if (!syscall_validate_writable_ptr((uintptr_t)buffer, size) ||
+        !syscall_validate_writable_ptr((uintptr_t)read, sizeof(size_t)))
     {
         return ERR_BAD_ADDRESS;
     }
@@ -381,7 +412,7 @@ Result sys_handle_read(int handle, char *buffer, size_t size, size_t *read)
 Result sys_handle_write(int handle, const char *buffer, size_t size, size_t *written)
 {
     if (!syscall_validate_ptr((uintptr_t)buffer, size) ||
-        !syscall_validate_ptr((uintptr_t)written, sizeof(size_t)))
+        !syscall_validate_writable_ptr((uintptr_t)written, sizeof(size_t)))
     {
         return ERR_BAD_ADDRESS;
     }
@@ -389,6 +420,142 @@ Result sys_handle_write(int handle, const char *buffer, size_t size, size_t *wri
     return task_fshandle_write(scheduler_running(), handle, buffer, size, written);
 }
 
+static Result sys_handle_copy_vectors(const IOVector *vectors, size_t count, IOVector *vectors_copy, bool writable)
+{
+    if (count > IOVECTOR_COUNT)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    if (!syscall_validate_ptr((uintptr_t)vectors, sizeof(IOVector) * count))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    // Copied so they can't change between the checks and the transfer.
+    memcpy(vectors_copy, vectors, sizeof(IOVector) * count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uintptr_t buffer = (uintptr_t)vectors_copy[i].buffer;
+
+        if (!syscall_validate_ptr(buffer, vectors_copy[i].size) ||
+            (writable && !syscall_validate_writable_ptr(buffer, vectors_copy[i].size)))
+        {
+            return ERR_BAD_ADDRESS;
+        }
+    }
+
+    return SUCCESS;
+}
+
+Result sys_handle_readv(int handle, const IOVector *vectors, size_t count, size_t *read)
+{
+    if (!syscall_validate_writable_ptr((uintptr_t)read, sizeof(size_t)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    IOVector vectors_copy[IOVECTOR_COUNT];
+    Result result = sys_handle_copy_vectors(vectors, count, vectors_copy, true);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    return task_fshandle_readv(scheduler_running(), handle, vectors_copy, count, read);
+}
+
+Result sys_handle_writev(int handle, const IOVector *vectors, size_t count, size_t *written)
+{
+    if (!syscall_validate_writable_ptr((uintptr_t)written, sizeof(size_t)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    IOVector vectors_copy[IOVECTOR_COUNT];
+    Result result = sys_handle_copy_vectors(vectors, count, vectors_copy, false);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    return task_fshandle_writev(scheduler_running(), handle, vectors_copy, count, written);
+}
+
+Result sys_handle_pread(int handle, char *buffer, size_t size, size_t offset, size_t *read)
+{
+    if (!syscall_validate_writable_ptr((uintptr_t)buffer, size) ||
+        !syscall_validate_writable_ptr((uintptr_t)read, sizeof(size_t)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    return task_fshandle_pread(scheduler_running(), handle, buffer, size, offset, read);
+}
+
+Result sys_handle_pwrite(int handle, const char *buffer, size_t size, size_t offset, size_t *written)
+{
+    if (!syscall_validate_ptr((uintptr_t)buffer, size) ||
+        !syscall_validate_writable_ptr((uintptr_t)written, sizeof(size_t)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    return task_fshandle_pwrite(scheduler_running(), handle, buffer, size, offset, written);
+}
+
+Result sys_handle_donate(int handle, const char *buffer, size_t size, size_t *written)
+{
+    if (!syscall_validate_ptr((uintptr_t)buffer, size) ||
+        !syscall_validate_writable_ptr((uintptr_t)written, sizeof(size_t)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    return task_fshandle_donate(scheduler_running(), handle, buffer, size, written);
+}
+
+Result sys_handle_send(int handle, Message *message)
+{
+    if (!syscall_validate_ptr((uintptr_t)message, sizeof(Message)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    Message copy = *message;
+
+    if (!syscall_validate_ptr((uintptr_t)copy.buffer, copy.size))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    return task_fshandle_send(scheduler_running(), handle, &copy);
+}
+
+Result sys_handle_receive(int handle, Message *message)
+{
+    if (!syscall_validate_writable_ptr((uintptr_t)message, sizeof(Message)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    Message copy = *message;
+
+    if (!syscall_validate_writable_ptr((uintptr_t)copy.buffer, copy.size))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    Result result = task_fshandle_receive(scheduler_running(), handle, &copy);
+
+    *message = copy;
+
+    return result;
+}
+
 Result sys_handle_call(int handle, IOCall request, void *args)
 {
     return task_fshandle_call(scheduler_running(), handle, request, args);
@@ -401,7 +568,7 @@ Result sys_handle_seek(int handle, int offset, Whence whence)
 
 Result sys_handle_tell(int handle, Whence whence, int *offset)
 {
-    if (!syscall_validate_ptr((uintptr_t)offset, sizeof(int)))
+    if (!syscall_validate_writable_ptr((uintptr_t)offset, sizeof(int)))
     {
         return ERR_BAD_ADDRESS;
     }
@@ -411,7 +578,7 @@ Result sys_handle_tell(int handle, Whence whence, int *offset)
 
 Result sys_handle_stat(int handle, FileState *state)
 {
-    if (!syscall_validate_ptr((uintptr_t)state, sizeof(FileState)))
+    if (!syscall_validate_writable_ptr((uintptr_t)state, sizeof(FileState)))
     {
         return ERR_BAD_ADDRESS;
     }
@@ -421,14 +588,98 @@ Result sys_handle_stat(int handle, FileState *state)
 
 Result sys_handle_connect(int *handle, const char *path)
 {
+    if (!syscall_validate_writable_ptr((uintptr_t)handle, sizeof(int)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
     return task_fshandle_connect(scheduler_running(), handle, path);
 }
 
 Result sys_handle_accept(int handle, int *connection_handle)
 {
+    if (!syscall_validate_writable_ptr((uintptr_t)connection_handle, sizeof(int)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
     return task_fshandle_accept(scheduler_running(), handle, connection_handle);
 }
 
+Result sys_handle_map(int handle, uintptr_t *out_address, size_t *out_size)
+{
+    if (!syscall_validate_writable_ptr((uintptr_t)out_address, sizeof(uintptr_t)) ||
+        !syscall_validate_writable_ptr((uintptr_t)out_size, sizeof(size_t)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    return task_fshandle_map(scheduler_running(), handle, out_address, out_size);
+}
+
+static void sys_handle_ring_run(IORingSubmission *submission, IORingCompletion *completion)
+{
+    completion->user_data = submission->user_data;
+    completion->size = 0;
+    completion->handle = HANDLE_INVALID_ID;
+    completion->events = 0;
+
+    // The completion lives in the memory of the process, so the results
+    // are written there directly.
+    switch (submission->operation)
+    {
+    case IORING_NOP:
+        completion->result = SUCCESS;
+        break;
+
+    case IORING_READ:
+        completion->result = sys_handle_read(submission->handle, (char *)submission->buffer, submission->size, &completion->size);
+        break;
+
+    case IORING_WRITE:
+        completion->result = sys_handle_write(submission->handle, (const char *)submission->buffer, submission->size, &completion->size);
+        break;
+
+    case IORING_SELECT:
+        completion->result = sys_handle_select((HandleSet *)submission->buffer, &completion->handle, &completion->events, submission->timeout);
+        break;
+
+    case IORING_CONNECT:
+        completion->result = sys_handle_connect(&completion->handle, (const char *)submission->buffer);
+        break;
+
+    case IORING_CLOSE:
+        completion->result = sys_handle_close(submission->handle);
+        break;
+
+    default:
+        completion->result = ERR_INVALID_ARGUMENT;
+        break;
+    }
+}
+
+Result sys_handle_ring(IORing *ring)
+{
+    if (!syscall_validate_writable_ptr((uintptr_t)ring, sizeof(IORing)))
+    {
+        return ERR_BAD_ADDRESS;
+    }
+
+    // Whatever doesn't have room for its completion waits for the next time.
+    while (ring->submission_head != ring->submission_tail &&
+           ring->completion_tail - ring->completion_head < IORING_COUNT)
+    {
+        // Copied so it can't change while it's being checked and run.
+        IORingSubmission submission = ring->submissions[ring->submission_head % IORING_COUNT];
+        ring->submission_head++;
+
+        sys_handle_ring_run(&submission, &ring->completions[ring->completion_tail % IORING_COUNT]);
+        ring->completion_tail++;
+    }
+
+    return SUCCESS;
+}
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wcast-function-type"
 
@@ -461,12 +712,21 @@ static SyscallHandler syscalls[__SYSCALL_COUNT] = {
     [SYS_HANDLE_SELECT] = reinterpret_cast<SyscallHandler>(sys_handle_select),
     [SYS_HANDLE_READ] = reinterpret_cast<SyscallHandler>(sys_handle_read),
     [SYS_HANDLE_WRITE] = reinterpret_cast<SyscallHandler>(sys_handle_write),
+    [SYS_HANDLE_READV] = reinterpret_cast<SyscallHandler>(sys_handle_readv),
+    [SYS_HANDLE_WRITEV] = reinterpret_cast<SyscallHandler>(sys_handle_writev),
+    [SYS_HANDLE_PREAD] = reinterpret_cast<SyscallHandler>(sys_handle_pread),
+    [SYS_HANDLE_PWRITE] = reinterpret_cast<SyscallHandler>(sys_handle_pwrite),
+    [SYS_HANDLE_DONATE] = reinterpret_cast<SyscallHandler>(sys_handle_donate),
+    [SYS_HANDLE_SEND] = reinterpret_cast<SyscallHandler>(sys_handle_send),
+    [SYS_HANDLE_RECEIVE] = reinterpret_cast<SyscallHandler>(sys_handle_receive),
     [SYS_HANDLE_CALL] = reinterpret_cast<SyscallHandler>(sys_handle_call),
     [SYS_HANDLE_SEEK] = reinterpret_cast<SyscallHandler>(sys_handle_seek),
     [SYS_HANDLE_TELL] = reinterpret_cast<SyscallHandler>(sys_handle_tell),
     [SYS_HANDLE_STAT] = reinterpret_cast<SyscallHandler>(sys_handle_stat),
     [SYS_HANDLE_CONNECT] = reinterpret_cast<SyscallHandler>(sys_handle_connect),
     [SYS_HANDLE_ACCEPT] = reinterpret_cast<SyscallHandler>(sys_handle_accept),
+    [SYS_HANDLE_MAP] = reinterpret_cast<SyscallHandler>(sys_handle_map),
+    [SYS_HANDLE_RING] = reinterpret_cast<SyscallHandler>(sys_handle_ring),
     [SYS_CREATE_PIPE] = reinterpret_cast<SyscallHandler>(sys_create_pipe),
     [SYS_CREATE_TERM] = reinterpret_cast<SyscallHandler>(sys_create_term),
 };
@@ -506,6 +766,8 @@ int task_do_syscall(Syscall syscall, int arg0, int arg1, int arg2, int arg3, int
         return ERR_FUNCTION_NOT_IMPLEMENTED;
     }
 
+    scheduler_running()->syscalls++;
+
     result = handler(arg0, arg1, arg2, arg3, arg4);
 
     if (result != SUCCESS && result != TIMEOUT)
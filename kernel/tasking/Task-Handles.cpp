@@ -8,6 +8,7 @@
 #include "kernel/scheduling/Scheduler.h"
 #include "kernel/tasking/Task-Directory.h"
 #include "kernel/tasking/Task-Handles.h"
+#include "kernel/tasking/Task-Memory.h"
 
 Result task_fshandle_add(Task *task, int *handle_index, FsHandle *handle)
 {
@@ -223,6 +224,91 @@ Result task_fshandle_write(Task *task, int handle_index, const void *buffer, siz
     return result;
 }
 
+Result task_fshandle_readv(Task *task, int handle_index, const IOVector *vectors, size_t count, size_t *read)
+{
+    FsHandle *handle = task_fshandle_acquire(task, handle_index);
+
+    if (handle == nullptr)
+    {
+        *read = 0;
+        return ERR_BAD_FILE_DESCRIPTOR;
+    }
+
+    Result result = fshandle_readv(handle, vectors, count, read);
+
+    task_fshandle_release(task, handle_index);
+
+    return result;
+}
+
+Result task_fshandle_writev(Task *task, int handle_index, const IOVector *vectors, size_t count, size_t *written)
+{
+    FsHandle *handle = task_fshandle_acquire(task, handle_index);
+
+    if (handle == nullptr)
+    {
+        *written = 0;
+        return ERR_BAD_FILE_DESCRIPTOR;
+    }
+
+    Result result = fshandle_writev(handle, vectors, count, written);
+
+    task_fshandle_release(task, handle_index);
+
+    return result;
+}
+
+Result task_fshandle_pread(Task *task, int handle_index, void *buffer, size_t size, size_t offset, size_t *read)
+{
+    FsHandle *handle = task_fshandle_acquire(task, handle_index);
+
+    if (handle == nullptr)
+    {
+        *read = 0;
+        return ERR_BAD_FILE_DESCRIPTOR;
+    }
+
+    Result result = fshandle_pread(handle, buffer, size, offset, read);
+
+    task_fshandle_release(task, handle_index);
+
+    return result;
+}
+
+Result task_fshandle_pwrite(Task *task, int handle_index, const void *buffer, size_t size, size_t offset, size_t *written)
+{
+    FsHandle *handle = task_fshandle_acquire(task, handle_index);
+
+    if (handle == nullptr)
+    {
+        *written = 0;
+        return ERR_BAD_FILE_DESCRIPTOR;
+    }
+
+    Result result = fshandle_pwrite(handle, buffer, size, offset, written);
+
+    task_fshandle_release(task, handle_index);
+
+    return result;
+}
+
+Result task_fshandle_donate(Task *task, int handle_index, const void *buffer, size_t size, size_t *written)
+{
+    FsHandle *handle = task_fshandle_acquire(task, handle_index);
+
+    if (handle == nullptr)
+    {
+        *written = 0;
+        return ERR_BAD_FILE_DESCRIPTOR;
+    }
+
+    Result result = fshandle_donate(handle, buffer, size, written);
+
+    task_fshandle_release(task, handle_index);
+
+    return result;
+}
+
 Result task_fshandle_call(Task *task, int handle_index, IOCall request, void *args)
 {
     FsHandle *handle = task_fshandle_acquire(task, handle_index);
@@ -287,6 +373,22 @@ Result task_fshandle_stat(Task *task, int handle_index, FileState *stat)
     return result;
 }
 
+Result task_fshandle_map(Task *task, int handle_index, uintptr_t *out_address, size_t *out_size)
+{
+    FsHandle *handle = task_fshandle_acquire(task, handle_index);
+
+    if (handle == nullptr)
+    {
+        return ERR_BAD_FILE_DESCRIPTOR;
+    }
+
+    Result result = task_memory_map_file(task, handle, out_address, out_size);
+
+    task_fshandle_release(task, handle_index);
+
+    return result;
+}
+
 Result task_fshandle_connect(Task *task, int *connection_handle_index, const char *socket_path)
 {
     Path *resolved_path = task_resolve_directory(task, socket_path);
@@ -338,6 +440,172 @@ Result task_fshandle_accept(Task *task, int socket_handle_index, int *connection
     return result;
 }
 
+static Result task_message_attachment_pack(Task *task, const MessageAttachment *attachment, FsAttachment *packed)
+{
+    *packed = {};
+
+    if (attachment->type == MESSAGE_ATTACHMENT_HANDLE)
+    {
+        FsHandle *handle = task_fshandle_acquire(task, attachment->id);
+
+        if (handle == nullptr)
+        {
+            return ERR_BAD_FILE_DESCRIPTOR;
+        }
+
+        // Two connections waiting in each other's messages would keep each
+        // other alive for good, and one in its own would hold its lock when
+        // it goes away. Sockets keep the connections waiting to be accepted,
+        // so they could do the same.
+        if (handle->node->type == FILE_TYPE_CONNECTION ||
+            handle->node->type == FILE_TYPE_SOCKET)
+        {
+            task_fshandle_release(task, attachment->id);
+
+            return ERR_OPERATION_NOT_SUPPORTED;
+        }
+
+        packed->type = MESSAGE_ATTACHMENT_HANDLE;
+        packed->handle = fshandle_clone(handle);
+
+        task_fshandle_release(task, attachment->id);
+
+        return packed->handle ? SUCCESS : ERR_INVALID_ARGUMENT;
+    }
+    else if (attachment->type == MESSAGE_ATTACHMENT_MEMORY)
+    {
+        packed->type = MESSAGE_ATTACHMENT_MEMORY;
+        packed->memory_object = memory_object_by_id(attachment->id);
+
+        return packed->memory_object ? SUCCESS : ERR_BAD_ADDRESS;
+    }
+    else
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+}
+
+static void task_message_attachment_unpack(Task *task, FsAttachment *packed, MessageAttachment *attachment)
+{
+    *attachment = {};
+    attachment->type = packed->type;
+    attachment->id = HANDLE_INVALID_ID;
+
+    if (packed->type == MESSAGE_ATTACHMENT_HANDLE)
+    {
+        if (task_fshandle_add(task, &attachment->id, packed->handle) == SUCCESS)
+        {
+            packed->handle = nullptr;
+        }
+    }
+    else if (packed->type == MESSAGE_ATTACHMENT_MEMORY)
+    {
+        MemoryMapping *memory_mapping = task_memory_mapping_create(task, packed->memory_object);
+
+        if (memory_mapping)
+        {
+            attachment->id = packed->memory_object->id;
+            attachment->address = memory_mapping->address;
+            attachment->size = memory_mapping->size;
+        }
+    }
+
+    // Whatever didn't make it into the task goes away.
+    fsattachment_release(packed);
+}
+
+Result task_fshandle_send(Task *task, int handle_index, const Message *message)
+{
+    if (message->attachments_count > MESSAGE_ATTACHMENT_COUNT)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    FsHandle *handle = task_fshandle_acquire(task, handle_index);
+
+    if (handle == nullptr)
+    {
+        return ERR_BAD_FILE_DESCRIPTOR;
+    }
+
+    FsNode *destination = handle->node;
+
+    // Attached handles are looked up without holding ours, it might be one of them.
+    task_fshandle_release(task, handle_index);
+
+    FsAttachment attachments[MESSAGE_ATTACHMENT_COUNT] = {};
+    size_t attachments_count = 0;
+
+    Result result = SUCCESS;
+
+    while (attachments_count < message->attachments_count && result == SUCCESS)
+    {
+        result = task_message_attachment_pack(task, &message->attachments[attachments_count], &attachments[attachments_count]);
+        attachments_count++;
+    }
+
+    if (result == SUCCESS)
+    {
+        handle = task_fshandle_acquire(task, handle_index);
+
+        if (handle == nullptr)
+        {
+            result = ERR_BAD_FILE_DESCRIPTOR;
+        }
+        else if (handle->node != destination)
+        {
+            result = ERR_BAD_FILE_DESCRIPTOR;
+            task_fshandle_release(task, handle_index);
+        }
+        else
+        {
+            size_t sent = 0;
+            result = fshandle_send(handle, message->buffer, message->size, attachments, attachments_count, &sent);
+            task_fshandle_release(task, handle_index);
+        }
+    }
+
+    // The connection only keeps them if the message went through.
+    if (result != SUCCESS)
+    {
+        for (size_t i = 0; i < attachments_count; i++)
+        {
+            fsattachment_release(&attachments[i]);
+        }
+    }
+
+    return result;
+}
+
+Result task_fshandle_receive(Task *task, int handle_index, Message *message)
+{
+    message->attachments_count = 0;
+
+    FsHandle *handle = task_fshandle_acquire(task, handle_index);
+
+    if (handle == nullptr)
+    {
+        message->size = 0;
+        return ERR_BAD_FILE_DESCRIPTOR;
+    }
+
+    FsAttachment attachments[MESSAGE_ATTACHMENT_COUNT] = {};
+    size_t attachments_count = 0;
+
+    Result result = fshandle_receive(handle, message->buffer, message->size, attachments, &attachments_count, &message->size);
+
+    task_fshandle_release(task, handle_index);
+
+    for (size_t i = 0; i < attachments_count; i++)
+    {
+        task_message_attachment_unpack(task, &attachments[i], &message->attachments[i]);
+    }
+
+    message->attachments_count = attachments_count;
+
+    return result;
+}
+
 Result task_create_pipe(Task *task, int *reader_handle_index, int *writer_handle_index)
 {
     *reader_handle_index = HANDLE_INVALID_ID;
@@ -19,6 +19,16 @@ Result task_fshandle_read(Task *task, int handle_index, void *buffer, size_t siz
 
 Result task_fshandle_write(Task *task, int handle_index, const void *buffer, size_t size, size_t *written);
 
+Result task_fshandle_readv(Task *task, int handle_index, const IOVector *vectors, size_t count, size_t *read);
+
+Result task_fshandle_writev(Task *task, int handle_index, const IOVector *vectors, size_t count, size_t *written);
+
+Result task_fshandle_pread(Task *task, int handle_index, void *buffer, size_t size, size_t offset, size_t *read);
+
+Result task_fshandle_pwrite(Task *task, int handle_index, const void *buffer, size_t size, size_t offset, size_t *written);
+
+Result task_fshandle_donate(Task *task, int handle_index, const void *buffer, size_t size, size_t *written);
+
 Result task_fshandle_seek(Task *task, int handle_index, int offset, Whence whence);
 
 Result task_fshandle_tell(Task *task, int handle_index, Whence whence, int *offset);
@@ -31,10 +41,18 @@ Result task_fshandle_connect(Task *task, int *handle_index, const char *path);
 
 Result task_fshandle_accept(Task *task, int handle_index, int *connection_handle_index);
 
+Result task_fshandle_map(Task *task, int handle_index, uintptr_t *out_address, size_t *out_size);
+
 Result task_fshandle_send(Task *task, int handle_index, const void *buffer, size_t size, size_t *sended);
 
 Result task_fshandle_receive(Task *task, int handle_index, void *buffer, size_t size, size_t *received);
 
+// Send or receive one message on a connection, with the handles and memory
+// objects attached to it.
+Result task_fshandle_send(Task *task, int handle_index, const Message *message);
+
+Result task_fshandle_receive(Task *task, int handle_index, Message *message);
+
 Result task_create_pipe(Task *task, int *reader_handle_index, int *writer_handle_index);
 
 Result task_create_term(Task *task, int *master_handle_index, int *slave_handle_index);
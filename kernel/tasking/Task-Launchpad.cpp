@@ -3,41 +3,121 @@
 #include <libsystem/Logger.h>
 #include <libsystem/core/CString.h>
 
+#include "kernel/filesystem/Filesystem.h"
+#include "kernel/memory/PageCache.h"
 #include "kernel/scheduling/Scheduler.h"
+#include "kernel/tasking/Task-Directory.h"
+#include "kernel/tasking/Task-Lanchpad.h"
 #include "kernel/tasking/Task-Memory.h"
 #include "kernel/tasking/Task.h"
 
-Result task_launch_load_elf(Task *parent_task, Task *child_task, Stream *elf_file, ELFProgram *program_header)
+static Result task_launch_copy_elf(Task *parent_task, Task *child_task, FsHandle *elf_file, ELFProgram *program_header)
 {
-    if (program_header->vaddr <= 0x100000)
+    MemoryRange range = MemoryRange::around_non_aligned_address(program_header->vaddr, program_header->memsz);
+
+    Result result = task_memory_map(child_task, range.base(), range.size(), MEMORY_CLEAR);
+
+    if (result != SUCCESS)
     {
-        logger_error("ELF program no in user memory (0x%08x)!", program_header->vaddr);
-        return ERR_EXEC_FORMAT_ERROR;
+        return result;
     }
 
     PageDirectory *parent_page_directory = task_switch_pdir(parent_task, child_task->pdir);
 
-    MemoryRange range = MemoryRange::around_non_aligned_address(program_header->vaddr, program_header->memsz);
+    task_memory_populate(child_task, program_header->vaddr, program_header->filesz);
 
-    task_memory_map(child_task, range.base(), range.size(), MEMORY_CLEAR);
+    size_t read = 0;
+    fshandle_pread(elf_file, (void *)program_header->vaddr, program_header->filesz, program_header->offset, &read);
 
-    stream_seek(elf_file, program_header->offset, WHENCE_START);
-    size_t read = stream_read(elf_file, (void *)program_header->vaddr, program_header->filesz);
+    task_switch_pdir(parent_task, parent_page_directory);
 
     if (read != program_header->filesz)
     {
         logger_error("Didn't read the right amount from the ELF file!");
+        return ERR_EXEC_FORMAT_ERROR;
+    }
 
-        task_switch_pdir(parent_task, parent_page_directory);
+    return SUCCESS;
+}
 
+Result task_launch_load_elf(Task *parent_task, Task *child_task, FsHandle *elf_file, MemoryObject *elf_pages, ELFProgram *program_header)
+{
+    if (program_header->vaddr <= 0x100000)
+    {
+        logger_error("ELF program no in user memory (0x%08x)!", program_header->vaddr);
         return ERR_EXEC_FORMAT_ERROR;
     }
-    else
-    {
-        task_switch_pdir(parent_task, parent_page_directory);
 
+    if (program_header->memsz == 0)
+    {
         return SUCCESS;
     }
+
+    if (program_header->vaddr % ARCH_PAGE_SIZE != program_header->offset % ARCH_PAGE_SIZE)
+    {
+        // The pages of the file don't line up with the pages of the segment, so they can't be shared.
+        return task_launch_copy_elf(parent_task, child_task, elf_file, program_header);
+    }
+
+    uintptr_t base = program_header->vaddr - program_header->vaddr % ARCH_PAGE_SIZE;
+    uintptr_t file_end = program_header->vaddr + program_header->filesz;
+    uintptr_t memory_end = PAGE_ALIGN_UP(program_header->vaddr + program_header->memsz);
+    uintptr_t anonymous_begin = base;
+
+    if (program_header->filesz > 0)
+    {
+        size_t offset = program_header->offset - program_header->offset % ARCH_PAGE_SIZE;
+        size_t size = PAGE_ALIGN_UP(file_end) - base;
+
+        Result result = page_cache_fill(elf_pages, elf_file, offset, size);
+
+        if (result != SUCCESS)
+        {
+            return result;
+        }
+
+        if (offset + size > elf_pages->size() ||
+            task_memory_mapping_colides(child_task, base, size))
+        {
+            logger_error("Bad ELF program (0x%08x)!", program_header->vaddr);
+            return ERR_EXEC_FORMAT_ERROR;
+        }
+
+        // The .bss lives in the last page of the file too, it has to be cleared in a copy of that page.
+        bool writable = (program_header->flags & ELFP_WRITABLE) || program_header->memsz > program_header->filesz;
+
+        task_memory_mapping_create_at(
+            child_task,
+            elf_pages,
+            base,
+            offset,
+            size,
+            writable ? MEMORY_MAPPING_PRIVATE : MEMORY_MAPPING_READONLY);
+
+        anonymous_begin = PAGE_ALIGN_UP(file_end);
+    }
+
+    if (memory_end > anonymous_begin)
+    {
+        Result result = task_memory_map(child_task, anonymous_begin, memory_end - anonymous_begin, MEMORY_CLEAR);
+
+        if (result != SUCCESS)
+        {
+            return result;
+        }
+    }
+
+    if (program_header->memsz > program_header->filesz && file_end % ARCH_PAGE_SIZE)
+    {
+        PageDirectory *parent_page_directory = task_switch_pdir(parent_task, child_task->pdir);
+
+        task_memory_populate(child_task, file_end, 1);
+        memset((void *)file_end, 0, ARCH_PAGE_SIZE - file_end % ARCH_PAGE_SIZE);
+
+        task_switch_pdir(parent_task, parent_page_directory);
+    }
+
+    return SUCCESS;
 }
 
 void task_launch_passhandle(Task *parent_task, Task *child_task, Launchpad *launchpad)
@@ -60,23 +140,12 @@ void task_launch_passhandle(Task *parent_task, Task *child_task, Launchpad *laun
     }
 }
 
-Result task_launch(Task *parent_task, Launchpad *launchpad, int *pid)
+static Result task_launch_from_file(Task *parent_task, Launchpad *launchpad, FsHandle *elf_file, int *pid)
 {
-    assert(parent_task == scheduler_running());
-
-    *pid = -1;
-
-    __cleanup(stream_cleanup) Stream *elf_file = stream_open(launchpad->executable, OPEN_READ);
-
-    if (handle_has_error(elf_file))
-    {
-        logger_error("Failed to open ELF file %s: %s!", launchpad->executable, handle_error_string(elf_file));
-        return handle_get_error(elf_file);
-    }
-
     ELFHeader elf_header;
     {
-        size_t elf_header_size = stream_read(elf_file, &elf_header, sizeof(ELFHeader));
+        size_t elf_header_size = 0;
+        fshandle_read(elf_file, &elf_header, sizeof(ELFHeader), &elf_header_size);
 
         if (elf_header_size != sizeof(ELFHeader) || !elf_valid(&elf_header))
         {
@@ -85,34 +154,71 @@ Result task_launch(Task *parent_task, Launchpad *launchpad, int *pid)
         }
     }
 
+    // Shared by every task running this executable.
+    MemoryObject *elf_pages = page_cache_acquire(elf_file);
+
+    // The program headers are packed together, they are read in one go.
+    size_t elf_program_headers_size = elf_header.phentsize * elf_header.phnum;
+    __cleanup_malloc char *elf_program_headers = (char *)malloc(elf_program_headers_size);
+
+    size_t read = 0;
+    fshandle_pread(elf_file, elf_program_headers, elf_program_headers_size, elf_header.phoff, &read);
+
+    if (read != elf_program_headers_size || elf_header.phentsize < sizeof(ELFProgram))
+    {
+        logger_error("Failed to load ELF file %s: bad program headers!", launchpad->executable);
+        memory_object_deref(elf_pages);
+        return ERR_EXEC_FORMAT_ERROR;
+    }
+
+    Task *child_task = task_spawn_with_argv(parent_task, launchpad->name, (TaskEntry)elf_header.entry, (const char **)launchpad->argv, true);
+
+    for (int i = 0; i < elf_header.phnum; i++)
     {
-        Task *child_task = task_spawn_with_argv(parent_task, launchpad->name, (TaskEntry)elf_header.entry, (const char **)launchpad->argv, true);
+        ELFProgram *elf_program_header = (ELFProgram *)(elf_program_headers + elf_header.phentsize * i);
+
+        Result result = task_launch_load_elf(parent_task, child_task, elf_file, elf_pages, elf_program_header);
 
-        for (int i = 0; i < elf_header.phnum; i++)
+        if (result != SUCCESS)
         {
-            ELFProgram elf_program_header;
-            stream_seek(elf_file, elf_header.phoff + elf_header.phentsize * i, WHENCE_START);
-
-            if (stream_read(elf_file, &elf_program_header, sizeof(ELFProgram)) != sizeof(ELFProgram))
-            {
-                task_destroy(child_task);
-                return ERR_EXEC_FORMAT_ERROR;
-            }
-
-            Result result = task_launch_load_elf(parent_task, child_task, elf_file, &elf_program_header);
-
-            if (result != SUCCESS)
-            {
-                task_destroy(child_task);
-                return result;
-            }
+            memory_object_deref(elf_pages);
+            task_destroy(child_task);
+            return result;
         }
+    }
 
-        task_launch_passhandle(parent_task, child_task, launchpad);
+    memory_object_deref(elf_pages);
 
-        *pid = child_task->id;
-        task_go(child_task);
-    }
+    task_launch_passhandle(parent_task, child_task, launchpad);
+
+    *pid = child_task->id;
+    task_go(child_task);
 
     return SUCCESS;
 }
+
+Result task_launch(Task *parent_task, Launchpad *launchpad, int *pid)
+{
+    assert(parent_task == scheduler_running());
+
+    *pid = -1;
+
+    Path *elf_path = task_resolve_directory(parent_task, launchpad->executable);
+
+    FsHandle *elf_file = nullptr;
+    Result result = filesystem_open(elf_path, OPEN_READ, &elf_file);
+
+    path_destroy(elf_path);
+
+    if (result != SUCCESS)
+    {
+        logger_error("Failed to open ELF file %s: %s!", launchpad->executable, result_to_string(result));
+        return result;
+    }
+
+    result = task_launch_from_file(parent_task, launchpad, elf_file, pid);
+
+    fshandle_destroy(elf_file);
+
+    return result;
+}
@@ -1,37 +1,188 @@
 #include <libsystem/core/CString.h>
 #include <libsystem/thread/Atomic.h>
 
+#include "kernel/memory/PageCache.h"
 #include "kernel/memory/Virtual.h"
 #include "kernel/tasking/Task-Memory.h"
 
-MemoryMapping *task_memory_mapping_create(Task *task, MemoryObject *memory_object)
+// Pages are copied through here when a task writes to a copy-on-write page,
+// it's only used with the kernel lock held.
+static char _copy_buffer[ARCH_PAGE_SIZE];
+
+static MemoryMapping *task_memory_mapping_create_internal(
+    Task *task,
+    MemoryObject *memory_object,
+    uintptr_t address,
+    size_t offset,
+    size_t size,
+    MemoryMappingType type)
 {
-    AtomicHolder holder;
-
+    // Nothing is mapped yet, pages are brought in by task_memory_handle_page_fault()
+    // the first time they are touched.
     MemoryMapping *memory_mapping = __create(MemoryMapping);
 
     memory_mapping->object = memory_object_ref(memory_object);
-    memory_mapping->address = virtual_alloc(task->pdir, memory_object->range(), MEMORY_USER).base();
-    memory_mapping->size = memory_object->range().size();
+    memory_mapping->offset = offset;
+    memory_mapping->type = type;
+    memory_mapping->address = address;
+    memory_mapping->size = size;
+
+    if (type == MEMORY_MAPPING_PRIVATE)
+    {
+        memory_mapping->copy = memory_object_create(size);
+    }
 
-    list_pushback(task->memory_mapping, memory_mapping);
+    memory_region_tree_insert(&task->memory_mappings, memory_mapping);
 
     return memory_mapping;
 }
 
-MemoryMapping *task_memory_mapping_create_at(Task *task, MemoryObject *memory_object, uintptr_t address)
+static Result task_memory_mapping_map_page(Task *task, uintptr_t physical_address, uintptr_t page_address, MemoryFlags flags)
+{
+    return virtual_map(task->pdir, MemoryRange{physical_address, ARCH_PAGE_SIZE}, page_address, MEMORY_USER | flags);
+}
+
+// Map the page holding address, write is set when it's about to be written
+// to. Returns false if the fault wasn't caused by lazy mapping or copy-on-write.
+static bool task_memory_mapping_fault_in(Task *task, MemoryMapping *memory_mapping, uintptr_t address, bool write)
+{
+    uintptr_t page_address = address - address % ARCH_PAGE_SIZE;
+    size_t page_index = (page_address - memory_mapping->address) / ARCH_PAGE_SIZE;
+    size_t object_page_index = memory_mapping->offset / ARCH_PAGE_SIZE + page_index;
+
+    bool present = virtual_present(task->pdir, page_address);
+
+    if (memory_mapping->type == MEMORY_MAPPING_SHARED)
+    {
+        if (present)
+        {
+            return false;
+        }
+
+        bool fresh = false;
+        uintptr_t physical_address = memory_object_page(memory_mapping->object, object_page_index, &fresh);
+
+        if (!physical_address ||
+            task_memory_mapping_map_page(task, physical_address, page_address, MEMORY_NONE) != SUCCESS)
+        {
+            return false;
+        }
+
+        if (fresh)
+        {
+            memset((void *)page_address, 0, ARCH_PAGE_SIZE);
+        }
+    }
+    else if (memory_mapping->type == MEMORY_MAPPING_READONLY)
+    {
+        uintptr_t physical_address = memory_mapping->object->page(object_page_index);
+
+        if (present || write || !physical_address)
+        {
+            return false;
+        }
+
+        if (task_memory_mapping_map_page(task, physical_address, page_address, MEMORY_READONLY) != SUCCESS)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        uintptr_t source_address = memory_mapping->object->page(object_page_index);
+
+        if (memory_mapping->copy->page(page_index))
+        {
+            // Already ours, so this is a real protection fault.
+            if (present)
+            {
+                return false;
+            }
+
+            if (task_memory_mapping_map_page(task, memory_mapping->copy->page(page_index), page_address, MEMORY_NONE) != SUCCESS)
+            {
+                return false;
+            }
+        }
+        else if (!write && source_address)
+        {
+            if (present)
+            {
+                return false;
+            }
+
+            if (task_memory_mapping_map_page(task, source_address, page_address, MEMORY_READONLY) != SUCCESS)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            if (present)
+            {
+                memcpy(_copy_buffer, (void *)page_address, ARCH_PAGE_SIZE);
+            }
+            else if (source_address)
+            {
+                if (task_memory_mapping_map_page(task, source_address, page_address, MEMORY_READONLY) != SUCCESS)
+                {
+                    return false;
+                }
+
+                memcpy(_copy_buffer, (void *)page_address, ARCH_PAGE_SIZE);
+            }
+            else
+            {
+                memset(_copy_buffer, 0, ARCH_PAGE_SIZE);
+            }
+
+            bool fresh = false;
+            uintptr_t physical_address = memory_object_page(memory_mapping->copy, page_index, &fresh);
+
+            if (!physical_address ||
+                task_memory_mapping_map_page(task, physical_address, page_address, MEMORY_NONE) != SUCCESS)
+            {
+                return false;
+            }
+
+            memcpy((void *)page_address, _copy_buffer, ARCH_PAGE_SIZE);
+        }
+    }
+
+    if (!present)
+    {
+        memory_mapping->resident += ARCH_PAGE_SIZE;
+        task->memory_resident += ARCH_PAGE_SIZE;
+    }
+
+    return true;
+}
+
+MemoryMapping *task_memory_mapping_create(Task *task, MemoryObject *memory_object)
 {
     AtomicHolder holder;
 
-    MemoryMapping *memory_mapping = __create(MemoryMapping);
+    uintptr_t address = memory_region_tree_find_free(&task->memory_mappings, memory_object->size());
 
-    memory_mapping->object = memory_object_ref(memory_object);
-    memory_mapping->address = virtual_map(task->pdir, memory_object->range(), address, MEMORY_USER);
-    memory_mapping->size = memory_object->range().size();
+    if (address == 0)
+    {
+        return nullptr;
+    }
 
-    list_pushback(task->memory_mapping, memory_mapping);
+    return task_memory_mapping_create_internal(task, memory_object, address, 0, memory_object->size(), MEMORY_MAPPING_SHARED);
+}
 
-    return memory_mapping;
+MemoryMapping *task_memory_mapping_create_at(
+    Task *task,
+    MemoryObject *memory_object,
+    uintptr_t address,
+    size_t offset,
+    size_t size,
+    MemoryMappingType type)
+{
+    AtomicHolder holder;
+
+    return task_memory_mapping_create_internal(task, memory_object, address, offset, size, type);
 }
 
 void task_memory_mapping_destroy(Task *task, MemoryMapping *memory_mapping)
@@ -41,18 +192,24 @@ void task_memory_mapping_destroy(Task *task, MemoryMapping *memory_mapping)
     virtual_free(task->pdir, (MemoryRange){memory_mapping->address, memory_mapping->size});
     memory_object_deref(memory_mapping->object);
 
-    list_remove(task->memory_mapping, memory_mapping);
+    if (memory_mapping->copy)
+    {
+        memory_object_deref(memory_mapping->copy);
+    }
+
+    task->memory_resident -= memory_mapping->resident;
+
+    memory_region_tree_remove(&task->memory_mappings, memory_mapping);
     free(memory_mapping);
 }
 
 MemoryMapping *task_memory_mapping_by_address(Task *task, uintptr_t address)
 {
-    list_foreach(MemoryMapping, memory_mapping, task->memory_mapping)
+    MemoryRegion *region = memory_region_tree_lookup(&task->memory_mappings, address);
+
+    if (region && region->address == address)
     {
-        if (memory_mapping->address == address)
-        {
-            return memory_mapping;
-        }
+        return static_cast<MemoryMapping *>(region);
     }
 
     return nullptr;
@@ -60,16 +217,158 @@ MemoryMapping *task_memory_mapping_by_address(Task *task, uintptr_t address)
 
 bool task_memory_mapping_colides(Task *task, uintptr_t address, size_t size)
 {
-    list_foreach(MemoryMapping, memory_mapping, task->memory_mapping)
+    return memory_region_tree_overlap(&task->memory_mappings, address, size) != nullptr;
+}
+
+bool task_memory_is_writable(Task *task, uintptr_t address, size_t size)
+{
+    AtomicHolder holder;
+
+    uintptr_t end = address + size;
+
+    while (address < end)
     {
-        if (address < memory_mapping->address + memory_mapping->size &&
-            address + size > memory_mapping->address)
+        MemoryRegion *region = memory_region_tree_lookup(&task->memory_mappings, address);
+
+        if (!region)
         {
-            return true;
+            uintptr_t next = PAGE_ALIGN_DOWN(address) + ARCH_PAGE_SIZE;
+
+            // The end of the address space.
+            if (next < address)
+            {
+                break;
+            }
+
+            address = next;
+            continue;
+        }
+
+        if (static_cast<MemoryMapping *>(region)->type == MEMORY_MAPPING_READONLY)
+        {
+            return false;
         }
+
+        address = region->address + region->size;
     }
 
-    return false;
+    return true;
+}
+
+bool task_memory_handle_page_fault(Task *task, uintptr_t address, bool write)
+{
+    AtomicHolder holder;
+
+    MemoryRegion *region = memory_region_tree_lookup(&task->memory_mappings, address);
+
+    if (!region)
+    {
+        return false;
+    }
+
+    return task_memory_mapping_fault_in(task, static_cast<MemoryMapping *>(region), address, write);
+}
+
+void task_memory_populate(Task *task, uintptr_t address, size_t size)
+{
+    AtomicHolder holder;
+
+    for (uintptr_t page = address - address % ARCH_PAGE_SIZE; page < address + size; page += ARCH_PAGE_SIZE)
+    {
+        MemoryRegion *region = memory_region_tree_lookup(&task->memory_mappings, page);
+
+        if (region)
+        {
+            task_memory_mapping_fault_in(task, static_cast<MemoryMapping *>(region), page, true);
+        }
+    }
+}
+
+// Only pages of the task's own anonymous memory can change hands, others are
+// seen by other tasks or belong to a file.
+static MemoryMapping *task_memory_page_owner(Task *task, uintptr_t address, size_t *out_index)
+{
+    MemoryRegion *region = memory_region_tree_lookup(&task->memory_mappings, address);
+
+    if (!region || address % ARCH_PAGE_SIZE)
+    {
+        return nullptr;
+    }
+
+    MemoryMapping *memory_mapping = static_cast<MemoryMapping *>(region);
+
+    if (memory_mapping->type != MEMORY_MAPPING_SHARED ||
+        memory_mapping->object->identity() ||
+        memory_mapping->object->refcount != 1)
+    {
+        return nullptr;
+    }
+
+    *out_index = (memory_mapping->offset + address - memory_mapping->address) / ARCH_PAGE_SIZE;
+
+    return memory_mapping;
+}
+
+uintptr_t task_memory_page_take(Task *task, uintptr_t address)
+{
+    AtomicHolder holder;
+
+    size_t index = 0;
+    MemoryMapping *memory_mapping = task_memory_page_owner(task, address, &index);
+
+    if (!memory_mapping)
+    {
+        return 0;
+    }
+
+    uintptr_t page = memory_object_take_page(memory_mapping->object, index);
+
+    if (page && virtual_present(task->pdir, address))
+    {
+        virtual_free(task->pdir, MemoryRange{address, ARCH_PAGE_SIZE});
+
+        memory_mapping->resident -= ARCH_PAGE_SIZE;
+        task->memory_resident -= ARCH_PAGE_SIZE;
+    }
+
+    return page;
+}
+
+bool task_memory_page_give(Task *task, uintptr_t address, uintptr_t page)
+{
+    AtomicHolder holder;
+
+    size_t index = 0;
+    MemoryMapping *memory_mapping = task_memory_page_owner(task, address, &index);
+
+    if (!memory_mapping || !memory_object_give_page(memory_mapping->object, index, page))
+    {
+        return false;
+    }
+
+    bool present = virtual_present(task->pdir, address);
+
+    if (task_memory_mapping_map_page(task, page, address, MEMORY_NONE) != SUCCESS)
+    {
+        // The object has it, it will be mapped by the next fault.
+        if (present)
+        {
+            virtual_free(task->pdir, MemoryRange{address, ARCH_PAGE_SIZE});
+
+            memory_mapping->resident -= ARCH_PAGE_SIZE;
+            task->memory_resident -= ARCH_PAGE_SIZE;
+        }
+
+        return true;
+    }
+
+    if (!present)
+    {
+        memory_mapping->resident += ARCH_PAGE_SIZE;
+        task->memory_resident += ARCH_PAGE_SIZE;
+    }
+
+    return true;
 }
 
 /* --- User facing API ------------------------------------------------------ */
@@ -82,6 +381,11 @@ Result task_memory_alloc(Task *task, size_t size, uintptr_t *out_address)
 
     memory_object_deref(memory_object);
 
+    if (!memory_mapping)
+    {
+        return ERR_OUT_OF_MEMORY;
+    }
+
     *out_address = memory_mapping->address;
 
     return SUCCESS;
@@ -89,21 +393,22 @@ Result task_memory_alloc(Task *task, size_t size, uintptr_t *out_address)
 
 Result task_memory_map(Task *task, uintptr_t address, size_t size, MemoryFlags flags)
 {
-    if (task_memory_mapping_colides(task, address, size))
+    if (address < task->memory_mappings.begin ||
+        address + size > task->memory_mappings.end ||
+        task_memory_mapping_colides(task, address, size))
     {
         return ERR_BAD_ADDRESS;
     }
 
     MemoryObject *memory_object = memory_object_create(size);
 
-    task_memory_mapping_create_at(task, memory_object, address);
+    task_memory_mapping_create_at(task, memory_object, address, 0, memory_object->size(), MEMORY_MAPPING_SHARED);
 
     memory_object_deref(memory_object);
 
-    if (flags & MEMORY_CLEAR)
-    {
-        memset((void *)address, 0, size);
-    }
+    // Pages are zero-filled when they are first touched, so MEMORY_CLEAR
+    // comes for free.
+    __unused(flags);
 
     return SUCCESS;
 }
@@ -135,12 +440,70 @@ Result task_memory_include(Task *task, int handle, uintptr_t *out_address, size_
 
     memory_object_deref(memory_object);
 
+    if (!memory_mapping)
+    {
+        return ERR_OUT_OF_MEMORY;
+    }
+
     *out_address = memory_mapping->address;
     *out_size = memory_mapping->size;
 
     return SUCCESS;
 }
 
+Result task_memory_map_file(Task *task, FsHandle *handle, uintptr_t *out_address, size_t *out_size)
+{
+    if (handle->node->type != FILE_TYPE_REGULAR)
+    {
+        return ERR_INAPPROPRIATE_CALL_FOR_DEVICE;
+    }
+
+    if (!handle->has_flag(OPEN_READ))
+    {
+        return ERR_WRITE_ONLY_STREAM;
+    }
+
+    *out_address = 0;
+    *out_size = handle->node->size ? handle->node->size(handle->node, handle) : 0;
+
+    // There would be nothing to map, and no address to give back.
+    if (*out_size == 0)
+    {
+        return ERR_INVALID_ARGUMENT;
+    }
+
+    MemoryObject *memory_object = page_cache_acquire(handle);
+
+    Result result = page_cache_fill(memory_object, handle, 0, memory_object->size());
+
+    // The pages could have been cached while the file was still empty.
+    if (result == SUCCESS && memory_object->size() == 0)
+    {
+        result = ERR_INVALID_ARGUMENT;
+    }
+
+    if (result == SUCCESS)
+    {
+        AtomicHolder holder;
+
+        uintptr_t address = memory_region_tree_find_free(&task->memory_mappings, memory_object->size());
+
+        if (address)
+        {
+            task_memory_mapping_create_at(task, memory_object, address, 0, memory_object->size(), MEMORY_MAPPING_READONLY);
+            *out_address = address;
+        }
+        else
+        {
+            result = ERR_OUT_OF_MEMORY;
+        }
+    }
+
+    memory_object_deref(memory_object);
+
+    return result;
+}
+
 Result task_memory_get_handle(Task *task, uintptr_t address, int *out_handle)
 {
     MemoryMapping *memory_mapping = task_memory_mapping_by_address(task, address);
@@ -167,12 +530,10 @@ PageDirectory *task_switch_pdir(Task *task, PageDirectory *pdir)
 
 size_t task_memory_usage(Task *task)
 {
-    size_t total = 0;
-
-    list_foreach(MemoryMapping, memory_mapping, task->memory_mapping)
-    {
-        total += memory_mapping->size;
-    }
+    return task->memory_mappings.size;
+}
 
-    return total;
+size_t task_memory_resident(Task *task)
+{
+    return task->memory_resident;
 }
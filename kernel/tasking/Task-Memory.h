@@ -1,22 +1,71 @@
 #pragma once
 
 #include "kernel/memory/MemoryObject.h"
+#include "kernel/node/Handle.h"
 #include "kernel/tasking/Task.h"
 
-struct MemoryMapping
+enum MemoryMappingType
+{
+    // Reads and writes go to the object.
+    MEMORY_MAPPING_SHARED,
+    // Reads go to the object, writes fault.
+    MEMORY_MAPPING_READONLY,
+    // Reads go to the object until a page is written to, then the task
+    // gets its own copy of it.
+    MEMORY_MAPPING_PRIVATE,
+};
+
+// Lives in Task::memory_mappings, MemoryRegion::address and
+// MemoryRegion::size are where the object is mapped.
+struct MemoryMapping : public MemoryRegion
 {
     MemoryObject *object;
+    size_t offset; // Where the mapping starts in the object.
+
+    MemoryMappingType type;
+    MemoryObject *copy; // Pages written to by a MEMORY_MAPPING_PRIVATE mapping.
 
-    uintptr_t address;
-    size_t size;
+    size_t resident; // Bytes actually mapped in the task.
 };
 
 MemoryMapping *task_memory_mapping_create(Task *task, MemoryObject *memory_object);
 
+MemoryMapping *task_memory_mapping_create_at(
+    Task *task,
+    MemoryObject *memory_object,
+    uintptr_t address,
+    size_t offset,
+    size_t size,
+    MemoryMappingType type);
+
 void task_memory_mapping_destroy(Task *task, MemoryMapping *memory_mapping);
 
 MemoryMapping *task_memory_mapping_by_address(Task *task, uintptr_t address);
 
+bool task_memory_mapping_colides(Task *task, uintptr_t address, size_t size);
+
+// Whether [address, address + size) can be written to without a fault
+// nothing would fix, the kernel checks before writing there for the task.
+bool task_memory_is_writable(Task *task, uintptr_t address, size_t size);
+
+// Map the page behind a fault on address, or copy it if it was a write to a
+// copy-on-write page. Returns false if the fault wasn't caused by either.
+bool task_memory_handle_page_fault(Task *task, uintptr_t address, bool write);
+
+// Fault in the pages of [address, address + size) ready to be written to, for
+// when the kernel writes to the memory of a task from another task, the page
+// directory of the task has to be the current one.
+void task_memory_populate(Task *task, uintptr_t address, size_t size);
+
+// Take the page mapped at address out of the task, the task sees a fresh
+// zeroed page the next time it touches it. Returns 0 if the page can't be
+// taken, because it's shared with someone else or was never touched.
+uintptr_t task_memory_page_take(Task *task, uintptr_t address);
+
+// Map page at address in place of the page there, the task owns it from now
+// on. Returns false if the page can't be replaced, then the caller still owns it.
+bool task_memory_page_give(Task *task, uintptr_t address, uintptr_t page);
+
 Result task_memory_alloc(Task *task, size_t size, uintptr_t *out_address);
 
 Result task_memory_map(Task *task, uintptr_t address, size_t size, MemoryFlags flags);
@@ -25,8 +74,16 @@ Result task_memory_free(Task *task, uintptr_t address);
 
 Result task_memory_include(Task *task, int handle, uintptr_t *out_address, size_t *out_size);
 
+// Map the content of a file read-only, the pages come from the page cache so
+// every task mapping the same file shares them.
+Result task_memory_map_file(Task *task, FsHandle *handle, uintptr_t *out_address, size_t *out_size);
+
 Result task_memory_get_handle(Task *task, uintptr_t address, int *out_handle);
 
 PageDirectory *task_switch_pdir(Task *task, PageDirectory *pdir);
 
-size_t task_memory_usage(Task *task);
\ No newline at end of file
+// Bytes of address space reserved by the task.
+size_t task_memory_usage(Task *task);
+
+// Bytes of memory actually backing the task.
+size_t task_memory_resident(Task *task);
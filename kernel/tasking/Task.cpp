@@ -39,8 +39,8 @@ Task *task_create(Task *parent, const char *name, bool user)
         task->pdir = memory_kpdir();
     }
 
-    // Setup shms
-    task->memory_mapping = list_create();
+    // Setup shms, they go between the first gigabyte (kernel space) and the top of the user stack.
+    memory_region_tree_initialize(&task->memory_mappings, 0x40000000, 0xff000000 + PROCESS_STACK_SIZE);
 
     // Setup current working directory.
     lock_init(task->directory_lock);
@@ -66,7 +66,15 @@ Task *task_create(Task *parent, const char *name, bool user)
     memory_alloc(task->pdir, PROCESS_STACK_SIZE, MEMORY_CLEAR, (uintptr_t *)&task->kernel_stack);
     task->kernel_stack_pointer = ((uintptr_t)task->kernel_stack + PROCESS_STACK_SIZE);
 
-    memory_map(task->pdir, MemoryRange(0xff000000, PROCESS_STACK_SIZE), MEMORY_USER);
+    if (user)
+    {
+        task_memory_map(task, 0xff000000, PROCESS_STACK_SIZE, MEMORY_CLEAR);
+    }
+    else
+    {
+        memory_map(task->pdir, MemoryRange(0xff000000, PROCESS_STACK_SIZE), MEMORY_USER);
+    }
+
     task->user_stack_pointer = 0xff000000 + PROCESS_STACK_SIZE;
     task->user_stack = (void *)0xff000000;
 
@@ -88,21 +96,21 @@ void task_destroy(Task *task)
 
     atomic_end();
 
-    MemoryMapping *mapping = nullptr;
-
-    while ((mapping = (MemoryMapping *)list_peek(task->memory_mapping)))
+    while (task->memory_mappings.root)
     {
-        task_memory_mapping_destroy(task, mapping);
+        task_memory_mapping_destroy(task, static_cast<MemoryMapping *>(task->memory_mappings.root));
     }
 
-    list_destroy(task->memory_mapping);
-
     task_fshandle_close_all(task);
 
     path_destroy(task->directory);
 
     memory_free(task->pdir, (MemoryRange){(uintptr_t)task->kernel_stack, PROCESS_STACK_SIZE});
-    memory_free(task->pdir, (MemoryRange){(uintptr_t)task->user_stack, PROCESS_STACK_SIZE});
+
+    if (task->pdir == memory_kpdir())
+    {
+        memory_free(task->pdir, (MemoryRange){(uintptr_t)task->user_stack, PROCESS_STACK_SIZE});
+    }
 
     if (task->pdir != memory_kpdir())
     {
@@ -240,6 +248,7 @@ uintptr_t task_kernel_stack_push(Task *task, const void *value, size_t size)
 uintptr_t task_user_stack_push(Task *task, const void *value, size_t size)
 {
     task->user_stack_pointer -= size;
+    task_memory_populate(task, task->user_stack_pointer, size);
     memcpy((void *)task->user_stack_pointer, value, size);
     return task->user_stack_pointer;
 }
@@ -289,23 +298,33 @@ void task_go(Task *task)
 
 Result task_sleep(Task *task, int timeout)
 {
-    task_block(task, new BlockerTime(system_get_tick() + timeout), -1);
+    task_block(task, new BlockerTime(system_get_tick() + timeout), timeout);
 
     return TIMEOUT;
 }
 
 Result task_wait(int task_id, int *exit_value)
 {
-    AtomicHolder holder;
+    {
+        AtomicHolder holder;
 
-    Task *task = task_by_id(task_id);
+        Task *task = task_by_id(task_id);
 
-    if (!task)
-    {
-        return ERR_NO_SUCH_TASK;
+        if (!task)
+        {
+            return ERR_NO_SUCH_TASK;
+        }
+
+        if (task->state == TASK_STATE_CANCELED)
+        {
+            *exit_value = task->exit_value;
+            return SUCCESS;
+        }
     }
 
-    task_block(scheduler_running(), new BlockerWait(task, exit_value), -1);
+    // Not while holding the lock, the next task on this processor would
+    // inherit it. The blocker looks the task up again under the lock.
+    task_block(scheduler_running(), new BlockerWait(task_id, exit_value), -1);
 
     return SUCCESS;
 }
@@ -328,6 +347,19 @@ BlockerResult task_block(Task *task, Blocker *blocker, Timeout timeout)
         return BLOCKER_UNBLOCKED;
     }
 
+    // Only asking, no need to wait for the next tick to say it's not ready.
+    if (timeout == 0)
+    {
+        blocker->on_timeout(task);
+
+        atomic_end();
+
+        task->blocker = nullptr;
+        delete blocker;
+
+        return BLOCKER_TIMEOUT;
+    }
+
     if (timeout == (Timeout)-1)
     {
         blocker->_timeout = (Timeout)-1;
@@ -359,6 +391,8 @@ Result task_cancel(Task *task, int exit_value)
     task->exit_value = exit_value;
     task_set_state(task, TASK_STATE_CANCELED);
 
+    task->waiters.wakeup();
+
     return SUCCESS;
 }
 
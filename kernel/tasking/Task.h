@@ -6,7 +6,9 @@
 #include <libsystem/utils/List.h>
 
 #include "kernel/memory/Memory.h"
+#include "kernel/memory/MemoryRegion.h"
 #include "kernel/scheduling/Blocker.h"
+#include "kernel/scheduling/WaitQueue.h"
 
 typedef void (*TaskEntry)();
 
@@ -19,6 +21,13 @@ struct Task
     TaskState state;
     Blocker *blocker;
 
+    // Scheduler bookkeeping, see kernel/scheduling/Scheduler.cpp
+    Task *scheduler_prev;
+    Task *scheduler_next;
+    int priority;
+    int time_slice;
+    int processor;
+
     uintptr_t user_stack_pointer;
     void *user_stack;
 
@@ -34,10 +43,17 @@ struct Task
     Lock directory_lock;
     Path *directory;
 
-    List *memory_mapping;
+    MemoryRegionTree memory_mappings;
+    size_t memory_resident;
     PageDirectory *pdir; // Page directory
 
     int exit_value;
+
+    // How many times it trapped into the kernel.
+    size_t syscalls;
+
+    // Tasks waiting for this one to exit.
+    WaitQueue waiters;
 };
 
 Task *task_create(Task *parent, const char *name, bool user);
@@ -7,7 +7,8 @@ static Iteration destroy_task_if_canceled(void *target, Task *task)
 {
     __unused(target);
 
-    if (task->state == TASK_STATE_CANCELED)
+    // A canceled task may still be on its way out on another processor.
+    if (task->state == TASK_STATE_CANCELED && !scheduler_is_on_processor(task))
     {
         task_destroy(task);
     }
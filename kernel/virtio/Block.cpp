@@ -1,4 +1,153 @@
-#include <kernel/virtio/Block.h>
+#include <libsystem/Logger.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "kernel/devices/Disk.h"
+#include "kernel/interrupts/Dispatcher.h"
+#include "kernel/memory/Memory.h"
+#include "kernel/virtio/Block.h"
+
+// 5.2 Block Device
+
+#define VIRTIO_BLOCK_FEATURE_SEGMENTS_MAX (1 << 2)
+
+#define VIRTIO_BLOCK_CONFIG_CAPACITY (0)
+#define VIRTIO_BLOCK_CONFIG_SEGMENTS_MAX (12)
+
+#define VIRTIO_BLOCK_REQUEST_IN (0)
+#define VIRTIO_BLOCK_REQUEST_OUT (1)
+
+#define VIRTIO_BLOCK_STATUS_OK (0)
+
+// More requests in flight don't make the device any faster.
+#define VIRTIO_BLOCK_MAX_IN_FLIGHT (32)
+
+struct __packed VirtioBlockHeader
+{
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+};
+
+// What the device reads and writes around the data of a request.
+struct VirtioBlockSlot
+{
+    VirtioBlockHeader header;
+    uint8_t status;
+
+    DiskRequest *request;
+};
+
+struct VirtioBlock
+{
+    VirtioDevice device;
+    Virtqueue *queue;
+    Disk disk;
+
+    // Identity mapped, the device is given their physical address.
+    VirtioBlockSlot *slots;
+    size_t slots_count;
+
+    VirtioBlock *next;
+};
+
+static VirtioBlock *_devices = nullptr;
+
+static VirtioBlockSlot *virtio_block_slot_alloc(VirtioBlock *block)
+{
+    for (size_t i = 0; i < block->slots_count; i++)
+    {
+        if (!block->slots[i].request)
+        {
+            return &block->slots[i];
+        }
+    }
+
+    return nullptr;
+}
+
+static bool virtio_block_submit(Disk *disk, DiskRequest *request)
+{
+    VirtioBlock *block = (VirtioBlock *)disk->driver;
+    VirtioBlockSlot *slot = virtio_block_slot_alloc(block);
+
+    if (!slot)
+    {
+        return false;
+    }
+
+    slot->header.type = request->type == DISK_READ ? VIRTIO_BLOCK_REQUEST_IN : VIRTIO_BLOCK_REQUEST_OUT;
+    slot->header.reserved = 0;
+    slot->header.sector = request->sector;
+    slot->status = 0xFF;
+
+    VirtqueueBuffer buffers[DISK_REQUEST_SEGMENTS + 2];
+    size_t count = 0;
+
+    buffers[count++] = (VirtqueueBuffer){(uintptr_t)&slot->header, sizeof(VirtioBlockHeader), false};
+
+    for (size_t i = 0; i < request->segment_count; i++)
+    {
+        DiskSegment *segment = &request->segments[i];
+        buffers[count++] = (VirtqueueBuffer){segment->address, segment->size, request->type == DISK_READ};
+    }
+
+    buffers[count++] = (VirtqueueBuffer){(uintptr_t)&slot->status, sizeof(uint8_t), true};
+
+    if (!virtqueue_push(block->queue, buffers, count, slot))
+    {
+        return false;
+    }
+
+    slot->request = request;
+
+    return true;
+}
+
+static void virtio_block_notify(Disk *disk)
+{
+    VirtioBlock *block = (VirtioBlock *)disk->driver;
+
+    if (virtqueue_should_notify(block->queue))
+    {
+        virtio_device_notify(&block->device, 0);
+    }
+}
+
+static void virtio_block_interrupt_handler()
+{
+    AtomicHolder holder;
+
+    for (VirtioBlock *block = _devices; block; block = block->next)
+    {
+        virtio_device_interrupt_status(&block->device);
+
+        void *cookie = nullptr;
+
+        while (virtqueue_pop(block->queue, &cookie, nullptr))
+        {
+            VirtioBlockSlot *slot = (VirtioBlockSlot *)cookie;
+            DiskRequest *request = slot->request;
+
+            slot->request = nullptr;
+
+            disk_complete(&block->disk, request, slot->status == VIRTIO_BLOCK_STATUS_OK ? SUCCESS : ERR_INPUT_OUTPUT_ERROR);
+        }
+    }
+}
+
+static bool virtio_block_handles_interrupt(int interrupt)
+{
+    for (VirtioBlock *block = _devices; block; block = block->next)
+    {
+        if (block->device.interrupt == interrupt)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
 
 bool virtio_block_match(DeviceInfo info)
 {
@@ -7,5 +156,73 @@ bool virtio_block_match(DeviceInfo info)
 
 void virtio_block_initialize(DeviceInfo info)
 {
-    __unused(info);
+    VirtioBlock *block = __create(VirtioBlock);
+    VirtioDevice *device = &block->device;
+
+    virtio_device_initialize(device, info);
+    virtio_device_negotiate(device, VIRTIO_BLOCK_FEATURE_SEGMENTS_MAX);
+
+    block->queue = virtio_device_setup_queue(device, 0);
+
+    uintptr_t slots = 0;
+
+    if (block->queue == nullptr ||
+        block->queue->size < 3 ||
+        memory_alloc_identity(memory_kpdir(), MEMORY_CLEAR, &slots) != SUCCESS)
+    {
+        virtio_device_failed(device);
+
+        if (block->queue)
+        {
+            virtqueue_destroy(block->queue);
+        }
+
+        free(block);
+        return;
+    }
+
+    // Requests are their segments between a header and a status.
+    size_t max_segments = MIN(DISK_REQUEST_SEGMENTS, block->queue->size - 2);
+
+    if (device->features & VIRTIO_BLOCK_FEATURE_SEGMENTS_MAX)
+    {
+        max_segments = MIN(max_segments, virtio_device_read_config32(device, VIRTIO_BLOCK_CONFIG_SEGMENTS_MAX));
+    }
+
+    max_segments = MAX(max_segments, 1);
+
+    block->slots = (VirtioBlockSlot *)slots;
+    block->slots_count = MIN(block->queue->size / virtqueue_chain_cost(block->queue, max_segments + 2), VIRTIO_BLOCK_MAX_IN_FLIGHT);
+    block->slots_count = MIN(block->slots_count, ARCH_PAGE_SIZE / sizeof(VirtioBlockSlot));
+
+    Disk *disk = &block->disk;
+
+    disk->sector_count = virtio_device_read_config64(device, VIRTIO_BLOCK_CONFIG_CAPACITY);
+    disk->driver = block;
+    disk->submit = virtio_block_submit;
+    disk->notify = virtio_block_notify;
+    disk->max_segments = max_segments;
+    disk->max_in_flight = block->slots_count;
+
+    {
+        AtomicHolder holder;
+
+        if (!virtio_block_handles_interrupt(device->interrupt))
+        {
+            dispatcher_register_handler(device->interrupt, virtio_block_interrupt_handler);
+        }
+
+        block->next = _devices;
+        _devices = block;
+    }
+
+    virtio_device_ready(device);
+
+    disk_register(disk);
+
+    logger_info("Disk %d: %d sectors, %d requests of %d segments in flight",
+                disk->id,
+                (int)disk->sector_count,
+                (int)disk->max_in_flight,
+                (int)disk->max_segments);
 }
@@ -1,5 +1,161 @@
+#include <abi/Paths.h>
+#include <libsystem/Logger.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/math/MinMax.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "kernel/filesystem/Filesystem.h"
+#include "kernel/interrupts/Dispatcher.h"
+#include "kernel/memory/Memory.h"
 #include "kernel/virtio/Entropy.h"
 
+// 5.4 Entropy Device
+
+#define ENTROPY_BUFFER_COUNT (16)
+
+// Filled by the device then handed out to readers.
+struct EntropyBuffer
+{
+    uint8_t *data;
+    size_t size;
+    size_t offset;
+};
+
+static VirtioDevice _device = {};
+static Virtqueue *_queue = nullptr;
+static FsNode *_node = nullptr;
+
+static EntropyBuffer _buffers[ENTROPY_BUFFER_COUNT] = {};
+static size_t _buffers_count = 0;
+
+// Filled buffers in the order the device gave them back.
+static EntropyBuffer *_ready[ENTROPY_BUFFER_COUNT] = {};
+static size_t _ready_head = 0;
+static size_t _ready_count = 0;
+
+static void entropy_post(EntropyBuffer *buffer)
+{
+    ASSERT_ATOMIC;
+
+    buffer->size = 0;
+    buffer->offset = 0;
+
+    VirtqueueBuffer request = {(uintptr_t)buffer->data, ARCH_PAGE_SIZE, true};
+    virtqueue_push(_queue, &request, 1, buffer);
+}
+
+static void entropy_notify()
+{
+    if (virtqueue_should_notify(_queue))
+    {
+        virtio_device_notify(&_device, 0);
+    }
+}
+
+static void virtio_entropy_interrupt_handler()
+{
+    AtomicHolder holder;
+
+    virtio_device_interrupt_status(&_device);
+
+    void *cookie = nullptr;
+    size_t written = 0;
+    bool reposted = false;
+
+    while (virtqueue_pop(_queue, &cookie, &written))
+    {
+        EntropyBuffer *buffer = (EntropyBuffer *)cookie;
+
+        if (written == 0)
+        {
+            entropy_post(buffer);
+            reposted = true;
+            continue;
+        }
+
+        buffer->size = MIN(written, ARCH_PAGE_SIZE);
+        _ready[(_ready_head + _ready_count) % ENTROPY_BUFFER_COUNT] = buffer;
+        _ready_count++;
+    }
+
+    if (reposted)
+    {
+        entropy_notify();
+    }
+
+    _node->waiters.wakeup();
+}
+
+class EntropyDevice : public FsNode
+{
+private:
+public:
+    EntropyDevice() : FsNode(FILE_TYPE_DEVICE)
+    {
+    }
+
+    bool can_read(FsHandle *handle)
+    {
+        __unused(handle);
+
+        return _ready_count > 0;
+    }
+
+    ResultOr<size_t> read(FsHandle &handle, void *buffer, size_t size)
+    {
+        __unused(handle);
+
+        size_t done = 0;
+
+        while (done < size)
+        {
+            EntropyBuffer *ready = nullptr;
+
+            {
+                AtomicHolder holder;
+
+                if (_ready_count == 0)
+                {
+                    break;
+                }
+
+                ready = _ready[_ready_head];
+            }
+
+            // We hold the node lock so nobody else takes from the ready
+            // buffers, but the copy can fault so do it outside of atomic.
+            size_t chunk = MIN(ready->size - ready->offset, size - done);
+            memcpy((uint8_t *)buffer + done, ready->data + ready->offset, chunk);
+
+            ready->offset += chunk;
+            done += chunk;
+
+            if (ready->offset == ready->size)
+            {
+                AtomicHolder holder;
+
+                _ready_head = (_ready_head + 1) % ENTROPY_BUFFER_COUNT;
+                _ready_count--;
+
+                entropy_post(ready);
+            }
+        }
+
+        AtomicHolder holder;
+        entropy_notify();
+
+        return done;
+    }
+
+    ResultOr<size_t> write(FsHandle &handle, const void *buffer, size_t size)
+    {
+        __unused(handle);
+        __unused(buffer);
+
+        return size;
+    }
+};
+
 bool virtio_entropy_match(DeviceInfo info)
 {
     return virtio_is_specific_virtio_device(info, VIRTIO_DEVICE_ENTROPY);
@@ -7,5 +163,53 @@ bool virtio_entropy_match(DeviceInfo info)
 
 void virtio_entropy_initialize(DeviceInfo info)
 {
-    __unused(info);
+    if (_queue)
+    {
+        logger_warn("Only one virtIO entropy source is supported");
+        return;
+    }
+
+    virtio_device_initialize(&_device, info);
+    virtio_device_negotiate(&_device, 0);
+
+    _queue = virtio_device_setup_queue(&_device, 0);
+
+    if (_queue == nullptr)
+    {
+        virtio_device_failed(&_device);
+        return;
+    }
+
+    for (size_t i = 0; i < MIN(ENTROPY_BUFFER_COUNT, _queue->size); i++)
+    {
+        uintptr_t page = 0;
+
+        if (memory_alloc_identity(memory_kpdir(), MEMORY_NONE, &page) != SUCCESS)
+        {
+            break;
+        }
+
+        _buffers[i].data = (uint8_t *)page;
+        _buffers_count++;
+    }
+
+    _node = new EntropyDevice();
+
+    dispatcher_register_handler(_device.interrupt, virtio_entropy_interrupt_handler);
+    virtio_device_ready(&_device);
+
+    {
+        AtomicHolder holder;
+
+        // Ask for all of it at once, the device fills them back to back.
+        for (size_t i = 0; i < _buffers_count; i++)
+        {
+            entropy_post(&_buffers[i]);
+        }
+
+        entropy_notify();
+    }
+
+    // Takes the place of the pseudo random device, see random_initialize().
+    filesystem_link_cstring(UNIX_DEVICE_PATH("random"), _node);
 }
@@ -3,6 +3,8 @@
 #include "kernel/bus/PCI.h"
 #include "kernel/virtio/Virtio.h"
 
+static VirtioDevice _device = {};
+
 bool virtio_network_match(DeviceInfo info)
 {
     return virtio_is_specific_virtio_device(info, VIRTIO_DEVICE_NETWORK);
@@ -10,5 +12,5 @@ bool virtio_network_match(DeviceInfo info)
 
 void virtio_network_initialize(DeviceInfo info)
 {
-    virtio_device_initialize(info);
+    virtio_device_initialize(&_device, info);
 }
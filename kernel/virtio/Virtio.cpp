@@ -1,11 +1,115 @@
 #include <libsystem/Logger.h>
 
+#include "arch/x86/x86.h"
 #include "kernel/bus/PCI.h"
 #include "kernel/virtio/Virtio.h"
 
-void virtio_device_initialize(DeviceInfo info)
+#define PCI_COMMAND_IO_SPACE (1 << 0)
+#define PCI_COMMAND_BUS_MASTER (1 << 2)
+
+static void virtio_device_set_status(VirtioDevice *device, uint8_t status)
+{
+    out8(device->io_base + VIRTIO_REGISTER_DEVICE_STATUS, status);
+}
+
+static void virtio_device_add_status(VirtioDevice *device, uint8_t status)
+{
+    uint8_t current = in8(device->io_base + VIRTIO_REGISTER_DEVICE_STATUS);
+    virtio_device_set_status(device, current | status);
+}
+
+void virtio_device_initialize(VirtioDevice *device, DeviceInfo info)
 {
     logger_info("Initializing virtIO device %s", device_to_static_string(info));
+
+    device->info = info;
+    device->io_base = pci_device_read_bar(info.pci_device, 0) & 0xFFFFFFFC;
+    device->interrupt = pci_device_get_interrupt(info.pci_device);
+    device->features = 0;
+
+    // The device reads and writes the rings on its own.
+    uint32_t command = pci_device_read(info.pci_device, PCI_COMMAND, 2);
+    pci_device_write(info.pci_device, PCI_COMMAND, 2, command | PCI_COMMAND_IO_SPACE | PCI_COMMAND_BUS_MASTER);
+
+    virtio_device_set_status(device, 0);
+    virtio_device_add_status(device, VIRTIO_STATUS_ACKNOWLEDGE);
+    virtio_device_add_status(device, VIRTIO_STATUS_DRIVER);
+}
+
+uint32_t virtio_device_negotiate(VirtioDevice *device, uint32_t supported)
+{
+    uint32_t offered = in32(device->io_base + VIRTIO_REGISTER_DEVICE_FEATURES);
+
+    device->features = offered & (supported | VIRTIO_FEATURE_RING);
+    out32(device->io_base + VIRTIO_REGISTER_GUEST_FEATURES, device->features);
+
+    return device->features;
+}
+
+Virtqueue *virtio_device_setup_queue(VirtioDevice *device, uint16_t index)
+{
+    out16(device->io_base + VIRTIO_REGISTER_QUEUE_SELECT, index);
+
+    // Legacy devices choose the size of their queues.
+    uint16_t size = in16(device->io_base + VIRTIO_REGISTER_QUEUE_SIZE);
+
+    if (size == 0)
+    {
+        return nullptr;
+    }
+
+    Virtqueue *queue = virtqueue_create(size, device->features);
+
+    out32(device->io_base + VIRTIO_REGISTER_QUEUE_ADDRESS, virtqueue_physical_address(queue) / ARCH_PAGE_SIZE);
+
+    return queue;
+}
+
+void virtio_device_ready(VirtioDevice *device)
+{
+    virtio_device_add_status(device, VIRTIO_STATUS_DRIVER_OK);
+}
+
+void virtio_device_failed(VirtioDevice *device)
+{
+    logger_error("VirtIO device %s failed", device_to_static_string(device->info));
+
+    virtio_device_add_status(device, VIRTIO_STATUS_FAILED);
+}
+
+void virtio_device_notify(VirtioDevice *device, uint16_t queue)
+{
+    out16(device->io_base + VIRTIO_REGISTER_QUEUE_NOTIFY, queue);
+}
+
+uint8_t virtio_device_interrupt_status(VirtioDevice *device)
+{
+    return in8(device->io_base + VIRTIO_REGISTER_ISR_STATUS);
+}
+
+uint8_t virtio_device_read_config8(VirtioDevice *device, size_t offset)
+{
+    return in8(device->io_base + VIRTIO_REGISTER_CONFIG + offset);
+}
+
+uint32_t virtio_device_read_config32(VirtioDevice *device, size_t offset)
+{
+    return in32(device->io_base + VIRTIO_REGISTER_CONFIG + offset);
+}
+
+uint64_t virtio_device_read_config64(VirtioDevice *device, size_t offset)
+{
+    // There is no atomic 64bit access, read until both halves agree.
+    uint32_t low;
+    uint32_t high;
+
+    do
+    {
+        high = virtio_device_read_config32(device, offset + 4);
+        low = virtio_device_read_config32(device, offset);
+    } while (high != virtio_device_read_config32(device, offset + 4));
+
+    return ((uint64_t)high << 32) | low;
 }
 
 bool virtio_is_virtio_device(DeviceInfo info)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "kernel/devices/Devices.h"
+#include "kernel/virtio/Virtqueue.h"
 
 // 2.1 Device Status Field
 
@@ -20,13 +21,53 @@
 #define VIRTIO_REGISTER_DEVICE_STATUS (0x12)
 #define VIRTIO_REGISTER_ISR_STATUS (0x13)
 
+// Device specific configuration, when MSI-X is disabled.
+#define VIRTIO_REGISTER_CONFIG (0x14)
+
+#define VIRTIO_ISR_QUEUE (1)
+#define VIRTIO_ISR_CONFIG (2)
+
 #define VIRTIO_DEVICE_NETWORK (1)
 #define VIRTIO_DEVICE_BLOCK (2)
 #define VIRTIO_DEVICE_CONSOLE (3)
 #define VIRTIO_DEVICE_ENTROPY (4)
 #define VIRTIO_DEVICE_GRAPHICS (16)
 
-void virtio_device_initialize(DeviceInfo info);
+// A device behind the legacy PCI transport, the only one QEMU
+// exposes for transitional devices on a machine without MSI-X.
+struct VirtioDevice
+{
+    DeviceInfo info;
+    uint16_t io_base;
+    int interrupt;
+    uint32_t features;
+};
+
+// Reset the device and tell it we found it and know how to drive it.
+void virtio_device_initialize(VirtioDevice *device, DeviceInfo info);
+
+// Accept the features we support among the ones the device offers, the
+// virtqueues take care of the VIRTIO_FEATURE_RING ones.
+uint32_t virtio_device_negotiate(VirtioDevice *device, uint32_t supported);
+
+// Must come after virtio_device_negotiate(), returns nullptr if the
+// device doesn't have a queue at index.
+Virtqueue *virtio_device_setup_queue(VirtioDevice *device, uint16_t index);
+
+void virtio_device_ready(VirtioDevice *device);
+
+void virtio_device_failed(VirtioDevice *device);
+
+void virtio_device_notify(VirtioDevice *device, uint16_t queue);
+
+// Reading the ISR status acknowledges the interrupt.
+uint8_t virtio_device_interrupt_status(VirtioDevice *device);
+
+uint8_t virtio_device_read_config8(VirtioDevice *device, size_t offset);
+
+uint32_t virtio_device_read_config32(VirtioDevice *device, size_t offset);
+
+uint64_t virtio_device_read_config64(VirtioDevice *device, size_t offset);
 
 bool virtio_is_virtio_device(DeviceInfo info);
 
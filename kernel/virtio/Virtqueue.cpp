@@ -0,0 +1,259 @@
+#include <libsystem/Assert.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/thread/Atomic.h>
+
+#include "kernel/memory/Physical.h"
+#include "kernel/memory/Virtual.h"
+#include "kernel/virtio/Virtqueue.h"
+
+static size_t virtqueue_used_offset(uint16_t size)
+{
+    size_t descriptors_size = sizeof(VirtqueueDescriptor) * size;
+    size_t available_size = sizeof(uint16_t) * (3 + size);
+
+    // The legacy transport wants the used ring on its own page.
+    return PAGE_ALIGN_UP(descriptors_size + available_size);
+}
+
+size_t virtqueue_layout_size(uint16_t size)
+{
+    size_t used_size = sizeof(uint16_t) * 3 + sizeof(VirtqueueUsedElement) * size;
+
+    return virtqueue_used_offset(size) + PAGE_ALIGN_UP(used_size);
+}
+
+// Written by us, the device interrupts once the used index goes past it.
+static volatile uint16_t *virtqueue_used_event(Virtqueue *queue)
+{
+    // Right after the ring, the flags and the index.
+    return (volatile uint16_t *)((uintptr_t)queue->available + sizeof(uint16_t) * (2 + queue->size));
+}
+
+// Written by the device, it wants to be notified once the available index goes past it.
+static volatile uint16_t *virtqueue_available_event(Virtqueue *queue)
+{
+    return (volatile uint16_t *)&queue->used->ring[queue->size];
+}
+
+// Did the index move past event when it went from old to now?
+static bool virtqueue_need_event(uint16_t event, uint16_t now, uint16_t old)
+{
+    return (uint16_t)(now - event - 1) < (uint16_t)(now - old);
+}
+
+Virtqueue *virtqueue_create(uint16_t size, uint32_t features)
+{
+    AtomicHolder holder;
+
+    Virtqueue *queue = __create(Virtqueue);
+
+    queue->size = size;
+    queue->memory = physical_alloc(virtqueue_layout_size(size));
+
+    uintptr_t base = virtual_alloc(&kpdir, queue->memory, MEMORY_NONE).base();
+    memset((void *)base, 0, queue->memory.size());
+
+    queue->descriptors = (VirtqueueDescriptor *)base;
+    queue->available = (VirtqueueAvailable *)(base + sizeof(VirtqueueDescriptor) * size);
+    queue->used = (VirtqueueUsed *)(base + virtqueue_used_offset(size));
+
+    for (uint16_t i = 0; i < size; i++)
+    {
+        queue->descriptors[i].next = i + 1;
+    }
+
+    queue->free_head = 0;
+    queue->free_count = size;
+    queue->next_available = 0;
+    queue->last_used = 0;
+
+    queue->cookies = (void **)calloc(size, sizeof(void *));
+
+    queue->notified_available = 0;
+    queue->event_index = features & VIRTIO_FEATURE_RING_EVENT_INDEX;
+
+    if (features & VIRTIO_FEATURE_RING_INDIRECT_DESCRIPTORS)
+    {
+        queue->indirect_memory = physical_alloc(PAGE_ALIGN_UP(sizeof(VirtqueueDescriptor) * VIRTQUEUE_INDIRECT_MAX * size));
+        queue->indirect = (VirtqueueDescriptor *)virtual_alloc(&kpdir, queue->indirect_memory, MEMORY_NONE).base();
+    }
+
+    return queue;
+}
+
+void virtqueue_destroy(Virtqueue *queue)
+{
+    AtomicHolder holder;
+
+    virtual_free(&kpdir, MemoryRange{(uintptr_t)queue->descriptors, queue->memory.size()});
+    physical_free(queue->memory);
+
+    if (queue->indirect)
+    {
+        virtual_free(&kpdir, MemoryRange{(uintptr_t)queue->indirect, queue->indirect_memory.size()});
+        physical_free(queue->indirect_memory);
+    }
+
+    free(queue->cookies);
+    free(queue);
+}
+
+uintptr_t virtqueue_physical_address(Virtqueue *queue)
+{
+    return queue->memory.base();
+}
+
+size_t virtqueue_chain_cost(Virtqueue *queue, size_t count)
+{
+    if (queue->indirect && count > 1 && count <= VIRTQUEUE_INDIRECT_MAX)
+    {
+        return 1;
+    }
+
+    return count;
+}
+
+static void virtqueue_fill_descriptor(VirtqueueDescriptor *descriptor, VirtqueueBuffer *buffer, bool has_next)
+{
+    descriptor->address = buffer->address;
+    descriptor->length = buffer->size;
+    descriptor->flags = buffer->writable ? VIRTQUEUE_DESCRIPTOR_WRITE : 0;
+
+    if (has_next)
+    {
+        descriptor->flags |= VIRTQUEUE_DESCRIPTOR_NEXT;
+    }
+}
+
+bool virtqueue_push(Virtqueue *queue, VirtqueueBuffer *buffers, size_t count, void *cookie)
+{
+    assert(count > 0);
+    assert(cookie);
+
+    size_t cost = virtqueue_chain_cost(queue, count);
+
+    if (cost > queue->free_count)
+    {
+        return false;
+    }
+
+    uint16_t head = queue->free_head;
+
+    if (cost == 1 && count > 1)
+    {
+        VirtqueueDescriptor *table = &queue->indirect[head * VIRTQUEUE_INDIRECT_MAX];
+
+        for (size_t i = 0; i < count; i++)
+        {
+            virtqueue_fill_descriptor(&table[i], &buffers[i], i + 1 < count);
+            table[i].next = i + 1;
+        }
+
+        uintptr_t table_offset = (uintptr_t)table - (uintptr_t)queue->indirect;
+
+        VirtqueueDescriptor *descriptor = &queue->descriptors[head];
+        descriptor->address = queue->indirect_memory.base() + table_offset;
+        descriptor->length = sizeof(VirtqueueDescriptor) * count;
+        descriptor->flags = VIRTQUEUE_DESCRIPTOR_INDIRECT;
+
+        queue->free_head = descriptor->next;
+    }
+    else
+    {
+        uint16_t index = head;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            virtqueue_fill_descriptor(&queue->descriptors[index], &buffers[i], i + 1 < count);
+            index = queue->descriptors[index].next;
+        }
+
+        queue->free_head = index;
+    }
+
+    queue->free_count -= cost;
+    queue->cookies[head] = cookie;
+
+    queue->available->ring[queue->next_available % queue->size] = head;
+    queue->next_available++;
+
+    // The device must see the descriptors and the ring entry before the index.
+    __sync_synchronize();
+
+    queue->available->index = queue->next_available;
+
+    return true;
+}
+
+bool virtqueue_should_notify(Virtqueue *queue)
+{
+    // Make sure the device sees the new index before we look at what it wants.
+    __sync_synchronize();
+
+    uint16_t old = queue->notified_available;
+    uint16_t now = queue->next_available;
+
+    queue->notified_available = now;
+
+    if (queue->event_index)
+    {
+        return virtqueue_need_event(*virtqueue_available_event(queue), now, old);
+    }
+
+    return !(queue->used->flags & VIRTQUEUE_USED_NO_NOTIFY);
+}
+
+bool virtqueue_pop(Virtqueue *queue, void **cookie, size_t *written)
+{
+    if (queue->last_used == queue->used->index)
+    {
+        if (!queue->event_index)
+        {
+            return false;
+        }
+
+        *virtqueue_used_event(queue) = queue->last_used;
+
+        // The device may have used a chain before it could see the new
+        // event index, it won't interrupt us for it so look again.
+        __sync_synchronize();
+
+        if (queue->last_used == queue->used->index)
+        {
+            return false;
+        }
+    }
+
+    // Don't read the element before the device is done writing it.
+    __sync_synchronize();
+
+    volatile VirtqueueUsedElement *element = &queue->used->ring[queue->last_used % queue->size];
+    uint16_t head = element->id;
+    size_t length = element->length;
+
+    queue->last_used++;
+
+    // Give the chain back to the free list.
+    uint16_t tail = head;
+    uint16_t count = 1;
+
+    while (queue->descriptors[tail].flags & VIRTQUEUE_DESCRIPTOR_NEXT)
+    {
+        tail = queue->descriptors[tail].next;
+        count++;
+    }
+
+    queue->descriptors[tail].next = queue->free_head;
+    queue->free_head = head;
+    queue->free_count += count;
+
+    *cookie = queue->cookies[head];
+    queue->cookies[head] = nullptr;
+
+    if (written)
+    {
+        *written = length;
+    }
+
+    return true;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+#include "kernel/memory/MemoryRange.h"
+
+// 2.4 Virtqueues, split rings as laid out by the legacy PCI transport.
+
+#define VIRTQUEUE_DESCRIPTOR_NEXT (1)
+#define VIRTQUEUE_DESCRIPTOR_WRITE (2)
+#define VIRTQUEUE_DESCRIPTOR_INDIRECT (4)
+
+#define VIRTQUEUE_USED_NO_NOTIFY (1)
+
+// 6 Reserved Feature Bits, they are about the rings so they are handled here.
+#define VIRTIO_FEATURE_RING_INDIRECT_DESCRIPTORS (1 << 28)
+#define VIRTIO_FEATURE_RING_EVENT_INDEX (1 << 29)
+
+#define VIRTIO_FEATURE_RING (VIRTIO_FEATURE_RING_INDIRECT_DESCRIPTORS | VIRTIO_FEATURE_RING_EVENT_INDEX)
+
+// Longest chain that fits in an indirect table.
+#define VIRTQUEUE_INDIRECT_MAX (32)
+
+struct __packed VirtqueueDescriptor
+{
+    uint64_t address;
+    uint32_t length;
+    uint16_t flags;
+    uint16_t next;
+};
+
+struct __packed VirtqueueAvailable
+{
+    uint16_t flags;
+    uint16_t index;
+    uint16_t ring[];
+};
+
+struct __packed VirtqueueUsedElement
+{
+    uint32_t id;
+    uint32_t length;
+};
+
+struct __packed VirtqueueUsed
+{
+    uint16_t flags;
+    uint16_t index;
+    VirtqueueUsedElement ring[];
+};
+
+// A physically contiguous piece of memory handed to the device.
+struct VirtqueueBuffer
+{
+    uintptr_t address;
+    size_t size;
+    bool writable;
+};
+
+struct Virtqueue
+{
+    uint16_t size;
+    MemoryRange memory;
+
+    VirtqueueDescriptor *descriptors;
+    volatile VirtqueueAvailable *available;
+    volatile VirtqueueUsed *used;
+
+    // Free descriptors are chained through their next field.
+    uint16_t free_head;
+    uint16_t free_count;
+
+    // Next slot we fill in the available ring and next one we read in the used ring.
+    uint16_t next_available;
+    uint16_t last_used;
+
+    // What the driver passed along with each chain, indexed by its head.
+    void **cookies;
+
+    // Available index the last time we considered notifying the device.
+    uint16_t notified_available;
+    bool event_index;
+
+    // One table of VIRTQUEUE_INDIRECT_MAX descriptors per head, so a chain
+    // only takes a single descriptor of the ring.
+    MemoryRange indirect_memory;
+    VirtqueueDescriptor *indirect;
+};
+
+// Size in bytes of the rings of a queue of size descriptors.
+size_t virtqueue_layout_size(uint16_t size);
+
+// features are the ones negotiated with the device, the queue makes use
+// of the VIRTIO_FEATURE_RING ones.
+Virtqueue *virtqueue_create(uint16_t size, uint32_t features);
+
+void virtqueue_destroy(Virtqueue *queue);
+
+// Physical address of the rings, what the device is told about.
+uintptr_t virtqueue_physical_address(Virtqueue *queue);
+
+// How many descriptors of the ring a chain of count buffers takes.
+size_t virtqueue_chain_cost(Virtqueue *queue, size_t count);
+
+// Chain buffers together and make them available to the device, returns
+// false if there are not enough free descriptors. The device is not
+// notified, so several chains can be pushed for a single notification.
+bool virtqueue_push(Virtqueue *queue, VirtqueueBuffer *buffers, size_t count, void *cookie);
+
+// Should the device be notified about the chains pushed since the last
+// call? With event indexes the device tells us how far it will look by
+// itself, so most notifications are skipped while it's busy.
+bool virtqueue_should_notify(Virtqueue *queue);
+
+// Take back the next chain the device is done with, returns false if there
+// is none. written is how many bytes the device wrote in the chain.
+// Once the ring is drained the device is asked to interrupt us for the
+// next chain only.
+bool virtqueue_pop(Virtqueue *queue, void **cookie, size_t *written);
@@ -25,6 +25,15 @@ struct HandleSet
     size_t count;
 };
 
+// One of the buffers of a vectored read or write.
+struct IOVector
+{
+    void *buffer;
+    size_t size;
+};
+
+#define IOVECTOR_COUNT 64
+
 #define HANDLE_INVALID_ID (-1)
 
 #define HANDLE(__subclass) ((Handle *)(__subclass))
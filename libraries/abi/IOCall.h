@@ -45,6 +45,11 @@ struct IOCallNetworkSateAgs
     MacAddress mac_address;
 };
 
+struct IOCallPipeCapacityArgs
+{
+    size_t capacity;
+};
+
 enum IOCall
 {
     IOCALL_TERMINAL_GET_SIZE,
@@ -62,5 +67,8 @@ enum IOCall
 
     IOCALL_NETWORK_GET_STATE,
 
+    IOCALL_PIPE_GET_CAPACITY,
+    IOCALL_PIPE_SET_CAPACITY,
+
     __IOCALL_COUNT,
 };
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <abi/Handle.h>
+
+#include <libsystem/Time.h>
+
+// A queue of operations and a queue of their results, living in the memory
+// of the process. The process pushes submissions then traps once with
+// SYS_HANDLE_RING, the kernel runs them in order and pushes a completion
+// for each of them before returning.
+
+#define IORING_COUNT 64
+
+enum IORingOperation
+{
+    IORING_NOP,
+    IORING_READ,
+    IORING_WRITE,
+    IORING_SELECT,
+    IORING_CONNECT,
+    IORING_CLOSE,
+};
+
+struct IORingSubmission
+{
+    IORingOperation operation;
+    int handle;
+
+    // What to read into or write from, the path to connect to, or the
+    // HandleSet to select on.
+    void *buffer;
+    size_t size;
+    Timeout timeout;
+
+    uintptr_t user_data;
+};
+
+struct IORingCompletion
+{
+    uintptr_t user_data;
+    Result result;
+
+    size_t size;        // What was read or written
+    int handle;         // The new handle of a connect, or the selected one
+    SelectEvent events; // What the selected handle is ready for
+};
+
+struct IORing
+{
+    // Free running, the slots are at index % IORING_COUNT.
+    unsigned int submission_head; // Moved by the kernel
+    unsigned int submission_tail; // Moved by the process
+    IORingSubmission submissions[IORING_COUNT];
+
+    unsigned int completion_head; // Moved by the process
+    unsigned int completion_tail; // Moved by the kernel
+    IORingCompletion completions[IORING_COUNT];
+};
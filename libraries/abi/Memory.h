@@ -3,4 +3,8 @@
 #define MEMORY_NONE (0)
 #define MEMORY_USER (1 << 0)
 #define MEMORY_CLEAR (1 << 1)
-typedef unsigned int MemoryFlags;
\ No newline at end of file
+#define MEMORY_READONLY (1 << 2)
+typedef unsigned int MemoryFlags;
+
+// Block sizes of the physical memory allocator, from one page up to 4MiB.
+#define MEMORY_ORDER_COUNT 11
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+// Connections carry messages, each read gets exactly one of them and each
+// write sends one. Handles and memory objects can travel along with a
+// message, they are held by the kernel until it is received.
+
+#define MESSAGE_SIZE_MAX 4096
+#define MESSAGE_ATTACHMENT_COUNT 4
+
+enum MessageAttachmentType
+{
+    MESSAGE_ATTACHMENT_NONE,
+    // The receiver gets its own handle on the same node as the sender's.
+    // Handles of connections and sockets can't be sent.
+    MESSAGE_ATTACHMENT_HANDLE,
+    // The memory object is mapped in the receiver.
+    MESSAGE_ATTACHMENT_MEMORY,
+};
+
+struct MessageAttachment
+{
+    MessageAttachmentType type;
+
+    // The handle or the memory object id, in the sender then in the receiver.
+    int id;
+
+    // Where the memory object was mapped in the receiver.
+    uintptr_t address;
+    size_t size;
+};
+
+struct Message
+{
+    // Sent from, or received into. Once received, size is how much of the
+    // message made it into buffer, whatever didn't fit is lost.
+    void *buffer;
+    size_t size;
+
+    MessageAttachment attachments[MESSAGE_ATTACHMENT_COUNT];
+    size_t attachments_count;
+};
@@ -16,4 +16,8 @@
 
 #define SERIAL_DEVICE_PATH DEVICE_PATH "/serial"
 
+#define DISK_DEVICE_PATH DEVICE_PATH "/disk"
+
+#define DISK_PATH "/Disk"
+
 #define UNIX_DEVICE_PATH(__device) DEVICE_PATH "/" __device
@@ -35,12 +35,21 @@
     __ENTRY(SYS_HANDLE_SELECT)         \
     __ENTRY(SYS_HANDLE_READ)           \
     __ENTRY(SYS_HANDLE_WRITE)          \
+    __ENTRY(SYS_HANDLE_READV)          \
+    __ENTRY(SYS_HANDLE_WRITEV)         \
+    __ENTRY(SYS_HANDLE_PREAD)          \
+    __ENTRY(SYS_HANDLE_PWRITE)         \
+    __ENTRY(SYS_HANDLE_DONATE)         \
+    __ENTRY(SYS_HANDLE_SEND)           \
+    __ENTRY(SYS_HANDLE_RECEIVE)        \
     __ENTRY(SYS_HANDLE_CALL)           \
     __ENTRY(SYS_HANDLE_SEEK)           \
     __ENTRY(SYS_HANDLE_TELL)           \
     __ENTRY(SYS_HANDLE_STAT)           \
     __ENTRY(SYS_HANDLE_CONNECT)        \
     __ENTRY(SYS_HANDLE_ACCEPT)         \
+    __ENTRY(SYS_HANDLE_MAP)            \
+    __ENTRY(SYS_HANDLE_RING)           \
                                        \
     __ENTRY(SYS_CREATE_PIPE)           \
     __ENTRY(SYS_CREATE_TERM)
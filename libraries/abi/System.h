@@ -1,5 +1,7 @@
 #pragma once
 
+#include <abi/Memory.h>
+
 #include <libsystem/Common.h>
 #include <libsystem/Time.h>
 
@@ -18,6 +20,7 @@ struct SystemStatus
     ElapsedTime uptime;
     size_t total_ram;
     size_t used_ram;
+    size_t free_blocks[MEMORY_ORDER_COUNT]; // Free physical blocks of (1 << order) pages.
     int running_tasks;
     int cpu_usage;
 };
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <__libc__.h>
+
+#include <stddef.h>
+#include <sys/types.h>
+
+__BEGIN_HEADER
+
+struct iovec
+{
+    void *iov_base;
+    size_t iov_len;
+};
+
+#define IOV_MAX 64
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt);
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt);
+
+__END_HEADER
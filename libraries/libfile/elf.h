@@ -58,6 +58,13 @@ struct __packed ELFSection
     uint entsize;
 };
 
+enum ELFProgramFlags
+{
+    ELFP_EXECUTABLE = 1 << 0,
+    ELFP_WRITABLE = 1 << 1,
+    ELFP_READABLE = 1 << 2,
+};
+
 struct ELFProgram
 {
     uint32_t type;
@@ -1,9 +1,10 @@
-
 /* tar.c: read in memory tar archive                                          */
 
 #include <libfile/tar.h>
 #include <libsystem/core/CString.h>
 
+#define TAR_BLOCK_SIZE 512
+
 struct __packed TARRawBlock
 {
     char name[100];     /*   0 */
@@ -25,64 +26,164 @@ struct __packed TARRawBlock
                         /* 500 */
 };
 
-uint get_file_size(TARRawBlock *header)
+// Octal, padded with spaces or NULs. Returns false if the field holds something else.
+static bool tar_parse_octal(const char *field, size_t length, size_t *value)
+{
+    size_t i = 0;
+    *value = 0;
+
+    while (i < length && field[i] == ' ')
+    {
+        i++;
+    }
+
+    for (; i < length && field[i] >= '0' && field[i] <= '7'; i++)
+    {
+        *value = *value * 8 + (field[i] - '0');
+    }
+
+    for (; i < length; i++)
+    {
+        if (field[i] != ' ' && field[i] != '\0')
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Sizes of 8GiB and more don't fit in octal, GNU tar stores them in
+// base-256 with the highest bit of the first byte set.
+static bool tar_parse_size(const char *field, size_t length, size_t *value)
 {
-    unsigned int size = 0;
-    unsigned int count = 1;
+    if (!(field[0] & 0x80))
+    {
+        return tar_parse_octal(field, length, value);
+    }
+
+    *value = field[0] & 0x7f;
 
-    for (uint j = 11; j > 0; j--, count *= 8)
+    for (size_t i = 1; i < length; i++)
     {
-        size += ((header->size[j - 1] - '0') * count);
+        if (*value > (SIZE_MAX >> 8))
+        {
+            return false;
+        }
+
+        *value = (*value << 8) | (uint8_t)field[i];
     }
 
-    return size;
+    return true;
 }
 
-uint tar_count(void *tarfile)
+// The checksum field counts as spaces. Some old tars summed signed chars.
+static bool tar_checksum_valid(TARRawBlock *header)
 {
-    TARRawBlock *header = (TARRawBlock *)tarfile;
-    uint count = 0;
+    size_t expected = 0;
 
-    while (header->name[0] != '\0')
+    if (!tar_parse_octal(header->chksum, sizeof(header->chksum), &expected))
     {
-        count++;
+        return false;
+    }
 
-        size_t size = get_file_size(header);
+    const char *bytes = (const char *)header;
+    size_t unsigned_sum = 0;
+    int signed_sum = 0;
 
-        header = (TARRawBlock *)((char *)header + ((size / 512) + 1) * 512);
+    for (size_t i = 0; i < TAR_BLOCK_SIZE; i++)
+    {
+        bool in_checksum = i >= offsetof(TARRawBlock, chksum) &&
+                           i < offsetof(TARRawBlock, chksum) + sizeof(header->chksum);
+
+        char byte = in_checksum ? ' ' : bytes[i];
 
-        if (size % 512)
-            header = (TARRawBlock *)((char *)header + 512);
+        unsigned_sum += (uint8_t)byte;
+        signed_sum += (signed char)byte;
     }
 
-    return count;
+    return expected == unsigned_sum || (int)expected == signed_sum;
 }
 
-bool tar_read(void *tarfile, TARBlock *block, uint index)
+static void tar_copy_field(char *destination, const char *field, size_t length)
 {
-    TARRawBlock *header = (TARRawBlock *)tarfile;
+    size_t i = 0;
 
-    for (size_t i = 0; i < index; i++)
+    for (; i < length && field[i]; i++)
     {
-        if (header->name[0] == '\0')
-            return false;
+        destination[i] = field[i];
+    }
 
-        size_t size = get_file_size(header);
+    destination[i] = '\0';
+}
 
-        header = (TARRawBlock *)((char *)header + ((size / 512) + 1) * 512);
+void tar_iterator_initialize(TARIterator *iterator, const void *archive, size_t size)
+{
+    iterator->archive = (const char *)archive;
+    iterator->size = size;
+    iterator->offset = 0;
+    iterator->corrupted = false;
+}
 
-        if (size % 512)
-            header = (TARRawBlock *)((char *)header + 512);
+bool tar_iterator_next(TARIterator *iterator, TARBlock *block)
+{
+    if (iterator->corrupted || iterator->offset + TAR_BLOCK_SIZE > iterator->size)
+    {
+        return false;
     }
 
+    TARRawBlock *header = (TARRawBlock *)(iterator->archive + iterator->offset);
+
+    // The archive ends with blocks of zeros.
     if (header->name[0] == '\0')
+    {
+        return false;
+    }
+
+    size_t size = 0;
+
+    if (!tar_checksum_valid(header) ||
+        !tar_parse_size(header->size, sizeof(header->size), &size) ||
+        size > iterator->size - iterator->offset - TAR_BLOCK_SIZE)
+    {
+        iterator->corrupted = true;
         return false;
+    }
 
-    memcpy(block->name, header->name, 100);
-    block->size = get_file_size(header);
+    // Only POSIX ustar has a prefix, GNU tar uses these bytes for other things.
+    if (memcmp(header->magic, "ustar\0", 6) == 0 && header->prefix[0])
+    {
+        tar_copy_field(block->name, header->prefix, sizeof(header->prefix));
+        strcat(block->name, "/");
+        tar_copy_field(block->name + strlen(block->name), header->name, sizeof(header->name));
+    }
+    else
+    {
+        tar_copy_field(block->name, header->name, sizeof(header->name));
+    }
+
+    tar_copy_field(block->linkname, header->linkname, sizeof(header->linkname));
     block->typeflag = header->typeflag;
-    memcpy(block->linkname, header->linkname, 100);
-    block->data = (char *)header + 512;
+    block->size = size;
+    block->data = (char *)header + TAR_BLOCK_SIZE;
+
+    iterator->offset += TAR_BLOCK_SIZE + __align_up(size, TAR_BLOCK_SIZE);
 
     return true;
 }
+
+bool tar_read(void *tarfile, size_t size, TARBlock *block, uint index)
+{
+    TARIterator iterator;
+    tar_iterator_initialize(&iterator, tarfile, size);
+
+    for (size_t i = 0; tar_iterator_next(&iterator, block); i++)
+    {
+        if (i == index)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -2,13 +2,43 @@
 
 #include <libsystem/Common.h>
 
+// Long enough for a ustar prefix, a '/' and a name.
+#define TAR_NAME_LENGTH 257
+
+#define TAR_TYPE_REGULAR '0'
+#define TAR_TYPE_REGULAR_OLD '\0'
+#define TAR_TYPE_HARD_LINK '1'
+#define TAR_TYPE_SYMBOLIC_LINK '2'
+#define TAR_TYPE_DIRECTORY '5'
+#define TAR_TYPE_CONTIGUOUS '7'
+
 struct TARBlock
 {
-    char name[100];
+    char name[TAR_NAME_LENGTH];
     char typeflag;
-    char linkname[100];
+    char linkname[101];
     size_t size;
     char *data;
 };
 
-bool tar_read(void *tarfile, TARBlock *block, uint index);
+// Walks the headers of an archive in memory one after the other, so going
+// through the whole archive is O(n).
+struct TARIterator
+{
+    const char *archive;
+    size_t size;
+    size_t offset;
+
+    // Set when the walk stopped on a damaged header rather than on the end
+    // of the archive.
+    bool corrupted;
+};
+
+void tar_iterator_initialize(TARIterator *iterator, const void *archive, size_t size);
+
+// Returns false once the end of the archive, or a damaged header, is reached.
+bool tar_iterator_next(TARIterator *iterator, TARBlock *block);
+
+// Returns the entry at index, this walks the archive from the start every
+// time so prefer a TARIterator to go through all of them.
+bool tar_read(void *tarfile, size_t size, TARBlock *block, uint index);
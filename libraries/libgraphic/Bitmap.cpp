@@ -45,15 +45,20 @@ ResultOr<RefPtr<Bitmap>> Bitmap::create_shared_from_handle(int handle, Vec2i wid
     if (result != SUCCESS)
         return result;
 
+    memory_get_handle(reinterpret_cast<uintptr_t>(pixels), &handle);
+
+    return create_shared_from_memory(handle, reinterpret_cast<uintptr_t>(pixels), size, width_and_height);
+}
+
+ResultOr<RefPtr<Bitmap>> Bitmap::create_shared_from_memory(int handle, uintptr_t address, size_t size, Vec2i width_and_height)
+{
     if (size < width_and_height.x() * width_and_height.y() * sizeof(Color))
     {
-        memory_free(reinterpret_cast<uintptr_t>(pixels));
+        memory_free(address);
         return ERR_BAD_IMAGE_FILE_FORMAT;
     }
 
-    memory_get_handle(reinterpret_cast<uintptr_t>(pixels), &handle);
-
-    return make<Bitmap>(handle, BITMAP_SHARED, width_and_height.x(), width_and_height.y(), pixels);
+    return make<Bitmap>(handle, BITMAP_SHARED, width_and_height.x(), width_and_height.y(), reinterpret_cast<Color *>(address));
 }
 
 RefPtr<Bitmap> Bitmap::create_static(int width, int height, Color *pixels)
@@ -63,9 +68,9 @@ RefPtr<Bitmap> Bitmap::create_static(int width, int height, Color *pixels)
 
 ResultOr<RefPtr<Bitmap>> Bitmap::load_from(const char *path)
 {
-    void *rawdata;
+    const void *rawdata;
     size_t rawdata_size;
-    Result result = file_read_all(path, &rawdata, &rawdata_size);
+    Result result = file_map(path, &rawdata, &rawdata_size);
 
     if (result != SUCCESS)
     {
@@ -83,6 +88,8 @@ ResultOr<RefPtr<Bitmap>> Bitmap::load_from(const char *path)
         (const unsigned char *)rawdata,
         rawdata_size);
 
+    memory_free(reinterpret_cast<uintptr_t>(rawdata));
+
     if (decode_result != 0)
     {
         return ERR_BAD_IMAGE_FILE_FORMAT;
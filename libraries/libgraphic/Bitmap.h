@@ -61,6 +61,9 @@ public:
 
     static ResultOr<RefPtr<Bitmap>> create_shared_from_handle(int handle, Vec2i width_and_height);
 
+    // Shared memory the process already mapped, freed along with the bitmap.
+    static ResultOr<RefPtr<Bitmap>> create_shared_from_memory(int handle, uintptr_t address, size_t size, Vec2i width_and_height);
+
     static RefPtr<Bitmap> create_static(int width, int height, Color *pixels);
 
     static ResultOr<RefPtr<Bitmap>> load_from(const char *path);
@@ -1,13 +1,14 @@
 #include <libgraphic/Bitmap.h>
 #include <libgraphic/TrueType.h>
 #include <libgraphic/TrueTypeFont.h>
-#include <libsystem/io/Stream.h>
+#include <libsystem/io/File.h>
+#include <libsystem/system/Memory.h>
 #include <libsystem/math/Vectors.h>
 
 struct TrueTypeFamily
 {
     truetype_fontinfo info;
-    void *buffer;
+    const void *buffer;
     size_t buffer_size;
 };
 
@@ -25,16 +26,17 @@ struct TrueTypeFont
 
 TrueTypeFamily *truetype_family_create(const char *path)
 {
-    Stream *font_file = stream_open(path, OPEN_READ);
+    const void *buffer = nullptr;
+    size_t buffer_size = 0;
 
-    FileState state = {};
-    stream_stat(font_file, &state);
+    if (file_map(path, &buffer, &buffer_size) != SUCCESS)
+    {
+        return nullptr;
+    }
 
     TrueTypeFamily *family = __create(TrueTypeFamily);
-    family->buffer_size = state.size;
-    family->buffer = malloc(state.size);
-
-    stream_read(font_file, family->buffer, state.size);
+    family->buffer_size = buffer_size;
+    family->buffer = buffer;
 
     truetype_InitFont(
         &family->info,
@@ -46,7 +48,7 @@ TrueTypeFamily *truetype_family_create(const char *path)
 
 void truetype_family_destroy(TrueTypeFamily *family)
 {
-    free(family->buffer);
+    memory_free((uintptr_t)family->buffer);
     free(family);
 }
 
@@ -9,13 +9,17 @@
     __ENTRY(ERR_BAD_IMAGE_FILE_FORMAT)           \
     __ENTRY(ERR_CANNOT_ALLOCATE_MEMORY)          \
     __ENTRY(ERR_CONNECTION_REFUSED)              \
+    __ENTRY(ERR_DIRECTORY_NOT_EMPTY)             \
     __ENTRY(ERR_EXEC_FORMAT_ERROR)               \
     __ENTRY(ERR_FILE_EXISTS)                     \
     __ENTRY(ERR_FUNCTION_NOT_IMPLEMENTED)        \
     __ENTRY(ERR_INAPPROPRIATE_CALL_FOR_DEVICE)   \
+    __ENTRY(ERR_INPUT_OUTPUT_ERROR)              \
     __ENTRY(ERR_INVALID_ARGUMENT)                \
     __ENTRY(ERR_IS_A_DIRECTORY)                  \
     __ENTRY(ERR_MEMORY_NOT_ALIGNED)              \
+    __ENTRY(ERR_MESSAGE_TOO_LONG)                \
+    __ENTRY(ERR_NO_SPACE_LEFT_ON_DEVICE)         \
     __ENTRY(ERR_NO_SUCH_DEVICE)                  \
     __ENTRY(ERR_NO_SUCH_FILE_OR_DIRECTORY)       \
     __ENTRY(ERR_NO_SUCH_TASK)                    \
@@ -1,7 +1,10 @@
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <libsystem/core/Plugs.h>
 
+static_assert(sizeof(iovec) == sizeof(IOVector), "iovec and IOVector should be the same");
+
 ssize_t write(int fd, const void *buf, size_t count)
 {
     Handle hnd = {
@@ -21,3 +24,83 @@ ssize_t write(int fd, const void *buf, size_t count)
         return (ssize_t)written;
     }
 }
+
+ssize_t pread(int fd, void *buf, size_t count, off_t offset)
+{
+    Handle hnd = {
+        .id = fd,
+        .flags = 0,
+        .result = SUCCESS,
+    };
+
+    size_t read = __plug_handle_pread(&hnd, buf, count, offset);
+
+    if (handle_has_error(&hnd))
+    {
+        return -1;
+    }
+    else
+    {
+        return (ssize_t)read;
+    }
+}
+
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset)
+{
+    Handle hnd = {
+        .id = fd,
+        .flags = 0,
+        .result = SUCCESS,
+    };
+
+    size_t written = __plug_handle_pwrite(&hnd, buf, count, offset);
+
+    if (handle_has_error(&hnd))
+    {
+        return -1;
+    }
+    else
+    {
+        return (ssize_t)written;
+    }
+}
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    Handle hnd = {
+        .id = fd,
+        .flags = 0,
+        .result = SUCCESS,
+    };
+
+    size_t read = __plug_handle_readv(&hnd, (const IOVector *)iov, iovcnt);
+
+    if (handle_has_error(&hnd))
+    {
+        return -1;
+    }
+    else
+    {
+        return (ssize_t)read;
+    }
+}
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    Handle hnd = {
+        .id = fd,
+        .flags = 0,
+        .result = SUCCESS,
+    };
+
+    size_t written = __plug_handle_writev(&hnd, (const IOVector *)iov, iovcnt);
+
+    if (handle_has_error(&hnd))
+    {
+        return -1;
+    }
+    else
+    {
+        return (ssize_t)written;
+    }
+}
@@ -5,7 +5,9 @@
 #include <abi/Filesystem.h>
 #include <abi/Handle.h>
 #include <abi/IOCall.h>
+#include <abi/IORing.h>
 #include <abi/Launchpad.h>
+#include <abi/Message.h>
 #include <abi/System.h>
 
 #include <libsystem/Time.h>
@@ -89,6 +91,20 @@ size_t __plug_handle_read(Handle *handle, void *buffer, size_t size);
 
 size_t __plug_handle_write(Handle *handle, const void *buffer, size_t size);
 
+size_t __plug_handle_readv(Handle *handle, const IOVector *vectors, size_t count);
+
+size_t __plug_handle_writev(Handle *handle, const IOVector *vectors, size_t count);
+
+size_t __plug_handle_pread(Handle *handle, void *buffer, size_t size, size_t offset);
+
+size_t __plug_handle_pwrite(Handle *handle, const void *buffer, size_t size, size_t offset);
+
+size_t __plug_handle_donate(Handle *handle, const void *buffer, size_t size);
+
+Result __plug_handle_send(Handle *handle, const Message *message);
+
+Result __plug_handle_receive(Handle *handle, Message *message);
+
 Result __plug_handle_call(Handle *handle, IOCall request, void *args);
 
 int __plug_handle_seek(Handle *handle, int offset, Whence whence);
@@ -101,6 +117,10 @@ void __plug_handle_connect(Handle *handle, const char *path);
 
 void __plug_handle_accept(Handle *handle, Handle *connection_handle);
 
+Result __plug_handle_map(Handle *handle, uintptr_t *out_address, size_t *out_size);
+
+Result __plug_handle_ring(IORing *ring);
+
 Result __plug_create_pipe(int *reader_handle, int *writer_handle);
 
 Result __plug_create_term(int *master_handle, int *slave_handle);
@@ -0,0 +1,252 @@
+#include <libsystem/Assert.h>
+#include <libsystem/core/CString.h>
+#include <libsystem/core/Plugs.h>
+#include <libsystem/eventloop/Channel.h>
+#include <libsystem/io/Pipe.h>
+#include <libsystem/system/Memory.h>
+
+// The positions are free running 16 bits counters, so count has to be a
+// power of two for them to wrap around with the messages.
+#define CHANNEL_COUNT_MAX 32768
+
+static uint16_t channel_head(uint32_t positions)
+{
+    return positions & 0xffff;
+}
+
+static uint16_t channel_tail(uint32_t positions)
+{
+    return positions >> 16;
+}
+
+static uint32_t channel_positions(uint16_t head, uint16_t tail)
+{
+    return (uint32_t)tail << 16 | head;
+}
+
+static void *channel_message(Channel *channel, uint16_t position)
+{
+    return channel->ring->messages + (position % channel->count) * channel->message_size;
+}
+
+// Never waits on the consumer. If the doorbell is full, it already has
+// plenty to wake up on, so the byte is dropped.
+static void channel_ring(Channel *channel)
+{
+    int handle = HANDLE(channel->doorbell_in)->id;
+    SelectEvent events = SELECT_WRITE;
+    HandleSet handle_set = {&handle, &events, 1};
+
+    int selected = HANDLE_INVALID_ID;
+    SelectEvent selected_events = 0;
+
+    if (__plug_handle_select(&handle_set, &selected, &selected_events, 0) != SUCCESS)
+    {
+        return;
+    }
+
+    char doorbell = 0;
+    stream_write(channel->doorbell_in, &doorbell, 1);
+}
+
+Channel *channel_create(size_t message_size, size_t count)
+{
+    assert(count > 1 && count <= CHANNEL_COUNT_MAX && (count & (count - 1)) == 0);
+
+    size_t size = sizeof(ChannelRing) + message_size * count;
+    uintptr_t address = 0;
+
+    if (memory_alloc(size, &address) != SUCCESS)
+    {
+        return nullptr;
+    }
+
+    Channel *channel = __create(Channel);
+
+    channel->ring = (ChannelRing *)address;
+    channel->address = address;
+    channel->size = size;
+    channel->message_size = message_size;
+    channel->count = count;
+
+    channel->ring->positions = channel_positions(0, 0);
+    channel->ring->message_size = message_size;
+    channel->ring->count = count;
+
+    memory_get_handle(address, &channel->memory);
+
+    Pipe *pipe = pipe_create();
+    channel->doorbell_in = pipe->in;
+    channel->doorbell_out = pipe->out;
+    free(pipe);
+
+    stream_set_write_buffer_mode(channel->doorbell_in, STREAM_BUFFERED_NONE);
+    stream_set_read_buffer_mode(channel->doorbell_out, STREAM_BUFFERED_NONE);
+
+    return channel;
+}
+
+Channel *channel_open(MessageAttachment *memory, MessageAttachment *doorbell, size_t message_size)
+{
+    if (memory->type != MESSAGE_ATTACHMENT_MEMORY || memory->id == HANDLE_INVALID_ID ||
+        doorbell->type != MESSAGE_ATTACHMENT_HANDLE || doorbell->id == HANDLE_INVALID_ID)
+    {
+        return nullptr;
+    }
+
+    ChannelRing *ring = (ChannelRing *)memory->address;
+
+    // The other side could have been lying about the size of the messages.
+    if (memory->size < sizeof(ChannelRing) ||
+        ring->message_size != message_size ||
+        ring->count <= 1 || ring->count > CHANNEL_COUNT_MAX || (ring->count & (ring->count - 1)) != 0 ||
+        message_size > (memory->size - sizeof(ChannelRing)) / ring->count)
+    {
+        return nullptr;
+    }
+
+    Channel *channel = __create(Channel);
+
+    channel->ring = ring;
+    channel->address = memory->address;
+    channel->size = memory->size;
+    channel->message_size = message_size;
+    channel->count = ring->count;
+    channel->memory = memory->id;
+
+    channel->doorbell_out = stream_open_handle(doorbell->id, OPEN_READ);
+    stream_set_read_buffer_mode(channel->doorbell_out, STREAM_BUFFERED_NONE);
+
+    // The channel owns them now.
+    memory->type = MESSAGE_ATTACHMENT_NONE;
+    doorbell->type = MESSAGE_ATTACHMENT_NONE;
+
+    return channel;
+}
+
+void channel_destroy(Channel *channel)
+{
+    if (channel->doorbell_in)
+    {
+        stream_close(channel->doorbell_in);
+    }
+
+    stream_close(channel->doorbell_out);
+    memory_free(channel->address);
+    free(channel);
+}
+
+Handle *channel_doorbell(Channel *channel)
+{
+    return HANDLE(channel->doorbell_out);
+}
+
+// Take the last message back from the consumer while it is folded into,
+// returns false if the consumer already took it or there is none.
+static bool channel_coalesce(Channel *channel, const void *message, ChannelCoalesceCallback coalesce)
+{
+    ChannelRing *ring = channel->ring;
+
+    uint32_t positions = ring->positions;
+    uint16_t tail = channel_tail(positions);
+
+    while (true)
+    {
+        if (channel_head(positions) == tail)
+        {
+            return false;
+        }
+
+        uint32_t taken_back = channel_positions(channel_head(positions), tail - 1);
+
+        if (__sync_bool_compare_and_swap(&ring->positions, positions, taken_back))
+        {
+            break;
+        }
+
+        positions = ring->positions;
+    }
+
+    // The consumer only takes messages before the tail, this one is ours until
+    // it is given back.
+    bool coalesced = coalesce(channel_message(channel, tail - 1), message);
+
+    do
+    {
+        positions = ring->positions;
+    } while (!__sync_bool_compare_and_swap(&ring->positions, positions, channel_positions(channel_head(positions), tail)));
+
+    // It might have run out of messages in the meantime and gone to sleep.
+    if (channel_head(positions) == (uint16_t)(tail - 1))
+    {
+        channel_ring(channel);
+    }
+
+    return coalesced;
+}
+
+bool channel_push(Channel *channel, const void *message, ChannelCoalesceCallback coalesce)
+{
+    ChannelRing *ring = channel->ring;
+
+    if (coalesce && channel_coalesce(channel, message, coalesce))
+    {
+        return true;
+    }
+
+    uint32_t positions = ring->positions;
+    uint16_t tail = channel_tail(positions);
+
+    // One message is kept free for the one the consumer is copying out.
+    if ((uint16_t)(tail - channel_head(positions)) >= channel->count - 1)
+    {
+        return false;
+    }
+
+    memcpy(channel_message(channel, tail), message, channel->message_size);
+
+    while (!__sync_bool_compare_and_swap(&ring->positions, positions, channel_positions(channel_head(positions), tail + 1)))
+    {
+        positions = ring->positions;
+    }
+
+    if (channel_head(positions) == tail)
+    {
+        channel_ring(channel);
+    }
+
+    return true;
+}
+
+void channel_acknowledge(Channel *channel)
+{
+    char doorbell[16];
+    stream_read(channel->doorbell_out, doorbell, 16);
+}
+
+bool channel_pop(Channel *channel, void *message)
+{
+    ChannelRing *ring = channel->ring;
+
+    uint32_t positions = ring->positions;
+
+    while (true)
+    {
+        uint16_t head = channel_head(positions);
+
+        if (head == channel_tail(positions))
+        {
+            return false;
+        }
+
+        // Moving the head first keeps the producer from folding anything into
+        // the message while it is copied out.
+        if (__sync_bool_compare_and_swap(&ring->positions, positions, channel_positions(head + 1, channel_tail(positions))))
+        {
+            memcpy(message, channel_message(channel, head), channel->message_size);
+            return true;
+        }
+
+        positions = ring->positions;
+    }
+}
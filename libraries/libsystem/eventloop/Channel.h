@@ -0,0 +1,64 @@
+#pragma once
+
+#include <abi/Message.h>
+#include <libsystem/io/Stream.h>
+
+// A single producer, single consumer queue of fixed size messages in memory
+// shared by two processes. Pushing and taking messages don't need the
+// kernel, only the doorbell does: the producer writes to it when the queue
+// stops being empty, and the consumer selects on it.
+
+struct ChannelRing
+{
+    // Where the consumer and the producer are, in a single word so they can
+    // be compared and swapped together: the head in the low half, the tail
+    // in the high half.
+    volatile uint32_t positions;
+
+    uint32_t message_size;
+    uint32_t count;
+
+    char messages[];
+};
+
+struct Channel
+{
+    ChannelRing *ring;
+    uintptr_t address;
+    size_t size;
+
+    // Our own copy, the other process could change the ones in the ring.
+    size_t message_size;
+    size_t count;
+
+    // The memory object and the reading end of the doorbell, they go to the
+    // other process along with a message.
+    int memory;
+    Stream *doorbell_out;
+
+    // Only kept by the producer.
+    Stream *doorbell_in;
+};
+
+// Tells whether message can be folded into waiting, the last message not
+// taken yet, and does it if so.
+typedef bool (*ChannelCoalesceCallback)(void *waiting, const void *message);
+
+Channel *channel_create(size_t message_size, size_t count);
+
+// From the memory and doorbell attachments of a message, fails unless the
+// messages are message_size bytes, which is what channel_pop() copies out.
+Channel *channel_open(MessageAttachment *memory, MessageAttachment *doorbell, size_t message_size);
+
+void channel_destroy(Channel *channel);
+
+Handle *channel_doorbell(Channel *channel);
+
+// Returns false if the queue is full, coalesce can be nullptr.
+bool channel_push(Channel *channel, const void *message, ChannelCoalesceCallback coalesce);
+
+// Once the doorbell rang, before taking messages until there are none left.
+void channel_acknowledge(Channel *channel);
+
+// Returns false if there is no message waiting.
+bool channel_pop(Channel *channel, void *message);
@@ -4,6 +4,7 @@
 #include <libsystem/eventloop/EventLoop.h>
 #include <libsystem/eventloop/Notifier.h>
 #include <libsystem/eventloop/Timer.h>
+#include <libsystem/io/IORing.h>
 #include <libsystem/math/MinMax.h>
 #include <libsystem/system/System.h>
 #include <libsystem/utils/List.h>
@@ -15,12 +16,33 @@ struct RunLater
     void *target;
 };
 
+struct EventLoopWrite
+{
+    Handle *handle;
+    size_t offset;
+    size_t size;
+    size_t written;
+    Result result;
+
+    void *target;
+    EventLoopWriteCallback callback;
+};
+
+#define EVENTLOOP_SELECT_USER_DATA ((uintptr_t)-1)
+
 static Vector<Timer *> _eventloop_timers;
 static TimeStamp _eventloop_timer_last_fire = 0;
 
 static List *_eventloop_notifiers = nullptr;
 static Vector<RunLater> *_eventloop_run_later = nullptr;
 
+// Writes are sent along with the select, the data waits in the buffer until then.
+static IORing *_eventloop_ring = nullptr;
+static Vector<EventLoopWrite> *_eventloop_writes = nullptr;
+static char *_eventloop_writes_buffer = nullptr;
+static size_t _eventloop_writes_used = 0;
+static size_t _eventloop_writes_capacity = 0;
+
 static size_t _eventloop_handles_count;
 static Handle *_eventloop_handles[PROCESS_HANDLE_COUNT];
 static SelectEvent _eventloop_events[PROCESS_HANDLE_COUNT];
@@ -41,6 +63,9 @@ void eventloop_initialize()
     _eventloop_notifiers = list_create();
     _eventloop_run_later = new Vector<RunLater>();
 
+    _eventloop_ring = ioring_create();
+    _eventloop_writes = new Vector<EventLoopWrite>();
+
     _eventloop_is_initialize = true;
 }
 
@@ -51,6 +76,17 @@ void eventloop_uninitialize()
     list_destroy(_eventloop_notifiers);
     delete _eventloop_run_later;
 
+    ioring_destroy(_eventloop_ring);
+    delete _eventloop_writes;
+
+    if (_eventloop_writes_buffer)
+    {
+        free(_eventloop_writes_buffer);
+        _eventloop_writes_buffer = nullptr;
+        _eventloop_writes_used = 0;
+        _eventloop_writes_capacity = 0;
+    }
+
     _eventloop_is_initialize = false;
 }
 
@@ -138,6 +174,137 @@ void eventloop_update_timers()
     _eventloop_timer_last_fire = current_fire;
 }
 
+static Result eventloop_select(Timeout timeout, Handle **selected, SelectEvent *selected_events)
+{
+    static int handles[PROCESS_HANDLE_COUNT];
+
+    for (size_t i = 0; i < _eventloop_handles_count; i++)
+    {
+        handles[i] = _eventloop_handles[i]->id;
+    }
+
+    HandleSet handle_set = {handles, _eventloop_events, _eventloop_handles_count};
+
+    Result result = SUCCESS;
+    int selected_handle = HANDLE_INVALID_ID;
+
+    size_t next_write = 0;
+    bool select_submitted = false;
+
+    while (!select_submitted)
+    {
+        // The writes go first, and the select along with the last of them.
+        while (next_write < _eventloop_writes->count())
+        {
+            IORingSubmission *submission = ioring_submission(_eventloop_ring);
+
+            if (!submission)
+            {
+                break;
+            }
+
+            EventLoopWrite &write = (*_eventloop_writes)[next_write];
+
+            submission->operation = IORING_WRITE;
+            submission->handle = write.handle->id;
+            submission->buffer = _eventloop_writes_buffer + write.offset;
+            submission->size = write.size;
+            submission->user_data = next_write;
+
+            next_write++;
+        }
+
+        if (next_write == _eventloop_writes->count())
+        {
+            IORingSubmission *submission = ioring_submission(_eventloop_ring);
+
+            if (submission)
+            {
+                submission->operation = IORING_SELECT;
+                submission->buffer = &handle_set;
+                submission->timeout = timeout;
+                submission->user_data = EVENTLOOP_SELECT_USER_DATA;
+
+                select_submitted = true;
+            }
+        }
+
+        Result enter_result = ioring_enter(_eventloop_ring);
+
+        if (enter_result != SUCCESS)
+        {
+            return enter_result;
+        }
+
+        IORingCompletion completion;
+
+        while (ioring_completion(_eventloop_ring, &completion))
+        {
+            if (completion.user_data == EVENTLOOP_SELECT_USER_DATA)
+            {
+                result = completion.result;
+                selected_handle = completion.handle;
+                *selected_events = completion.events;
+            }
+            else
+            {
+                EventLoopWrite &write = (*_eventloop_writes)[completion.user_data];
+
+                write.result = completion.result;
+                write.written = completion.size;
+            }
+        }
+    }
+
+    if (result == SUCCESS)
+    {
+        for (size_t i = 0; i < _eventloop_handles_count; i++)
+        {
+            if (_eventloop_handles[i]->id == selected_handle)
+            {
+                *selected = _eventloop_handles[i];
+            }
+        }
+    }
+
+    // The callbacks might queue more writes, they go with the next select.
+    Vector<EventLoopWrite> writes = *_eventloop_writes;
+    _eventloop_writes->clear();
+    _eventloop_writes_used = 0;
+
+    Vector<EventLoopWrite> done;
+
+    writes.foreach ([&](auto &write) {
+        if (write.result != SUCCESS || write.written >= write.size)
+        {
+            done.push_back(write);
+            return Iteration::CONTINUE;
+        }
+
+        // What didn't fit goes again with the next select, moved to the front
+        // of the buffer, so nothing after it overwrites it.
+        size_t remaining = write.size - write.written;
+
+        memmove(_eventloop_writes_buffer + _eventloop_writes_used, _eventloop_writes_buffer + write.offset + write.written, remaining);
+
+        _eventloop_writes->push_back(EventLoopWrite{write.handle, _eventloop_writes_used, remaining, 0, SUCCESS, write.target, write.callback});
+        _eventloop_writes_used += remaining;
+
+        return Iteration::CONTINUE;
+    });
+
+    done.foreach ([](auto &write) {
+        if (write.callback)
+        {
+            write.callback(write.target, write.handle, write.result);
+        }
+
+        return Iteration::CONTINUE;
+    });
+
+    return result;
+}
+
 void eventloop_pump(bool pool)
 {
     assert(_eventloop_is_initialize);
@@ -154,13 +321,7 @@ void eventloop_pump(bool pool)
     Handle *selected = nullptr;
     SelectEvent selected_events = 0;
 
-    Result result = handle_select(
-        &_eventloop_handles[0],
-        &_eventloop_events[0],
-        _eventloop_handles_count,
-        &selected,
-        &selected_events,
-        timeout);
+    Result result = eventloop_select(timeout, &selected, &selected_events);
 
     if (result_is_error(result))
     {
@@ -263,3 +424,27 @@ void event_cancel_run_later_for(void *target)
         return run_later.target == target;
     });
 }
+
+void eventloop_queue_write(Handle *handle, const void *buffer, size_t size, void *target, EventLoopWriteCallback callback)
+{
+    assert(_eventloop_is_initialize);
+
+    if (_eventloop_writes_used + size > _eventloop_writes_capacity)
+    {
+        _eventloop_writes_capacity = MAX(_eventloop_writes_capacity * 2, _eventloop_writes_used + size);
+        _eventloop_writes_buffer = (char *)realloc(_eventloop_writes_buffer, _eventloop_writes_capacity);
+    }
+
+    memcpy(_eventloop_writes_buffer + _eventloop_writes_used, buffer, size);
+
+    _eventloop_writes->push_back(EventLoopWrite{handle, _eventloop_writes_used, size, 0, SUCCESS, target, callback});
+
+    _eventloop_writes_used += size;
+}
+
+void eventloop_cancel_write_for(void *target)
+{
+    _eventloop_writes->remove_all_match([&](auto &write) {
+        return write.target == target;
+    });
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <abi/Handle.h>
+
 #include <libsystem/Common.h>
 
 struct Notifier;
@@ -32,4 +34,14 @@ void eventloop_run_later(RunLaterCallback callback, void *target);
 
 void event_cancel_run_later_for(void *target);
 
+typedef void (*EventLoopWriteCallback)(void *target, Handle *handle, Result result);
+
+// Write to handle along with the next wait for events, in the same system
+// call. The data is copied, and what isn't written at once goes along with
+// the following waits. callback, if any, is told how it went once all of it
+// is written or it failed.
+void eventloop_queue_write(Handle *handle, const void *buffer, size_t size, void *target, EventLoopWriteCallback callback);
+
+void eventloop_cancel_write_for(void *target);
+
 void eventloop_update_timers();
@@ -47,3 +47,19 @@ size_t connection_receive(Connection *connection, void *buffer, size_t size)
 
     return __plug_handle_read(HANDLE(connection), buffer, size);
 }
+
+Result connection_send_message(Connection *connection, const Message *message)
+{
+    assert(connection != nullptr);
+    assert(message != nullptr);
+
+    return __plug_handle_send(HANDLE(connection), message);
+}
+
+Result connection_receive_message(Connection *connection, Message *message)
+{
+    assert(connection != nullptr);
+    assert(message != nullptr);
+
+    return __plug_handle_receive(HANDLE(connection), message);
+}
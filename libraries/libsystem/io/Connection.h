@@ -1,6 +1,7 @@
 #pragma once
 
 #include <abi/Handle.h>
+#include <abi/Message.h>
 
 struct Socket;
 
@@ -13,3 +14,8 @@ void connection_close(Connection *connection);
 size_t connection_send(Connection *connection, const void *buffer, size_t size);
 
 size_t connection_receive(Connection *connection, void *buffer, size_t size);
+
+// One message with the handles and memory objects attached to it, see abi/Message.h
+Result connection_send_message(Connection *connection, const Message *message);
+
+Result connection_receive_message(Connection *connection, Message *message);
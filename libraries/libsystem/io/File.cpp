@@ -1,4 +1,5 @@
 #include <libsystem/io/File.h>
+#include <libsystem/core/Plugs.h>
 #include <libsystem/io/Stream.h>
 
 Result file_read_all(const char *path, void **buffer, size_t *size)
@@ -32,6 +33,28 @@ Result file_read_all(const char *path, void **buffer, size_t *size)
     return SUCCESS;
 }
 
+Result file_map(const char *path, const void **buffer, size_t *size)
+{
+    __cleanup(stream_cleanup) Stream *stream = stream_open(path, OPEN_READ);
+
+    if (handle_has_error(stream))
+    {
+        return handle_get_error(stream);
+    }
+
+    uintptr_t address = 0;
+    Result result = __plug_handle_map(HANDLE(stream), &address, size);
+
+    if (result != SUCCESS)
+    {
+        return result;
+    }
+
+    *buffer = (const void *)address;
+
+    return SUCCESS;
+}
+
 Result file_write_all(const char *path, void *buffer, size_t size)
 {
     __cleanup(stream_cleanup) Stream *stream = stream_open(path, OPEN_WRITE | OPEN_CREATE);
@@ -45,7 +68,7 @@ Result file_write_all(const char *path, void *buffer, size_t size)
 
     while (remaining)
     {
-        remaining -= stream_write(stream, ((char *)buffer + (size - remaining)), size);
+        remaining -= stream_write(stream, ((char *)buffer + (size - remaining)), remaining);
 
         if (handle_has_error(stream))
         {
@@ -5,6 +5,11 @@
 
 Result file_read_all(const char *path, void **buffer, size_t *size);
 
+// Map the whole file read-only, the pages are shared with every other task
+// mapping it. Release the mapping with memory_free((uintptr_t)buffer).
+// Empty files can't be mapped and give ERR_INVALID_ARGUMENT.
+Result file_map(const char *path, const void **buffer, size_t *size);
+
 Result file_write_all(const char *path, void *buffer, size_t size);
 
 bool file_exist(const char *path);
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include <libsystem/core/Plugs.h>
+#include <libsystem/io/IORing.h>
+
+IORing *ioring_create()
+{
+    return __create(IORing);
+}
+
+void ioring_destroy(IORing *ring)
+{
+    free(ring);
+}
+
+IORingSubmission *ioring_submission(IORing *ring)
+{
+    // Every submission needs room for its completion.
+    size_t pending = ring->submission_tail - ring->submission_head;
+    size_t completed = ring->completion_tail - ring->completion_head;
+
+    if (pending + completed == IORING_COUNT)
+    {
+        return nullptr;
+    }
+
+    IORingSubmission *submission = &ring->submissions[ring->submission_tail % IORING_COUNT];
+    *submission = {};
+
+    ring->submission_tail++;
+
+    return submission;
+}
+
+Result ioring_enter(IORing *ring)
+{
+    if (ring->submission_head == ring->submission_tail)
+    {
+        return SUCCESS;
+    }
+
+    return __plug_handle_ring(ring);
+}
+
+bool ioring_completion(IORing *ring, IORingCompletion *completion)
+{
+    if (ring->completion_head == ring->completion_tail)
+    {
+        return false;
+    }
+
+    *completion = ring->completions[ring->completion_head % IORING_COUNT];
+    ring->completion_head++;
+
+    return true;
+}
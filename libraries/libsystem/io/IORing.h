@@ -0,0 +1,17 @@
+#pragma once
+
+#include <abi/IORing.h>
+
+IORing *ioring_create();
+
+void ioring_destroy(IORing *ring);
+
+// The next free submission, or nullptr if the ring has to be entered and
+// its completions collected first.
+IORingSubmission *ioring_submission(IORing *ring);
+
+// Run everything submitted so far, in a single system call.
+Result ioring_enter(IORing *ring);
+
+// Take the oldest completion, returns false if there is none left.
+bool ioring_completion(IORing *ring, IORingCompletion *completion);
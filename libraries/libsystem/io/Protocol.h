@@ -0,0 +1,180 @@
+#pragma once
+
+#include <abi/Message.h>
+
+#include <libsystem/Assert.h>
+#include <libsystem/io/Connection.h>
+
+// What the code generated by toolbox/ipc-compiler.py from protocols/*.ipc
+// builds on. A message is a header followed by its own fields and nothing
+// more. They are encoded in place one after the other, and go out together
+// as a single message of the connection.
+
+#define PROTOCOL_ALIGN 4
+
+struct ProtocolHeader
+{
+    uint32_t magic;
+    uint16_t type;
+
+    // Of the whole message, the header included.
+    uint16_t size;
+};
+
+// Memory objects and handles go along as attachments of the message, the
+// field only says which one it is.
+struct ProtocolAttachment
+{
+    int index;
+};
+
+struct ProtocolBatch;
+
+typedef void (*ProtocolFlushCallback)(void *target, ProtocolBatch *batch);
+
+struct ProtocolBatch
+{
+    void *target;
+    ProtocolFlushCallback callback;
+
+    Message message;
+    char buffer[MESSAGE_SIZE_MAX];
+};
+
+template <typename T>
+constexpr size_t protocol_size()
+{
+    return __align_up(sizeof(ProtocolHeader) + sizeof(T), PROTOCOL_ALIGN);
+}
+
+static inline void protocol_batch_initialize(ProtocolBatch *batch, void *target, ProtocolFlushCallback callback)
+{
+    batch->target = target;
+    batch->callback = callback;
+
+    batch->message = {};
+    batch->message.buffer = batch->buffer;
+}
+
+static inline bool protocol_batch_empty(ProtocolBatch *batch)
+{
+    return batch->message.size == 0;
+}
+
+static inline void protocol_batch_flush(ProtocolBatch *batch)
+{
+    if (protocol_batch_empty(batch))
+    {
+        return;
+    }
+
+    batch->callback(batch->target, batch);
+
+    batch->message.size = 0;
+    batch->message.attachments_count = 0;
+}
+
+// Room for a message at the end of the batch, which is flushed first if it
+// doesn't fit.
+static inline void *protocol_batch_reserve(ProtocolBatch *batch, uint32_t magic, uint16_t type, size_t size, size_t attachments)
+{
+    size = __align_up(sizeof(ProtocolHeader) + size, PROTOCOL_ALIGN);
+
+    assert(size <= MESSAGE_SIZE_MAX);
+    assert(attachments <= MESSAGE_ATTACHMENT_COUNT);
+
+    if (batch->message.size + size > MESSAGE_SIZE_MAX ||
+        batch->message.attachments_count + attachments > MESSAGE_ATTACHMENT_COUNT)
+    {
+        protocol_batch_flush(batch);
+    }
+
+    ProtocolHeader *header = (ProtocolHeader *)(batch->buffer + batch->message.size);
+
+    header->magic = magic;
+    header->type = type;
+    header->size = size;
+
+    batch->message.size += size;
+
+    return header + 1;
+}
+
+// The room for the attachments was made when the message was reserved.
+static inline ProtocolAttachment protocol_batch_attach(ProtocolBatch *batch, MessageAttachmentType type, int id)
+{
+    if (id == HANDLE_INVALID_ID)
+    {
+        return {-1};
+    }
+
+    size_t index = batch->message.attachments_count;
+
+    batch->message.attachments[index] = {type, id, 0, 0};
+    batch->message.attachments_count++;
+
+    return {(int)index};
+}
+
+template <typename T>
+T *protocol_encode(ProtocolBatch *batch, uint32_t magic)
+{
+    return (T *)protocol_batch_reserve(batch, magic, (uint16_t)T::TYPE, sizeof(T), T::ATTACHMENTS);
+}
+
+template <typename T>
+bool protocol_is(const ProtocolHeader *header)
+{
+    return header->size == protocol_size<T>();
+}
+
+// Call callback with each message of the batch, until one of them doesn't
+// add up or callback says so.
+template <typename Callback>
+bool protocol_decode(Message *message, uint32_t magic, Callback callback)
+{
+    size_t offset = 0;
+
+    while (offset < message->size)
+    {
+        if (message->size - offset < sizeof(ProtocolHeader))
+        {
+            return false;
+        }
+
+        const ProtocolHeader *header = (const ProtocolHeader *)((const char *)message->buffer + offset);
+
+        if (header->magic != magic ||
+            header->size < sizeof(ProtocolHeader) ||
+            header->size > message->size - offset)
+        {
+            return false;
+        }
+
+        if (!callback(header, (const void *)(header + 1)))
+        {
+            return false;
+        }
+
+        offset += header->size;
+    }
+
+    return true;
+}
+
+// The attachment a field refers to, if the message came with it.
+static inline MessageAttachment *protocol_attachment(Message *message, ProtocolAttachment attachment)
+{
+    if (attachment.index < 0 || (size_t)attachment.index >= message->attachments_count)
+    {
+        return nullptr;
+    }
+
+    return &message->attachments[attachment.index];
+}
+
+// For batches sent right away on a connection.
+static inline void protocol_batch_send(Connection *connection, ProtocolBatch *batch)
+{
+    connection_send_message(connection, &batch->message);
+}
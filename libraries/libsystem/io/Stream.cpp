@@ -279,6 +279,80 @@ size_t stream_write(Stream *stream, const void *buffer, size_t size)
     }
 }
 
+size_t stream_readv(Stream *stream, const IOVector *vectors, size_t count)
+{
+    if (!stream)
+        return 0;
+
+    size_t result = 0;
+
+    if (stream->has_unget || stream->read_head != stream->read_used)
+    {
+        // What's already buffered comes first, one buffer at the time.
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t read = stream_read(stream, vectors[i].buffer, vectors[i].size);
+            result += read;
+
+            if (read < vectors[i].size)
+            {
+                break;
+            }
+        }
+
+        return result;
+    }
+
+    result = __plug_handle_readv(HANDLE(stream), vectors, count);
+
+    if (result == 0)
+    {
+        stream->is_end_of_file = true;
+    }
+
+    return result;
+}
+
+size_t stream_writev(Stream *stream, const IOVector *vectors, size_t count)
+{
+    if (!stream)
+        return 0;
+
+    stream_flush(stream);
+
+    return __plug_handle_writev(HANDLE(stream), vectors, count);
+}
+
+size_t stream_pread(Stream *stream, void *buffer, size_t size, size_t offset)
+{
+    if (!stream)
+        return 0;
+
+    stream_flush(stream);
+
+    return __plug_handle_pread(HANDLE(stream), buffer, size, offset);
+}
+
+size_t stream_pwrite(Stream *stream, const void *buffer, size_t size, size_t offset)
+{
+    if (!stream)
+        return 0;
+
+    stream_flush(stream);
+
+    return __plug_handle_pwrite(HANDLE(stream), buffer, size, offset);
+}
+
+size_t stream_donate(Stream *stream, const void *buffer, size_t size)
+{
+    if (!stream)
+        return 0;
+
+    stream_flush(stream);
+
+    return __plug_handle_donate(HANDLE(stream), buffer, size);
+}
+
 void stream_flush(Stream *stream)
 {
     if (!stream)
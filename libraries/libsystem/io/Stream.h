@@ -42,6 +42,20 @@ size_t stream_read(Stream *stream, void *buffer, size_t size);
 
 size_t stream_write(Stream *stream, const void *buffer, size_t size);
 
+// Fill or drain the buffers in order, with a single system call.
+size_t stream_readv(Stream *stream, const IOVector *vectors, size_t count);
+
+size_t stream_writev(Stream *stream, const IOVector *vectors, size_t count);
+
+// Read or write at offset without moving the stream.
+size_t stream_pread(Stream *stream, void *buffer, size_t size, size_t offset);
+
+size_t stream_pwrite(Stream *stream, const void *buffer, size_t size, size_t offset);
+
+// Write buffer, pipes take its whole pages instead of copying them, so what's
+// left in buffer afterward is unspecified.
+size_t stream_donate(Stream *stream, const void *buffer, size_t size);
+
 void stream_flush(Stream *stream);
 
 Result stream_call(Stream *stream, IOCall request, void *arg);
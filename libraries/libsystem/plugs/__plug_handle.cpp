@@ -39,6 +39,65 @@ size_t __plug_handle_write(Handle *handle, const void *buffer, size_t size)
     return written;
 }
 
+size_t __plug_handle_readv(Handle *handle, const IOVector *vectors, size_t count)
+{
+    size_t read;
+
+    handle->result = __syscall(SYS_HANDLE_READV, handle->id, (int)vectors, count, (int)&read);
+
+    return read;
+}
+
+size_t __plug_handle_writev(Handle *handle, const IOVector *vectors, size_t count)
+{
+    size_t written;
+
+    handle->result = __syscall(SYS_HANDLE_WRITEV, handle->id, (int)vectors, count, (int)&written);
+
+    return written;
+}
+
+size_t __plug_handle_pread(Handle *handle, void *buffer, size_t size, size_t offset)
+{
+    size_t read;
+
+    handle->result = __syscall(SYS_HANDLE_PREAD, handle->id, (int)buffer, size, offset, (int)&read);
+
+    return read;
+}
+
+size_t __plug_handle_pwrite(Handle *handle, const void *buffer, size_t size, size_t offset)
+{
+    size_t written;
+
+    handle->result = __syscall(SYS_HANDLE_PWRITE, handle->id, (int)buffer, size, offset, (int)&written);
+
+    return written;
+}
+
+size_t __plug_handle_donate(Handle *handle, const void *buffer, size_t size)
+{
+    size_t written;
+
+    handle->result = __syscall(SYS_HANDLE_DONATE, handle->id, (int)buffer, size, (int)&written);
+
+    return written;
+}
+
+Result __plug_handle_send(Handle *handle, const Message *message)
+{
+    handle->result = __syscall(SYS_HANDLE_SEND, handle->id, (int)message);
+
+    return handle->result;
+}
+
+Result __plug_handle_receive(Handle *handle, Message *message)
+{
+    handle->result = __syscall(SYS_HANDLE_RECEIVE, handle->id, (int)message);
+
+    return handle->result;
+}
+
 Result __plug_handle_call(Handle *handle, IOCall request, void *args)
 {
 
@@ -80,6 +139,18 @@ void __plug_handle_accept(Handle *handle, Handle *connection_handle)
     handle->result = __syscall(SYS_HANDLE_ACCEPT, handle->id, (int)&connection_handle->id);
 }
 
+Result __plug_handle_map(Handle *handle, uintptr_t *out_address, size_t *out_size)
+{
+    handle->result = __syscall(SYS_HANDLE_MAP, handle->id, (int)out_address, (int)out_size);
+
+    return handle->result;
+}
+
+Result __plug_handle_ring(IORing *ring)
+{
+    return __syscall(SYS_HANDLE_RING, (int)ring);
+}
+
 Result __plug_create_pipe(int *reader_handle, int *writer_handle)
 {
     return __syscall(SYS_CREATE_PIPE, (int)reader_handle, (int)writer_handle);
@@ -1,42 +1,96 @@
-
 #include <libsystem/thread/Atomic.h>
+#include <libsystem/thread/Spinlock.h>
 
 #include "arch/Arch.h"
 
-static bool atomic_enabled = false;
-static uint atomic_depth = 0;
+// Atomic sections are protected by a single kernel lock shared by every
+// processor, the nesting depth and the interrupt state are per processor.
+static Spinlock kernel_lock = {};
+static volatile int kernel_lock_owner = -1;
+
+static bool atomic_enabled[ARCH_PROCESSOR_MAX_COUNT] = {};
+static uint atomic_depth[ARCH_PROCESSOR_MAX_COUNT] = {};
+static bool atomic_locked_by_interrupt[ARCH_PROCESSOR_MAX_COUNT] = {};
+
+static void kernel_lock_acquire(int processor)
+{
+    spinlock_acquire(&kernel_lock);
+    kernel_lock_owner = processor;
+
+    // Another processor may have unmapped kernel memory while we were waiting.
+    arch_tlb_sync();
+}
+
+static void kernel_lock_release()
+{
+    kernel_lock_owner = -1;
+    spinlock_release(&kernel_lock);
+}
 
 bool is_atomic()
 {
-    return !atomic_enabled || atomic_depth > 0;
+    int processor = arch_processor_id();
+
+    return !atomic_enabled[processor] || atomic_depth[processor] > 0;
 }
 
 void atomic_enable()
 {
-    atomic_enabled = true;
+    int processor = arch_processor_id();
+
+    if (atomic_locked_by_interrupt[processor])
+    {
+        atomic_locked_by_interrupt[processor] = false;
+        kernel_lock_release();
+    }
+
+    atomic_enabled[processor] = true;
 }
 
 void atomic_disable()
 {
-    atomic_enabled = false;
+    int processor = arch_processor_id();
+
+    atomic_enabled[processor] = false;
+
+    if (kernel_lock_owner != processor)
+    {
+        kernel_lock_acquire(processor);
+        atomic_locked_by_interrupt[processor] = true;
+    }
 }
 
 void atomic_begin()
 {
-    if (atomic_enabled)
+    // Interrupts must be off before looking up the processor,
+    // otherwise we could be moved to another one in between.
+    arch_disable_interupts();
+
+    int processor = arch_processor_id();
+
+    if (atomic_enabled[processor])
     {
-        arch_disable_interupts();
-        atomic_depth++;
+        if (atomic_depth[processor] == 0)
+        {
+            kernel_lock_acquire(processor);
+        }
+
+        atomic_depth[processor]++;
     }
 }
 
 void atomic_end()
 {
-    if (atomic_enabled)
+    int processor = arch_processor_id();
+
+    if (atomic_enabled[processor])
     {
-        atomic_depth--;
+        atomic_depth[processor]--;
 
-        if (atomic_depth == 0)
+        if (atomic_depth[processor] == 0)
+        {
+            kernel_lock_release();
             arch_enable_interupts();
+        }
     }
 }
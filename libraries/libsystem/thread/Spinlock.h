@@ -0,0 +1,33 @@
+#pragma once
+
+#include <libsystem/Common.h>
+
+// Busy-waiting lock for very short critical sections that can be entered by
+// several processors at once, it never sleeps so it can be taken with the
+// interrupts disabled.
+struct Spinlock
+{
+    volatile int locked;
+};
+
+static inline bool spinlock_try_acquire(Spinlock *lock)
+{
+    return __sync_lock_test_and_set(&lock->locked, 1) == 0;
+}
+
+static inline void spinlock_acquire(Spinlock *lock)
+{
+    while (!spinlock_try_acquire(lock))
+    {
+        // Spin on a plain read so we don't bounce the cache line around.
+        while (lock->locked)
+        {
+            asm volatile("pause");
+        }
+    }
+}
+
+static inline void spinlock_release(Spinlock *lock)
+{
+    __sync_lock_release(&lock->locked);
+}
@@ -17,6 +17,7 @@ struct HashMap
 {
     List **buckets;
     size_t buckets_count;
+    size_t count;
 
     HashMapCopyKeyCallback copy_key;
     HashMapHashKeyCallback hash_key;
@@ -52,6 +53,10 @@ static void hashmap_string_destroy(char *string)
 
 #define HASHMAP_BUCKET_COUNT 32
 
+// Past this many items per bucket on average the buckets are doubled, so
+// lookups stay O(1) no matter how many items there are.
+#define HASHMAP_LOAD_FACTOR 2
+
 HashMap *hashmap_create_string_to_value()
 {
     HashMap *hashmap = __create(HashMap);
@@ -81,7 +86,7 @@ void hashmap_destroy_with_callback(
     HashMap *hashmap,
     HashMapDestroyValueCallback callback)
 {
-    for (size_t i = 0; i < HASHMAP_BUCKET_COUNT; i++)
+    for (size_t i = 0; i < hashmap->buckets_count; i++)
     {
         list_foreach(HashMapItem, item, hashmap->buckets[i])
         {
@@ -109,7 +114,7 @@ void hashmap_clear_with_callback(
     HashMap *hashmap,
     HashMapDestroyValueCallback callback)
 {
-    for (size_t i = 0; i < HASHMAP_BUCKET_COUNT; i++)
+    for (size_t i = 0; i < hashmap->buckets_count; i++)
     {
         list_foreach(HashMapItem, item, hashmap->buckets[i])
         {
@@ -123,6 +128,8 @@ void hashmap_clear_with_callback(
 
         list_clear_with_callback(hashmap->buckets[i], free);
     }
+
+    hashmap->count = 0;
 }
 
 static HashMapItem *hashmap_find_item(HashMap *hashmap, const void *key)
@@ -161,6 +168,32 @@ static HashMapItem *hashmap_find_item_by_value(HashMap *hashmap, void *value)
     return nullptr;
 }
 
+static void hashmap_grow(HashMap *hashmap)
+{
+    size_t buckets_count = hashmap->buckets_count * 2;
+    List **buckets = (List **)calloc(buckets_count, sizeof(List *));
+
+    for (size_t i = 0; i < buckets_count; i++)
+    {
+        buckets[i] = list_create();
+    }
+
+    for (size_t i = 0; i < hashmap->buckets_count; i++)
+    {
+        list_foreach(HashMapItem, item, hashmap->buckets[i])
+        {
+            list_pushback(buckets[item->hash % buckets_count], item);
+        }
+
+        list_destroy(hashmap->buckets[i]);
+    }
+
+    free(hashmap->buckets);
+
+    hashmap->buckets = buckets;
+    hashmap->buckets_count = buckets_count;
+}
+
 bool hashmap_put(HashMap *hashmap, const void *key, void *value)
 {
     if (hashmap_has(hashmap, key))
@@ -178,6 +211,13 @@ bool hashmap_put(HashMap *hashmap, const void *key, void *value)
 
     list_pushback(bucket, item);
 
+    hashmap->count++;
+
+    if (hashmap->count > hashmap->buckets_count * HASHMAP_LOAD_FACTOR)
+    {
+        hashmap_grow(hashmap);
+    }
+
     return true;
 }
 
@@ -235,6 +275,8 @@ bool hashmap_remove_with_callback(
 
     list_remove_with_callback(bucket, item, free);
 
+    hashmap->count--;
+
     return true;
 }
 
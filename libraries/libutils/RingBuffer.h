@@ -3,30 +3,48 @@
 #include <libsystem/Assert.h>
 #include <libsystem/Common.h>
 #include <libsystem/core/CString.h>
+#include <libsystem/math/MinMax.h>
 
 struct RingBuffer;
 
+// The capacity is rounded up to a power of two, so positions wrap with a
+// mask. _head and _tail run freely and are only masked to index the buffer.
 class RingBuffer
 {
 private:
     size_t _head = 0;
     size_t _tail = 0;
     size_t _size = 0;
-    size_t _used = 0;
 
     char *_buffer = nullptr;
 
+    static size_t round_up(size_t size)
+    {
+        size_t rounded = 1;
+
+        while (rounded < size)
+        {
+            rounded <<= 1;
+        }
+
+        return rounded;
+    }
+
+    size_t mask() const
+    {
+        return _size - 1;
+    }
+
 public:
     RingBuffer(size_t size)
     {
-        _size = size;
-        _buffer = new char[size];
+        _size = round_up(size);
+        _buffer = new char[_size];
     }
 
     RingBuffer(const RingBuffer &other) : _head(other._head),
                                           _tail(other._tail),
-                                          _size(other._size),
-                                          _used(other._used)
+                                          _size(other._size)
     {
         _buffer = new char[other._size];
         memcpy(_buffer, other._buffer, other._size);
@@ -36,13 +54,11 @@ public:
         : _head(other._head),
           _tail(other._tail),
           _size(other._size),
-          _used(other._used),
           _buffer(other._buffer)
     {
         other._head = 0;
         other._tail = 0;
         other._size = 0;
-        other._used = 0;
         other._buffer = nullptr;
     }
 
@@ -56,7 +72,6 @@ public:
         swap(_head, other._head);
         swap(_tail, other._tail);
         swap(_size, other._size);
-        swap(_used, other._used);
         swap(_buffer, other._buffer);
 
         return *this;
@@ -70,69 +85,106 @@ public:
 
     bool empty() const
     {
-        return _used == 0;
+        return _head == _tail;
     }
 
     bool full() const
     {
-        return _used == _size;
+        return used() == _size;
     }
 
     size_t used() const
     {
-        return _used;
+        return _head - _tail;
+    }
+
+    size_t capacity() const
+    {
+        return _size;
+    }
+
+    // Move the content to a buffer of at least size bytes, fails if it doesn't fit.
+    bool resize(size_t size)
+    {
+        size_t new_size = round_up(size);
+
+        if (new_size < used())
+        {
+            return false;
+        }
+
+        char *new_buffer = new char[new_size];
+        size_t new_used = read(new_buffer, used());
+
+        delete[] _buffer;
+
+        _buffer = new_buffer;
+        _size = new_size;
+        _head = new_used;
+        _tail = 0;
+
+        return true;
     }
 
     void put(char c)
     {
         assert(!full());
 
-        _buffer[_head] = c;
-        _head = (_head + 1) % (_size);
-        _used++;
+        _buffer[_head & mask()] = c;
+        _head++;
     }
 
     char get()
     {
         assert(!empty());
 
-        char c = _buffer[_tail];
-        _tail = (_tail + 1) % (_size);
-        _used--;
+        char c = _buffer[_tail & mask()];
+        _tail++;
 
         return c;
     }
 
     char peek(size_t peek)
     {
-        int offset = (_tail + peek) % (_size);
-
-        return _buffer[offset];
+        return _buffer[(_tail + peek) & mask()];
     }
 
+    // Both copy in at most two pieces: up to the end of the buffer, then from its start.
     size_t read(char *buffer, size_t size)
     {
-        size_t read = 0;
+        size = MIN(size, used());
 
-        while (!empty() && read < size)
-        {
-            buffer[read] = get();
-            read++;
-        }
+        size_t offset = _tail & mask();
+        size_t first = MIN(size, _size - offset);
+
+        memcpy(buffer, _buffer + offset, first);
+        memcpy(buffer + first, _buffer, size - first);
 
-        return read;
+        _tail += size;
+
+        return size;
+    }
+
+    size_t skip(size_t size)
+    {
+        size = MIN(size, used());
+        _tail += size;
+
+        return size;
     }
 
     size_t write(const char *buffer, size_t size)
     {
-        size_t written = 0;
+        size = MIN(size, _size - used());
 
-        while (!full() && written < size)
-        {
-            put(buffer[written]);
-            written++;
-        }
+        size_t offset = _head & mask();
+        size_t first = MIN(size, _size - offset);
+
+        memcpy(_buffer + offset, buffer, first);
+        memcpy(_buffer, buffer + first, size - first);
+
+        _head += size;
 
-        return written;
+        return size;
     }
 };
@@ -1,17 +1,21 @@
 #include <libsystem/Assert.h>
 #include <libsystem/Logger.h>
 #include <libsystem/core/CString.h>
+#include <libsystem/core/Plugs.h>
+#include <libsystem/eventloop/Channel.h>
 #include <libsystem/eventloop/EventLoop.h>
 #include <libsystem/eventloop/Notifier.h>
 #include <libsystem/io/Connection.h>
+#include <libsystem/io/Protocol.h>
 #include <libsystem/io/Socket.h>
 #include <libsystem/process/Process.h>
+#include <libsystem/system/Memory.h>
 #include <libsystem/utils/Hexdump.h>
 
 #include <libwidget/Application.h>
 #include <libwidget/Screen.h>
 
-#include "compositor/Protocol.h"
+#include "protocols/compositor.h"
 
 enum ApplicationState
 {
@@ -26,86 +30,271 @@ static ApplicationState _state = APPLICATION_NONE;
 static List *_windows;
 static Connection *_connection;
 static Notifier *_connection_notifier;
+static Channel *_events;
+static Notifier *_events_notifier;
+
+// The last event handled from the channel and from the connection, the
+// others say which one they come after.
+static uint32_t _events_last_popped = 0;
+static uint32_t _events_last_received = 0;
 static bool _is_debbuging_layout = false;
 
-void application_do_message(CompositorMessage *message)
+static ProtocolBatch _outbox;
+static int _acks = 0;
+
+// What comes in while waiting for an ack is kept for after it, so the
+// windows don't get events in the middle of being flipped.
+struct ApplicationPending
+{
+    protocol::Application::Type type;
+    protocol::Application::ChangedResolution changed_resolution;
+    protocol::Application::EventWindow event_window;
+};
+
+static List *_pending;
+static bool _waiting_for_ack = false;
+static bool _replaying_pending = false;
+
+static void application_flush()
+{
+    protocol_batch_flush(&_outbox);
+}
+
+// Messages to the compositor go together, once the event loop gets to them
+// or before waiting for it.
+static ProtocolBatch *application_outbox()
+{
+    if (protocol_batch_empty(&_outbox))
+    {
+        eventloop_run_later((RunLaterCallback)application_flush, nullptr);
+    }
+
+    return &_outbox;
+}
+
+void application_events_callback(void *target, Handle *handle, SelectEvent events);
+
+static Result application_receive();
+
+static void application_handle_event_window(const protocol::Application::EventWindow &event_window)
 {
-    if (message->type == COMPOSITOR_MESSAGE_EVENT_WINDOW)
+    Window *window = application_get_window(event_window.id);
+
+    if (window)
     {
-        Window *window = application_get_window(message->event_window.id);
+        Event event = event_window.event;
+        window_event(window, &event);
+    }
+}
+
+static void application_handle_changed_resolution(const protocol::Application::ChangedResolution &changed_resolution)
+{
+    Screen::bound(changed_resolution.resolution);
 
-        if (window)
+    list_foreach(Window, window, _windows)
+    {
+        Event event = {
+            .type = Event::DISPLAY_SIZE_CHANGED,
+            .accepted = false,
+            .mouse = {},
+            .keyboard = {},
+        };
+
+        window_event(window, &event);
+    }
+}
+
+// The events queued in the channel before this one come first.
+static void application_handle_received_event_window(const protocol::Application::EventWindow &event_window)
+{
+    protocol::Application::EventWindow popped = {};
+
+    while (_events &&
+           _events_last_popped != event_window.after &&
+           channel_pop(_events, &popped))
+    {
+        application_handle_event_window(popped);
+        _events_last_popped = popped.sequence;
+    }
+
+    application_handle_event_window(event_window);
+    _events_last_received = event_window.sequence;
+}
+
+struct ApplicationSignals
+{
+    void handle(const protocol::Application::Ack &, Message *)
+    {
+        _acks++;
+    }
+
+    // Window events come through the channel that came along, if any.
+    void handle(const protocol::Application::Greetings &greetings, Message *message)
+    {
+        Screen::bound(greetings.screen_bound);
+
+        MessageAttachment *memory = protocol_attachment(message, greetings.events);
+        MessageAttachment *doorbell = protocol_attachment(message, greetings.events_doorbell);
+
+        if (_events || !memory || !doorbell)
+        {
+            return;
+        }
+
+        _events = channel_open(memory, doorbell, sizeof(protocol::Application::EventWindow));
+
+        if (_events)
         {
-            window_event(window, &message->event_window.event);
+            _events_notifier = notifier_create(
+                nullptr,
+                channel_doorbell(_events),
+                SELECT_READ,
+                (NotifierCallback)application_events_callback);
         }
     }
-    else if (message->type == COMPOSITOR_MESSAGE_CHANGED_RESOLUTION)
-    {
-        Screen::bound(message->changed_resolution.resolution);
 
-        list_foreach(Window, window, _windows)
+    void handle(const protocol::Application::ChangedResolution &changed_resolution, Message *)
+    {
+        if (_waiting_for_ack)
         {
-            Event event = {
-                .type = Event::DISPLAY_SIZE_CHANGED,
-                .accepted = false,
-                .mouse = {},
-                .keyboard = {},
-            };
-
-            window_event(window, &event);
+            ApplicationPending pending = {};
+            pending.type = protocol::Application::Type::CHANGED_RESOLUTION;
+            pending.changed_resolution = changed_resolution;
+            list_pushback_copy(_pending, &pending, sizeof(ApplicationPending));
+
+            return;
         }
+
+        application_handle_changed_resolution(changed_resolution);
     }
-    else
+
+    void handle(const protocol::Application::EventWindow &event_window, Message *)
     {
-        logger_error("Got an invalid message from compositor (%d)!", message->type);
-        hexdump(&message, sizeof(CompositorMessage));
-        application_exit(-1);
+        if (_waiting_for_ack)
+        {
+            ApplicationPending pending = {};
+            pending.type = protocol::Application::Type::EVENT_WINDOW;
+            pending.event_window = event_window;
+            list_pushback_copy(_pending, &pending, sizeof(ApplicationPending));
+
+            return;
+        }
+
+        application_handle_received_event_window(event_window);
     }
-}
+};
 
-void application_send_message(CompositorMessage message)
+static void application_release_attachments(Message *message)
 {
-    connection_send(_connection, &message, sizeof(CompositorMessage));
+    for (size_t i = 0; i < message->attachments_count; i++)
+    {
+        MessageAttachment &attachment = message->attachments[i];
+
+        if (attachment.id == HANDLE_INVALID_ID)
+        {
+            continue;
+        }
+
+        if (attachment.type == MESSAGE_ATTACHMENT_MEMORY)
+        {
+            memory_free(attachment.address);
+        }
+        else if (attachment.type == MESSAGE_ATTACHMENT_HANDLE)
+        {
+            Handle handle = {attachment.id, 0, SUCCESS};
+            __plug_handle_close(&handle);
+        }
+    }
 }
 
-CompositorMessage *application_wait_for_message(CompositorMessageType expected_message)
+// Wait for the next batch of messages from the compositor and handle them.
+static Result application_receive()
 {
-    List *pending_messages = nullptr;
+    char buffer[MESSAGE_SIZE_MAX];
 
-    CompositorMessage *message = __create(CompositorMessage);
-    connection_receive(_connection, message, sizeof(CompositorMessage));
+    Message message = {};
+    message.buffer = buffer;
+    message.size = MESSAGE_SIZE_MAX;
 
-    while (message->type != expected_message)
+    Result result = connection_receive_message(_connection, &message);
+
+    if (result != SUCCESS)
     {
-        if (pending_messages == nullptr)
-        {
-            pending_messages = list_create();
-        }
+        logger_error("Connection to the compositor closed %s!", result_to_string(result));
+        return result;
+    }
+
+    ApplicationSignals signals;
+
+    if (!protocol::Application::dispatch(signals, &message))
+    {
+        logger_error("Got an invalid message from compositor!");
+        hexdump(buffer, message.size);
 
-        list_pushback(pending_messages, message);
-        message = __create(CompositorMessage);
-        connection_receive(_connection, message, sizeof(CompositorMessage));
+        result = ERR_INVALID_ARGUMENT;
     }
 
-    if (pending_messages)
+    application_release_attachments(&message);
+
+    return result;
+}
+
+static void application_replay_pending()
+{
+    // A window flipped by one of these waits again, what comes in meanwhile
+    // goes at the back of the list and is handled by this loop.
+    if (_replaying_pending)
     {
-        list_foreach(CompositorMessage, message, pending_messages)
+        return;
+    }
+
+    _replaying_pending = true;
+
+    ApplicationPending *pending = nullptr;
+
+    while (list_pop(_pending, (void **)&pending))
+    {
+        if (pending->type == protocol::Application::Type::CHANGED_RESOLUTION)
         {
-            application_do_message(message);
+            application_handle_changed_resolution(pending->changed_resolution);
+        }
+        else
+        {
+            application_handle_received_event_window(pending->event_window);
         }
 
-        list_destroy_with_callback(pending_messages, free);
+        free(pending);
     }
 
-    return message;
+    _replaying_pending = false;
 }
 
 void application_wait_for_ack()
 {
-    CompositorMessage *ack_message = application_wait_for_message(COMPOSITOR_MESSAGE_ACK);
-    if (ack_message)
+    application_flush();
+
+    bool was_waiting_for_ack = _waiting_for_ack;
+    _waiting_for_ack = true;
+
+    Result result = SUCCESS;
+
+    while (_acks == 0 && result == SUCCESS)
+    {
+        result = application_receive();
+    }
+
+    _waiting_for_ack = was_waiting_for_ack;
+
+    if (result != SUCCESS)
     {
-        free(ack_message);
+        return;
+    }
+
+    _acks--;
+
+    if (!_waiting_for_ack)
+    {
+        application_replay_pending();
     }
 }
 
@@ -115,26 +304,40 @@ void application_request_callback(
     SelectEvent events)
 {
     __unused(target);
+    __unused(connection);
     __unused(events);
 
-    CompositorMessage message = {};
-    memset((void *)&message, 0xff, sizeof(CompositorMessage));
-    size_t message_size = connection_receive(connection, &message, sizeof(CompositorMessage));
-
-    if (handle_has_error(connection))
+    if (application_receive() != SUCCESS)
     {
-        logger_error("Connection to the compositor closed %s!", handle_error_string(connection));
         application_exit(-1);
     }
+}
 
-    if (message_size != sizeof(CompositorMessage))
+void application_events_callback(void *target, Handle *handle, SelectEvent events)
+{
+    __unused(target);
+    __unused(handle);
+    __unused(events);
+
+    channel_acknowledge(_events);
+
+    protocol::Application::EventWindow event_window = {};
+
+    while (_state == APPLICATION_RUNNING && channel_pop(_events, &event_window))
     {
-        logger_error("Got a message with an invalid size from compositor %u != %u!", sizeof(CompositorMessage), message_size);
-        hexdump(&message, message_size);
-        application_exit(-1);
-    }
+        // The ones which went through the connection meanwhile come first,
+        // they were sent before this one was queued.
+        while (_events_last_received != event_window.after)
+        {
+            if (application_receive() != SUCCESS)
+            {
+                return;
+            }
+        }
 
-    application_do_message(&message);
+        application_handle_event_window(event_window);
+        _events_last_popped = event_window.sequence;
+    }
 }
 
 Result application_initialize(int argc, char **argv)
@@ -162,7 +365,7 @@ Result application_initialize(int argc, char **argv)
     if (!theme_changed)
         theme_load("/System/Themes/skift-dark.json");
 
-    _connection = socket_connect("/Session/compositor.ipc");
+    _connection = socket_connect(protocol::COMPOSITOR_PATH);
 
     if (handle_has_error(_connection))
     {
@@ -175,6 +378,7 @@ Result application_initialize(int argc, char **argv)
     }
 
     _windows = list_create();
+    _pending = list_create();
 
     eventloop_initialize();
 
@@ -184,13 +388,16 @@ Result application_initialize(int argc, char **argv)
         SELECT_READ,
         (NotifierCallback)application_request_callback);
 
+    protocol_batch_initialize(&_outbox, _connection, (ProtocolFlushCallback)protocol_batch_send);
+
     _state = APPLICATION_INITALIZED;
 
-    CompositorMessage *greetings_message = application_wait_for_message(COMPOSITOR_MESSAGE_GREETINGS);
+    // The compositor greets us before anything else.
+    application_receive();
 
-    if (greetings_message)
+    if (!_events)
     {
-        Screen::bound((greetings_message->greetings.screen_bound));
+        logger_warn("No events channel from the compositor, they will come through the connection.");
     }
 
     return SUCCESS;
@@ -235,6 +442,8 @@ void application_exit(int exit_value)
         window = (Window *)list_peek(_windows);
     }
 
+    application_flush();
+
     eventloop_exit(exit_value);
 
     _state = APPLICATION_NONE;
@@ -308,21 +517,20 @@ void application_show_window(Window *window)
     assert(_state >= APPLICATION_INITALIZED);
     assert(list_contains(_windows, window));
 
-    CompositorMessage message = {
-        .type = COMPOSITOR_MESSAGE_CREATE_WINDOW,
-        .create_window = {
-            .id = window_handle(window),
-            .flags = window->flags,
-            .type = window->type(),
-            .frontbuffer = window_frontbuffer_handle(window),
-            .frontbuffer_size = window->frontbuffer->size(),
-            .backbuffer = window_backbuffer_handle(window),
-            .backbuffer_size = window->frontbuffer->size(),
-            .bound = window->bound_on_screen(),
-        },
-    };
-
-    application_send_message(message);
+    // The compositor gets the buffers along with the message, so they have
+    // to still be there when it is sent.
+    protocol::Compositor::create_window(
+        application_outbox(),
+        window_handle(window),
+        window->flags,
+        window->type(),
+        window_frontbuffer_handle(window),
+        window->frontbuffer->size(),
+        window_backbuffer_handle(window),
+        window->frontbuffer->size(),
+        window->bound_on_screen());
+
+    application_flush();
 }
 
 void application_hide_window(Window *window)
@@ -330,14 +538,8 @@ void application_hide_window(Window *window)
     assert(_state >= APPLICATION_INITALIZED);
     assert(list_contains(_windows, window));
 
-    CompositorMessage message = {
-        .type = COMPOSITOR_MESSAGE_DESTROY_WINDOW,
-        .destroy_window = {
-            .id = window_handle(window),
-        },
-    };
+    protocol::Compositor::destroy_window(application_outbox(), window_handle(window));
 
-    application_send_message(message);
     application_exit_if_all_windows_are_closed();
 }
 
@@ -346,19 +548,15 @@ void application_flip_window(Window *window, Rectangle bound)
     assert(_state >= APPLICATION_INITALIZED);
     assert(list_contains(_windows, window));
 
-    CompositorMessage message = {
-        .type = COMPOSITOR_MESSAGE_FLIP_WINDOW,
-        .flip_window = {
-            .id = window_handle(window),
-            .frontbuffer = window_frontbuffer_handle(window),
-            .frontbuffer_size = window->frontbuffer->size(),
-            .backbuffer = window_backbuffer_handle(window),
-            .backbuffer_size = window->frontbuffer->size(),
-            .bound = bound,
-        },
-    };
-
-    application_send_message(message);
+    protocol::Compositor::flip_window(
+        application_outbox(),
+        window_handle(window),
+        window_frontbuffer_handle(window),
+        window->frontbuffer->size(),
+        window_backbuffer_handle(window),
+        window->frontbuffer->size(),
+        bound);
+
     application_wait_for_ack();
 }
 
@@ -367,15 +565,7 @@ void application_move_window(Window *window, Vec2i position)
     assert(_state >= APPLICATION_INITALIZED);
     assert(list_contains(_windows, window));
 
-    CompositorMessage message = {
-        .type = COMPOSITOR_MESSAGE_MOVE_WINDOW,
-        .move_window = {
-            .id = window_handle(window),
-            .position = position,
-        },
-    };
-
-    application_send_message(message);
+    protocol::Compositor::move_window(application_outbox(), window_handle(window), position);
 }
 
 void application_resize_window(Window *window, Rectangle bound)
@@ -383,15 +573,7 @@ void application_resize_window(Window *window, Rectangle bound)
     assert(_state >= APPLICATION_INITALIZED);
     assert(list_contains(_windows, window));
 
-    CompositorMessage message = {
-        .type = COMPOSITOR_MESSAGE_RESIZE_WINDOW,
-        .resize_window = {
-            .id = window_handle(window),
-            .bound = bound,
-        },
-    };
-
-    application_send_message(message);
+    protocol::Compositor::resize_window(application_outbox(), window_handle(window), bound);
 }
 
 void application_window_change_cursor(Window *window, CursorState state)
@@ -399,13 +581,5 @@ void application_window_change_cursor(Window *window, CursorState state)
     assert(_state >= APPLICATION_INITALIZED);
     assert(list_contains(_windows, window));
 
-    CompositorMessage message = {
-        .type = COMPOSITOR_MESSAGE_CURSOR_WINDOW,
-        .cursor_window = {
-            .id = window_handle(window),
-            .state = state,
-        },
-    };
-
-    application_send_message(message);
+    protocol::Compositor::cursor_window(application_outbox(), window_handle(window), state);
 }
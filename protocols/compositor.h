@@ -0,0 +1,407 @@
+#pragma once
+
+// Don't edit this code !
+// It was generated by ipc-compiler.py from protocols/compositor.ipc
+
+#include <compositor/Protocol.h>
+#include <libgraphic/Shape.h>
+#include <libsystem/io/Protocol.h>
+#include <libwidget/Cursor.h>
+#include <libwidget/Event.h>
+
+namespace protocol
+{
+
+static constexpr const char *COMPOSITOR_PATH = "/Session/compositor.ipc";
+
+/* --- Client --------------------------------------------------------------- */
+
+struct Application
+{
+    static constexpr uint32_t MAGIC = 0x553be5a1;
+
+    enum class Type : uint16_t
+    {
+        ACK,
+        GREETINGS,
+        CHANGED_RESOLUTION,
+        EVENT_WINDOW,
+    };
+
+    struct Ack
+    {
+        static constexpr Type TYPE = Type::ACK;
+        static constexpr size_t ATTACHMENTS = 0;
+    };
+
+    struct Greetings
+    {
+        static constexpr Type TYPE = Type::GREETINGS;
+        static constexpr size_t ATTACHMENTS = 2;
+
+        Rectangle screen_bound;
+        ProtocolAttachment events;
+        ProtocolAttachment events_doorbell;
+    };
+
+    struct ChangedResolution
+    {
+        static constexpr Type TYPE = Type::CHANGED_RESOLUTION;
+        static constexpr size_t ATTACHMENTS = 0;
+
+        Rectangle resolution;
+    };
+
+    struct EventWindow
+    {
+        static constexpr Type TYPE = Type::EVENT_WINDOW;
+        static constexpr size_t ATTACHMENTS = 0;
+
+        int id;
+        Event event;
+        uint32_t sequence;
+        uint32_t after;
+    };
+
+    static inline void ack(ProtocolBatch *batch)
+    {
+        protocol_encode<Ack>(batch, MAGIC);
+    }
+
+    static inline void greetings(ProtocolBatch *batch, Rectangle screen_bound, int events, int events_doorbell)
+    {
+        Greetings *message = protocol_encode<Greetings>(batch, MAGIC);
+
+        message->screen_bound = screen_bound;
+        message->events = protocol_batch_attach(batch, MESSAGE_ATTACHMENT_MEMORY, events);
+        message->events_doorbell = protocol_batch_attach(batch, MESSAGE_ATTACHMENT_HANDLE, events_doorbell);
+    }
+
+    static inline void changed_resolution(ProtocolBatch *batch, Rectangle resolution)
+    {
+        ChangedResolution *message = protocol_encode<ChangedResolution>(batch, MAGIC);
+
+        message->resolution = resolution;
+    }
+
+    static inline void event_window(ProtocolBatch *batch, int id, Event event, uint32_t sequence, uint32_t after)
+    {
+        EventWindow *message = protocol_encode<EventWindow>(batch, MAGIC);
+
+        message->id = id;
+        message->event = event;
+        message->sequence = sequence;
+        message->after = after;
+    }
+
+    // Give each message of the batch to handler.handle(), returns false as
+    // soon as one of them isn't what it should be.
+    template <typename Handler>
+    static inline bool dispatch(Handler &handler, Message *message)
+    {
+        return protocol_decode(message, MAGIC, [&](const ProtocolHeader *header, const void *payload) {
+            switch ((Type)header->type)
+            {
+            case Type::ACK:
+                if (!protocol_is<Ack>(header))
+                {
+                    return false;
+                }
+
+                handler.handle(*(const Ack *)payload, message);
+                return true;
+
+            case Type::GREETINGS:
+                if (!protocol_is<Greetings>(header))
+                {
+                    return false;
+                }
+
+                handler.handle(*(const Greetings *)payload, message);
+                return true;
+
+            case Type::CHANGED_RESOLUTION:
+                if (!protocol_is<ChangedResolution>(header))
+                {
+                    return false;
+                }
+
+                handler.handle(*(const ChangedResolution *)payload, message);
+                return true;
+
+            case Type::EVENT_WINDOW:
+                if (!protocol_is<EventWindow>(header))
+                {
+                    return false;
+                }
+
+                handler.handle(*(const EventWindow *)payload, message);
+                return true;
+
+            default:
+                return false;
+            }
+        });
+    }
+};
+
+/* --- Server --------------------------------------------------------------- */
+
+struct Compositor
+{
+    static constexpr uint32_t MAGIC = 0x553be5a1;
+
+    enum class Type : uint16_t
+    {
+        CREATE_WINDOW,
+        DESTROY_WINDOW,
+        RESIZE_WINDOW,
+        MOVE_WINDOW,
+        FLIP_WINDOW,
+        CURSOR_WINDOW,
+        SET_RESOLUTION,
+        SET_WALLPAPER,
+    };
+
+    struct CreateWindow
+    {
+        static constexpr Type TYPE = Type::CREATE_WINDOW;
+        static constexpr size_t ATTACHMENTS = 2;
+
+        int id;
+        WindowFlag flags;
+        WindowType type;
+        ProtocolAttachment frontbuffer;
+        Vec2i frontbuffer_size;
+        ProtocolAttachment backbuffer;
+        Vec2i backbuffer_size;
+        Rectangle bound;
+    };
+
+    struct DestroyWindow
+    {
+        static constexpr Type TYPE = Type::DESTROY_WINDOW;
+        static constexpr size_t ATTACHMENTS = 0;
+
+        int id;
+    };
+
+    struct ResizeWindow
+    {
+        static constexpr Type TYPE = Type::RESIZE_WINDOW;
+        static constexpr size_t ATTACHMENTS = 0;
+
+        int id;
+        Rectangle bound;
+    };
+
+    struct MoveWindow
+    {
+        static constexpr Type TYPE = Type::MOVE_WINDOW;
+        static constexpr size_t ATTACHMENTS = 0;
+
+        int id;
+        Vec2i position;
+    };
+
+    struct FlipWindow
+    {
+        static constexpr Type TYPE = Type::FLIP_WINDOW;
+        static constexpr size_t ATTACHMENTS = 0;
+
+        int id;
+        int frontbuffer;
+        Vec2i frontbuffer_size;
+        int backbuffer;
+        Vec2i backbuffer_size;
+        Rectangle bound;
+    };
+
+    struct CursorWindow
+    {
+        static constexpr Type TYPE = Type::CURSOR_WINDOW;
+        static constexpr size_t ATTACHMENTS = 0;
+
+        int id;
+        CursorState state;
+    };
+
+    struct SetResolution
+    {
+        static constexpr Type TYPE = Type::SET_RESOLUTION;
+        static constexpr size_t ATTACHMENTS = 0;
+
+        int width;
+        int height;
+    };
+
+    struct SetWallpaper
+    {
+        static constexpr Type TYPE = Type::SET_WALLPAPER;
+        static constexpr size_t ATTACHMENTS = 1;
+
+        ProtocolAttachment wallpaper;
+        Vec2i resolution;
+    };
+
+    static inline void create_window(ProtocolBatch *batch, int id, WindowFlag flags, WindowType type, int frontbuffer, Vec2i frontbuffer_size, int backbuffer, Vec2i backbuffer_size, Rectangle bound)
+    {
+        CreateWindow *message = protocol_encode<CreateWindow>(batch, MAGIC);
+
+        message->id = id;
+        message->flags = flags;
+        message->type = type;
+        message->frontbuffer = protocol_batch_attach(batch, MESSAGE_ATTACHMENT_MEMORY, frontbuffer);
+        message->frontbuffer_size = frontbuffer_size;
+        message->backbuffer = protocol_batch_attach(batch, MESSAGE_ATTACHMENT_MEMORY, backbuffer);
+        message->backbuffer_size = backbuffer_size;
+        message->bound = bound;
+    }
+
+    static inline void destroy_window(ProtocolBatch *batch, int id)
+    {
+        DestroyWindow *message = protocol_encode<DestroyWindow>(batch, MAGIC);
+
+        message->id = id;
+    }
+
+    static inline void resize_window(ProtocolBatch *batch, int id, Rectangle bound)
+    {
+        ResizeWindow *message = protocol_encode<ResizeWindow>(batch, MAGIC);
+
+        message->id = id;
+        message->bound = bound;
+    }
+
+    static inline void move_window(ProtocolBatch *batch, int id, Vec2i position)
+    {
+        MoveWindow *message = protocol_encode<MoveWindow>(batch, MAGIC);
+
+        message->id = id;
+        message->position = position;
+    }
+
+    static inline void flip_window(ProtocolBatch *batch, int id, int frontbuffer, Vec2i frontbuffer_size, int backbuffer, Vec2i backbuffer_size, Rectangle bound)
+    {
+        FlipWindow *message = protocol_encode<FlipWindow>(batch, MAGIC);
+
+        message->id = id;
+        message->frontbuffer = frontbuffer;
+        message->frontbuffer_size = frontbuffer_size;
+        message->backbuffer = backbuffer;
+        message->backbuffer_size = backbuffer_size;
+        message->bound = bound;
+    }
+
+    static inline void cursor_window(ProtocolBatch *batch, int id, CursorState state)
+    {
+        CursorWindow *message = protocol_encode<CursorWindow>(batch, MAGIC);
+
+        message->id = id;
+        message->state = state;
+    }
+
+    static inline void set_resolution(ProtocolBatch *batch, int width, int height)
+    {
+        SetResolution *message = protocol_encode<SetResolution>(batch, MAGIC);
+
+        message->width = width;
+        message->height = height;
+    }
+
+    static inline void set_wallpaper(ProtocolBatch *batch, int wallpaper, Vec2i resolution)
+    {
+        SetWallpaper *message = protocol_encode<SetWallpaper>(batch, MAGIC);
+
+        message->wallpaper = protocol_batch_attach(batch, MESSAGE_ATTACHMENT_MEMORY, wallpaper);
+        message->resolution = resolution;
+    }
+
+    // Give each message of the batch to handler.handle(), returns false as
+    // soon as one of them isn't what it should be.
+    template <typename Handler>
+    static inline bool dispatch(Handler &handler, Message *message)
+    {
+        return protocol_decode(message, MAGIC, [&](const ProtocolHeader *header, const void *payload) {
+            switch ((Type)header->type)
+            {
+            case Type::CREATE_WINDOW:
+                if (!protocol_is<CreateWindow>(header))
+                {
+                    return false;
+                }
+
+                handler.handle(*(const CreateWindow *)payload, message);
+                return true;
+
+            case Type::DESTROY_WINDOW:
+                if (!protocol_is<DestroyWindow>(header))
+                {
+                    return false;
+                }
+
+                handler.handle(*(const DestroyWindow *)payload, message);
+                return true;
+
+            case Type::RESIZE_WINDOW:
+                if (!protocol_is<ResizeWindow>(header))
+                {
+                    return false;
+                }
+
+                handler.handle(*(const ResizeWindow *)payload, message);
+                return true;
+
+            case Type::MOVE_WINDOW:
+                if (!protocol_is<MoveWindow>(header))
+                {
+                    return false;
+                }
+
+                handler.handle(*(const MoveWindow *)payload, message);
+                return true;
+
+            case Type::FLIP_WINDOW:
+                if (!protocol_is<FlipWindow>(header))
+                {
+                    return false;
+                }
+
+                handler.handle(*(const FlipWindow *)payload, message);
+                return true;
+
+            case Type::CURSOR_WINDOW:
+                if (!protocol_is<CursorWindow>(header))
+                {
+                    return false;
+                }
+
+                handler.handle(*(const CursorWindow *)payload, message);
+                return true;
+
+            case Type::SET_RESOLUTION:
+                if (!protocol_is<SetResolution>(header))
+                {
+                    return false;
+                }
+
+                handler.handle(*(const SetResolution *)payload, message);
+                return true;
+
+            case Type::SET_WALLPAPER:
+                if (!protocol_is<SetWallpaper>(header))
+                {
+                    return false;
+                }
+
+                handler.handle(*(const SetWallpaper *)payload, message);
+                return true;
+
+            default:
+                return false;
+            }
+        });
+    }
+};
+
+} // namespace protocol
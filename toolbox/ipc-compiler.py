@@ -25,5 +25,5 @@ prot = Parser.protocol(lexer)
 # pp.pprint(prot)
 
 gen = Generator()
-Emit.protocol(gen, prot["properties"]["name"], prot)
-print(gen.finalize())
+Emit.protocol(gen, sys.argv[1], prot)
+print(gen.finalize(), end="")
@@ -1,10 +1,35 @@
 from utils import Generator
 
+# Fields of these types travel as attachments of the message, the wire only
+# says which one they are.
+ATTACHMENTS = {
+    "memory": "MESSAGE_ATTACHMENT_MEMORY",
+    "handle": "MESSAGE_ATTACHMENT_HANDLE",
+}
+
 
 def camelcase(name: str):
     return name.replace("_", " ").title().replace(" ", "")
 
 
+def is_attachment(field_type: str):
+    return field_type in ATTACHMENTS
+
+
+def wire_type(field_type: str):
+    if is_attachment(field_type):
+        return "ProtocolAttachment"
+
+    return field_type
+
+
+def argument_type(field_type: str):
+    if is_attachment(field_type):
+        return "int"
+
+    return field_type
+
+
 def struct(gen: Generator, name: str, fields):
     gen.emit("struct ", name)
     gen.emit('{')
@@ -29,182 +54,190 @@ def enumeration(gen: Generator, name: str, members):
     gen.emit('};')
 
 
+def messages_of(peer):
+    return dict(**peer["requests"], **peer["signals"])
+
+
 def message_types(gen: Generator, peer):
-    gen.emit(f"enum class {camelcase(peer['type'])}MessageType")
+    gen.emit("enum class Type : uint16_t")
     gen.emit('{')
     gen.push_ident()
 
-    for meb in dict(**peer["requests"], **peer["signals"]):
+    for meb in messages_of(peer):
         gen.emit(meb.upper(), ',')
 
     gen.pop_ident()
     gen.emit('};')
 
 
-def message_payloads(gen: Generator, peer):
-    requests_and_signals = dict(**peer["requests"], **peer["signals"])
+def message_payload(gen: Generator, name: str, arguments):
+    attachments = [a for a in arguments if is_attachment(arguments[a])]
 
-    for meb in requests_and_signals:
-        if len(requests_and_signals[meb]["arguments"]) > 0:
-            struct(gen, camelcase(peer["type"]) + camelcase(meb) + "Message",
-                   requests_and_signals[meb]["arguments"])
-            gen.emit('')
+    gen.emit("struct ", camelcase(name))
+    gen.emit('{')
+    gen.push_ident()
 
+    gen.emit(f"static constexpr Type TYPE = Type::{name.upper()};")
+    gen.emit(f"static constexpr size_t ATTACHMENTS = {len(attachments)};")
 
-def message_any_payload(peer):
-    requests_and_signals = dict(**peer["requests"], **peer["signals"])
+    if len(arguments) > 0:
+        gen.emit('')
 
-    for meb in requests_and_signals:
-        if len(requests_and_signals[meb]["arguments"]) > 0:
-            return True
+    for argument in arguments:
+        gen.emit(f"{wire_type(arguments[argument])} {argument};")
 
-    return False
+    gen.pop_ident()
+    gen.emit('};')
 
 
-def message_packet(gen: Generator, peer):
-    gen.emit(f"struct {camelcase(peer['type'])}Message")
-    gen.emit("{")
-    gen.push_ident()
+def message_proxy(gen: Generator, name: str, arguments):
+    parameters = ["ProtocolBatch *batch"]
 
-    gen.emit("uint32_t magic;")
-    gen.emit(f"{camelcase(peer['type'])}MessageType type;")
+    for argument in arguments:
+        parameters.append(f"{argument_type(arguments[argument])} {argument}")
 
-    if message_any_payload(peer):
-        gen.emit("union")
-        gen.emit("{")
-        gen.push_ident()
+    gen.emit(f"static inline void {name}({', '.join(parameters)})")
+    gen.emit('{')
+    gen.push_ident()
 
-        requests_and_signals = dict(**peer["requests"], **peer["signals"])
-        for meb in requests_and_signals:
-            if len(requests_and_signals[meb]["arguments"]) > 0:
-                gen.emit(
-                    f"{camelcase(peer['type'])}{camelcase(meb)}Message {meb};")
+    if len(arguments) == 0:
+        gen.emit(f"protocol_encode<{camelcase(name)}>(batch, MAGIC);")
+    else:
+        gen.emit(
+            f"{camelcase(name)} *message = protocol_encode<{camelcase(name)}>(batch, MAGIC);")
+        gen.emit('')
 
-        gen.pop_ident()
-        gen.emit("};")
+        for argument in arguments:
+            if is_attachment(arguments[argument]):
+                gen.emit(
+                    f"message->{argument} = protocol_batch_attach(batch, {ATTACHMENTS[arguments[argument]]}, {argument});")
+            else:
+                gen.emit(f"message->{argument} = {argument};")
 
     gen.pop_ident()
-    gen.emit("};")
+    gen.emit('}')
 
 
-def response_types(gen: Generator, peer):
-    gen.emit(f"enum class {camelcase(peer['type'])}ResponseType")
+def message_dispatch(gen: Generator, peer):
+    gen.emit("// Give each message of the batch to handler.handle(), returns false as")
+    gen.emit("// soon as one of them isn't what it should be.")
+    gen.emit("template <typename Handler>")
+    gen.emit("static inline bool dispatch(Handler &handler, Message *message)")
     gen.emit('{')
     gen.push_ident()
 
-    for meb in peer["requests"]:
-        gen.emit(meb.upper(), ',')
+    gen.emit(
+        "return protocol_decode(message, MAGIC, [&](const ProtocolHeader *header, const void *payload) {")
+    gen.push_ident()
 
+    gen.emit("switch ((Type)header->type)")
+    gen.emit('{')
+
+    for meb in messages_of(peer):
+        gen.emit(f"case Type::{meb.upper()}:")
+        gen.push_ident()
+        gen.emit(f"if (!protocol_is<{camelcase(meb)}>(header))")
+        gen.emit('{')
+        gen.push_ident()
+        gen.emit("return false;")
+        gen.pop_ident()
+        gen.emit('}')
+        gen.emit('')
+        gen.emit(
+            f"handler.handle(*(const {camelcase(meb)} *)payload, message);")
+        gen.emit("return true;")
+        gen.emit('')
+        gen.pop_ident()
+
+    gen.emit("default:")
+    gen.push_ident()
+    gen.emit("return false;")
     gen.pop_ident()
-    gen.emit('};')
 
+    gen.emit('}')
 
-def response_payload(gen: Generator, peer):
-    for meb in peer["requests"]:
-        if len(peer["requests"][meb]["response"]) > 0:
-            struct(gen, camelcase(peer["type"]) + camelcase(meb) + "Response",
-                   peer["requests"][meb]["response"])
-            gen.emit('')
+    gen.pop_ident()
+    gen.emit("});")
+
+    gen.pop_ident()
+    gen.emit('}')
 
 
-def response_any_payload(peer):
+def peer(gen: Generator, protocol, peer):
     for meb in peer["requests"]:
         if len(peer["requests"][meb]["response"]) > 0:
-            return True
+            raise Exception(f"ERROR: {meb}: responses aren't supported")
 
-    return False
-
-
-def response_packed(gen: Generator, peer):
-    gen.emit("struct Response")
-    gen.emit("{")
+    gen.emit(f"struct {camelcase(peer['name'])}")
+    gen.emit('{')
     gen.push_ident()
 
-    gen.emit("uint32_t magic;")
-    gen.emit(f"{camelcase(peer['type'])}ResponseType type;")
-
-    if response_any_payload(peer):
-        gen.emit("union")
-        gen.emit("{")
-        gen.push_ident()
-
-        requests_and_signals = peer["requests"]
-        for meb in requests_and_signals:
-            if len(peer["requests"][meb]["response"]) > 0:
-                gen.emit(camelcase(meb) + "Response", " ", meb)
-
-        gen.pop_ident()
-        gen.emit("};")
-
-    gen.pop_ident()
-    gen.emit("};")
-
+    gen.emit(
+        f"static constexpr uint32_t MAGIC = 0x{protocol['properties']['magic']};")
+    gen.emit('')
 
-def peer(gen: Generator, peer):
     message_types(gen, peer)
     gen.emit('')
 
-    message_payloads(gen, peer)
-
-    message_packet(gen, peer)
-    gen.emit('')
+    for meb, message in messages_of(peer).items():
+        message_payload(gen, meb, message["arguments"])
+        gen.emit('')
 
-    if len(peer["requests"]) > 0:
-        response_types(gen, peer)
+    for meb, message in messages_of(peer).items():
+        message_proxy(gen, meb, message["arguments"])
         gen.emit('')
 
-        response_payload(gen, peer)
+    message_dispatch(gen, peer)
 
-        response_packed(gen, peer)
-        gen.emit('')
+    gen.pop_ident()
+    gen.emit('};')
 
 
-def protocol(gen: Generator, name: str, protocol):
-    gen.emit("#pragma once")  # u mad molly ?
+def protocol(gen: Generator, path: str, protocol):
+    gen.emit("#pragma once")
 
     gen.emit("")
     gen.emit("// Don't edit this code !")
-    gen.emit("// It was generated by ipc-compiler.py")
+    gen.emit(f"// It was generated by ipc-compiler.py from {path}")
     gen.emit("")
 
+    for include in sorted(["libsystem/io/Protocol.h", *protocol["includes"]]):
+        gen.emit(f"#include <{include}>")
+
+    gen.emit("")
     gen.emit("namespace protocol")
     gen.emit("{")
+    gen.emit("")
+
+    if "file" in protocol["properties"]:
+        gen.emit(
+            f"static constexpr const char *{protocol['properties']['name'].upper()}_PATH = \"{protocol['properties']['file']}\";")
+        gen.emit("")
 
     if len(protocol["enumerations"]) > 0:
         gen.emit_section("Enumerations")
+
         for e in protocol["enumerations"]:
             enumeration(gen, e, protocol["enumerations"][e])
+            gen.emit("")
 
     if len(protocol["structures"]) > 0:
         gen.emit_section("Structures")
 
-        print(protocol["structures"])
-
         for s in protocol["structures"]:
             struct(gen, s, protocol["structures"][s])
+            gen.emit("")
 
-    gen.emit("")
-    gen.emit("class " + camelcase(protocol["properties"]["name"]))
-    gen.emit("{")
+    if len(protocol["client"]) > 0:
+        gen.emit_section("Client")
 
-    gen.push_ident()
+        peer(gen, protocol, protocol["client"])
+        gen.emit("")
 
-    gen.emit(
-        f"static constexpr int MAGIC = 0x{protocol['properties']['magic']};")
-    gen.emit("")
-
-    gen.emit_section("Client")
-
-    peer(gen, protocol["client"])
-
-    gen.emit_section("Server")
+    if len(protocol["server"]) > 0:
+        gen.emit_section("Server")
 
-    peer(gen, protocol["server"])
-
-    gen.pop_ident()
-
-    gen.emit("};")
-
-    gen.emit("")
+        peer(gen, protocol, protocol["server"])
+        gen.emit("")
 
-    gen.emit("}")
+    gen.emit("} // namespace protocol")
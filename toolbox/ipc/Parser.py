@@ -147,9 +147,17 @@ def peer(lexer: Lexer, type_: str):
     return peer
 
 
+def include(lexer: Lexer):
+    lexer.eat_whitespace()
+
+    return string(lexer)
+
+
 def protocol_field(lexer: Lexer, protocol):
     if lexer.skip_word("property"):
         protocol["properties"].update(property_(lexer))
+    elif lexer.skip_word("include"):
+        protocol["includes"].append(include(lexer))
     elif lexer.skip_word("struct"):
         protocol["structures"].update(structure(lexer))
     elif lexer.skip_word("enum"):
@@ -165,6 +173,7 @@ def protocol_field(lexer: Lexer, protocol):
 def protocol(lexer: Lexer):
     protocol = {
         "properties": {},
+        "includes": [],
         "enumerations": {},
         "structures": {},
         "client": {},